@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""
+Moss macro benchmark runner.
+
+Runs every benchmark in this directory with the given moss binary, records
+wall time, peak RSS and garbage collector statistics (from --gc-stats) into
+a JSON file and compares median times against a stored baseline.
+
+Exit code is 1 when any benchmark regressed by more than the threshold.
+
+Usage:
+    run-benchmarks.py --moss build/moss [--repetitions 5] [--warmup 1]
+                      [--baseline benchmarks/baseline.json] [--threshold 10]
+                      [--output results.json] [--update-baseline]
+                      [--filter nbody,fib]
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# name -> (source file, moss options, program arguments)
+# Program arguments in {} are names of generated input files.
+BENCHMARKS = {
+    "fib": ("fib.ms", [], []),
+    "nbody": ("nbody.ms", [], []),
+    "spectral_norm": ("spectral_norm.ms", [], []),
+    "fannkuch": ("fannkuch.ms", [], []),
+    "richards": ("richards.ms", [], []),
+    "string_building": ("string_building.ms", [], []),
+    "word_count": ("word_count.ms", [], []),
+    "object_churn": ("object_churn.ms", [], []),
+    "json_parse": ("json_parse.ms", [], ["{json}"]),
+    "csv_parse": ("csv_parse.ms", [], ["{csv}"]),
+    "md_parse": ("md_parse.ms", [], ["{md}"]),
+    "notebook_html": ("notebook.ms", ["-f", "html", "-O", "{out_html}"], []),
+}
+
+GC_STATS_RX = {
+    "collections": re.compile(r"collections:\s+(\d+)"),
+    "time_ms": re.compile(r"time \(ms\):\s+([0-9.e+-]+)"),
+    "freed_values": re.compile(r"freed values:\s+(\d+)"),
+    "peak_bytes": re.compile(r"peak bytes:\s+(\d+)"),
+}
+
+
+def generate_json(path, rng, records=40):
+    data = {"meta": {"version": 1, "generator": "moss-bench"}, "records": []}
+    for i in range(records):
+        data["records"].append({
+            "id": i,
+            "name": "user%d" % rng.randrange(100000),
+            "score": round(rng.random() * 100, 3),
+            "active": rng.random() < 0.5,
+            "tags": ["t%d" % rng.randrange(50) for _ in range(rng.randrange(1, 5))],
+            "address": {"city": "City%d" % rng.randrange(100), "zip": "%05d" % rng.randrange(100000)},
+        })
+    with open(path, "w") as f:
+        json.dump(data, f, indent=2)
+
+
+def generate_csv(path, rng, rows=250):
+    with open(path, "w") as f:
+        f.write("id,name,city,amount,note\n")
+        for i in range(rows):
+            f.write('%d,user%d,City%d,%d,"note, %d"\n' % (
+                i, rng.randrange(100000), rng.randrange(100), rng.randrange(1000), i))
+
+
+def generate_md(path, rng, sections=20):
+    with open(path, "w") as f:
+        f.write("# Generated document\n\n")
+        for i in range(sections):
+            f.write("## Section %d\n\n" % i)
+            f.write("Some **bold** text, _italic_ text and a [link](https://example.com/%d).\n\n" % i)
+            for j in range(rng.randrange(2, 5)):
+                f.write("* item %d\n" % j)
+            f.write("\n> quote %d\n\n" % rng.randrange(1000))
+            f.write("```\ncode %d\n```\n\n" % i)
+
+
+def generate_inputs(work_dir):
+    """Generates deterministic input files and returns their paths."""
+    os.makedirs(work_dir, exist_ok=True)
+    rng = random.Random(42)
+    inputs = {
+        "json": os.path.join(work_dir, "input.json"),
+        "csv": os.path.join(work_dir, "input.csv"),
+        "md": os.path.join(work_dir, "input.md"),
+        "out_html": os.path.join(work_dir, "notebook.html"),
+    }
+    generate_json(inputs["json"], rng)
+    generate_csv(inputs["csv"], rng)
+    generate_md(inputs["md"], rng)
+    return inputs
+
+
+def run_once(cmd):
+    """Runs cmd and returns (wall seconds, peak RSS in KB or None, stderr)."""
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, cwd=BENCH_DIR)
+    if hasattr(os, "wait4"):
+        # Read stderr before waiting so that the child does not block on a full pipe
+        err = proc.stderr.read()
+        _, status, rusage = os.wait4(proc.pid, 0)
+        wall = time.perf_counter() - start
+        proc.returncode = os.waitstatus_to_exitcode(status) if hasattr(os, "waitstatus_to_exitcode") else status
+        rss = rusage.ru_maxrss
+        if sys.platform == "darwin":
+            rss //= 1024
+    else:
+        _, err = proc.communicate()
+        wall = time.perf_counter() - start
+        rss = None
+    err = err.decode("utf-8", errors="replace")
+    if proc.returncode != 0:
+        raise RuntimeError("'%s' failed with exit code %d:\n%s" % (" ".join(cmd), proc.returncode, err))
+    return wall, rss, err
+
+
+def parse_gc_stats(err):
+    stats = {}
+    for key, rx in GC_STATS_RX.items():
+        m = rx.search(err)
+        if m:
+            stats[key] = float(m.group(1)) if key == "time_ms" else int(m.group(1))
+    return stats
+
+
+def run_benchmark(moss, name, inputs, warmup, repetitions):
+    src, opts, prog_args = BENCHMARKS[name]
+    cmd = [moss, "--gc-stats"] + [o.format(**inputs) for o in opts] + [src] + [a.format(**inputs) for a in prog_args]
+    for _ in range(warmup):
+        run_once(cmd)
+    times = []
+    rss = []
+    gc = {}
+    for _ in range(repetitions):
+        wall, peak, err = run_once(cmd)
+        times.append(wall)
+        if peak is not None:
+            rss.append(peak)
+        gc = parse_gc_stats(err)
+    return {
+        "wall_s": times,
+        "median_s": statistics.median(times),
+        "min_s": min(times),
+        "peak_rss_kb": max(rss) if rss else None,
+        "gc": gc,
+    }
+
+
+def compare(results, baseline, threshold):
+    """Prints comparison with baseline and returns names of regressed benchmarks."""
+    regressed = []
+    print("\n%-16s %10s %10s %8s" % ("benchmark", "base (s)", "now (s)", "change"))
+    for name, res in results.items():
+        base = baseline.get("benchmarks", {}).get(name)
+        if base is None:
+            print("%-16s %10s %10.3f %8s" % (name, "-", res["median_s"], "new"))
+            continue
+        change = 100.0 * (res["median_s"] - base["median_s"]) / base["median_s"]
+        mark = ""
+        if change > threshold:
+            mark = "  REGRESSION"
+            regressed.append(name)
+        print("%-16s %10.3f %10.3f %+7.1f%%%s" % (name, base["median_s"], res["median_s"], change, mark))
+    return regressed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Moss macro benchmarks")
+    parser.add_argument("--moss", required=True, help="Path to moss binary")
+    parser.add_argument("--warmup", type=int, default=1, help="Runs before measuring")
+    parser.add_argument("--repetitions", type=int, default=5, help="Measured runs")
+    parser.add_argument("--baseline", default=os.path.join(BENCH_DIR, "baseline.json"), help="Baseline JSON file")
+    parser.add_argument("--threshold", type=float, default=10.0, help="Allowed slowdown in percent")
+    parser.add_argument("--output", default="moss-bench-results.json", help="Output JSON file")
+    parser.add_argument("--work-dir", default="moss-bench-inputs", help="Directory for generated inputs")
+    parser.add_argument("--update-baseline", action="store_true", help="Stores results as the new baseline")
+    parser.add_argument("--filter", default="", help="Comma separated benchmark names to run")
+    args = parser.parse_args()
+
+    moss = os.path.abspath(args.moss)
+    names = [n for n in BENCHMARKS if not args.filter or n in args.filter.split(",")]
+    inputs = generate_inputs(os.path.abspath(args.work_dir))
+
+    results = {}
+    for name in names:
+        print("Running %s..." % name, flush=True)
+        results[name] = run_benchmark(moss, name, inputs, args.warmup, args.repetitions)
+        r = results[name]
+        print("  median %.3f s, min %.3f s, peak RSS %s KB, GC %s" % (
+            r["median_s"], r["min_s"], r["peak_rss_kb"], r["gc"]), flush=True)
+
+    output = {
+        "moss": moss,
+        "warmup": args.warmup,
+        "repetitions": args.repetitions,
+        "benchmarks": results,
+    }
+    with open(args.output, "w") as f:
+        json.dump(output, f, indent=2)
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(output, f, indent=2)
+        print("Baseline written to %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("No baseline found at %s (use --update-baseline to create it)" % args.baseline)
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    regressed = compare(results, baseline, args.threshold)
+    if regressed:
+        print("\nRegressed by more than %.1f%%: %s" % (args.threshold, ", ".join(regressed)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,18 +1,66 @@
 #include "bytecode.hpp"
+#include "bytecode_reader.hpp"
 #include "clopts.hpp"
+#include <algorithm>
 
 using namespace moss;
 using namespace opcode;
 
+Bytecode::Bytecode() : header(nullptr) {}
+
 Bytecode::~Bytecode() {
     if (header)
         delete header;
     for (auto *op: code) {
+        if (!op)
+            continue;
+        // Quickened opcodes are deleted bellow, generic ones have to be
+        // deleted here
+        if (is_quickened(op))
+            op = dynamic_cast<QuickenedOpCode *>(op)->get_generic();
+        delete op;
+    }
+    for (auto *op: quickened) {
         delete op;
     }
 }
 
+void Bytecode::set_lazy_reader(std::unique_ptr<BytecodeReader> reader) {
+    lazy_reader = std::move(reader);
+}
+
+OpCode *Bytecode::read_lazy(Address addr) {
+    assert(lazy_reader && "Missing opcode without lazy reader");
+    lazy_reader->read_lazy(this, addr);
+    // Mapped file is no longer needed once everything is decoded
+    if (lazy_reader->is_done())
+        lazy_reader.reset();
+    return code[addr];
+}
+
+void Bytecode::read_all() {
+    if (!lazy_reader)
+        return;
+    lazy_reader->read_all(this);
+    lazy_reader.reset();
+}
+
+void Bytecode::quicken(opcode::Address bci, opcode::OpCode *quickened_op) {
+    assert(bci < code.size() && "Quickening bci out of bounds");
+    assert(is_quickened(quickened_op) && "Opcode is not quickened");
+    quickened.push_back(quickened_op);
+    code[bci] = quickened_op;
+}
+
+void Bytecode::dequicken(opcode::Address bci, opcode::OpCode *generic) {
+    assert(bci < code.size() && "De-quickening bci out of bounds");
+    assert(is_quickened(code[bci]) && "De-quickening generic opcode");
+    assert(dynamic_cast<QuickenedOpCode *>(code[bci])->get_generic() == generic && "Incorrect generic opcode");
+    code[bci] = generic;
+}
+
 std::ostream& Bytecode::debug(std::ostream& os, std::optional<Address> start, std::optional<Address> end) {
+    read_all();
     Address begin = start.value_or(0);
     Address finish = end.value_or(code.size());
 
@@ -32,7 +80,28 @@ std::ostream& Bytecode::debug(std::ostream& os, std::optional<Address> start, st
     return os;
 }
 
+void Bytecode::update_switch_addrs(Address update_bci, Address add_amount) {
+    for (size_t i = 0; i < code.size(); ++i) {
+        auto sw = dyn_cast<Switch>(code[i]);
+        if (!sw)
+            continue;
+        if (sw->default_addr >= update_bci)
+            sw->default_addr += add_amount;
+        // Addresses are pushed as STORE_INT_CONST and LIST_PUSH_CONST pairs
+        for (size_t j = i; j >= 2; j -= 2) {
+            auto push = dyn_cast<ListPushConst>(code[j-1]);
+            auto addr = dyn_cast<StoreIntConst>(code[j-2]);
+            if (!push || !addr || push->dst != sw->addrs || push->csrc != addr->dst)
+                break;
+            auto target = static_cast<Address>(addr->val);
+            if (target >= update_bci)
+                addr->val = static_cast<Address>(target + add_amount);
+        }
+    }
+}
+
 void Bytecode::insert(opcode::OpCode *op, opcode::Address bci) {
+    read_all();
     assert(bci <= code.size() && "Inserting way after last BC");
     if (bci == code.size()) {
         push_back(op);
@@ -41,10 +110,52 @@ void Bytecode::insert(opcode::OpCode *op, opcode::Address bci) {
     for (auto i: code) {
         i->update_addrs(bci, 1);
     }
+    update_switch_addrs(bci, 1);
     code.insert(code.begin() + bci, op);
+    for (auto &e: lines) {
+        if (e.bci > bci)
+            ++e.bci;
+    }
+    for (auto &e: inlined) {
+        if (e.start > bci)
+            ++e.start;
+        if (e.end > bci)
+            ++e.end;
+    }
+}
+
+void Bytecode::insert(const std::vector<opcode::OpCode *> &ops, opcode::Address bci, size_t landing) {
+    read_all();
+    assert(bci <= code.size() && "Inserting way after last BC");
+    assert(landing <= ops.size() && "Landing out of inserted opcodes");
+    if (ops.empty())
+        return;
+    if (bci == code.size()) {
+        for (auto op: ops)
+            push_back(op);
+        return;
+    }
+    for (auto i: code) {
+        i->update_addrs(bci, landing);
+        i->update_addrs(bci + landing + 1, ops.size() - landing);
+    }
+    update_switch_addrs(bci, landing);
+    update_switch_addrs(bci + landing + 1, ops.size() - landing);
+    code.insert(code.begin() + bci, ops.begin(), ops.end());
+    for (auto &e: lines) {
+        if (e.bci > bci)
+            e.bci += ops.size();
+    }
+    for (auto &e: inlined) {
+        if (e.start > bci)
+            e.start += ops.size();
+        if (e.end > bci)
+            e.end += ops.size();
+    }
 }
 
 void Bytecode::erase(Address bci) {
+    read_all();
     assert(bci < code.size() && "Deleting bci out of bounds");
     OpCode *op = code[bci];
     // No need to optimize for popping last, since it is END and there is no
@@ -53,6 +164,63 @@ void Bytecode::erase(Address bci) {
     for (auto i: code) {
         i->update_addrs(bci, -1);
     }
+    update_switch_addrs(bci, -1);
+    for (auto &e: lines) {
+        if (e.bci > bci)
+            --e.bci;
+    }
+    for (auto &e: inlined) {
+        if (e.start > bci)
+            --e.start;
+        if (e.end > bci)
+            --e.end;
+    }
+    inlined.erase(std::remove_if(inlined.begin(), inlined.end(), [](const InlinedEntry &e) {
+        return e.start == e.end;
+    }), inlined.end());
+    // Run which contained only the erased opcode is now empty
+    auto empty = std::adjacent_find(lines.begin(), lines.end(), [](const LineEntry &a, const LineEntry &b) {
+        return a.bci == b.bci;
+    });
+    if (empty != lines.end()) {
+        auto next = lines.erase(empty);
+        // Runs around the erased one might now be of the same line
+        if (next != lines.begin() && next != lines.end() && std::prev(next)->line == next->line)
+            lines.erase(next);
+    }
     assert(op && "Sanity check");
     delete op;
-}
\ No newline at end of file
+}
+
+void Bytecode::set_line(unsigned line) {
+    if (!lines.empty()) {
+        if (lines.back().line == line)
+            return;
+        // Nothing was pushed for the previous line
+        if (lines.back().bci == code.size()) {
+            lines.pop_back();
+            if (!lines.empty() && lines.back().line == line)
+                return;
+        }
+    }
+    lines.push_back(LineEntry{static_cast<Address>(code.size()), line});
+}
+
+unsigned Bytecode::get_line(Address bci) {
+    auto it = std::upper_bound(lines.begin(), lines.end(), bci, [](Address b, const LineEntry &e) {
+        return b < e.bci;
+    });
+    if (it == lines.begin())
+        return 0;
+    return std::prev(it)->line;
+}
+
+std::vector<ustring> Bytecode::get_inlined_at(Address bci) {
+    // Nested calls are emitted before the outer ones
+    std::vector<ustring> sigs;
+    for (auto &e: inlined) {
+        if (e.start <= bci && bci < e.end)
+            sigs.push_back(e.signature);
+    }
+    return sigs;
+}
@@ -16,6 +16,7 @@
 #include <vector>
 #include <map>
 #include <optional>
+#include <memory>
 
 namespace moss {
 
@@ -24,6 +25,21 @@ namespace opcode {
     class BCBlob;
 }
 
+class BytecodeReader;
+
+/// Start of a run of opcodes generated from the same source line
+struct LineEntry {
+    opcode::Address bci; ///< First bci of the run
+    unsigned line;       ///< Source line (starting at 1), 0 if unknown
+};
+
+/// Run of opcodes generated from a body of an inlined function call
+struct InlinedEntry {
+    opcode::Address start; ///< First bci of the body
+    opcode::Address end;   ///< Bci after the body
+    ustring signature;     ///< Inlined function as shown in stack trace
+};
+
 /// \brief Class holding bytecode program
 /// It consists of a vector of opcodes and API to work with it. 
 class Bytecode {
@@ -31,12 +47,23 @@ private:
     friend class opcode::BCBlob;
 private:
     std::vector<opcode::OpCode *> code;
+    std::vector<opcode::OpCode *> quickened; ///< Owned quickened opcodes
+    std::vector<LineEntry> lines; ///< Bci to source line table sorted by bci
+    std::vector<InlinedEntry> inlined; ///< Inlined calls, nested ones before the outer
     bc_header::BytecodeHeader *header;
+    /// Reader of function bodies which were not decoded yet (their opcodes
+    /// are nullptr in code)
+    std::unique_ptr<BytecodeReader> lazy_reader;
+
+    opcode::OpCode *read_lazy(opcode::Address addr);
+    /// Switch's case addresses are int constants pushed into a list right
+    /// before it, so update_addrs of the opcodes does not change them
+    void update_switch_addrs(opcode::Address update_bci, opcode::Address add_amount);
 #ifndef NDEBUG
     std::map<unsigned, ustring> comments;
 #endif
 public:
-    Bytecode() : header(nullptr) {}
+    Bytecode();
     ~Bytecode();
 
     std::ostream& debug(std::ostream& os, std::optional<opcode::Address> start=std::nullopt, std::optional<opcode::Address> end=std::nullopt);
@@ -47,26 +74,81 @@ public:
     }
 
     void insert(opcode::OpCode *op, opcode::Address bci);
+    /// Inserts ops before bci, jumps to bci lead to ops[landing] or to the
+    /// opcode at bci if landing is ops.size()
+    void insert(const std::vector<opcode::OpCode *> &ops, opcode::Address bci, size_t landing);
 
     void erase(opcode::Address bci);
 
     bool empty() { return code.empty(); }
 
+    /// \brief Replaces opcode at bci with its quickened version.
+    /// Generic opcode is kept alive as the quickened one might put it back.
+    /// Bytecode takes ownership of the quickened opcode.
+    void quicken(opcode::Address bci, opcode::OpCode *quickened_op);
+
+    /// Puts generic opcode back at bci in place of its quickened version
+    void dequicken(opcode::Address bci, opcode::OpCode *generic);
+
 #ifndef NDEBUG
     /// Adds a new comment at the current bytecode index.
     /// These comments are visible when outputting BC with --annotate-bc
     void push_comment(ustring comm) { comments[code.size()] = comm; }
 #endif
 
+    /// \brief Sets source line for all the opcodes pushed from now on.
+    /// \param line Source line starting at 1 (0 for unknown)
+    void set_line(unsigned line);
+
+    /// \return Line that will be used for the next pushed opcode
+    unsigned get_current_line() { return lines.empty() ? 0 : lines.back().line; }
+
+    /// \return Source line of opcode at bci or 0 if it is not known
+    unsigned get_line(opcode::Address bci);
+
+    /// \brief Appends a line table entry (used by bytecode reader)
+    void push_line_entry(LineEntry e) { lines.push_back(e); }
+
+    std::vector<LineEntry> &get_lines() { return this->lines; }
+
+    /// \brief Appends an inlined call's body (empty ones are skipped)
+    void push_inlined(InlinedEntry e) {
+        if (e.start < e.end)
+            inlined.push_back(e);
+    }
+
+    std::vector<InlinedEntry> &get_inlined() { return this->inlined; }
+
+    /// \return Signatures of inlined functions whose body contains bci, the
+    ///         innermost first
+    std::vector<ustring> get_inlined_at(opcode::Address bci);
+
     /// How many opcodes are in this bytecode program
     size_t size() { return code.size(); }
 
     inline opcode::OpCode *operator[](opcode::Address addr) {
         assert(addr < code.size() && "Out of bounds bci access");
-        return code[addr];
+        auto op = code[addr];
+        if (!op)
+            return read_lazy(addr);
+        return op;
+    }
+
+    /// \return All opcodes, any not yet decoded function bodies are decoded
+    std::vector<opcode::OpCode *> &get_code() {
+        if (lazy_reader)
+            read_all();
+        return this->code;
     }
 
-    std::vector<opcode::OpCode *> &get_code() { return this->code; }
+    /// \return Opcodes including nullptr in place of not yet decoded ones
+    std::vector<opcode::OpCode *> &get_raw_code() { return this->code; }
+
+    /// Sets reader which decodes function bodies on their first access
+    void set_lazy_reader(std::unique_ptr<BytecodeReader> reader);
+
+    /// Decodes all not yet decoded function bodies
+    void read_all();
 
     void set_header(bc_header::BytecodeHeader *header) {
         this->header = header;
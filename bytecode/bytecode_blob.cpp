@@ -53,6 +53,6 @@ BCBlob *BCBlob::parse_bc_impl(Bytecode &bc, Address start, Address end, BlobType
     return rb;
 }
 
-BCBlob *BCBlob::parse_bc(Bytecode &bc) {
-    return parse_bc_impl(bc, 0, bc.size(), BlobType::BC_BLOB, true);
+BCBlob *BCBlob::parse_bc(Bytecode &bc, Address start) {
+    return parse_bc_impl(bc, start, bc.size(), BlobType::BC_BLOB, true);
 }
\ No newline at end of file
@@ -62,7 +62,9 @@ private:
     static BCBlob *parse_bc_impl(Bytecode &bc, Address start, Address end, BlobType type, bool is_glob=false);
 
 public:
-    static BCBlob *parse_bc(Bytecode &bc);
+    /// Parses bytecode from address start (the rest of the module when it is
+    /// compiled in chunks) into blobs
+    static BCBlob *parse_bc(Bytecode &bc, Address start=0);
 
     auto begin() {
         return bc.code.begin() + start_;
@@ -89,6 +91,10 @@ public:
         return end_ - start_;
     }
 
+    Address get_start() const { return start_; }
+    Address get_end() const { return end_; }
+    Bytecode &get_bc() { return bc; }
+
     OpCode* front() const { return bc.code[start_]; }
     OpCode* back()  const { return bc.code[end_-1]; }
 
@@ -11,6 +11,7 @@
 #define _BYTECODE_HEADER_HPP_
 
 #include "moss.hpp"
+#include "commons.hpp"
 #include <cstdint>
 #include <ctime>
 
@@ -28,7 +29,76 @@ namespace bc_header {
 
 /// Version of bytecode generated by this version of interpreter.
 /// Any changes in bytecode should reflect in incrementing this version.
-constexpr std::uint32_t BYTECODE_VERSION = 2;
+constexpr std::uint32_t BYTECODE_VERSION = 6;
+
+/// Oldest bytecode version which can still be read.
+/// Version 2 differs only in missing the line table and version 3 in missing
+/// the function table and sections offset. Versions before 5 use fixed size
+/// operands, inline strings and sections after the opcodes. Version 5 only
+/// lacks the TAIL_CALL opcode.
+constexpr std::uint32_t BYTECODE_MIN_VERSION = 2;
+
+/// Value in place of an opcode which starts the line table section.
+/// Line table follows after all opcodes and is in the format of:
+///
+/// 4B                 | amount of entries
+/// (BC_ADDR_SIZE + 4B) | first bci of a run and its source line (per entry)
+///
+constexpr opcode::opcode_t LINE_TABLE_SECTION = 0xFF;
+
+/// Value in place of an opcode which starts the function table section.
+/// Function table follows the line table and lists function bodies, so that
+/// the reader can skip them and decode them only once they are called:
+///
+/// 4B                 | amount of entries
+/// (2*BC_ADDR_SIZE + 8B) | first bci of a body, bci after the body and their
+///                    | byte offsets in the file (4B each) (per entry)
+///
+/// Entries are sorted by the first bci of the body.
+constexpr opcode::opcode_t FUN_TABLE_SECTION = 0xFE;
+
+/// Size of the offset of the first section which is the last thing in the
+/// file (since bytecode version 4)
+constexpr std::size_t SECTIONS_OFFSET_SIZE = 4;
+
+/// First bytecode version with function table and sections offset
+constexpr std::uint32_t FUN_TABLE_MIN_VERSION = 4;
+
+/// First bytecode version with section directory, string table and
+/// variable length operands.
+///
+/// Since this version the header is followed by the section directory:
+///
+/// 1B                 | amount of sections
+/// (1B + 4B + 4B)     | section kind, its offset in the file and size (per section)
+///
+/// Registers, addresses, string ids and all counts and offsets in sections
+/// are encoded as unsigned LEB128 and integer constants as zigzag LEB128.
+/// Float and bool constants keep their fixed size.
+/// Sections which the reader does not know are skipped.
+constexpr std::uint32_t COMPACT_MIN_VERSION = 5;
+
+/// Size of a single entry in the section directory
+constexpr std::size_t SECTION_ENTRY_SIZE = 9;
+
+/// Kinds of sections in the section directory
+enum class Section : std::uint8_t {
+    /// Deduplicated string constants, opcodes refer to them by their index:
+    /// amount of strings followed by length and bytes of each string
+    STRINGS = 1,
+    /// Opcodes
+    CODE = 2,
+    /// Line table, amount of entries followed by bci difference from the
+    /// previous entry and source line (per entry)
+    LINES = 3,
+    /// Function table, amount of entries followed by first bci of a body,
+    /// bci after the body and their byte offsets in the code section
+    FUNCTIONS = 4,
+    /// Inlined calls (optional, used only for stack trace), amount of entries
+    /// followed by first bci of the inlined body, bci after it and string id
+    /// of the inlined function's signature (per entry)
+    INLINED = 5,
+};
 
 /// Bytecode header consists of:
 /// 
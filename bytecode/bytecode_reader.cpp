@@ -3,126 +3,1142 @@
 #include "bytecode.hpp"
 #include "opcode.hpp"
 #include "logging.hpp"
-#include "errors.hpp"
+#include "utils.hpp"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 
 using namespace moss;
 using namespace moss::opcode;
 
-void BytecodeReader::read_raw(char* data, std::size_t size) {
-    this->stream->read(data, size);
+void BytecodeReader::fail(const char *msg) {
+    if (file) {
+        error::error(error::ErrorCode::BYTECODE, msg, file, true);
+    } else {
+        // Lazy reader might outlive the file
+        ustring msg_with_file = file_name + ": " + msg;
+        error::error(error::ErrorCode::BYTECODE, msg_with_file.c_str(), nullptr, true);
+    }
+    std::abort();
+}
 
-    if (static_cast<size_t>(this->stream->gcount()) == size) {
-        for (size_t i = 0; i < size; ++i) {
-            crc_checksum ^= static_cast<unsigned char>(data[i]);
-            for (int j = 0; j < 8; ++j)
-                crc_checksum = (crc_checksum >> 1) ^ (0xEDB88320 & -(crc_checksum & 1));
-        }
+void BytecodeReader::read_raw(char* data, std::size_t size) {
+    if (static_cast<size_t>(end - pos) < size) {
+        fail("Moss bytecode is truncated");
     }
+    std::memcpy(data, pos, size);
+    pos += size;
+}
 
-    if (!this->stream && !this->stream->eof()) {
-        error::error(error::ErrorCode::BYTECODE, "Error reading bytecode", &this->file, true);
+std::uint64_t BytecodeReader::read_uint() {
+    std::uint64_t v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= end) {
+            fail("Moss bytecode is truncated");
+        }
+        auto byte = static_cast<std::uint8_t>(*pos++);
+        v |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return v;
     }
+    fail("Moss bytecode contains invalid number encoding");
 }
 
 Register BytecodeReader::read_register() {
-    char buffer[BC_REGISTER_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_REGISTER_SIZE);
+    if (compact)
+        return static_cast<Register>(read_uint());
     Register reg;
-    std::memcpy(&reg, buffer, sizeof(reg));
+    read_raw(reinterpret_cast<char *>(&reg), BC_REGISTER_SIZE);
     return reg;
 }
 
 StringConst BytecodeReader::read_string() {
-    char buffer[BC_STR_LEN_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_STR_LEN_SIZE);
+    if (compact) {
+        auto index = read_uint();
+        if (index >= strings.size()) {
+            fail("Moss bytecode string index is out of bounds");
+        }
+        return StringConst(strings[index]);
+    }
     strlen_t str_len;
-    std::memcpy(&str_len, buffer, sizeof(str_len));
-
-    if (str_len > buffer_size) {
-        // Change buffer to size of nearest higher multiple of 64
-        buffer_size = ((str_len - 1) | 63) + 1;
-        this->str_buffer = (char *)std::realloc(str_buffer, buffer_size);
+    read_raw(reinterpret_cast<char *>(&str_len), BC_STR_LEN_SIZE);
+    if (static_cast<size_t>(end - pos) < str_len) {
+        fail("Moss bytecode is truncated");
     }
-
-    read_raw(str_buffer, str_len);
-    return StringConst(str_buffer, str_len);
+    StringConst str(pos, str_len);
+    pos += str_len;
+    return str;
 }
 
 IntConst BytecodeReader::read_const_int() {
-    char buffer[BC_INT_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_INT_SIZE);
+    if (compact) {
+        auto u = read_uint();
+        return static_cast<IntConst>((u >> 1) ^ (~(u & 1) + 1));
+    }
     IntConst c;
-    std::memcpy(&c, buffer, sizeof(c));
+    read_raw(reinterpret_cast<char *>(&c), BC_INT_SIZE);
     return c;
 }
 
 FloatConst BytecodeReader::read_const_float() {
-    char buffer[BC_FLOAT_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_FLOAT_SIZE);
     FloatConst c;
-    std::memcpy(&c, buffer, sizeof(c));
+    read_raw(reinterpret_cast<char *>(&c), BC_FLOAT_SIZE);
     return c;
 }
 
 BoolConst BytecodeReader::read_const_bool() {
-    char buffer[BC_BOOL_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_BOOL_SIZE);
     BoolConst c;
-    std::memcpy(&c, buffer, sizeof(c));
+    read_raw(reinterpret_cast<char *>(&c), BC_BOOL_SIZE);
     return c;
 }
 
 Address BytecodeReader::read_address() {
-    char buffer[BC_ADDR_SIZE];
-    char *buffer_ptr = &buffer[0];
-    read_raw(buffer_ptr, BC_ADDR_SIZE);
+    if (compact)
+        return static_cast<Address>(read_uint());
     Address addr;
-    std::memcpy(&addr, buffer, sizeof(addr));
+    read_raw(reinterpret_cast<char *>(&addr), BC_ADDR_SIZE);
     return addr;
 }
 
+std::uint32_t BytecodeReader::read_uint32() {
+    std::uint32_t v;
+    read_raw(reinterpret_cast<char *>(&v), sizeof(v));
+    return v;
+}
+
 bc_header::BytecodeHeader BytecodeReader::read_header() {
     bc_header::BytecodeHeader header{};
-    this->stream->read(reinterpret_cast<char*>(&header), sizeof(header));
 
     // Check read success (size).
-    if (this->stream->gcount() != sizeof(header)) {
+    if (contents->size() < sizeof(header)) {
         std::string msg = "Invalid moss bytecode file — file size cannot fit header";
-        error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
+        fail(msg.c_str());
     }
+    std::memcpy(&header, contents->data(), sizeof(header));
 
     // Validate ID.
     constexpr std::uint32_t EXPECTED_ID = 0xFF00002A;
     if (header.id != EXPECTED_ID) {
         std::string msg = "Invalid moss bytecode file — moss ID not matched";
-        error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
+        fail(msg.c_str());
     }
 
     // Check BC version compatibility.
-    if (header.bc_version != bc_header::BYTECODE_VERSION) {
+    if (header.bc_version > bc_header::BYTECODE_VERSION || header.bc_version < bc_header::BYTECODE_MIN_VERSION) {
         std::string msg = "Incompatible moss bytecode version — interpreter uses version " +
             std::to_string(bc_header::BYTECODE_VERSION) + ", but file uses version " +
             std::to_string(header.bc_version);
-        error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
+        fail(msg.c_str());
     }
 
     // Check Moss version and warn if bc was compiled with newer version.
     if (header.moss_version > MOSS_VERSION_UINT32) {
         auto version_string = header.get_version_string();
-        error::warning(diags::Diagnostic(true, file, diags::WarningID::MSB_COMPILED_WITH_NEWER_VER, version_string.c_str()));
+        error::warning(diags::Diagnostic(true, *file, diags::WarningID::MSB_COMPILED_WITH_NEWER_VER, version_string.c_str()));
+    }
+
+    // Checksum covers everything after the header
+    std::uint32_t computed = ~utils::crc32_update(0xFFFFFFFF, contents->data() + sizeof(header), contents->size() - sizeof(header));
+    if (computed != header.checksum) {
+        std::string msg = "Moss bytecode checksum mismatch (corrupted file)";
+        fail(msg.c_str());
     }
 
     return header;
 }
 
+void BytecodeReader::read_line_table(Bytecode *bc) {
+    std::uint32_t amount = read_uint32();
+    if (static_cast<size_t>(end - pos) / (BC_ADDR_SIZE + sizeof(std::uint32_t)) < amount) {
+        fail("Moss bytecode line table is truncated");
+    }
+    for (std::uint32_t i = 0; i < amount; ++i) {
+        auto bci = read_address();
+        std::uint32_t line = read_uint32();
+        bc->push_line_entry(LineEntry{bci, line});
+    }
+}
+
+void BytecodeReader::read_fun_table() {
+    std::uint32_t amount = read_uint32();
+    if (static_cast<size_t>(end - pos) / (2 * BC_ADDR_SIZE + 2 * sizeof(std::uint32_t)) < amount) {
+        fail("Moss bytecode function table is truncated");
+    }
+    bodies.reserve(amount);
+    for (std::uint32_t i = 0; i < amount; ++i) {
+        FunBody body;
+        body.start = read_address();
+        body.end = read_address();
+        body.start_offset = read_uint32();
+        body.end_offset = read_uint32();
+        if (body.start > body.end || body.start_offset > body.end_offset
+                || (!bodies.empty() && bodies.back().start >= body.start)) {
+            fail("Moss bytecode function table is malformed");
+        }
+        bodies.push_back(body);
+    }
+    decoded_bodies.assign(bodies.size(), false);
+    undecoded_bodies = bodies.size();
+}
+
+void BytecodeReader::read_string_table() {
+    auto amount = read_uint();
+    if (static_cast<size_t>(end - pos) < amount) {
+        fail("Moss bytecode string table is truncated");
+    }
+    strings.reserve(amount);
+    for (std::uint64_t i = 0; i < amount; ++i) {
+        auto size = read_uint();
+        if (static_cast<size_t>(end - pos) < size) {
+            fail("Moss bytecode string table is truncated");
+        }
+        strings.emplace_back(pos, size);
+        pos += size;
+    }
+}
+
+void BytecodeReader::read_compact_line_table(Bytecode *bc) {
+    auto amount = read_uint();
+    if (static_cast<size_t>(end - pos) / 2 < amount) {
+        fail("Moss bytecode line table is truncated");
+    }
+    Address bci = 0;
+    for (std::uint64_t i = 0; i < amount; ++i) {
+        bci += read_address();
+        auto line = static_cast<std::uint32_t>(read_uint());
+        bc->push_line_entry(LineEntry{bci, line});
+    }
+}
+
+void BytecodeReader::read_inlined_table(Bytecode *bc) {
+    auto amount = read_uint();
+    if (static_cast<size_t>(end - pos) / 3 < amount) {
+        fail("Moss bytecode inlined calls table is truncated");
+    }
+    for (std::uint64_t i = 0; i < amount; ++i) {
+        auto start = read_address();
+        auto body_end = read_address();
+        auto signature = read_string();
+        bc->push_inlined(InlinedEntry{start, body_end, signature});
+    }
+}
+
+void BytecodeReader::read_compact_fun_table(size_t code_offset) {
+    auto amount = read_uint();
+    if (static_cast<size_t>(end - pos) / 4 < amount) {
+        fail("Moss bytecode function table is truncated");
+    }
+    bodies.reserve(amount);
+    for (std::uint64_t i = 0; i < amount; ++i) {
+        FunBody body;
+        body.start = read_address();
+        body.end = read_address();
+        // Offsets are relative to the code section
+        body.start_offset = static_cast<std::uint32_t>(code_offset + read_uint());
+        body.end_offset = static_cast<std::uint32_t>(code_offset + read_uint());
+        if (body.start > body.end || body.start_offset > body.end_offset
+                || (!bodies.empty() && bodies.back().start >= body.start)) {
+            fail("Moss bytecode function table is malformed");
+        }
+        bodies.push_back(body);
+    }
+    decoded_bodies.assign(bodies.size(), false);
+    undecoded_bodies = bodies.size();
+}
+
+void BytecodeReader::read_sections(Bytecode *bc, size_t &code_offset, size_t &code_end) {
+    struct SectionEntry {
+        std::uint8_t kind;
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    pos = contents->data() + BCH_SIZE;
+    end = contents->data() + contents->size();
+    std::uint8_t amount;
+    read_raw(reinterpret_cast<char *>(&amount), sizeof(amount));
+    if (static_cast<size_t>(end - pos) / bc_header::SECTION_ENTRY_SIZE < amount) {
+        fail("Moss bytecode section directory is truncated");
+    }
+    std::vector<SectionEntry> sections;
+    for (std::uint8_t i = 0; i < amount; ++i) {
+        SectionEntry entry;
+        read_raw(reinterpret_cast<char *>(&entry.kind), sizeof(entry.kind));
+        entry.offset = read_uint32();
+        entry.size = read_uint32();
+        if (entry.offset > contents->size() || entry.size > contents->size() - entry.offset) {
+            fail("Moss bytecode section is out of bounds");
+        }
+        sections.push_back(entry);
+    }
+
+    auto find_section = [&sections](bc_header::Section kind) -> const SectionEntry * {
+        for (auto &s: sections) {
+            if (s.kind == static_cast<std::uint8_t>(kind))
+                return &s;
+        }
+        return nullptr;
+    };
+    auto set_section = [this](const SectionEntry *s) {
+        pos = contents->data() + s->offset;
+        end = pos + s->size;
+    };
+
+    // String table has to be read before the code referring to it
+    auto strings_section = find_section(bc_header::Section::STRINGS);
+    auto code_section = find_section(bc_header::Section::CODE);
+    if (!strings_section || !code_section) {
+        fail("Moss bytecode is missing a required section");
+    }
+    set_section(strings_section);
+    read_string_table();
+    if (auto lines_section = find_section(bc_header::Section::LINES)) {
+        set_section(lines_section);
+        read_compact_line_table(bc);
+    }
+    if (auto functions_section = find_section(bc_header::Section::FUNCTIONS)) {
+        set_section(functions_section);
+        read_compact_fun_table(code_section->offset);
+    }
+    if (auto inlined_section = find_section(bc_header::Section::INLINED)) {
+        set_section(inlined_section);
+        read_inlined_table(bc);
+    }
+    code_offset = code_section->offset;
+    code_end = code_offset + code_section->size;
+}
+
+OpCode *BytecodeReader::read_opcode(opcode_t opcode) {
+    OpCode *op = nullptr;
+    switch (opcode) {
+        case opcode::OpCodes::END: {
+            op = new End();
+        } break;
+        case opcode::OpCodes::LOAD: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new Load(reg, str);
+        } break;
+        case opcode::OpCodes::LOAD_ATTR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto str = read_string();
+            op = new LoadAttr(reg1, reg2, str);
+        } break;
+        case opcode::OpCodes::LOAD_GLOBAL: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new LoadGlobal(reg, str);
+        } break;
+        case opcode::OpCodes::LOAD_NONLOC: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new LoadNonLoc(reg, str);
+        } break;
+        case opcode::OpCodes::STORE: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new Store(reg1, reg2);
+        } break;
+        case opcode::OpCodes::STORE_NAME: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new StoreName(reg, str);
+        } break;
+        case opcode::OpCodes::STORE_CONST: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new StoreConst(reg1, reg2);
+        } break;
+        case opcode::OpCodes::STORE_ATTR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto str = read_string();
+            op = new StoreAttr(reg1, reg2, str);
+        } break;
+        case opcode::OpCodes::STORE_CONST_ATTR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto str = read_string();
+            op = new StoreConstAttr(reg1, reg2, str);
+        } break;
+        case opcode::OpCodes::STORE_GLOBAL: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new StoreGlobal(reg, str);
+        } break;
+        case opcode::OpCodes::STORE_NONLOC: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new StoreNonLoc(reg, str);
+        } break;
+        case opcode::OpCodes::STORE_SUBSC: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new StoreSubsc(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::STORE_CONST_SUBSC: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new StoreConstSubsc(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::STORE_SUBSC_CONST: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new StoreSubscConst(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::STORE_C_SUBSC_C: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new StoreConstSubscConst(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::STORE_INT_CONST: {
+            auto reg = read_register();
+            auto cint = read_const_int();
+            op = new StoreIntConst(reg, cint);
+        } break;
+        case opcode::OpCodes::STORE_FLOAT_CONST: {
+            auto reg = read_register();
+            auto cfl = read_const_float();
+            op = new StoreFloatConst(reg, cfl);
+        } break;
+        case opcode::OpCodes::STORE_BOOL_CONST: {
+            auto reg = read_register();
+            auto cbool = read_const_bool();
+            op = new StoreBoolConst(reg, cbool);
+        } break;
+        case opcode::OpCodes::STORE_STRING_CONST: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new StoreStringConst(reg, str);
+        } break;
+        case opcode::OpCodes::STORE_NIL_CONST: {
+            op = new StoreNilConst(read_register());
+        } break;
+        case opcode::OpCodes::JMP: {
+            op = new Jmp(read_address());
+        } break;
+        case opcode::OpCodes::BREAK_TO: {
+            op = new BreakTo(read_address());
+        } break;
+        case opcode::OpCodes::JMP_IF_TRUE: {
+            auto reg = read_register();
+            auto addr = read_address();
+            op = new JmpIfTrue(reg, addr);
+        } break;
+        case opcode::OpCodes::JMP_IF_FALSE: {
+            auto reg = read_register();
+            auto addr = read_address();
+            op = new JmpIfFalse(reg, addr);
+        } break;
+        case opcode::OpCodes::CALL: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new Call(reg1, reg2);
+        } break;
+        case opcode::OpCodes::CALL_FORMATTER: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new CallFormatter(reg, str);
+        } break;
+        //case opcode::OpCodes::PUSH_FRAME: {
+        //    op = new PushFrame();
+        //} break;
+        case opcode::OpCodes::POP_FRAME: {
+            op = new PopFrame();
+        } break;
+        case opcode::OpCodes::PUSH_CALL_FRAME: {
+            op = new PushCallFrame();
+        } break;
+        case opcode::OpCodes::POP_CALL_FRAME: {
+            op = new PopCallFrame();
+        } break;
+        case opcode::OpCodes::RETURN: {
+            op = new Return(read_register());
+        } break;
+        case opcode::OpCodes::RETURN_CONST: {
+            op = new ReturnConst(read_register());
+        } break;
+        case opcode::OpCodes::PUSH_ARG: {
+            op = new PushArg(read_register());
+        } break;
+        case opcode::OpCodes::PUSH_CONST_ARG: {
+            op = new PushConstArg(read_register());
+        } break;
+        case opcode::OpCodes::PUSH_NAMED_ARG: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new PushNamedArg(reg, str);
+        } break;
+        case opcode::OpCodes::PUSH_UNPACKED: {
+            op = new PushUnpacked(read_register());
+        } break;
+        case opcode::OpCodes::CREATE_FUN: {
+            auto reg = read_register();
+            auto str1 = read_string();
+            auto str2 = read_string();
+            op = new CreateFun(reg, str1, str2);
+        } break;
+        case opcode::OpCodes::FUN_BEGIN: {
+            auto reg = read_register();
+            op = new FunBegin(reg);
+        } break;
+        case opcode::OpCodes::SET_DEFAULT: {
+            auto reg1 = read_register();
+            auto index = read_const_int();
+            auto reg2 = read_register();
+            op = new SetDefault(reg1, index, reg2);
+        } break;
+        case opcode::OpCodes::SET_DEFAULT_CONST: {
+            auto reg1 = read_register();
+            auto index = read_const_int();
+            auto reg2 = read_register();
+            op = new SetDefaultConst(reg1, index, reg2);
+        } break;
+        case opcode::OpCodes::SET_TYPE: {
+            auto reg1 = read_register();
+            auto index = read_const_int();
+            auto reg2 = read_register();
+            op = new SetType(reg1, index, reg2);
+        } break;
+        case opcode::OpCodes::SET_VARARG: {
+            auto reg = read_register();
+            auto index = read_const_int();
+            op = new SetVararg(reg, index);
+        } break;
+        case opcode::OpCodes::IMPORT: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new Import(reg, str);
+        } break;
+        case opcode::OpCodes::IMPORT_ALL: {
+            op = new ImportAll(read_register());
+        } break;
+        case opcode::OpCodes::PUSH_PARENT: {
+            op = new PushParent(read_register());
+        } break;
+        case opcode::OpCodes::BUILD_CLASS: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new BuildClass(reg, str);
+        } break;
+        case opcode::OpCodes::ANNOTATE: {
+            auto reg1 = read_register();
+            auto str = read_string();
+            auto reg2 = read_register();
+            op = new Annotate(reg1, str, reg2);
+        } break;
+        case opcode::OpCodes::ANNOTATE_MOD: {
+            auto str = read_string();
+            auto reg = read_register();
+            op = new AnnotateMod(str, reg);
+        } break;
+        case opcode::OpCodes::DOCUMENT: {
+            auto reg = read_register();
+            auto str = read_string();
+            op = new Document(reg, str);
+        } break;
+        case opcode::OpCodes::OUTPUT: {
+            op = new Output(read_register());
+        } break;
+        case opcode::OpCodes::CONCAT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Concat(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EXP: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Exp(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::ADD: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Add(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUB: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Sub(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::DIV: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Div(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MUL: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mul(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MOD: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mod(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EQ: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Eq(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::NEQ: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Neq(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Bt(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Lt(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BEQ: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Beq(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LEQ: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Leq(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::IN: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new In(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::AND: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new And(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::OR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Or(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::XOR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Xor(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUBSC: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Subsc(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::CONCAT2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Concat2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EXP2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Exp2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::ADD2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Add2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUB2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Sub2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::DIV2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Div2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MUL2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mul2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MOD2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mod2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EQ2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Eq2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::NEQ2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Neq2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BT2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Bt2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LT2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Lt2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BEQ2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Beq2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LEQ2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Leq2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::IN2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new In2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::AND2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new And2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::OR2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Or2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::XOR2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Xor2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUBSC2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Subsc2(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::CONCAT3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Concat3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EXP3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Exp3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::ADD3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Add3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUB3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Sub3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::DIV3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Div3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MUL3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mul3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::MOD3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Mod3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::EQ3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Eq3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::NEQ3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Neq3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BT3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Bt3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LT3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Lt3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BEQ3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Beq3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::LEQ3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Leq3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::IN3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new In3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::AND3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new And3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::OR3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Or3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::XOR3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Xor3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUBSC3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Subsc3(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUBSCLAST: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new SubscLast(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::SUBSCREST: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new SubscRest(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::NOT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new Not(reg1, reg2);
+        } break;
+        case opcode::OpCodes::NEG: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new Neg(reg1, reg2);
+        } break;
+        case opcode::OpCodes::ASSERT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new Assert(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::RAISE: {
+            op = new Raise(read_register());
+        } break;
+        case opcode::OpCodes::CATCH: {
+            auto name = read_string();
+            auto addr = read_address();
+            auto id = read_const_int();
+            op = new Catch(name, addr, id);
+        } break;
+        case opcode::OpCodes::CATCH_TYPED: {
+            auto name = read_string();
+            auto type = read_register();
+            auto addr = read_address();
+            auto id = read_const_int();
+            op = new CatchTyped(name, type, addr, id);
+        } break;
+        case opcode::OpCodes::POP_CATCH: {
+            auto val = read_const_int();
+            op = new PopCatch(val);
+        } break;
+        case opcode::OpCodes::FINALLY: {
+            auto addr = read_address();
+            auto reg = read_register();
+            op = new Finally(addr, reg);
+        } break;
+        case opcode::OpCodes::POP_FINALLY: {
+            op = new PopFinally();
+        } break;
+        case opcode::OpCodes::FINALLY_RETURN: {
+            auto reg = read_register();
+            op = new FinallyReturn(reg);
+        } break;
+        case opcode::OpCodes::RUN_FINALLY: {
+            op = new RunFinally();
+        } break;
+        case opcode::OpCodes::LIST_PUSH: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new ListPush(reg1, reg2);
+        } break;
+        case opcode::OpCodes::LIST_PUSH_CONST: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new ListPushConst(reg1, reg2);
+        } break;
+        case opcode::OpCodes::BUILD_LIST: {
+            op = new BuildList(read_register());
+        } break;
+        case opcode::OpCodes::BUILD_DICT: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            op = new BuildDict(reg1, reg2, reg3);
+        } break;
+        case opcode::OpCodes::BUILD_ENUM: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto str = read_string();
+            op = new BuildEnum(reg1, reg2, str);
+        } break;
+        case opcode::OpCodes::BUILD_SPACE: {
+            auto reg1 = read_register();
+            auto str = read_string();
+            // Anonymous spaces have name starting with number.
+            bool anonymous = !str.empty() && std::isdigit(str[0]);
+            op = new BuildSpace(reg1, str, anonymous);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE2: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange2(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE3: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange3(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE4: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange4(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE5: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange5(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE6: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange6(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE7: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange7(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::CREATE_RANGE8: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto reg4 = read_register();
+            op = new CreateRange8(reg1, reg2, reg3, reg4);
+        } break;
+        case opcode::OpCodes::SWITCH: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto reg3 = read_register();
+            auto addr = read_address();
+            op = new Switch(reg1, reg2, reg3, addr);
+        } break;
+        case opcode::OpCodes::FOR: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto addr = read_address();
+            op = new For(reg1, reg2, addr);
+        } break;
+        case opcode::OpCodes::FOR_MULTI: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            auto addr = read_address();
+            auto reg3 = read_register();
+            op = new ForMulti(reg1, reg2, addr, reg3);
+        } break;
+        case opcode::OpCodes::ITER: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new Iter(reg1, reg2);
+        } break;
+        case opcode::OpCodes::LOOP_BEGIN: {
+            op = new LoopBegin();
+        } break;
+        case opcode::OpCodes::LOOP_END: {
+            op = new LoopEnd();
+        } break;
+        case opcode::OpCodes::TAIL_CALL: {
+            auto reg1 = read_register();
+            auto reg2 = read_register();
+            op = new TailCall(reg1, reg2);
+        } break;
+        default: {
+            std::string msg = "unknown opcode in bytecode reader: "+std::to_string(opcode);
+            fail(msg.c_str());
+        }
+    }
+    return op;
+}
+
+void BytecodeReader::read_code(Bytecode *bc, Address bci, size_t offset, size_t end_offset, size_t next_body) {
+    auto &code = bc->get_raw_code();
+    pos = contents->data() + offset;
+    end = contents->data() + end_offset;
+    while (pos < end) {
+        if (next_body < bodies.size() && bodies[next_body].start < bci) {
+            fail("Moss bytecode function table does not match the code");
+        }
+        // Skip function bodies, they are decoded once called
+        if (next_body < bodies.size() && bodies[next_body].start == bci) {
+            auto &body = bodies[next_body];
+            if (body.start_offset != static_cast<size_t>(pos - contents->data()) || body.end_offset > end_offset) {
+                fail("Moss bytecode function table does not match the code");
+            }
+            if (code.size() < body.end)
+                code.resize(body.end, nullptr);
+            bci = body.end;
+            pos = contents->data() + body.end_offset;
+            // Skip also bodies nested in this one
+            while (next_body < bodies.size() && bodies[next_body].start < body.end)
+                ++next_body;
+            continue;
+        }
+
+        opcode_t opcode = static_cast<opcode_t>(*pos++);
+        if (!compact && opcode == bc_header::LINE_TABLE_SECTION) {
+            read_line_table(bc);
+            continue;
+        }
+        auto op = read_opcode(opcode);
+        if (bci < code.size())
+            code[bci] = op;
+        else
+            code.push_back(op);
+        ++bci;
+    }
+}
+
+void BytecodeReader::read_body(Bytecode *bc, size_t body_index) {
+    auto &body = bodies[body_index];
+    if (body.end_offset > contents->size()) {
+        fail("Moss bytecode function table does not match the code");
+    }
+    LOGMAX("Decoding function body [" << body.start << "; " << body.end << ")");
+    read_code(bc, body.start, body.start_offset, body.end_offset, body_index + 1);
+    decoded_bodies[body_index] = true;
+    --undecoded_bodies;
+}
+
+void BytecodeReader::read_lazy(Bytecode *bc, Address bci) {
+    // Outer bodies have to be decoded first as nested ones are skipped in them
+    while (!bc->get_raw_code()[bci]) {
+        auto it = std::upper_bound(bodies.begin(), bodies.end(), bci, [](Address a, const FunBody &b) {
+            return a < b.start;
+        });
+        size_t outermost = bodies.size();
+        for (size_t i = std::distance(bodies.begin(), it); i-- > 0;) {
+            if (!decoded_bodies[i] && bodies[i].start <= bci && bci < bodies[i].end)
+                outermost = i;
+        }
+        assert(outermost < bodies.size() && "Not decoded opcode outside of function bodies");
+        read_body(bc, outermost);
+    }
+}
+
+void BytecodeReader::read_all(Bytecode *bc) {
+    for (size_t i = 0; i < bodies.size(); ++i) {
+        if (!decoded_bodies[i])
+            read_body(bc, i);
+    }
+}
+
 Bytecode *BytecodeReader::read() {
-    LOG1("Reading bytecode from file " << this->file.get_name());
+    LOG1("Reading bytecode from file " << this->file->get_name());
+    contents = file->read_contents();
 
     Bytecode *bc = new Bytecode();
 
@@ -131,770 +1147,45 @@ Bytecode *BytecodeReader::read() {
     LOGMAX("Read header: " << *header);
     bc->set_header(header);
 
-    char opcode_char;
-    opcode_t opcode;
-
-    do {
-        read_raw(&opcode_char, BC_OPCODE_SIZE);
-        opcode = static_cast<opcode_t>(opcode_char);
-        if (this->stream->eof()) 
-            break;
-
-        switch (opcode) {
-            case opcode::OpCodes::END: {
-                bc->push_back(new End());
-            } break;
-            case opcode::OpCodes::LOAD: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new Load(reg, str));
-            } break;
-            case opcode::OpCodes::LOAD_ATTR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto str = read_string();
-                bc->push_back(new LoadAttr(reg1, reg2, str));
-            } break;
-            case opcode::OpCodes::LOAD_GLOBAL: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new LoadGlobal(reg, str));
-            } break;
-            case opcode::OpCodes::LOAD_NONLOC: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new LoadNonLoc(reg, str));
-            } break;
-            case opcode::OpCodes::STORE: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new Store(reg1, reg2));
-            } break;
-            case opcode::OpCodes::STORE_NAME: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreName(reg, str));
-            } break;
-            case opcode::OpCodes::STORE_CONST: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new StoreConst(reg1, reg2));
-            } break;
-            case opcode::OpCodes::STORE_ATTR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreAttr(reg1, reg2, str));
-            } break;
-            case opcode::OpCodes::STORE_CONST_ATTR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreConstAttr(reg1, reg2, str));
-            } break;
-            case opcode::OpCodes::STORE_GLOBAL: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreGlobal(reg, str));
-            } break;
-            case opcode::OpCodes::STORE_NONLOC: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreNonLoc(reg, str));
-            } break;
-            case opcode::OpCodes::STORE_SUBSC: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new StoreSubsc(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::STORE_CONST_SUBSC: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new StoreConstSubsc(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::STORE_SUBSC_CONST: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new StoreSubscConst(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::STORE_C_SUBSC_C: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new StoreConstSubscConst(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::STORE_INT_CONST: {
-                auto reg = read_register();
-                auto cint = read_const_int();
-                bc->push_back(new StoreIntConst(reg, cint));
-            } break;
-            case opcode::OpCodes::STORE_FLOAT_CONST: {
-                auto reg = read_register();
-                auto cfl = read_const_float();
-                bc->push_back(new StoreFloatConst(reg, cfl));
-            } break;
-            case opcode::OpCodes::STORE_BOOL_CONST: {
-                auto reg = read_register();
-                auto cbool = read_const_bool();
-                bc->push_back(new StoreBoolConst(reg, cbool));
-            } break;
-            case opcode::OpCodes::STORE_STRING_CONST: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new StoreStringConst(reg, str));
-            } break;
-            case opcode::OpCodes::STORE_NIL_CONST: {
-                bc->push_back(new StoreNilConst(read_register()));
-            } break;
-            case opcode::OpCodes::JMP: {
-                bc->push_back(new Jmp(read_address()));
-            } break;
-            case opcode::OpCodes::BREAK_TO: {
-                bc->push_back(new BreakTo(read_address()));
-            } break;
-            case opcode::OpCodes::JMP_IF_TRUE: {
-                auto reg = read_register();
-                auto addr = read_address();
-                bc->push_back(new JmpIfTrue(reg, addr));
-            } break;
-            case opcode::OpCodes::JMP_IF_FALSE: {
-                auto reg = read_register();
-                auto addr = read_address();
-                bc->push_back(new JmpIfFalse(reg, addr));
-            } break;
-            case opcode::OpCodes::CALL: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new Call(reg1, reg2));
-            } break;
-            case opcode::OpCodes::CALL_FORMATTER: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new CallFormatter(reg, str));
-            } break;
-            //case opcode::OpCodes::PUSH_FRAME: {
-            //    bc->push_back(new PushFrame());
-            //} break;
-            case opcode::OpCodes::POP_FRAME: {
-                bc->push_back(new PopFrame());
-            } break;
-            case opcode::OpCodes::PUSH_CALL_FRAME: {
-                bc->push_back(new PushCallFrame());
-            } break;
-            case opcode::OpCodes::POP_CALL_FRAME: {
-                bc->push_back(new PopCallFrame());
-            } break;
-            case opcode::OpCodes::RETURN: {
-                bc->push_back(new Return(read_register()));
-            } break;
-            case opcode::OpCodes::RETURN_CONST: {
-                bc->push_back(new ReturnConst(read_register()));
-            } break;
-            case opcode::OpCodes::PUSH_ARG: {
-                bc->push_back(new PushArg(read_register()));
-            } break;
-            case opcode::OpCodes::PUSH_CONST_ARG: {
-                bc->push_back(new PushConstArg(read_register()));
-            } break;
-            case opcode::OpCodes::PUSH_NAMED_ARG: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new PushNamedArg(reg, str));
-            } break;
-            case opcode::OpCodes::PUSH_UNPACKED: {
-                bc->push_back(new PushUnpacked(read_register()));
-            } break;
-            case opcode::OpCodes::CREATE_FUN: {
-                auto reg = read_register();
-                auto str1 = read_string();
-                auto str2 = read_string();
-                bc->push_back(new CreateFun(reg, str1, str2));
-            } break;
-            case opcode::OpCodes::FUN_BEGIN: {
-                auto reg = read_register();
-                bc->push_back(new FunBegin(reg));
-            } break;
-            case opcode::OpCodes::SET_DEFAULT: {
-                auto reg1 = read_register();
-                auto index = read_const_int();
-                auto reg2 = read_register();
-                bc->push_back(new SetDefault(reg1, index, reg2));
-            } break;
-            case opcode::OpCodes::SET_DEFAULT_CONST: {
-                auto reg1 = read_register();
-                auto index = read_const_int();
-                auto reg2 = read_register();
-                bc->push_back(new SetDefaultConst(reg1, index, reg2));
-            } break;
-            case opcode::OpCodes::SET_TYPE: {
-                auto reg1 = read_register();
-                auto index = read_const_int();
-                auto reg2 = read_register();
-                bc->push_back(new SetType(reg1, index, reg2));
-            } break;
-            case opcode::OpCodes::SET_VARARG: {
-                auto reg = read_register();
-                auto index = read_const_int();
-                bc->push_back(new SetVararg(reg, index));
-            } break;
-            case opcode::OpCodes::IMPORT: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new Import(reg, str));
-            } break;
-            case opcode::OpCodes::IMPORT_ALL: {
-                bc->push_back(new ImportAll(read_register()));
-            } break;
-            case opcode::OpCodes::PUSH_PARENT: {
-                bc->push_back(new PushParent(read_register()));
-            } break;
-            case opcode::OpCodes::BUILD_CLASS: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new BuildClass(reg, str));
-            } break;
-            case opcode::OpCodes::ANNOTATE: {
-                auto reg1 = read_register();
-                auto str = read_string();
-                auto reg2 = read_register();
-                bc->push_back(new Annotate(reg1, str, reg2));
-            } break;
-            case opcode::OpCodes::ANNOTATE_MOD: {
-                auto str = read_string();
-                auto reg = read_register();
-                bc->push_back(new AnnotateMod(str, reg));
-            } break;
-            case opcode::OpCodes::DOCUMENT: {
-                auto reg = read_register();
-                auto str = read_string();
-                bc->push_back(new Document(reg, str));
-            } break;
-            case opcode::OpCodes::OUTPUT: {
-                bc->push_back(new Output(read_register()));
-            } break;
-            case opcode::OpCodes::CONCAT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Concat(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EXP: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Exp(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::ADD: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Add(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUB: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Sub(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::DIV: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Div(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MUL: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mul(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MOD: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mod(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EQ: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Eq(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::NEQ: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Neq(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Bt(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Lt(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BEQ: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Beq(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LEQ: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Leq(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::IN: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new In(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::AND: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new And(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::OR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Or(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::XOR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Xor(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUBSC: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Subsc(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::CONCAT2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Concat2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EXP2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Exp2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::ADD2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Add2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUB2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Sub2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::DIV2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Div2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MUL2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mul2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MOD2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mod2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EQ2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Eq2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::NEQ2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Neq2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BT2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Bt2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LT2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Lt2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BEQ2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Beq2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LEQ2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Leq2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::IN2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new In2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::AND2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new And2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::OR2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Or2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::XOR2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Xor2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUBSC2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Subsc2(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::CONCAT3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Concat3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EXP3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Exp3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::ADD3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Add3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUB3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Sub3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::DIV3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Div3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MUL3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mul3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::MOD3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Mod3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::EQ3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Eq3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::NEQ3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Neq3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BT3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Bt3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LT3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Lt3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BEQ3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Beq3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::LEQ3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Leq3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::IN3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new In3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::AND3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new And3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::OR3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Or3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::XOR3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Xor3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUBSC3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Subsc3(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUBSCLAST: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new SubscLast(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::SUBSCREST: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new SubscRest(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::NOT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new Not(reg1, reg2));
-            } break;
-            case opcode::OpCodes::NEG: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new Neg(reg1, reg2));
-            } break;
-            case opcode::OpCodes::ASSERT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new Assert(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::RAISE: {
-                bc->push_back(new Raise(read_register()));
-            } break;
-            case opcode::OpCodes::CATCH: {
-                auto name = read_string();
-                auto addr = read_address();
-                auto id = read_const_int();
-                bc->push_back(new Catch(name, addr, id));
-            } break;
-            case opcode::OpCodes::CATCH_TYPED: {
-                auto name = read_string();
-                auto type = read_register();
-                auto addr = read_address();
-                auto id = read_const_int();
-                bc->push_back(new CatchTyped(name, type, addr, id));
-            } break;
-            case opcode::OpCodes::POP_CATCH: {
-                auto val = read_const_int();
-                bc->push_back(new PopCatch(val));
-            } break;
-            case opcode::OpCodes::FINALLY: {
-                auto addr = read_address();
-                auto reg = read_register();
-                bc->push_back(new Finally(addr, reg));
-            } break;
-            case opcode::OpCodes::POP_FINALLY: {
-                bc->push_back(new PopFinally());
-            } break;
-            case opcode::OpCodes::FINALLY_RETURN: {
-                auto reg = read_register();
-                bc->push_back(new FinallyReturn(reg));
-            } break;
-            case opcode::OpCodes::RUN_FINALLY: {
-                bc->push_back(new RunFinally());
-            } break;
-            case opcode::OpCodes::LIST_PUSH: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new ListPush(reg1, reg2));
-            } break;
-            case opcode::OpCodes::LIST_PUSH_CONST: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new ListPushConst(reg1, reg2));
-            } break;
-            case opcode::OpCodes::BUILD_LIST: {
-                bc->push_back(new BuildList(read_register()));
-            } break;
-            case opcode::OpCodes::BUILD_DICT: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                bc->push_back(new BuildDict(reg1, reg2, reg3));
-            } break;
-            case opcode::OpCodes::BUILD_ENUM: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto str = read_string();
-                bc->push_back(new BuildEnum(reg1, reg2, str));
-            } break;
-            case opcode::OpCodes::BUILD_SPACE: {
-                auto reg1 = read_register();
-                auto str = read_string();
-                // Anonymous spaces have name starting with number.
-                bool anonymous = !str.empty() && std::isdigit(str[0]);
-                bc->push_back(new BuildSpace(reg1, str, anonymous));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE2: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange2(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE3: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange3(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE4: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange4(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE5: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange5(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE6: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange6(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE7: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange7(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::CREATE_RANGE8: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto reg4 = read_register();
-                bc->push_back(new CreateRange8(reg1, reg2, reg3, reg4));
-            } break;
-            case opcode::OpCodes::SWITCH: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto reg3 = read_register();
-                auto addr = read_address();
-                bc->push_back(new Switch(reg1, reg2, reg3, addr));
-            } break;
-            case opcode::OpCodes::FOR: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto addr = read_address();
-                bc->push_back(new For(reg1, reg2, addr));
-            } break;
-            case opcode::OpCodes::FOR_MULTI: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                auto addr = read_address();
-                auto reg3 = read_register();
-                bc->push_back(new ForMulti(reg1, reg2, addr, reg3));
-            } break;
-            case opcode::OpCodes::ITER: {
-                auto reg1 = read_register();
-                auto reg2 = read_register();
-                bc->push_back(new Iter(reg1, reg2));
-            } break;
-            case opcode::OpCodes::LOOP_BEGIN: {
-                bc->push_back(new LoopBegin());
-            } break;
-            case opcode::OpCodes::LOOP_END: {
-                bc->push_back(new LoopEnd());
-            } break;
-            default: {
-                std::string msg = "unknown opcode in bytecode reader: "+std::to_string(opcode);
-                error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
+    size_t code_offset = sizeof(*header);
+    size_t code_end = contents->size();
+    if (header->bc_version >= bc_header::COMPACT_MIN_VERSION) {
+        compact = true;
+        read_sections(bc, code_offset, code_end);
+    } else if (header->bc_version >= bc_header::FUN_TABLE_MIN_VERSION) {
+        // Sections are read first, so that function bodies can be skipped
+        if (code_end < sizeof(*header) + bc_header::SECTIONS_OFFSET_SIZE) {
+            fail("Moss bytecode is truncated");
+        }
+        pos = contents->data() + code_end - bc_header::SECTIONS_OFFSET_SIZE;
+        end = contents->data() + code_end;
+        std::uint32_t sections_offset = read_uint32();
+        if (sections_offset < sizeof(*header) || sections_offset > code_end - bc_header::SECTIONS_OFFSET_SIZE) {
+            fail("Moss bytecode sections offset is out of bounds");
+        }
+        pos = contents->data() + sections_offset;
+        end = contents->data() + code_end - bc_header::SECTIONS_OFFSET_SIZE;
+        while (pos < end) {
+            opcode_t section = static_cast<opcode_t>(*pos++);
+            if (section == bc_header::LINE_TABLE_SECTION) {
+                read_line_table(bc);
+            } else if (section == bc_header::FUN_TABLE_SECTION) {
+                read_fun_table();
+            } else {
+                fail("Unknown section in moss bytecode");
             }
         }
-    } while(!this->stream->eof());
-
-    std::uint32_t computed = ~crc_checksum;
-    std::uint32_t expected = header->checksum;
+        code_end = sections_offset;
+    }
+    read_code(bc, 0, code_offset, code_end, 0);
 
-    if (computed != expected) {
-        std::string msg = "Moss bytecode checksum mismatch (corrupted file)";
-        error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
+    if (undecoded_bodies > 0) {
+        // Bytecode keeps its own reader, this one might be used only while
+        // the file exists
+        auto lazy_reader = std::make_unique<BytecodeReader>(*this);
+        lazy_reader->file = nullptr;
+        bc->set_lazy_reader(std::move(lazy_reader));
     }
 
     return bc;
-}
\ No newline at end of file
+}
@@ -4,7 +4,7 @@
 /// \copyright Copyright 2024 Marek Sedlacek. All rights reserved.
 ///            See accompanied LICENSE file.
 /// 
-/// \brief Reads bytecode from a stream
+/// \brief Reads bytecode from a file
 /// 
 
 #ifndef _BYTECODE_READER_HPP_
@@ -14,22 +14,44 @@
 #include "bytecode.hpp"
 #include "bytecode_header.hpp"
 #include "opcode.hpp"
-#include <fstream>
 #include <cstdlib>
+#include <memory>
+#include <string_view>
+#include <vector>
 
 namespace moss {
 
-/// Reader of bytecode files, it converts them into bytecode object
+/// \brief Reader of bytecode files, it converts them into bytecode object
+///
+/// The file is memory mapped and its opcodes are decoded straight from the
+/// mapping. Function bodies listed in the function table (since bytecode
+/// version 4) are not decoded by read(), the returned bytecode keeps a copy
+/// of this reader and decodes each body once its opcode is first accessed.
+/// Files of older versions (down to BYTECODE_MIN_VERSION) can still be read.
 class BytecodeReader {
 private:
-    BytecodeFile &file;
-    std::istream *stream;
+    /// Function body from the function table
+    struct FunBody {
+        opcode::Address start;
+        opcode::Address end;
+        std::uint32_t start_offset;
+        std::uint32_t end_offset;
+    };
+
+    BytecodeFile *file;   ///< Read file, nullptr for lazy decoding reader
+    ustring file_name;
+    std::shared_ptr<FileContents> contents;
+    const char *pos;      ///< Current read position in contents
+    const char *end;      ///< End of currently read part of contents
 
-    char *str_buffer;
-    size_t buffer_size;
+    bool compact;         ///< Variable length operands and string table (since version 5)
+    std::vector<std::string_view> strings; ///< String table pointing into contents
 
-    std::uint32_t crc_checksum;
+    std::vector<FunBody> bodies;
+    std::vector<bool> decoded_bodies;
+    size_t undecoded_bodies;
 
+    [[noreturn]] void fail(const char *msg);
     void read_raw(char* data, std::size_t size);
     opcode::Register read_register();
     opcode::StringConst read_string();
@@ -37,20 +59,33 @@ private:
     opcode::FloatConst read_const_float();
     opcode::BoolConst read_const_bool();
     opcode::Address read_address();
+    std::uint32_t read_uint32();
+    std::uint64_t read_uint();
     bc_header::BytecodeHeader read_header();
+    void read_line_table(Bytecode *bc);
+    void read_fun_table();
+    void read_string_table();
+    void read_compact_line_table(Bytecode *bc);
+    void read_compact_fun_table(size_t code_offset);
+    void read_inlined_table(Bytecode *bc);
+    void read_sections(Bytecode *bc, size_t &code_offset, size_t &code_end);
+    opcode::OpCode *read_opcode(opcode::opcode_t opcode);
+    void read_code(Bytecode *bc, opcode::Address bci, size_t offset, size_t end_offset, size_t next_body);
+    void read_body(Bytecode *bc, size_t body_index);
 public:
-    BytecodeReader(BytecodeFile &file) : file(file), buffer_size(256), crc_checksum(0xFFFFFFFF) {
-        this->stream = file.get_new_stream();
-        // Buffer might be reallocated, so malloc has to be used
-        this->str_buffer = (char *)std::malloc(buffer_size);
-    }
-    ~BytecodeReader() {
-        delete stream;
-        std::free(str_buffer);
-    }
+    BytecodeReader(BytecodeFile &file) : file(&file), file_name(file.get_name()), pos(nullptr), end(nullptr), compact(false), undecoded_bodies(0) {}
 
     /// Reads bytecode into Bytecode object
     Bytecode *read();
+
+    /// Decodes function body containing bci (and bodies it is nested in)
+    void read_lazy(Bytecode *bc, opcode::Address bci);
+
+    /// Decodes all not yet decoded function bodies
+    void read_all(Bytecode *bc);
+
+    /// \return true if all function bodies were already decoded
+    bool is_done() { return undecoded_bodies == 0; }
 };
 
 }
@@ -5,44 +5,55 @@
 #include "commons.hpp"
 #include "opcode.hpp"
 #include "errors.hpp"
+#include "utils.hpp"
 #include <cassert>
 #include <iterator>
+#include <vector>
+#include <string>
 
 using namespace moss;
 using namespace moss::opcode;
 
 void BytecodeWriter::write_raw(const char* data, std::size_t size) {
-    this->stream->write(data, size);
+    this->out->append(data, size);
+}
 
-    // update CRC
-    for (size_t i = 0; i < size; ++i) {
-        crc_checksum ^= static_cast<unsigned char>(data[i]);
-        for (int j = 0; j < 8; ++j)
-            crc_checksum = (crc_checksum >> 1) ^ (0xEDB88320 & -(crc_checksum & 1));
-    }
+void BytecodeWriter::write_uint(std::uint64_t v) {
+    // LEB128, 7 bits per byte with the highest bit set when more follow
+    char buffer[10];
+    size_t i = 0;
+    do {
+        char byte = v & 0x7F;
+        v >>= 7;
+        if (v != 0)
+            byte |= 0x80;
+        buffer[i++] = byte;
+    } while (v != 0);
+    write_raw(buffer, i);
 }
 
 void BytecodeWriter::write_register(Register reg) {
-    write_raw(reinterpret_cast<char *>(&reg), BC_REGISTER_SIZE);
+    write_uint(reg);
 }
 
 void BytecodeWriter::write_address(Address addr) {
-    write_raw(reinterpret_cast<char *>(&addr), BC_ADDR_SIZE);
+    write_uint(addr);
 }
 
 void BytecodeWriter::write_int(IntConst v) {
-    write_raw(reinterpret_cast<char *>(&v), BC_INT_SIZE);
+    // Zigzag encoding, so that small negative values are also short
+    auto u = static_cast<std::uint64_t>(v);
+    write_uint((u << 1) ^ (v < 0 ? ~std::uint64_t(0) : 0));
 }
 
 void BytecodeWriter::write_string(StringConst val) {
-    const char *txt = val.c_str();
-    strlen_t len = val.size();
-    write_raw(reinterpret_cast<char *>(&len), BC_STR_LEN_SIZE);
-    write_raw(txt, val.size());
+    auto [it, inserted] = string_ids.try_emplace(val, static_cast<std::uint32_t>(string_ids.size()));
+    if (inserted)
+        strings.push_back(&it->first);
+    write_uint(it->second);
 }
 
 void BytecodeWriter::write_header(bc_header::BytecodeHeader bch) {
-    // Write header and don't update checksum.
     this->stream->write(reinterpret_cast<char *>(&bch.id), BCH_ID_SIZE);
     this->stream->write(reinterpret_cast<char *>(&bch.checksum), BCH_CHECKSUM_SIZE);
     this->stream->write(reinterpret_cast<char *>(&bch.bc_version), BCH_BC_VERSION_SIZE);
@@ -54,10 +65,18 @@ void BytecodeWriter::write(Bytecode *code) {
     LOGMAX("Writing bytecode to file: " << this->file.get_path());
     assert(code && "Bytecode to be written is null");
 
-    bc_header::BytecodeHeader header = bc_header::create_header();
-    write_header(header);
-
+    string_ids.clear();
+    strings.clear();
+    std::string code_section;
+    this->out = &code_section;
+    // Byte offset of each opcode for function table
+    std::vector<std::uint32_t> offsets;
+    offsets.reserve(code->size() + 1);
     for (opcode::OpCode *op_gen: code->get_code()) {
+        offsets.push_back(static_cast<std::uint32_t>(code_section.size()));
+        // Quickened opcodes exist only at runtime
+        if (opcode::is_quickened(op_gen))
+            op_gen = dynamic_cast<opcode::QuickenedOpCode *>(op_gen)->get_generic();
         opcode_t opc = op_gen->get_type();
         write_raw(reinterpret_cast<char *>(&opc), BC_OPCODE_SIZE);
         if (isa<opcode::End>(op_gen)){
@@ -411,18 +430,98 @@ void BytecodeWriter::write(Bytecode *code) {
         else if (isa<opcode::LoopEnd>(op_gen)){
             // Nothing to do.
         }
+        else if (auto o = dyn_cast<opcode::TailCall>(op_gen)){
+            write_register(o->dst);
+            write_register(o->src);
+        }
         else {
             std::string msg = "unknown opcode in bytecode writer: "+std::to_string(opc);
             error::error(error::ErrorCode::BYTECODE, msg.c_str(), &this->file, true);
         }
     }
 
-    // Patch checksum
-    std::uint32_t final_crc = ~crc_checksum;
-    auto end_pos = this->stream->tellp();
-    this->stream->seekp(BCH_ID_SIZE);
-    this->stream->write(reinterpret_cast<char*>(&final_crc), BCH_CHECKSUM_SIZE);
-    this->stream->seekp(end_pos);
+    offsets.push_back(static_cast<std::uint32_t>(code_section.size()));
+
+    std::string lines_section;
+    this->out = &lines_section;
+    write_uint(code->get_lines().size());
+    Address prev_bci = 0;
+    for (auto e: code->get_lines()) {
+        // Entries are sorted by bci, so only the difference is stored
+        write_address(e.bci - prev_bci);
+        write_uint(e.line);
+        prev_bci = e.bci;
+    }
+
+    // Function bodies start after function begin and a jump over the body
+    std::vector<std::pair<Address, Address>> bodies;
+    auto &ops = code->get_code();
+    for (Address i = 0; i + 1 < ops.size(); ++i) {
+        if (!isa<opcode::FunBegin>(ops[i]))
+            continue;
+        if (auto jmp = dyn_cast<opcode::Jmp>(ops[i+1])) {
+            if (jmp->addr >= i + 2 && jmp->addr <= ops.size())
+                bodies.push_back(std::make_pair(i + 2, jmp->addr));
+        }
+    }
+    std::string functions_section;
+    this->out = &functions_section;
+    write_uint(bodies.size());
+    for (auto [start, end]: bodies) {
+        write_address(start);
+        write_address(end);
+        write_uint(offsets[start]);
+        write_uint(offsets[end]);
+    }
+
+    std::string inlined_section;
+    this->out = &inlined_section;
+    write_uint(code->get_inlined().size());
+    for (auto &e: code->get_inlined()) {
+        write_address(e.start);
+        write_address(e.end);
+        write_string(e.signature);
+    }
+
+    std::string strings_section;
+    this->out = &strings_section;
+    write_uint(strings.size());
+    for (auto str: strings) {
+        write_uint(str->size());
+        write_raw(str->data(), str->size());
+    }
+
+    // Section directory followed by the sections
+    std::vector<std::pair<bc_header::Section, std::string *>> sections = {
+        {bc_header::Section::STRINGS, &strings_section},
+        {bc_header::Section::CODE, &code_section},
+        {bc_header::Section::LINES, &lines_section},
+        {bc_header::Section::FUNCTIONS, &functions_section},
+    };
+    // Optional sections are written only when there is something in them
+    if (!code->get_inlined().empty())
+        sections.push_back({bc_header::Section::INLINED, &inlined_section});
+    std::string body;
+    this->out = &body;
+    std::uint8_t sections_amount = sections.size();
+    write_raw(reinterpret_cast<char *>(&sections_amount), sizeof(sections_amount));
+    std::uint32_t offset = BCH_SIZE + sizeof(sections_amount) + sections.size() * bc_header::SECTION_ENTRY_SIZE;
+    for (auto [kind, data]: sections) {
+        auto kind_byte = static_cast<std::uint8_t>(kind);
+        std::uint32_t size = data->size();
+        write_raw(reinterpret_cast<char *>(&kind_byte), sizeof(kind_byte));
+        write_raw(reinterpret_cast<char *>(&offset), sizeof(offset));
+        write_raw(reinterpret_cast<char *>(&size), sizeof(size));
+        offset += size;
+    }
+    for (auto [_, data]: sections)
+        body += *data;
+
+    // Checksum covers everything after the header
+    bc_header::BytecodeHeader header = bc_header::create_header();
+    header.checksum = ~utils::crc32_update(0xFFFFFFFF, body.data(), body.size());
+    write_header(header);
+    this->stream->write(body.data(), body.size());
 
     this->stream->flush();
     LOGMAX("Finished writing bytecode");
@@ -16,6 +16,9 @@
 #include "opcode.hpp"
 #include <fstream>
 #include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace moss {
 
@@ -26,16 +29,19 @@ private:
     BytecodeFile &file;
     std::ostream *stream;
 
-    std::uint32_t crc_checksum;
+    std::string *out; ///< Section currently being written
+    std::unordered_map<ustring, std::uint32_t> string_ids;
+    std::vector<const ustring *> strings; ///< Strings for the string table in order of their ids
 
     void write_raw(const char* data, std::size_t size);
+    void write_uint(std::uint64_t v);
     void write_register(opcode::Register reg);
     void write_address(opcode::Address addr);
     void write_string(opcode::StringConst val);
     void write_int(opcode::IntConst v);
     void write_header(bc_header::BytecodeHeader bch);
 public:
-    BytecodeWriter(BytecodeFile &file) : file(file), crc_checksum(0xFFFFFFFF) {
+    BytecodeWriter(BytecodeFile &file) : file(file), out(nullptr) {
         this->stream = file.create_out_stream();
     }
     ~BytecodeWriter() {
@@ -2,6 +2,7 @@
 #include "logging.hpp"
 #include "opcode.hpp"
 #include "ir.hpp"
+#include "pass_stats.hpp"
 
 using namespace moss;
 using namespace ir;
@@ -1119,6 +1120,16 @@ RegValue *BytecodeGen::emit(ir::UnaryExpr *expr) {
     return nullptr;
 }
 
+void BytecodeGen::expect_typed_operands(ir::BinaryExpr *expr, opcode::Address start) {
+    // Operation is the last one emitted, only stores can follow it
+    for (auto bci = code->size(); bci > start; --bci) {
+        if (auto op = dynamic_cast<BinExprOpCode *>((*code)[bci-1])) {
+            opcode::expect_typed_operands(op, expr->get_operands_type() == StaticType::FLOAT);
+            return;
+        }
+    }
+}
+
 RegValue *BytecodeGen::emit(ir::Expression *expr, bool get_as_ncreg) {
     RegValue *bcv = nullptr;
     if (auto val = dyn_cast<IntLiteral>(expr)) {
@@ -1198,7 +1209,10 @@ RegValue *BytecodeGen::emit(ir::Expression *expr, bool get_as_ncreg) {
         bcv = last_reg();
     }
     else if (auto be = dyn_cast<BinaryExpr>(expr)) {
+        auto start = code->size();
         bcv = emit(be);
+        if (be->get_operands_type() != StaticType::UNKNOWN)
+            expect_typed_operands(be, start);
     }
     else if (auto ue = dyn_cast<UnaryExpr>(expr)) {
         bcv = emit(ue);
@@ -1265,6 +1279,12 @@ RegValue *BytecodeGen::emit(ir::Expression *expr, bool get_as_ncreg) {
         append(new opcode::Call(next_reg(), free_reg(fun)));
         bcv = last_reg();
     }
+    else if (auto ic = dyn_cast<ir::InlinedCall>(expr)) {
+        // Body's opcodes are mapped to the inlined function for stack trace
+        opcode::Address start = code->size();
+        bcv = emit(ic->get_body());
+        code->push_inlined(InlinedEntry{start, static_cast<opcode::Address>(code->size()), ic->get_signature()});
+    }
     else if (auto rng = dyn_cast<ir::Range>(expr)) {
         auto start = rng->get_start();
         auto second = rng->get_second();
@@ -1378,6 +1398,7 @@ RegValue *BytecodeGen::emit(ir::Expression *expr, bool get_as_ncreg) {
         push_reg_scope(lmb->get_args().size()+1);
         // Generate function body
         auto rval = emit(lmb->get_body());
+        emit_tail_call(lmb->get_body(), rval);
         if (rval->is_const())
             append(new opcode::ReturnConst(free_reg(rval)));
         else
@@ -1409,8 +1430,21 @@ void BytecodeGen::emit(ir::Raise *r) {
     append(new opcode::Raise(free_reg(exc)));
 }
 
+void BytecodeGen::emit_tail_call(ir::Expression *expr, RegValue *val) {
+    if (!isa<ir::Call>(expr) || val->is_const() || code->empty())
+        return;
+    auto &ops = code->get_code();
+    auto cl = dyn_cast<opcode::Call>(ops.back());
+    if (!cl || cl->dst != val->reg())
+        return;
+    // Return after it stays for when the frame cannot be reused
+    ops.back() = new opcode::TailCall(cl->dst, cl->src);
+    delete cl;
+}
+
 void BytecodeGen::emit(ir::Return *r) {
     auto ex = emit(r->get_expr());
+    emit_tail_call(r->get_expr(), ex);
     if (ex->is_const())
         append(new opcode::ReturnConst(free_reg(ex)));
     else
@@ -1906,6 +1940,13 @@ void BytecodeGen::emit(ir::Annotation *annt) {
 
 void BytecodeGen::emit(ir::IR *decl) {
     assert(decl && "emitting nullptr");
+    // Opcodes are mapped to the line of the statement they were generated
+    // from. Enclosing statement's line is restored after nested statements.
+    bool is_mod = isa<Module>(decl);
+    unsigned outer_line = code->get_current_line();
+    if (!is_mod)
+        code->set_line(decl->get_src_info().get_lines().first + 1);
+
     if (auto mod = dyn_cast<Module>(decl)) {
         emit(mod);
     }
@@ -1970,6 +2011,9 @@ void BytecodeGen::emit(ir::IR *decl) {
         LOGMAX("Unimplemented IR generation for: " << *decl);
         assert(false && "Unimplemented IR generation");
     }
+
+    if (!is_mod)
+        code->set_line(outer_line);
 }
 
 void BytecodeGen::emit(std::list<ir::IR *> block) {
@@ -1991,7 +2035,10 @@ void BytecodeGen::output(RegValue *val) {
 void BytecodeGen::generate(ir::IR *decl) {
     LOGMAX("Generating bytecode from IR " << decl->get_name());
 
+    passstats::PhaseTimer timer(decl->get_src_info().get_file().get_name(), "bcgen");
+    auto start_size = code->size();
     emit(decl);
+    timer.count = code->size() - start_size;
 
     LOGMAX("Finished generating bytecode");
 }
\ No newline at end of file
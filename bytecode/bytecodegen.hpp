@@ -75,6 +75,14 @@ private:
     RegValue *emit(ir::UnaryExpr *expr);
     RegValue *emit(ir::Expression *expr, bool get_as_ncreg=false);
 
+    /// Makes opcode of binary expression emitted from start quicken on its
+    /// first execution as the types of its operands are known
+    void expect_typed_operands(ir::BinaryExpr *expr, opcode::Address start);
+
+    /// Replaces call which was just emitted for returned expression with a
+    /// tail call, so that the returning function's frame can be reused
+    void emit_tail_call(ir::Expression *expr, RegValue *val);
+
     /// \brief Emits import expression for either module or space
     /// \param e Expression to emit
     /// \param space_import This value is set within this function and used in recursive call
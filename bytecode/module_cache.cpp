@@ -0,0 +1,200 @@
+#include "module_cache.hpp"
+#include "bytecode.hpp"
+#include "bytecode_header.hpp"
+#include "bytecode_reader.hpp"
+#include "bytecode_writer.hpp"
+#include "source.hpp"
+#include "clopts.hpp"
+#include "logging.hpp"
+#include "utils.hpp"
+#include "moss.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace moss;
+using namespace module_cache;
+
+/// Has to be increased on every change of the entry format
+static constexpr uint32_t CACHE_FORMAT_VERSION = 2;
+static constexpr char CACHE_MAGIC[8] = {'M', 'S', 'C', 'A', 'C', 'H', 'E', '\0'};
+/// Environment variable to relocate (or disable with "off") the cache
+static constexpr char CACHE_ENV_VAR[] = "MOSS_MODULE_CACHE";
+
+namespace {
+
+/// Header of cache entry, which is followed by the source path and then
+/// by the bytecode in the same format as in .msb files
+struct EntryHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t moss_version;
+    uint32_t bc_version;
+    uint32_t opt_level;         ///< Optimization level the module was compiled with
+    uint32_t path_size;         ///< Size of the source path following the header
+    CacheEntry::SourceKey source;
+    uint64_t bc_size;
+    uint64_t bc_checksum;
+};
+
+/// Bytecode file kept in memory, so that the entry can be verified and
+/// prefixed with its header without writing or reading the file twice
+class MemoryBytecodeFile : public BytecodeFile {
+private:
+    std::stringbuf buffer;
+public:
+    MemoryBytecodeFile(ustring path, const ustring &contents="")
+        : BytecodeFile(path), buffer(contents, std::ios::in | std::ios::out | std::ios::binary) {}
+
+    virtual std::unique_ptr<FileContents> read_contents() override {
+        return std::make_unique<FileContents>(buffer.str());
+    }
+
+    virtual std::ostream *create_out_stream() override {
+        return new std::ostream(&buffer);
+    }
+
+    ustring contents() { return buffer.str(); }
+};
+
+/// \return Directory set by the user or environment or nullopt if not set
+std::optional<ustring> get_user_cache_dir() {
+    if (clopts::module_cache_dir)
+        return args::get(clopts::module_cache_dir);
+    if (const char *value = std::getenv(CACHE_ENV_VAR))
+        return ustring(value);
+    return std::nullopt;
+}
+
+}
+
+bool module_cache::is_enabled() {
+    if (clopts::no_module_cache)
+        return false;
+    // Warnings are reported while parsing, so the source has to be compiled
+    // for them to be reported
+    if (clopts::get_warning_level() != clopts::WarningLevel::WL_IGNORE)
+        return false;
+    auto dir = get_user_cache_dir();
+    return !dir || (!dir->empty() && *dir != "off");
+}
+
+CacheEntry::CacheEntry(ustring src_path) : src_path(src_path) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    auto abs_path = fs::absolute(src_path, ec);
+    if (ec)
+        abs_path = src_path;
+    this->src_path = abs_path.string();
+    auto stem = abs_path.stem().string();
+
+    if (auto dir = get_user_cache_dir()) {
+        // Relocated cache is shared by all sources, so the entry name
+        // has to be unique for the source path
+        auto path_hash = utils::fnv1a(this->src_path.data(), this->src_path.size());
+        entry_path = (fs::path(*dir) / (stem + "." + utils::formatv("%016llx", static_cast<unsigned long long>(path_hash)) + ".msb")).string();
+    } else {
+        entry_path = (abs_path.parent_path() / CACHE_DIR_NAME / (stem + ".msb")).string();
+    }
+
+    auto source = utils::read_file(this->src_path);
+    auto mtime = fs::last_write_time(abs_path, ec);
+    if (!source || ec)
+        return;
+    key = SourceKey{source->size(),
+                    static_cast<int64_t>(mtime.time_since_epoch().count()),
+                    utils::checksum(source->data(), source->size())};
+}
+
+Bytecode *CacheEntry::load() {
+    if (!key)
+        return nullptr;
+    auto data = utils::read_file(entry_path);
+    if (!data || data->size() < sizeof(EntryHeader)) {
+        LOGMAX("No module cache entry " << entry_path);
+        return nullptr;
+    }
+    EntryHeader header;
+    std::memcpy(&header, data->data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0
+            || header.format_version != CACHE_FORMAT_VERSION
+            || header.moss_version != MOSS_VERSION_UINT32
+            || header.bc_version != bc_header::BYTECODE_VERSION) {
+        LOGMAX("Module cache entry " << entry_path << " was created by different version");
+        return nullptr;
+    }
+    if (header.opt_level != clopts::get_opt_level()) {
+        LOGMAX("Module cache entry " << entry_path << " was compiled with different optimization level");
+        return nullptr;
+    }
+    if (data->size() != sizeof(header) + header.path_size + header.bc_size
+            || data->compare(sizeof(header), header.path_size, src_path) != 0) {
+        LOGMAX("Module cache entry " << entry_path << " is for different source");
+        return nullptr;
+    }
+    if (header.source.size != key->size || header.source.mtime != key->mtime || header.source.hash != key->hash) {
+        LOGMAX("Module cache entry " << entry_path << " is stale");
+        return nullptr;
+    }
+    auto bc_start = data->data() + sizeof(header) + header.path_size;
+    if (header.bc_checksum != utils::checksum(bc_start, header.bc_size)) {
+        LOGMAX("Module cache entry " << entry_path << " is corrupted");
+        return nullptr;
+    }
+
+    MemoryBytecodeFile bf(entry_path, ustring(bc_start, header.bc_size));
+    BytecodeReader reader(bf);
+    LOGMAX("Using module cache entry " << entry_path);
+    return reader.read();
+}
+
+void CacheEntry::store(Bytecode *bc) {
+    namespace fs = std::filesystem;
+    if (!key)
+        return;
+    MemoryBytecodeFile bf(entry_path);
+    {
+        BytecodeWriter writer(bf);
+        writer.write(bc);
+    }
+    auto bc_data = bf.contents();
+
+    EntryHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.format_version = CACHE_FORMAT_VERSION;
+    header.moss_version = MOSS_VERSION_UINT32;
+    header.bc_version = bc_header::BYTECODE_VERSION;
+    header.opt_level = clopts::get_opt_level();
+    header.path_size = static_cast<uint32_t>(src_path.size());
+    header.source = *key;
+    header.bc_size = bc_data.size();
+    header.bc_checksum = utils::checksum(bc_data.data(), bc_data.size());
+
+    std::error_code ec;
+    fs::create_directories(fs::path(entry_path).parent_path(), ec);
+    if (ec) {
+        LOGMAX("Could not create module cache directory for " << entry_path << ": " << ec.message());
+        return;
+    }
+    auto tmp_path = entry_path + "." + std::to_string(std::random_device{}()) + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(src_path.data(), src_path.size());
+        out.write(bc_data.data(), bc_data.size());
+        if (!out) {
+            LOGMAX("Could not write module cache entry " << tmp_path);
+            out.close();
+            fs::remove(tmp_path, ec);
+            return;
+        }
+    }
+    fs::rename(tmp_path, entry_path, ec);
+    if (ec) {
+        LOGMAX("Could not write module cache entry " << entry_path << ": " << ec.message());
+        fs::remove(tmp_path, ec);
+    }
+}
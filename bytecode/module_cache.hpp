@@ -0,0 +1,76 @@
+///
+/// \file module_cache.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Cache of compiled bytecode for imported moss source modules
+///
+/// When a module is imported from .ms file, its compiled bytecode is stored
+/// into a cache entry and next import of the same unchanged file reads the
+/// bytecode instead of parsing and compiling the source again.
+/// By default entries are stored in `__mosscache__` directory next to the
+/// source file, this can be relocated by --module-cache-dir or the
+/// MOSS_MODULE_CACHE environment variable (value "off" disables the cache).
+///
+
+#ifndef _MODULE_CACHE_HPP_
+#define _MODULE_CACHE_HPP_
+
+#include "commons.hpp"
+#include <cstdint>
+#include <optional>
+
+namespace moss {
+
+class Bytecode;
+
+/// Namespace for compiled module cache resources
+namespace module_cache {
+
+/// Name of the cache directory created next to module sources
+inline constexpr char CACHE_DIR_NAME[] = "__mosscache__";
+
+/// \return true if compiled modules should be cached
+bool is_enabled();
+
+/// \brief Cache entry for a single module source file
+///
+/// Entry is valid only for the source it was created from, which is checked
+/// using the source size, modification time and hash of its contents and
+/// also for the moss and bytecode version which created it.
+class CacheEntry {
+public:
+    /// Information identifying the compiled source
+    struct SourceKey {
+        uint64_t size;
+        int64_t mtime;
+        uint64_t hash;
+    };
+private:
+    ustring src_path;
+    ustring entry_path;
+    std::optional<SourceKey> key;
+public:
+    /// \param src_path Path to the module source file
+    CacheEntry(ustring src_path);
+
+    /// \return Bytecode read from the entry or nullptr if there is no
+    ///         entry or it does not match current source
+    Bytecode *load();
+
+    /// Writes compiled bytecode of the source into the entry.
+    /// Entry is written into a temporary file first and then renamed so
+    /// that other running interpreters never read partially written entry.
+    /// Any failure (e.g. read-only directory) is silently ignored.
+    void store(Bytecode *bc);
+
+    /// \return Path to the entry file
+    ustring get_entry_path() { return entry_path; }
+};
+
+}
+
+}
+
+#endif//_MODULE_CACHE_HPP_
@@ -0,0 +1,243 @@
+#include "module_precompiler.hpp"
+#include "module_cache.hpp"
+#include "bytecode.hpp"
+#include "bytecodegen.hpp"
+#include "opcode.hpp"
+#include "parser.hpp"
+#include "ir_pipeline.hpp"
+#include "source.hpp"
+#include "clopts.hpp"
+#include "logging.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace moss;
+using namespace module_precompiler;
+
+namespace {
+
+/// Pool of threads compiling scheduled modules
+class Precompiler {
+private:
+    enum class State {
+        QUEUED,     ///< Waiting for a thread
+        CLAIMED,    ///< Taken before compilation started, will not be compiled
+        RUNNING,    ///< Being compiled
+        DONE,       ///< Compiled (or failed) and not taken yet
+        TAKEN       ///< Result was taken
+    };
+
+    struct Task {
+        State state;
+        std::optional<CompiledModule> result;
+    };
+
+    std::mutex mtx;
+    std::condition_variable queued_cv;
+    std::condition_variable done_cv;
+    std::unordered_map<ustring, Task> tasks;
+    std::deque<ustring> queue;
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    void work();
+    std::optional<CompiledModule> compile(const ustring &path);
+public:
+    Precompiler(unsigned jobs);
+    ~Precompiler();
+
+    void schedule(const std::vector<ustring> &paths);
+    std::optional<CompiledModule> take(const ustring &path);
+};
+
+/// \return Paths of .ms modules imported by bc from address start
+std::vector<ustring> find_imported_sources(Bytecode *bc, opcode::Address start=0) {
+    std::vector<ustring> paths;
+    auto &code = bc->get_raw_code();
+    // Lazily read function bodies are not decoded just for this
+    for (auto i = start; i < code.size(); ++i) {
+        auto op = code[i];
+        if (!op)
+            continue;
+        auto imp = dyn_cast<opcode::Import>(op);
+        if (!imp)
+            continue;
+        // Bytecode modules are preferred by import and need no compilation
+        if (get_file_path(imp->name + ".msb"))
+            continue;
+        if (auto path = get_file_path(imp->name + ".ms"))
+            paths.push_back(*path);
+    }
+    return paths;
+}
+
+Precompiler &get_precompiler() {
+    static Precompiler precompiler(args::get(clopts::import_jobs));
+    return precompiler;
+}
+
+}
+
+Precompiler::Precompiler(unsigned jobs) : stopping(false) {
+    // Lookup path has to outlive the threads
+    get_lookup_path();
+    for (unsigned i = 0; i < jobs; ++i)
+        workers.emplace_back(&Precompiler::work, this);
+}
+
+Precompiler::~Precompiler() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    queued_cv.notify_all();
+    for (auto &w: workers) {
+        // Fatal error in a worker exits from its own thread
+        if (w.get_id() == std::this_thread::get_id())
+            w.detach();
+        else
+            w.join();
+    }
+    for (auto &[_, task]: tasks) {
+        if (task.result) {
+            delete task.result->bc;
+            delete task.result->file;
+        }
+    }
+}
+
+void Precompiler::schedule(const std::vector<ustring> &paths) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &p: paths) {
+            if (tasks.try_emplace(p, Task{State::QUEUED, std::nullopt}).second) {
+                LOGMAX("Scheduling precompilation of " << p);
+                queue.push_back(p);
+            }
+        }
+    }
+    queued_cv.notify_all();
+}
+
+std::optional<CompiledModule> Precompiler::take(const ustring &path) {
+    std::unique_lock<std::mutex> lock(mtx);
+    auto it = tasks.find(path);
+    if (it == tasks.end())
+        return std::nullopt;
+    auto &task = it->second;
+    if (task.state == State::QUEUED) {
+        // Compiling it right away is faster than waiting for a free thread
+        task.state = State::CLAIMED;
+        return std::nullopt;
+    }
+    done_cv.wait(lock, [&task]() { return task.state != State::RUNNING; });
+    if (task.state != State::DONE)
+        return std::nullopt;
+    task.state = State::TAKEN;
+    auto result = task.result;
+    task.result.reset();
+    return result;
+}
+
+void Precompiler::work() {
+    while (true) {
+        ustring path;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            queued_cv.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            path = queue.front();
+            queue.pop_front();
+            auto &task = tasks[path];
+            if (task.state != State::QUEUED)
+                continue;
+            task.state = State::RUNNING;
+        }
+
+        auto result = compile(path);
+        // Imports have to be found before the result can be taken and run
+        std::vector<ustring> imported;
+        if (result)
+            imported = find_imported_sources(result->bc);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto &task = tasks[path];
+            task.result = result;
+            task.state = State::DONE;
+        }
+        done_cv.notify_all();
+        schedule(imported);
+    }
+}
+
+std::optional<CompiledModule> Precompiler::compile(const ustring &path) {
+    LOGMAX("Precompiling module " << path);
+    // SourceFile reports inaccessible file as a fatal error, but the file
+    // might not even be imported
+    if (!std::ifstream(path))
+        return std::nullopt;
+    auto module_file = new SourceFile(path, SourceFile::SourceType::FILE);
+
+    std::optional<module_cache::CacheEntry> cache_entry;
+    if (module_cache::is_enabled()) {
+        cache_entry.emplace(path);
+        if (auto bc = cache_entry->load())
+            return CompiledModule{bc, module_file};
+    }
+
+    // Errors are not reported here, import compiles the module again
+    // and reports them once the import is actually executed
+    Parser parser(*module_file);
+    auto module_ir = parser.parse();
+    ir::IRPipeline ipl(parser, clopts::get_opt_level());
+    if (auto err = ipl.run(module_ir)) {
+        delete err;
+        delete module_file;
+        return std::nullopt;
+    }
+    if (isa<ir::Raise>(module_ir)) {
+        delete module_ir;
+        delete module_file;
+        return std::nullopt;
+    }
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    try {
+        cgen.generate(module_ir);
+    } catch (ir::IR *err) {
+        delete err;
+        delete module_ir;
+        delete bc;
+        delete module_file;
+        return std::nullopt;
+    }
+    delete module_ir;
+    if (cache_entry)
+        cache_entry->store(bc);
+    return CompiledModule{bc, module_file};
+}
+
+bool module_precompiler::is_enabled() {
+    if (!clopts::import_jobs || args::get(clopts::import_jobs) == 0)
+        return false;
+    // Warnings would be reported out of order from other threads
+    return clopts::get_warning_level() == clopts::WarningLevel::WL_IGNORE;
+}
+
+void module_precompiler::schedule_imports(Bytecode *bc, opcode::Address start) {
+    if (!is_enabled())
+        return;
+    get_precompiler().schedule(find_imported_sources(bc, start));
+}
+
+std::optional<CompiledModule> module_precompiler::take(const ustring &path) {
+    if (!is_enabled())
+        return std::nullopt;
+    return get_precompiler().take(path);
+}
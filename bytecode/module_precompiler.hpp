@@ -0,0 +1,56 @@
+///
+/// \file module_precompiler.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Parallel compilation of imported moss source modules
+///
+/// With --import-jobs the modules imported by the main module are found in
+/// its bytecode and compiled on a pool of threads while the main module
+/// runs. Imports of compiled modules are scheduled as well, so the whole
+/// dependency graph gets compiled ahead of its import. IMPORT then only
+/// picks up the finished bytecode instead of compiling the module.
+///
+
+#ifndef _MODULE_PRECOMPILER_HPP_
+#define _MODULE_PRECOMPILER_HPP_
+
+#include "commons.hpp"
+#include <optional>
+
+namespace moss {
+
+class Bytecode;
+class SourceFile;
+
+/// Namespace for ahead of import module compilation
+namespace module_precompiler {
+
+/// Module compiled by the precompiler
+struct CompiledModule {
+    Bytecode *bc;
+    SourceFile *file;
+};
+
+/// \return true if imported modules should be compiled ahead of their import
+bool is_enabled();
+
+/// Schedules compilation of .ms modules imported by bc (from address start)
+/// which were not scheduled yet.
+/// Has to be called before this code is run, as running it modifies its
+/// opcodes.
+void schedule_imports(Bytecode *bc, opcode::Address start=0);
+
+/// Takes the compiled module for source path, if it is being compiled it
+/// waits for it to finish.
+/// \return Compiled module or nullopt if the module was not scheduled or it
+///         could not be compiled (errors are then reported by the caller
+///         compiling it again).
+std::optional<CompiledModule> take(const ustring &path);
+
+}
+
+}
+
+#endif//_MODULE_PRECOMPILER_HPP_
@@ -8,6 +8,10 @@
 #include "bytecode_reader.hpp"
 #include "bytecodegen.hpp"
 #include "ir_pipeline.hpp"
+#include "snapshot.hpp"
+#include "module_cache.hpp"
+#include "module_precompiler.hpp"
+#include "note_cache.hpp"
 #include "mslib_list.hpp"
 #include <sstream>
 #include <cmath>
@@ -39,6 +43,15 @@ static bool is_int_expr(Value *v1, Value *v2) {
     return isa<IntValue>(v1) && isa<IntValue>(v2);
 }
 
+/// \return true if op is the opcode at current bci
+static bool is_current_opcode(Interpreter *vm, OpCode *op) {
+    // Opcode might have jumped (e.g. operator function call) and then its
+    // position is not known
+    auto code = vm->get_code();
+    auto bci = vm->get_bci();
+    return bci < code->size() && (*code)[bci] == op;
+}
+
 bool opcode::is_type_eq_or_subtype(Value *t1, Value *t2) {
     if (t1 == t2)
         return true;
@@ -207,6 +220,15 @@ void LoadAttr::exec(Interpreter *vm) {
         diags::Diagnostic(*vm->get_src_file(), diags::ATTRIB_NOT_DEFINED,
             get_type_or_name(v).c_str(), this->name.c_str())));
     vm->store(this->dst, attr);
+
+    // Only attributes directly in object's attribute pool can use slot cache
+    OpCodes candidate = OpCodes::OPCODES_AMOUNT;
+    if (isa<ObjectValue>(v) && v->get_attrs() && v->get_attrs()->get_name_register(this->name))
+        candidate = OpCodes::LOAD_ATTR_SLOT;
+    if (observe_quickening(candidate) && is_current_opcode(vm, this)) {
+        LOGMAX("Quickening " << *this << " into LOAD_ATTR_SLOT");
+        vm->get_code()->quicken(vm->get_bci(), new LoadAttrSlot(this));
+    }
 }
 
 void LoadGlobal::exec(Interpreter *vm) {
@@ -407,7 +429,7 @@ static std::optional<diags::DiagID> can_call(FunValue *f, CallFrame *cf) {
     assert(f && "sanity check");
     LOGMAX("Checking if can call " << *f);
     auto &og_call_args = cf->get_args();
-    const auto fun_args = f->get_args();
+    const auto &fun_args = f->get_args();
 
 #ifndef NDEBUG
     unsigned indx = 0;
@@ -616,7 +638,10 @@ static ustring create_fun_args_str(std::vector<CallFrameArg> args) {
     return ss.str();
 }
 
-void call(Interpreter *vm, Register dst, Value *funV) {
+/// \brief Calls funV with arguments in the current call frame
+/// \param tail If true then this is a tail call and the frame of the calling
+///             function is reused when possible
+void call(Interpreter *vm, Register dst, Value *funV, bool tail=false) {
     LOGMAX("Call to : " << *funV);
     auto cf = vm->get_call_frame();
     cf->set_return_reg(dst);
@@ -717,7 +742,7 @@ void call(Interpreter *vm, Register dst, Value *funV) {
         std::vector<std::pair<FunValue *, diags::DiagID>> call_errors;
         std::optional<diags::DiagID> err_id;
         // Walk functions backward and check if it can be called
-        auto fun_vect = fvl->get_funs();
+        const auto &fun_vect = fvl->get_funs();
         for (auto it = fun_vect.rbegin(); it != fun_vect.rend(); ++it) {
             auto f = *it;
             err_id = can_call(f, cf);
@@ -812,7 +837,8 @@ void call(Interpreter *vm, Register dst, Value *funV) {
         }
     }
     else {
-        vm->push_frame(fun);
+        if (!tail || !vm->tail_call(fun))
+            vm->push_frame(fun);
         vm->set_bci(fun->get_body_addr());
     }
 }
@@ -916,7 +942,7 @@ FunValue *opcode::select_function(Value *fun, std::initializer_list<Value *> arg
     FunValue *funf = dyn_cast<FunValue>(fun);
     if (!funf && isa<FunValueList>(fun)) {
         auto funflist = dyn_cast<FunValueList>(fun);
-        auto fun_vect = funflist->get_funs();
+        const auto &fun_vect = funflist->get_funs();
         for (auto it = fun_vect.rbegin(); it != fun_vect.rend(); ++it) {
             auto f = *it;
             CallFrame cf;
@@ -1000,6 +1026,12 @@ void Call::exec(Interpreter *vm) {
     call(vm, dst, v);
 }
 
+void TailCall::exec(Interpreter *vm) {
+    auto v = vm->load(src);
+    assert(v && "register does not contain a value");
+    call(vm, dst, v, true);
+}
+
 void CallFormatter::exec(Interpreter *vm) {
     diags::DiagID did;
     assert(vm->get_call_frame()->get_args().size() == 1 && "Note should have 1 arg and that is the note string");
@@ -1372,6 +1404,7 @@ ModuleValue *opcode::load_module(Interpreter *vm, ustring name) {
         }
     }
     ustring path = *path_opt;
+    note_cache::module_loaded(path);
     Bytecode *bc = nullptr;
     File *input_file = nullptr;
 
@@ -1386,29 +1419,43 @@ ModuleValue *opcode::load_module(Interpreter *vm, ustring name) {
         if (name != "libms")
             LOGMAX("Read bytecode: \n" << *bc);
 #endif
+    } else if (auto compiled = module_precompiler::take(path)) {
+        LOGMAX("Using precompiled module");
+        bc = compiled->bc;
+        input_file = compiled->file;
     } else {
         auto module_file = new SourceFile(path, SourceFile::SourceType::FILE);
         input_file = module_file;
-        Parser parser(*module_file);
-        auto module_ir = parser.parse();
-        ir::IRPipeline ipl(parser);
-        if (auto err = ipl.run(module_ir)) {
-            module_ir = err;
-        }
-        if (auto exc = dyn_cast<ir::Raise>(module_ir)) {
-            // Parser error... there is not VM so it is returned as a StringValue
-            // place it into an exception and raise it correctly
-            raise_ir_error(exc);
-        }
-        bc = new Bytecode();
-        bcgen::BytecodeGen cgen(bc);
-        try {
-            cgen.generate(module_ir);
-        } catch (ir::IR *err) {
-            raise_ir_error(err);
+        std::optional<module_cache::CacheEntry> cache_entry;
+        if (module_cache::is_enabled()) {
+            cache_entry.emplace(path);
+            bc = cache_entry->load();
+        }
+        if (!bc) {
+            Parser parser(*module_file);
+            auto module_ir = parser.parse();
+            ir::IRPipeline ipl(parser, clopts::get_opt_level());
+            if (auto err = ipl.run(module_ir)) {
+                module_ir = err;
+            }
+            if (auto exc = dyn_cast<ir::Raise>(module_ir)) {
+                // Parser error... there is not VM so it is returned as a StringValue
+                // place it into an exception and raise it correctly
+                raise_ir_error(exc);
+            }
+            bc = new Bytecode();
+            bcgen::BytecodeGen cgen(bc);
+            try {
+                cgen.generate(module_ir);
+            } catch (ir::IR *err) {
+                raise_ir_error(err);
+            }
+            LOGMAX("Generated bytecode: \n" << *bc);
+            delete module_ir;
+            if (cache_entry)
+                cache_entry->store(bc);
         }
-        LOGMAX("Generated bytecode: \n" << *bc);
-        delete module_ir;
+        module_precompiler::schedule_imports(bc);
     }
 
     auto mod_i = new Interpreter(bc, input_file);
@@ -1417,7 +1464,18 @@ ModuleValue *opcode::load_module(Interpreter *vm, ustring name) {
     auto gen_mod = new ModuleValue(name, mod_i->get_global_frame(), mod_i);
     mod_i->set_vms_module(gen_mod);
     vm->push_currently_imported_module(gen_mod);
-    mod_i->run_from_external(nullptr);
+    // libms heap can be restored from its snapshot instead of running it
+    bool libms_snapshot = is_msb && name == "libms";
+    if (libms_snapshot && !snapshot::LibmsSnapshot::is_creating() && !clopts::no_libms_snapshot
+            && snapshot::LibmsSnapshot::restore(mod_i, path)) {
+        LOGMAX("libms restored from snapshot");
+    } else if (libms_snapshot && snapshot::LibmsSnapshot::is_creating()) {
+        snapshot::LibmsSnapshot::begin(mod_i);
+        mod_i->run_from_external(nullptr);
+        snapshot::LibmsSnapshot::write(mod_i);
+    } else {
+        mod_i->run_from_external(nullptr);
+    }
     if (mod_i->get_exit_code() != 0) {
         LOGMAX("Import exited, delegating exit code");
         vm->set_exit_code(mod_i->get_exit_code());
@@ -1604,6 +1662,12 @@ void Document::exec(Interpreter *vm) {
     d->set_attr(known_names::DOC_STRING, docv, true);
 }
 
+/// Passes note to the generator
+static void add_generator_note(Value *v) {
+    note_cache::record_generator_note(v);
+    Interpreter::add_generator_note(v);
+}
+
 void Output::exec(Interpreter *vm) {
     static std::unordered_set<ustring> running_converters{};
     if (clopts::disable_notes) {
@@ -1629,14 +1693,14 @@ void Output::exec(Interpreter *vm) {
         // notebook output
         if (vm->is_enable_code_output() && val_format == "txt") {
             if (target_format == "html") {
-                Interpreter::add_generator_note(new NoteValue("html", StringValue::get("<div class=\"moss-output-wrapper\"><pre class=\"moss-output\"><code class=\"moss-output-code\">")));
-                Interpreter::add_generator_note(v);
-                Interpreter::add_generator_note(new NoteValue("html", StringValue::get("</code></pre></div>")));
+                add_generator_note(new NoteValue("html", StringValue::get("<div class=\"moss-output-wrapper\"><pre class=\"moss-output\"><code class=\"moss-output-code\">")));
+                add_generator_note(v);
+                add_generator_note(new NoteValue("html", StringValue::get("</code></pre></div>")));
                 return;
             }
         }
 
-        Interpreter::add_generator_note(v);
+        add_generator_note(v);
         return;
     }
     else if (val_format != target_format) {
@@ -1667,6 +1731,7 @@ void Output::exec(Interpreter *vm) {
         }
     }
     
+    note_cache::record_output(ov);
     clopts::get_note_stream() << ov;
     if (clopts::print_notes)
         outs << ov;
@@ -1776,21 +1841,30 @@ static Value *add(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Add::exec(Interpreter *vm) {
-    auto res = add(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = add(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Add2::exec(Interpreter *vm) {
-    auto res = add(vm->load_const(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = add(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Add3::exec(Interpreter *vm) {
-    auto res = add(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = add(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *sub(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -1814,21 +1888,30 @@ static Value *sub(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Sub::exec(Interpreter *vm) {
-    auto res = sub(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = sub(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Sub2::exec(Interpreter *vm) {
-    auto res = sub(vm->load_const(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = sub(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Sub3::exec(Interpreter *vm) {
-    auto res = sub(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = sub(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *div(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -1924,21 +2007,30 @@ static Value *mul(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Mul::exec(Interpreter *vm) {
-    auto res = mul(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = mul(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Mul2::exec(Interpreter *vm) {
-    auto res = mul(vm->load_const(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = mul(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Mul3::exec(Interpreter *vm) {
-    auto res = mul(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = mul(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *mod(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -2174,18 +2266,27 @@ bool opcode::bt(Value *s1, Value *s2, Interpreter *vm) {
 }
 
 void Bt::exec(Interpreter *vm) {
-    auto res = bt(vm->load(src1), vm->load(src2), vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = bt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Bt2::exec(Interpreter *vm) {
-    auto res = bt(vm->load_const(src1), vm->load(src2), vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = bt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Bt3::exec(Interpreter *vm) {
-    auto res = bt(vm->load(src1), vm->load_const(src2), vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = bt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 bool opcode::lt(Value *s1, Value *s2, Interpreter *vm) {
@@ -2228,18 +2329,27 @@ bool opcode::lt(Value *s1, Value *s2, Interpreter *vm) {
 }
 
 void Lt::exec(Interpreter *vm) {
-    auto res = lt(vm->load(src1), vm->load(src2), vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = lt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Lt2::exec(Interpreter *vm) {
-    auto res = lt(vm->load_const(src1), vm->load(src2), vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = lt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Lt3::exec(Interpreter *vm) {
-    auto res = lt(vm->load(src1), vm->load_const(src2), vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = lt(s1, s2, vm);
     vm->store(dst, BoolValue::get(res));
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *beq(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -2268,21 +2378,30 @@ static Value *beq(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Beq::exec(Interpreter *vm) {
-    auto res = beq(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = beq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Beq2::exec(Interpreter *vm) {
-    auto res = beq(vm->load_const(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = beq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Beq3::exec(Interpreter *vm) {
-    auto res = beq(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = beq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *leq(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -2311,21 +2430,30 @@ static Value *leq(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Leq::exec(Interpreter *vm) {
-    auto res = leq(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = leq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Leq2::exec(Interpreter *vm) {
-    auto res = leq(vm->load_const(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load_const(src1);
+    auto s2 = vm->load(src2);
+    auto res = leq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Leq3::exec(Interpreter *vm) {
-    auto res = leq(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = leq(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 static Value *in(Value *s1, Value *s2, Register dst, Interpreter *vm) {
@@ -2640,9 +2768,12 @@ static Value *subsc(Value *s1, Value *s2, Register dst, Interpreter *vm) {
 }
 
 void Subsc::exec(Interpreter *vm) {
-    auto res = subsc(vm->load(src1), vm->load(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load(src2);
+    auto res = subsc(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void Subsc2::exec(Interpreter *vm) {
@@ -2652,9 +2783,12 @@ void Subsc2::exec(Interpreter *vm) {
 }
 
 void Subsc3::exec(Interpreter *vm) {
-    auto res = subsc(vm->load(src1), vm->load_const(src2), dst, vm);
+    auto s1 = vm->load(src1);
+    auto s2 = vm->load_const(src2);
+    auto res = subsc(s1, s2, dst, vm);
     if (res)
         vm->store(dst, res);
+    quicken_bin_expr(vm, this, s1, s2);
 }
 
 void SubscLast::exec(Interpreter *vm) {
@@ -3122,4 +3256,352 @@ void LoopEnd::exec(Interpreter *vm) {
     vm->pop_finally_stack();
 }
 
+// Quickening
+
+/// Amount of executions in a row with operands of the same types after which
+/// an opcode is replaced by its quickened version
+static constexpr uint8_t QUICKEN_THRESHOLD = 16;
+
+bool OpCode::observe_quickening(OpCodes candidate) {
+    if (quicken_disabled)
+        return false;
+    if (candidate != quicken_candidate) {
+        quicken_candidate = candidate;
+        quicken_hits = 0;
+    }
+    if (candidate == OpCodes::OPCODES_AMOUNT)
+        return false;
+    if (quicken_hits < QUICKEN_THRESHOLD)
+        ++quicken_hits;
+    return quicken_hits >= QUICKEN_THRESHOLD && !clopts::no_quickening;
+}
+
+void OpCode::expect_quickening(OpCodes candidate) {
+    quicken_candidate = candidate;
+    quicken_hits = QUICKEN_THRESHOLD - 1;
+}
+
+/// Sets int_op and float_op to quickened opcode types of arithmetic or
+/// comparison generic for int and float operands
+/// \return false if there are none
+static bool get_typed_quickened(OpCodes generic, OpCodes &int_op, OpCodes &float_op) {
+    switch (generic) {
+        case OpCodes::ADD:
+        case OpCodes::ADD2:
+        case OpCodes::ADD3:
+            int_op = OpCodes::ADD_INT_INT;
+            float_op = OpCodes::ADD_FLOAT_FLOAT;
+        break;
+        case OpCodes::SUB:
+        case OpCodes::SUB2:
+        case OpCodes::SUB3:
+            int_op = OpCodes::SUB_INT_INT;
+            float_op = OpCodes::SUB_FLOAT_FLOAT;
+        break;
+        case OpCodes::MUL:
+        case OpCodes::MUL2:
+        case OpCodes::MUL3:
+            int_op = OpCodes::MUL_INT_INT;
+            float_op = OpCodes::MUL_FLOAT_FLOAT;
+        break;
+        case OpCodes::LT:
+        case OpCodes::LT2:
+        case OpCodes::LT3:
+            int_op = OpCodes::LT_INT_INT;
+            float_op = OpCodes::LT_FLOAT_FLOAT;
+        break;
+        case OpCodes::BT:
+        case OpCodes::BT2:
+        case OpCodes::BT3:
+            int_op = OpCodes::BT_INT_INT;
+            float_op = OpCodes::BT_FLOAT_FLOAT;
+        break;
+        case OpCodes::LEQ:
+        case OpCodes::LEQ2:
+        case OpCodes::LEQ3:
+            int_op = OpCodes::LEQ_INT_INT;
+            float_op = OpCodes::LEQ_FLOAT_FLOAT;
+        break;
+        case OpCodes::BEQ:
+        case OpCodes::BEQ2:
+        case OpCodes::BEQ3:
+            int_op = OpCodes::BEQ_INT_INT;
+            float_op = OpCodes::BEQ_FLOAT_FLOAT;
+        break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+/// \return quickened opcode type for generic binary expression with
+///         operands s1 and s2 or OPCODES_AMOUNT if there is none
+static OpCodes select_quickened(OpCodes generic, Value *s1, Value *s2) {
+    if (generic == OpCodes::SUBSC || generic == OpCodes::SUBSC3) {
+        if (isa<ListValue>(s1) && isa<IntValue>(s2))
+            return OpCodes::SUBSC_LIST_INT;
+        return OpCodes::OPCODES_AMOUNT;
+    }
+    OpCodes int_op = OpCodes::OPCODES_AMOUNT;
+    OpCodes float_op = OpCodes::OPCODES_AMOUNT;
+    if (!get_typed_quickened(generic, int_op, float_op))
+        return OpCodes::OPCODES_AMOUNT;
+    if (isa<IntValue>(s1) && isa<IntValue>(s2))
+        return int_op;
+    if (isa<FloatValue>(s1) && isa<FloatValue>(s2))
+        return float_op;
+    return OpCodes::OPCODES_AMOUNT;
+}
+
+/// \return where are operands of generic binary expression stored
+static OperandKind get_operand_kind(OpCodes generic) {
+    switch (generic) {
+        case OpCodes::ADD2:
+        case OpCodes::SUB2:
+        case OpCodes::MUL2:
+        case OpCodes::LT2:
+        case OpCodes::BT2:
+        case OpCodes::LEQ2:
+        case OpCodes::BEQ2:
+            return OperandKind::CONST_REG;
+        case OpCodes::ADD3:
+        case OpCodes::SUB3:
+        case OpCodes::MUL3:
+        case OpCodes::LT3:
+        case OpCodes::BT3:
+        case OpCodes::LEQ3:
+        case OpCodes::BEQ3:
+        case OpCodes::SUBSC3:
+            return OperandKind::REG_CONST;
+        default:
+            return OperandKind::REG_REG;
+    }
+}
+
+void opcode::quicken_bin_expr(Interpreter *vm, BinExprOpCode *op, Value *s1, Value *s2) {
+    auto candidate = select_quickened(op->get_type(), s1, s2);
+    if (!op->observe_quickening(candidate) || !is_current_opcode(vm, op))
+        return;
+    auto kind = get_operand_kind(op->get_type());
+    OpCode *quickened = nullptr;
+    switch (candidate) {
+        case OpCodes::ADD_INT_INT: quickened = new AddIntInt(op, kind); break;
+        case OpCodes::ADD_FLOAT_FLOAT: quickened = new AddFloatFloat(op, kind); break;
+        case OpCodes::SUB_INT_INT: quickened = new SubIntInt(op, kind); break;
+        case OpCodes::SUB_FLOAT_FLOAT: quickened = new SubFloatFloat(op, kind); break;
+        case OpCodes::MUL_INT_INT: quickened = new MulIntInt(op, kind); break;
+        case OpCodes::MUL_FLOAT_FLOAT: quickened = new MulFloatFloat(op, kind); break;
+        case OpCodes::LT_INT_INT: quickened = new LtIntInt(op, kind); break;
+        case OpCodes::LT_FLOAT_FLOAT: quickened = new LtFloatFloat(op, kind); break;
+        case OpCodes::BT_INT_INT: quickened = new BtIntInt(op, kind); break;
+        case OpCodes::BT_FLOAT_FLOAT: quickened = new BtFloatFloat(op, kind); break;
+        case OpCodes::LEQ_INT_INT: quickened = new LeqIntInt(op, kind); break;
+        case OpCodes::LEQ_FLOAT_FLOAT: quickened = new LeqFloatFloat(op, kind); break;
+        case OpCodes::BEQ_INT_INT: quickened = new BeqIntInt(op, kind); break;
+        case OpCodes::BEQ_FLOAT_FLOAT: quickened = new BeqFloatFloat(op, kind); break;
+        case OpCodes::SUBSC_LIST_INT: quickened = new SubscListInt(op, kind); break;
+        default:
+            assert(false && "Missing quickened opcode");
+            return;
+    }
+    LOGMAX("Quickening " << *op << " into " << quickened->get_mnem());
+    vm->get_code()->quicken(vm->get_bci(), quickened);
+}
+
+void opcode::expect_typed_operands(BinExprOpCode *op, bool floats) {
+    OpCodes int_op = OpCodes::OPCODES_AMOUNT;
+    OpCodes float_op = OpCodes::OPCODES_AMOUNT;
+    if (get_typed_quickened(op->get_type(), int_op, float_op))
+        op->expect_quickening(floats ? float_op : int_op);
+}
+
+void QuickenedOpCode::dequicken(Interpreter *vm) {
+    LOGMAX("De-quickening " << *generic);
+    // Types are not stable, so don't try to quicken again
+    generic->disable_quickening();
+    vm->get_code()->dequicken(vm->get_bci(), generic);
+    generic->exec(vm);
+}
+
+void QuickenedBinExpr::load_operands(Interpreter *vm, Value *&s1, Value *&s2) {
+    switch (kind) {
+        case OperandKind::REG_REG:
+            s1 = vm->load(src1);
+            s2 = vm->load(src2);
+        break;
+        case OperandKind::CONST_REG:
+            s1 = vm->load_const(src1);
+            s2 = vm->load(src2);
+        break;
+        case OperandKind::REG_CONST:
+            s1 = vm->load(src1);
+            s2 = vm->load_const(src2);
+        break;
+    }
+}
+
+/// True iff both values are floats (not ints)
+static bool is_float_float_expr(Value *v1, Value *v2) {
+    return isa<FloatValue>(v1) && isa<FloatValue>(v2);
+}
+
+static inline IntConst int_val(Value *v) {
+    return static_cast<IntValue *>(v)->get_value();
+}
+
+static inline FloatConst float_val(Value *v) {
+    return static_cast<FloatValue *>(v)->get_value();
+}
+
+void AddIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, IntValue::get(int_val(s1) + int_val(s2)));
+}
+
+void AddFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, FloatValue::get(float_val(s1) + float_val(s2)));
+}
+
+void SubIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, IntValue::get(int_val(s1) - int_val(s2)));
+}
+
+void SubFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, FloatValue::get(float_val(s1) - float_val(s2)));
+}
+
+void MulIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, IntValue::get(int_val(s1) * int_val(s2)));
+}
+
+void MulFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, FloatValue::get(float_val(s1) * float_val(s2)));
+}
+
+void LtIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(int_val(s1) < int_val(s2)));
+}
+
+void LtFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(float_val(s1) < float_val(s2)));
+}
+
+void BtIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(int_val(s1) > int_val(s2)));
+}
+
+void BtFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(float_val(s1) > float_val(s2)));
+}
+
+void LeqIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(int_val(s1) <= int_val(s2)));
+}
+
+void LeqFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(float_val(s1) <= float_val(s2)));
+}
+
+void BeqIntInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_int_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(int_val(s1) >= int_val(s2)));
+}
+
+void BeqFloatFloat::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!is_float_float_expr(s1, s2))
+        return dequicken(vm);
+    vm->store(dst, BoolValue::get(float_val(s1) >= float_val(s2)));
+}
+
+void SubscListInt::exec(Interpreter *vm) {
+    Value *s1, *s2;
+    load_operands(vm, s1, s2);
+    if (!isa<ListValue>(s1) || !isa<IntValue>(s2))
+        return dequicken(vm);
+    auto &vals = static_cast<ListValue *>(s1)->get_vals();
+    auto index = int_val(s2);
+    if (index < 0)
+        index += static_cast<IntConst>(vals.size());
+    if (index < 0 || static_cast<uint64_t>(index) >= vals.size()) {
+        // Let the generic version raise the error
+        subsc(s1, s2, dst, vm);
+        return;
+    }
+    vm->store(dst, vals[index]);
+}
+
+void LoadAttrSlot::exec(Interpreter *vm) {
+    auto *v = vm->load(this->src);
+    if (isa<ObjectValue>(v)) {
+        auto attrs = v->get_attrs();
+        if (attrs == cached_pool && attrs->get_names_version() == cached_version) {
+            vm->store(this->dst, attrs->load(cached_reg));
+            return;
+        }
+        // Different object or its attributes changed, refill the cache
+        if (attrs) {
+            if (auto reg = attrs->get_name_register(this->name)) {
+                cached_pool = attrs;
+                cached_version = attrs->get_names_version();
+                cached_reg = *reg;
+                vm->store(this->dst, attrs->load(cached_reg));
+                return;
+            }
+        }
+    }
+    dequicken(vm);
+}
+
 #undef op_assert
\ No newline at end of file
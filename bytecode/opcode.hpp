@@ -20,6 +20,7 @@ namespace moss {
 
 class ModuleValue;
 class Interpreter;
+class MemoryPool;
 namespace opcode {
     class OpCode;
 }
@@ -195,8 +196,31 @@ enum OpCodes : opcode_t {
     ITER, // %iterator, %collection
     LOOP_BEGIN, //
     LOOP_END, //
-
-    OPCODES_AMOUNT
+    TAIL_CALL, //         %dst, fun
+
+    OPCODES_AMOUNT, // Amount of opcodes which can be stored in bytecode
+
+    // Quickened opcodes. These are created by the interpreter at runtime from
+    // generic opcodes once operand types are stable and are never stored
+    // in bytecode files.
+    ADD_INT_INT,    // %dst, %src1, %src2
+    ADD_FLOAT_FLOAT,// %dst, %src1, %src2
+    SUB_INT_INT,    // %dst, %src1, %src2
+    SUB_FLOAT_FLOAT,// %dst, %src1, %src2
+    MUL_INT_INT,    // %dst, %src1, %src2
+    MUL_FLOAT_FLOAT,// %dst, %src1, %src2
+    LT_INT_INT,     // %dst, %src1, %src2
+    LT_FLOAT_FLOAT, // %dst, %src1, %src2
+    BT_INT_INT,     // %dst, %src1, %src2
+    BT_FLOAT_FLOAT, // %dst, %src1, %src2
+    LEQ_INT_INT,    // %dst, %src1, %src2
+    LEQ_FLOAT_FLOAT,// %dst, %src1, %src2
+    BEQ_INT_INT,    // %dst, %src1, %src2
+    BEQ_FLOAT_FLOAT,// %dst, %src1, %src2
+    SUBSC_LIST_INT, // %dst, %src, %index
+    LOAD_ATTR_SLOT, // %dst, %src, "name"
+
+    QUICKENED_OPCODES_END
 };
 
 /// \brief Raises moss interpreter exception
@@ -252,9 +276,14 @@ class OpCode {
 protected:
     OpCodes op_type;
     ustring mnem;
+    OpCodes quicken_candidate; ///< Quickened opcode matching the last executed operands
+    uint8_t quicken_hits;      ///< How many times in a row was quicken_candidate observed
+    bool quicken_disabled;     ///< Set once quickened version of this was de-quickened
 
-    OpCode(OpCodes op_type, ustring mnem) : op_type(op_type), mnem(mnem) {
-        static_assert(OpCodes::OPCODES_AMOUNT <= 0xFF && "Opcodes cannot fit into 1 byte");
+    OpCode(OpCodes op_type, ustring mnem) : op_type(op_type), mnem(mnem),
+            quicken_candidate(OpCodes::OPCODES_AMOUNT), quicken_hits(0),
+            quicken_disabled(false) {
+        static_assert(OpCodes::QUICKENED_OPCODES_END <= 0xFF && "Opcodes cannot fit into 1 byte");
     }
 public:
     virtual ~OpCode() {}
@@ -272,6 +301,16 @@ public:
         (void)update_bci;
         (void)add_amount;
     }
+
+    /// \brief Records that this opcode could have been run by quickened opcode
+    /// \param candidate Quickened opcode type or OPCODES_AMOUNT if there is none
+    /// \return true if the same candidate was seen enough times to quicken
+    bool observe_quickening(OpCodes candidate);
+    /// \brief Makes the first observation of candidate quicken this opcode
+    /// Used when the types of the operands are known statically.
+    void expect_quickening(OpCodes candidate);
+    /// Disables any further quickening of this opcode
+    void disable_quickening() { this->quicken_disabled = true; }
 };
 
 /// Binary expression opcode
@@ -900,6 +939,33 @@ public:
     }
 };
 
+/// \brief Call in tail position (`return f()`)
+/// Frame of the returning function is reused for the called one when it
+/// cannot be observed (no exception handlers or finally in it and called
+/// function is not nested in it), otherwise this is a regular call and the
+/// return after it is executed.
+class TailCall : public OpCode {
+public:
+    Register dst;
+    Register src;
+
+    static const OpCodes ClassType = OpCodes::TAIL_CALL;
+
+    TailCall(Register dst, Register src) : OpCode(ClassType, "TAIL_CALL"), dst(dst), src(src) {}
+    
+    void exec(Interpreter *vm) override;
+    
+    virtual inline std::ostream& debug(std::ostream& os) const override {
+        os << mnem << "  %" << dst << ", %" << src;
+        return os;
+    }
+    bool equals(OpCode *other) override {
+        auto casted = dyn_cast<TailCall>(other);
+        if (!casted) return false;
+        return casted->src == src && casted->dst == dst;
+    }
+};
+
 class CallFormatter : public OpCode {
 public:
     Register dst;
@@ -2551,6 +2617,194 @@ public:
     }
 };
 
+// Quickened opcodes
+
+/// \brief Base of opcodes created at runtime by quickening
+/// Quickened opcode replaces its generic opcode in the bytecode and checks
+/// that operands are of expected types (guard). If not, it puts the generic
+/// opcode back (de-quickens) and runs it.
+class QuickenedOpCode {
+protected:
+    OpCode *generic; ///< Opcode this was created from
+
+    /// Puts generic opcode back into bytecode and executes it
+    void dequicken(Interpreter *vm);
+public:
+    QuickenedOpCode(OpCode *generic) : generic(generic) {}
+    virtual ~QuickenedOpCode() {}
+
+    OpCode *get_generic() { return this->generic; }
+};
+
+/// Where are operands of quickened binary expression stored
+enum class OperandKind {
+    REG_REG,   ///< Both in registers (e.g. ADD)
+    CONST_REG, ///< First is a constant (e.g. ADD2)
+    REG_CONST, ///< Second is a constant (e.g. ADD3)
+};
+
+/// Binary expression quickened from one of its generic variants
+class QuickenedBinExpr : public BinExprOpCode, public QuickenedOpCode {
+protected:
+    OperandKind kind;
+
+    QuickenedBinExpr(OpCodes code, ustring mnem, BinExprOpCode *generic, OperandKind kind)
+        : BinExprOpCode(code, mnem, generic->dst, generic->src1, generic->src2),
+          QuickenedOpCode(generic), kind(kind) {}
+
+    void load_operands(Interpreter *vm, Value *&s1, Value *&s2);
+};
+
+class AddIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::ADD_INT_INT;
+    AddIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "ADD_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class AddFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::ADD_FLOAT_FLOAT;
+    AddFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "ADD_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class SubIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::SUB_INT_INT;
+    SubIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "SUB_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class SubFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::SUB_FLOAT_FLOAT;
+    SubFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "SUB_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class MulIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::MUL_INT_INT;
+    MulIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "MUL_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class MulFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::MUL_FLOAT_FLOAT;
+    MulFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "MUL_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class LtIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::LT_INT_INT;
+    LtIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "LT_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class LtFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::LT_FLOAT_FLOAT;
+    LtFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "LT_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class BtIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::BT_INT_INT;
+    BtIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "BT_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class BtFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::BT_FLOAT_FLOAT;
+    BtFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "BT_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class LeqIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::LEQ_INT_INT;
+    LeqIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "LEQ_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class LeqFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::LEQ_FLOAT_FLOAT;
+    LeqFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "LEQ_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class BeqIntInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::BEQ_INT_INT;
+    BeqIntInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "BEQ_INT_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class BeqFloatFloat : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::BEQ_FLOAT_FLOAT;
+    BeqFloatFloat(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "BEQ_FLOAT_FLOAT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+class SubscListInt : public QuickenedBinExpr {
+public:
+    static const OpCodes ClassType = OpCodes::SUBSC_LIST_INT;
+    SubscListInt(BinExprOpCode *generic, OperandKind kind) : QuickenedBinExpr(ClassType, "SUBSC_LIST_INT", generic, kind) {}
+    void exec(Interpreter *vm) override;
+};
+
+/// Attribute load with cached register of the attribute in the object's
+/// attribute pool. The cache is refilled when a different object is
+/// accessed, de-quickening happens only when the value is not an object.
+class LoadAttrSlot : public OpCode, public QuickenedOpCode {
+private:
+    MemoryPool *cached_pool;
+    uint64_t cached_version;
+    Register cached_reg;
+public:
+    Register dst;
+    Register src;
+    StringConst name;
+
+    static const OpCodes ClassType = OpCodes::LOAD_ATTR_SLOT;
+
+    LoadAttrSlot(LoadAttr *generic) : OpCode(ClassType, "LOAD_ATTR_SLOT"), QuickenedOpCode(generic),
+            cached_pool(nullptr), cached_version(0), cached_reg(0),
+            dst(generic->dst), src(generic->src), name(generic->name) {}
+    void exec(Interpreter *vm) override;
+    virtual inline std::ostream& debug(std::ostream& os) const override {
+        os << mnem << "  %" << dst << ", %" << src << ", \"" << name << "\"";
+        return os;
+    }
+    bool equals(OpCode *other) override {
+        auto casted = dynamic_cast<LoadAttrSlot *>(other);
+        if (!casted) return false;
+        return casted->dst == dst && casted->src == src && casted->name == name;
+    }
+};
+
+/// \return true if opcode was created at runtime by quickening
+inline bool is_quickened(OpCode *op) {
+    return op->get_type() > OpCodes::OPCODES_AMOUNT;
+}
+
+/// \brief Tries to quicken binary expression based on its operands
+/// This should be called after a successful execution of op.
+void quicken_bin_expr(Interpreter *vm, BinExprOpCode *op, Value *s1, Value *s2);
+
+/// \brief Makes binary expression quicken on its first execution
+/// Operands of op have to be statically known to be both ints (or both
+/// floats), quickened opcode still checks them, as Int or Float might be
+/// subclassed.
+void expect_typed_operands(BinExprOpCode *op, bool floats);
+
 }
 
 // Helper functions
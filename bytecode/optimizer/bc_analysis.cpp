@@ -0,0 +1,288 @@
+#include "bc_analysis.hpp"
+
+using namespace moss;
+using namespace opcode;
+
+namespace {
+
+template<class T>
+void range_operands(OpCode *op, bool cstart, bool cnext, bool cend, std::vector<Operand> &ops) {
+    auto r = dyn_cast<T>(op);
+    assert(r && "Range opcode type mismatch");
+    ops.push_back({&r->dst, false, Access::DEF, -1});
+    ops.push_back({&r->start, cstart, Access::USE, -1});
+    ops.push_back({&r->next, cnext, Access::USE, -1});
+    ops.push_back({&r->end, cend, Access::USE, -1});
+}
+
+}
+
+bool opcode::get_operands(OpCode *op, std::vector<Operand> &ops) {
+    auto use = [&](Register &r) { ops.push_back({&r, false, Access::USE, -1}); };
+    auto cuse = [&](Register &r) { ops.push_back({&r, true, Access::USE, -1}); };
+    auto def = [&](Register &r) { ops.push_back({&r, false, Access::DEF, -1}); };
+    auto cdef = [&](Register &r) { ops.push_back({&r, true, Access::DEF, -1}); };
+    auto named = [&](Register &r) { ops.push_back({&r, false, Access::NAMED, -1}); };
+
+    auto type = op->get_type();
+    if (type >= OpCodes::CONCAT && type <= OpCodes::SUBSCLAST) {
+        auto be = dynamic_cast<BinExprOpCode *>(op);
+        assert(be && "Binary opcode is not BinExprOpCode");
+        def(be->dst);
+        if (type >= OpCodes::CONCAT2 && type <= OpCodes::SUBSC2)
+            cuse(be->src1);
+        else
+            use(be->src1);
+        if (type >= OpCodes::CONCAT3)
+            cuse(be->src2);
+        else
+            use(be->src2);
+        return true;
+    }
+
+    switch (type) {
+    case OpCodes::LOAD: def(dyn_cast<Load>(op)->dst); break;
+    case OpCodes::LOAD_ATTR: {
+        auto o = dyn_cast<LoadAttr>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::LOAD_GLOBAL: def(dyn_cast<LoadGlobal>(op)->dst); break;
+    case OpCodes::LOAD_NONLOC: def(dyn_cast<LoadNonLoc>(op)->dst); break;
+    case OpCodes::STORE: {
+        auto o = dyn_cast<Store>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::STORE_NAME: named(dyn_cast<StoreName>(op)->dst); break;
+    case OpCodes::STORE_CONST: {
+        auto o = dyn_cast<StoreConst>(op);
+        def(o->dst);
+        cuse(o->csrc);
+    } break;
+    case OpCodes::STORE_ATTR: {
+        auto o = dyn_cast<StoreAttr>(op);
+        use(o->src);
+        use(o->obj);
+    } break;
+    case OpCodes::STORE_CONST_ATTR: {
+        auto o = dyn_cast<StoreConstAttr>(op);
+        cuse(o->csrc);
+        use(o->obj);
+    } break;
+    case OpCodes::STORE_GLOBAL: use(dyn_cast<StoreGlobal>(op)->src); break;
+    case OpCodes::STORE_NONLOC: use(dyn_cast<StoreNonLoc>(op)->src); break;
+    case OpCodes::STORE_SUBSC: {
+        auto o = dyn_cast<StoreSubsc>(op);
+        use(o->src);
+        use(o->obj);
+        use(o->key);
+    } break;
+    case OpCodes::STORE_CONST_SUBSC: {
+        auto o = dyn_cast<StoreConstSubsc>(op);
+        cuse(o->csrc);
+        use(o->obj);
+        use(o->key);
+    } break;
+    case OpCodes::STORE_SUBSC_CONST: {
+        auto o = dyn_cast<StoreSubscConst>(op);
+        use(o->src);
+        use(o->obj);
+        cuse(o->ckey);
+    } break;
+    case OpCodes::STORE_C_SUBSC_C: {
+        auto o = dyn_cast<StoreConstSubscConst>(op);
+        cuse(o->csrc);
+        use(o->obj);
+        cuse(o->ckey);
+    } break;
+    case OpCodes::STORE_INT_CONST: cdef(dyn_cast<StoreIntConst>(op)->dst); break;
+    case OpCodes::STORE_FLOAT_CONST: cdef(dyn_cast<StoreFloatConst>(op)->dst); break;
+    case OpCodes::STORE_BOOL_CONST: cdef(dyn_cast<StoreBoolConst>(op)->dst); break;
+    case OpCodes::STORE_STRING_CONST: cdef(dyn_cast<StoreStringConst>(op)->dst); break;
+    case OpCodes::STORE_NIL_CONST: cdef(dyn_cast<StoreNilConst>(op)->dst); break;
+    case OpCodes::JMP:
+    case OpCodes::BREAK_TO:
+    case OpCodes::PUSH_CALL_FRAME:
+    case OpCodes::POP_CALL_FRAME:
+    case OpCodes::LOOP_BEGIN:
+    case OpCodes::LOOP_END:
+        break;
+    case OpCodes::JMP_IF_TRUE: use(dyn_cast<JmpIfTrue>(op)->src); break;
+    case OpCodes::JMP_IF_FALSE: use(dyn_cast<JmpIfFalse>(op)->src); break;
+    case OpCodes::CALL: {
+        auto o = dyn_cast<Call>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::CALL_FORMATTER: def(dyn_cast<CallFormatter>(op)->dst); break;
+    case OpCodes::TAIL_CALL: {
+        auto o = dyn_cast<TailCall>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::RETURN: use(dyn_cast<Return>(op)->src); break;
+    case OpCodes::RETURN_CONST: cuse(dyn_cast<ReturnConst>(op)->csrc); break;
+    case OpCodes::PUSH_ARG: use(dyn_cast<PushArg>(op)->src); break;
+    case OpCodes::PUSH_CONST_ARG: cuse(dyn_cast<PushConstArg>(op)->csrc); break;
+    case OpCodes::PUSH_NAMED_ARG: use(dyn_cast<PushNamedArg>(op)->src); break;
+    case OpCodes::PUSH_UNPACKED: use(dyn_cast<PushUnpacked>(op)->src); break;
+    case OpCodes::CREATE_FUN: named(dyn_cast<CreateFun>(op)->fun); break;
+    case OpCodes::FUN_BEGIN: use(dyn_cast<FunBegin>(op)->fun); break;
+    case OpCodes::SET_DEFAULT: {
+        auto o = dyn_cast<SetDefault>(op);
+        use(o->fun);
+        use(o->src);
+    } break;
+    case OpCodes::SET_DEFAULT_CONST: {
+        auto o = dyn_cast<SetDefaultConst>(op);
+        use(o->fun);
+        cuse(o->csrc);
+    } break;
+    case OpCodes::SET_TYPE: {
+        auto o = dyn_cast<SetType>(op);
+        use(o->fun);
+        use(o->type);
+    } break;
+    case OpCodes::SET_VARARG: use(dyn_cast<SetVararg>(op)->fun); break;
+    case OpCodes::IMPORT: def(dyn_cast<Import>(op)->dst); break;
+    case OpCodes::IMPORT_ALL: use(dyn_cast<ImportAll>(op)->src); break;
+    case OpCodes::ANNOTATE: {
+        auto o = dyn_cast<Annotate>(op);
+        use(o->dst);
+        use(o->val);
+    } break;
+    case OpCodes::ANNOTATE_MOD: use(dyn_cast<AnnotateMod>(op)->val); break;
+    case OpCodes::DOCUMENT: use(dyn_cast<Document>(op)->dst); break;
+    case OpCodes::OUTPUT: use(dyn_cast<Output>(op)->src); break;
+    case OpCodes::NOT: {
+        auto o = dyn_cast<Not>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::NEG: {
+        auto o = dyn_cast<Neg>(op);
+        def(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::ASSERT: {
+        auto o = dyn_cast<Assert>(op);
+        use(o->src);
+        cuse(o->line);
+        use(o->msg);
+    } break;
+    case OpCodes::RAISE: use(dyn_cast<Raise>(op)->src); break;
+    case OpCodes::LIST_PUSH: {
+        // List is modified in place
+        auto o = dyn_cast<ListPush>(op);
+        use(o->dst);
+        use(o->src);
+    } break;
+    case OpCodes::LIST_PUSH_CONST: {
+        auto o = dyn_cast<ListPushConst>(op);
+        use(o->dst);
+        cuse(o->csrc);
+    } break;
+    case OpCodes::BUILD_LIST: def(dyn_cast<BuildList>(op)->dst); break;
+    case OpCodes::BUILD_DICT: {
+        auto o = dyn_cast<BuildDict>(op);
+        def(o->dst);
+        use(o->keys);
+        use(o->vals);
+    } break;
+    case OpCodes::BUILD_ENUM: {
+        auto o = dyn_cast<BuildEnum>(op);
+        named(o->dst);
+        use(o->vals);
+    } break;
+    case OpCodes::CREATE_RANGE: range_operands<CreateRange>(op, false, false, false, ops); break;
+    case OpCodes::CREATE_RANGE2: range_operands<CreateRange2>(op, true, false, false, ops); break;
+    case OpCodes::CREATE_RANGE3: range_operands<CreateRange3>(op, false, true, false, ops); break;
+    case OpCodes::CREATE_RANGE4: range_operands<CreateRange4>(op, false, false, true, ops); break;
+    case OpCodes::CREATE_RANGE5: range_operands<CreateRange5>(op, true, true, false, ops); break;
+    case OpCodes::CREATE_RANGE6: range_operands<CreateRange6>(op, true, false, true, ops); break;
+    case OpCodes::CREATE_RANGE7: range_operands<CreateRange7>(op, false, true, true, ops); break;
+    case OpCodes::CREATE_RANGE8: range_operands<CreateRange8>(op, true, true, true, ops); break;
+    case OpCodes::SWITCH: {
+        auto o = dyn_cast<Switch>(op);
+        use(o->src);
+        use(o->vals);
+        use(o->addrs);
+    } break;
+    case OpCodes::FOR: {
+        // Index is not set when the loop ends
+        auto o = dyn_cast<For>(op);
+        ops.push_back({&o->index, false, Access::MAY_DEF, -1});
+        use(o->collection);
+    } break;
+    case OpCodes::ITER: {
+        auto o = dyn_cast<Iter>(op);
+        def(o->iterator);
+        use(o->collection);
+    } break;
+    // Opcodes with other frames (classes and spaces), exception handling
+    // and finally (jumps to dynamic addresses), registers stored as int
+    // values (unpacking into multiple variables) and quickened opcodes
+    default: return false;
+    }
+    return true;
+}
+
+bool opcode::get_fun_body(BCBlob *bcb, FunBody &body) {
+    if (!bcb->isa_fun())
+        return false;
+    auto &code = bcb->get_bc().get_code();
+    auto create = dyn_cast<CreateFun>(code[bcb->get_start()]);
+    if (!create)
+        return false;
+    Address fun_begin = bcb->get_start() + 1;
+    for (; fun_begin < code.size(); ++fun_begin) {
+        auto fb = dyn_cast<FunBegin>(code[fun_begin]);
+        if (fb && fb->fun == create->fun)
+            break;
+    }
+    if (fun_begin + 1 >= code.size())
+        return false;
+    auto body_jmp = dyn_cast<Jmp>(code[fun_begin + 1]);
+    if (!body_jmp || body_jmp->addr <= fun_begin + 2 || body_jmp->addr > code.size())
+        return false;
+    body.create = create;
+    body.start = fun_begin + 2;
+    body.end = body_jmp->addr;
+    return true;
+}
+
+bool opcode::get_frame_insts(Bytecode &bc, const FunBody &body, std::vector<Address> &insts) {
+    auto &code = bc.get_code();
+    for (Address a = body.start; a < body.end;) {
+        insts.push_back(a);
+        if (isa<FunBegin>(code[a]) && a + 1 < body.end) {
+            if (auto j = dyn_cast<Jmp>(code[a + 1])) {
+                if (j->addr <= a + 1 || j->addr > body.end)
+                    return false;
+                insts.push_back(a + 1);
+                a = j->addr;
+                continue;
+            }
+        }
+        ++a;
+    }
+    return true;
+}
+
+void opcode::get_module_stores(Bytecode &bc, std::unordered_set<ustring> &names, std::unordered_set<ustring> &attrs) {
+    names.clear();
+    attrs.clear();
+    for (auto op: bc.get_code()) {
+        if (auto sg = dyn_cast<StoreGlobal>(op)) {
+            names.insert(sg->name);
+        } else if (auto snl = dyn_cast<StoreNonLoc>(op)) {
+            names.insert(snl->name);
+        } else if (auto sa = dyn_cast<StoreAttr>(op)) {
+            attrs.insert(sa->name);
+        } else if (auto sca = dyn_cast<StoreConstAttr>(op)) {
+            attrs.insert(sca->name);
+        }
+    }
+    names.insert(attrs.begin(), attrs.end());
+}
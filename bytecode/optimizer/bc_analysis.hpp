@@ -0,0 +1,71 @@
+///
+/// \file bc_analysis.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Analysis of bytecode shared by bytecode optimization passes.
+///
+
+#ifndef _BC_ANALYSIS_HPP_
+#define _BC_ANALYSIS_HPP_
+
+#include "bytecode.hpp"
+#include "bytecode_blob.hpp"
+#include "opcode.hpp"
+#include <unordered_set>
+#include <vector>
+
+namespace moss {
+namespace opcode {
+
+/// How an opcode accesses its register operand
+enum class Access {
+    USE,     ///< Value in the register is read
+    DEF,     ///< Register is overwritten
+    MAY_DEF, ///< Register is overwritten only on some paths (for's index)
+    NAMED    ///< Register is bound to a name
+};
+
+/// Register operand of an opcode
+struct Operand {
+    Register *reg;
+    bool constant;
+    Access access;
+    long cand;     ///< Index of the renamed register or -1
+};
+
+/// Collects register operands of an opcode
+/// \return false if the opcode is not known to this analysis or it accesses
+///         registers in a way that cannot be tracked (registers stored as
+///         values or dynamic return addresses of finally)
+bool get_operands(OpCode *op, std::vector<Operand> &ops);
+
+/// Function body of a function blob
+struct FunBody {
+    CreateFun *create;
+    Address start; ///< First opcode of the body
+    Address end;   ///< Address after the body (where the jump over it leads)
+};
+
+/// \brief Finds body of a function blob
+/// Function body is the code skipped by jump right after FUN_BEGIN
+/// (default values and types before it run in the outer frame).
+/// \return false if bcb is not a function blob or its body cannot be found
+bool get_fun_body(BCBlob *bcb, FunBody &body);
+
+/// \brief Collects addresses of opcodes which run in the function's frame
+/// Bodies of nested functions are skipped as they have their own frames.
+/// \return false if a nested body cannot be skipped
+bool get_frame_insts(Bytecode &bc, const FunBody &body, std::vector<Address> &insts);
+
+/// \brief Collects names and attributes which might be changed by other code
+/// Names are those stored by `$` or `::` anywhere in the module and also
+/// assigned attributes, as module's global names can be assigned as its
+/// attributes.
+void get_module_stores(Bytecode &bc, std::unordered_set<ustring> &names, std::unordered_set<ustring> &attrs);
+
+}
+}
+
+#endif//_BC_ANALYSIS_HPP_
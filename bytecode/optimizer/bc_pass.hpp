@@ -18,7 +18,15 @@ namespace opcode {
 
 class BCPass {
 public:
+    /// Called before the pass is run on blobs of bc
+    virtual void init(Bytecode *bc) { (void)bc; }
     virtual void run(BCBlob *bcb) = 0;
+    /// \return Name of the pass used in statistics
+    virtual const char *get_name() const = 0;
+    /// Pass which needs to see all code of the module is not run on modules
+    /// compiled in chunks
+    virtual bool needs_whole_module() { return false; }
+    virtual ~BCPass() {}
 };
 
 }
@@ -1,14 +1,87 @@
 #include "bc_pipeline.hpp"
+#include "loop_invariant_pass.hpp"
+#include "cse_pass.hpp"
 #include "register_reuse_pass.hpp"
+#include "pass_stats.hpp"
 #include <vector>
+#include <sstream>
+#include <unordered_map>
 #include <unordered_set>
 
 using namespace moss;
 using namespace opcode;
 
-std::list<BCPass *> moss::opcode::O1Pipeline{
-    new RegisterReusePass()
-};
+BCPipeline::BCPipeline(Bytecode *bc, unsigned opt_level, ustring module)
+        : bc(bc), pipeline(owned_passes), module(module) {
+    if (opt_level >= 2) {
+        owned_passes.push_back(new LoopInvariantPass());
+        owned_passes.push_back(new CSEPass());
+    }
+    if (opt_level >= 1)
+        owned_passes.push_back(new RegisterReusePass());
+}
+
+BCPipeline::~BCPipeline() {
+    for (auto p: owned_passes)
+        delete p;
+}
+
+/// \return Textual form of opcodes from address start
+static std::vector<ustring> ops_as_text(Bytecode *bc, Address start) {
+    std::vector<ustring> ops;
+    auto &code = bc->get_code();
+    for (Address i = start; i < code.size(); ++i) {
+        std::stringstream ss;
+        code[i]->debug(ss);
+        ops.push_back(ss.str());
+    }
+    return ops;
+}
+
+/// \return Amount of opcodes which were added, removed or rewritten
+static unsigned long count_changes(const std::vector<ustring> &before, const std::vector<ustring> &after) {
+    std::unordered_map<ustring, long> diff;
+    for (auto &op: before)
+        ++diff[op];
+    for (auto &op: after)
+        --diff[op];
+    unsigned long changes = 0;
+    for (auto &[op, d]: diff)
+        changes += d < 0 ? -d : d;
+    return changes;
+}
+
+void BCPipeline::run(Address start, bool whole_module) {
+    LOG1("Running BC optimization pipeline");
+    bool timed = passstats::is_enabled();
+    for (auto p: pipeline) {
+        if (!whole_module && p->needs_whole_module())
+            continue;
+        std::vector<ustring> ops_before;
+        if (timed)
+            ops_before = ops_as_text(bc, start);
+        auto pass_start = passstats::Clock::now();
+        // Passes might insert opcodes, so blobs are parsed for each one
+        // and run from the last one, which keeps addresses of the blobs
+        // not yet run
+        auto mod_blob = BCBlob::parse_bc(*bc, start);
+        // TODO: Perhaps drop very short blobs?
+        std::vector<BCBlob *> all_blobs = collect_all_blobs(mod_blob);
+        std::stable_sort(all_blobs.begin(), all_blobs.end(), [](BCBlob *a, BCBlob *b) {
+            return a->get_start() > b->get_start();
+        });
+        p->init(bc);
+        for (auto bcblb: all_blobs) {
+            p->run(bcblb);
+        }
+        for (auto bcblb: all_blobs)
+            delete bcblb;
+        if (timed) {
+            auto time = passstats::Clock::now() - pass_start;
+            passstats::record(module, p->get_name(), time, count_changes(ops_before, ops_as_text(bc, start)));
+        }
+    }
+}
 
 std::vector<BCBlob*> opcode::collect_all_blobs(BCBlob* root) {
     std::vector<BCBlob*> result;
@@ -13,6 +13,7 @@
 #include "bc_pass.hpp"
 #include "bytecode.hpp"
 #include "logging.hpp"
+#include <algorithm>
 #include <list>
 
 namespace moss {
@@ -23,26 +24,27 @@ std::vector<BCBlob*> collect_all_blobs(BCBlob* root);
 class BCPipeline {
 private:
     Bytecode *bc;
+    /// Passes created by this pipeline for an optimization level
+    std::list<BCPass *> owned_passes;
     std::list<BCPass *> &pipeline;
+    /// Name of the optimized module for pass statistics
+    ustring module;
 
 public:
-    BCPipeline(Bytecode *bc, std::list<BCPass *> &pipeline) : bc(bc), pipeline(pipeline) {}
-
-    void run() {
-        LOG1("Running BC optimization pipeline");
-        auto mod_blob = BCBlob::parse_bc(*bc);
-        // TODO: Perhaps drop very short blobs?
-        std::vector<BCBlob *> all_blobs = collect_all_blobs(mod_blob);
-        for (auto p: pipeline) {
-            for (auto bcblb: all_blobs) {
-                p->run(bcblb);
-            }
-        }
-    }
+    BCPipeline(Bytecode *bc, std::list<BCPass *> &pipeline, ustring module="")
+        : bc(bc), pipeline(pipeline), module(module) {}
+    /// Constructs pipeline with passes for optimization level (0 runs no
+    /// passes, 1 only reuses registers and 2 and higher also moves loop
+    /// invariant code out of loops and eliminates common subexpressions)
+    BCPipeline(Bytecode *bc, unsigned opt_level, ustring module="");
+    ~BCPipeline();
+
+    /// Optimizes bytecode from address start, code before it is left as is
+    /// (it might be already running)
+    /// \param whole_module false if more code of the module will follow
+    void run(Address start=0, bool whole_module=true);
 };
 
-extern std::list<BCPass *> O1Pipeline;
-
 }
 }
 
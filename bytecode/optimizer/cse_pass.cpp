@@ -0,0 +1,389 @@
+#include "cse_pass.hpp"
+#include "bc_analysis.hpp"
+#include "opcode.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace moss;
+using namespace opcode;
+
+namespace {
+
+/// Value of a load or constant store held in a register
+struct Known {
+    OpCodes kind;  ///< Opcode which computed the value
+    ustring key;   ///< Name, attribute or textual form of the constant
+    Register src;  ///< Object of attribute load
+    Register reg;  ///< Register (or constant register) holding the value
+};
+
+inline uint64_t reg_key(Register r, bool constant) {
+    return (static_cast<uint64_t>(constant) << 32) | r;
+}
+
+/// Finds the value computed by op
+/// \return false if op is not a load or constant store
+bool get_value(OpCode *op, Known &k) {
+    k.kind = op->get_type();
+    k.src = 0;
+    switch (k.kind) {
+    case OpCodes::LOAD: {
+        auto o = dyn_cast<Load>(op);
+        // Value of super depends on the class of the function
+        if (o->name == "super")
+            return false;
+        k.key = o->name;
+        k.reg = o->dst;
+    } break;
+    case OpCodes::LOAD_GLOBAL: {
+        auto o = dyn_cast<LoadGlobal>(op);
+        k.key = o->name;
+        k.reg = o->dst;
+    } break;
+    case OpCodes::LOAD_NONLOC: {
+        auto o = dyn_cast<LoadNonLoc>(op);
+        k.key = o->name;
+        k.reg = o->dst;
+    } break;
+    case OpCodes::LOAD_ATTR: {
+        auto o = dyn_cast<LoadAttr>(op);
+        k.key = o->name;
+        k.src = o->src;
+        k.reg = o->dst;
+    } break;
+    case OpCodes::STORE_INT_CONST: {
+        auto o = dyn_cast<StoreIntConst>(op);
+        k.key = std::to_string(o->val);
+        k.reg = o->dst;
+    } break;
+    case OpCodes::STORE_FLOAT_CONST: {
+        // Bits tell apart -0.0 and 0.0
+        auto o = dyn_cast<StoreFloatConst>(op);
+        uint64_t bits;
+        std::memcpy(&bits, &o->val, sizeof(bits));
+        k.key = std::to_string(bits);
+        k.reg = o->dst;
+    } break;
+    case OpCodes::STORE_BOOL_CONST: {
+        auto o = dyn_cast<StoreBoolConst>(op);
+        k.key = o->val ? "true" : "false";
+        k.reg = o->dst;
+    } break;
+    case OpCodes::STORE_STRING_CONST: {
+        auto o = dyn_cast<StoreStringConst>(op);
+        k.key = o->val;
+        k.reg = o->dst;
+    } break;
+    case OpCodes::STORE_NIL_CONST: {
+        k.key = "";
+        k.reg = dyn_cast<StoreNilConst>(op)->dst;
+    } break;
+    default: return false;
+    }
+    return true;
+}
+
+inline bool is_constant(OpCodes kind) {
+    return kind >= OpCodes::STORE_INT_CONST && kind <= OpCodes::STORE_NIL_CONST;
+}
+
+inline bool is_name_load(OpCodes kind) {
+    return kind == OpCodes::LOAD || kind == OpCodes::LOAD_GLOBAL || kind == OpCodes::LOAD_NONLOC;
+}
+
+/// \return true if the next opcode is not the only one op continues to
+bool ends_block(OpCode *op) {
+    switch (op->get_type()) {
+    case OpCodes::JMP:
+    case OpCodes::JMP_IF_TRUE:
+    case OpCodes::JMP_IF_FALSE:
+    case OpCodes::BREAK_TO:
+    case OpCodes::FOR:
+    case OpCodes::SWITCH:
+    case OpCodes::RETURN:
+    case OpCodes::RETURN_CONST:
+    case OpCodes::RAISE:
+        return true;
+    default: return false;
+    }
+}
+
+/// \return true if op might run code of a function, operator or iterator
+bool may_run_code(OpCode *op) {
+    switch (op->get_type()) {
+    case OpCodes::LOAD:
+    case OpCodes::LOAD_ATTR:
+    case OpCodes::LOAD_GLOBAL:
+    case OpCodes::LOAD_NONLOC:
+    case OpCodes::STORE:
+    case OpCodes::STORE_NAME:
+    case OpCodes::STORE_CONST:
+    case OpCodes::STORE_INT_CONST:
+    case OpCodes::STORE_FLOAT_CONST:
+    case OpCodes::STORE_BOOL_CONST:
+    case OpCodes::STORE_STRING_CONST:
+    case OpCodes::STORE_NIL_CONST:
+    case OpCodes::STORE_GLOBAL:
+    case OpCodes::STORE_NONLOC:
+    case OpCodes::JMP:
+    case OpCodes::JMP_IF_TRUE:
+    case OpCodes::JMP_IF_FALSE:
+    case OpCodes::BREAK_TO:
+    case OpCodes::PUSH_CALL_FRAME:
+    case OpCodes::POP_CALL_FRAME:
+    case OpCodes::PUSH_ARG:
+    case OpCodes::PUSH_CONST_ARG:
+    case OpCodes::PUSH_NAMED_ARG:
+    case OpCodes::LOOP_BEGIN:
+    case OpCodes::LOOP_END:
+    case OpCodes::CREATE_FUN:
+    case OpCodes::FUN_BEGIN:
+    case OpCodes::SET_DEFAULT:
+    case OpCodes::SET_DEFAULT_CONST:
+    case OpCodes::SET_TYPE:
+    case OpCodes::SET_VARARG:
+    case OpCodes::BUILD_LIST:
+    case OpCodes::LIST_PUSH:
+    case OpCodes::LIST_PUSH_CONST:
+    case OpCodes::RETURN:
+    case OpCodes::RETURN_CONST:
+        return false;
+    default: return true;
+    }
+}
+
+}
+
+void CSEPass::init(Bytecode *bc) {
+    get_module_stores(*bc, module_names, module_attrs);
+}
+
+void CSEPass::run(BCBlob *bcb) {
+    LOGMAX("Running CSE pass on " << bcb->get_debug_name());
+    FunBody body;
+    if (!get_fun_body(bcb, body))
+        return;
+    auto &bc = bcb->get_bc();
+    auto &code = bc.get_code();
+    std::vector<Address> insts;
+    if (!get_frame_insts(bc, body, insts))
+        return;
+
+    // Arguments (and this) are stored by the call into the first registers
+    Register first_temp = 1;
+    if (!body.create->arg_names.empty())
+        first_temp += std::count(body.create->arg_names.begin(), body.create->arg_names.end(), ',') + 1;
+
+    const size_t n = insts.size();
+    std::vector<std::vector<Operand>> operands(n);
+    std::unordered_map<uint64_t, unsigned> defs;
+    std::unordered_set<Register> named;
+    std::unordered_map<Register, std::vector<ustring>> bound_names;
+    std::unordered_set<Address> targets;
+    std::vector<Switch *> switches;
+    for (size_t i = 0; i < n; ++i) {
+        auto op = code[insts[i]];
+        if (!get_operands(op, operands[i])) {
+            LOGMAX("CSE pass skipped as " << op->get_mnem() << " is used");
+            return;
+        }
+        for (auto &o: operands[i]) {
+            if (o.access == Access::DEF || o.access == Access::MAY_DEF)
+                ++defs[reg_key(*o.reg, o.constant)];
+            else if (o.access == Access::NAMED)
+                named.insert(*o.reg);
+        }
+        if (auto sn = dyn_cast<StoreName>(op))
+            bound_names[sn->dst].push_back(sn->name);
+        else if (auto cf = dyn_cast<CreateFun>(op))
+            bound_names[cf->fun].push_back(cf->name);
+        else if (auto be = dyn_cast<BuildEnum>(op))
+            bound_names[be->dst].push_back(be->name);
+
+        if (auto j = dyn_cast<Jmp>(op))
+            targets.insert(j->addr);
+        else if (auto jt = dyn_cast<JmpIfTrue>(op))
+            targets.insert(jt->addr);
+        else if (auto jf = dyn_cast<JmpIfFalse>(op))
+            targets.insert(jf->addr);
+        else if (auto bt = dyn_cast<BreakTo>(op))
+            targets.insert(bt->addr);
+        else if (auto f = dyn_cast<For>(op))
+            targets.insert(f->addr);
+        else if (auto sw = dyn_cast<Switch>(op))
+            switches.push_back(sw);
+    }
+    // Switch jumps to addresses pushed into a list as int constants, any int
+    // constant of the frame is taken as a possible target. Constants of the
+    // addresses are kept as they are, since those are updated when code is
+    // moved
+    std::unordered_set<Register> addr_consts;
+    if (!switches.empty()) {
+        for (size_t i = 0; i < n; ++i) {
+            auto op = code[insts[i]];
+            if (auto sic = dyn_cast<StoreIntConst>(op)) {
+                targets.insert(static_cast<Address>(sic->val));
+            } else if (auto lpc = dyn_cast<ListPushConst>(op)) {
+                for (auto sw: switches) {
+                    if (lpc->dst == sw->addrs)
+                        addr_consts.insert(lpc->csrc);
+                }
+            } else if (auto lp = dyn_cast<ListPush>(op)) {
+                for (auto sw: switches) {
+                    if (lp->dst == sw->addrs) {
+                        LOGMAX("CSE pass skipped as switch addresses are not known");
+                        return;
+                    }
+                }
+            }
+        }
+        for (auto sw: switches)
+            targets.insert(sw->default_addr);
+    }
+
+    // Register holding a value might replace register defined only by the
+    // redundant opcode
+    auto is_single = [&](Register r, bool constant) {
+        if (!constant && (r < first_temp || named.count(r)))
+            return false;
+        return defs[reg_key(r, constant)] == 1;
+    };
+
+    std::vector<Known> known;
+    auto forget = [&](std::function<bool(const Known &)> pred) {
+        known.erase(std::remove_if(known.begin(), known.end(), pred), known.end());
+    };
+    std::unordered_map<uint64_t, Register> renamed;
+    std::vector<Address> removed;
+    size_t copies = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const Address addr = insts[i];
+        auto op = code[addr];
+        // Basic block starts at jump targets and after jumps
+        if (targets.count(addr) || (i > 0 && ends_block(code[insts[i - 1]])))
+            known.clear();
+
+        Known value;
+        bool has_value = get_value(op, value);
+        if (has_value && value.kind == OpCodes::STORE_INT_CONST && addr_consts.count(value.reg))
+            has_value = false;
+        if (has_value && value.kind == OpCodes::LOAD_ATTR) {
+            auto r = renamed.find(reg_key(value.src, false));
+            if (r != renamed.end())
+                value.src = r->second;
+        }
+        if (has_value) {
+            bool constant = is_constant(value.kind);
+            auto k = std::find_if(known.begin(), known.end(), [&](const Known &k) {
+                return k.kind == value.kind && k.src == value.src && k.key == value.key;
+            });
+            if (k != known.end()) {
+                if (k->reg == value.reg) {
+                    removed.push_back(addr);
+                    continue;
+                }
+                if (is_single(k->reg, constant) && is_single(value.reg, constant)) {
+                    renamed[reg_key(value.reg, constant)] = k->reg;
+                    removed.push_back(addr);
+                    continue;
+                }
+                if (!constant) {
+                    // Copy of the register is cheaper than the lookup
+                    code[addr] = new Store(value.reg, k->reg);
+                    delete op;
+                    op = code[addr];
+                    operands[i].clear();
+                    get_operands(op, operands[i]);
+                    has_value = false;
+                    ++copies;
+                }
+            }
+        }
+
+        // Values changed by the opcode
+        for (auto &o: operands[i]) {
+            if (o.access != Access::DEF && o.access != Access::MAY_DEF)
+                continue;
+            Register r = *o.reg;
+            bool constant = o.constant;
+            forget([&](const Known &k) {
+                if (is_constant(k.kind) != constant)
+                    return false;
+                return k.reg == r || (k.kind == OpCodes::LOAD_ATTR && k.src == r);
+            });
+            // Local variable bound to the register was changed
+            if (!constant && r < first_temp) {
+                forget([](const Known &k) { return k.kind == OpCodes::LOAD; });
+            } else if (!constant && named.count(r)) {
+                auto &names = bound_names[r];
+                forget([&](const Known &k) {
+                    return k.kind == OpCodes::LOAD && std::find(names.begin(), names.end(), k.key) != names.end();
+                });
+            }
+        }
+        ustring stored;
+        bool attr_stored = false;
+        if (auto sn = dyn_cast<StoreName>(op)) {
+            stored = sn->name;
+        } else if (auto cf = dyn_cast<CreateFun>(op)) {
+            stored = cf->name;
+        } else if (auto be = dyn_cast<BuildEnum>(op)) {
+            stored = be->name;
+        } else if (auto sg = dyn_cast<StoreGlobal>(op)) {
+            stored = sg->name;
+        } else if (auto snl = dyn_cast<StoreNonLoc>(op)) {
+            stored = snl->name;
+        } else if (auto sa = dyn_cast<StoreAttr>(op)) {
+            stored = sa->name;
+            attr_stored = true;
+        } else if (auto sca = dyn_cast<StoreConstAttr>(op)) {
+            stored = sca->name;
+            attr_stored = true;
+        }
+        if (!stored.empty()) {
+            // Module's global names can be assigned as its attributes
+            forget([&](const Known &k) {
+                return k.key == stored && (is_name_load(k.kind) || (attr_stored && k.kind == OpCodes::LOAD_ATTR));
+            });
+        }
+        if (isa<Import>(op) || isa<ImportAll>(op)) {
+            known.clear();
+        } else if (may_run_code(op)) {
+            bool call = isa<Call>(op) || isa<TailCall>(op) || isa<CallFormatter>(op);
+            forget([&](const Known &k) {
+                if (is_name_load(k.kind))
+                    return module_names.count(k.key) > 0;
+                if (k.kind == OpCodes::LOAD_ATTR)
+                    return call || module_attrs.count(k.key) > 0;
+                return false;
+            });
+        }
+        // Attribute load overwriting its object does not keep the value
+        if (has_value && !(value.kind == OpCodes::LOAD_ATTR && value.src == value.reg))
+            known.push_back(value);
+    }
+    if (removed.empty() && copies == 0)
+        return;
+
+    LOG2("CSE pass removed " << removed.size() << " and replaced " << copies << " opcodes in " << body.create->name);
+    std::unordered_set<Address> removed_set(removed.begin(), removed.end());
+    for (size_t i = 0; i < n; ++i) {
+        if (removed_set.count(insts[i]))
+            continue;
+        for (auto &o: operands[i]) {
+            auto r = renamed.find(reg_key(*o.reg, o.constant));
+            if (r != renamed.end())
+                *o.reg = r->second;
+        }
+    }
+    // Erasing from the last address keeps the addresses not yet erased
+    std::sort(removed.begin(), removed.end(), std::greater<Address>());
+    for (auto a: removed)
+        bc.erase(a);
+}
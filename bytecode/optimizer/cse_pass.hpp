@@ -0,0 +1,59 @@
+///
+/// \file cse_pass.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Bytecode optimization pass for redundant loads and constants.
+///
+/// Bytecode generator loads a name every time it is used, so expression
+/// such as `p.x * p.x + p.y * p.y` looks up `p` four times and `x` and `y`
+/// twice. This pass does local value numbering in basic blocks of function
+/// bodies and removes loads of names (`LOAD`, `LOAD_GLOBAL`, `LOAD_NONLOC`)
+/// and attributes (`LOAD_ATTR`) whose value is already in a register, as
+/// well as stores of constants already stored into a constant register.
+/// Uses of the removed register are replaced by the one holding the value,
+/// when this cannot be done, the load is replaced by a register copy.
+///
+/// Value of a load is known until the end of the basic block or until:
+///  - its name is stored in this frame or a register bound to a name is
+///    changed,
+///  - its name is stored by `$` or `::` anywhere in the module (or assigned
+///    as an attribute of the module) and code which might run other code
+///    (call, operator, iteration) is executed,
+///  - its attribute is assigned and for attributes assigned anywhere in the
+///    module also when other code might run, other attributes are forgotten
+///    only on calls (which can run code of other modules).
+/// Operator and iterator methods of objects are expected not to assign
+/// attributes of other values. Operators are not deduplicated as those
+/// might be overloaded with side effects.
+///
+
+#ifndef _CSE_PASS_HPP_
+#define _CSE_PASS_HPP_
+
+#include "bytecode.hpp"
+#include "bc_pass.hpp"
+#include "bytecode_blob.hpp"
+#include <unordered_set>
+
+namespace moss {
+namespace opcode {
+
+class CSEPass : public BCPass {
+private:
+    /// Names stored by `$` or `::` or assigned as attributes in the module
+    std::unordered_set<ustring> module_names;
+    /// Attributes assigned in the module
+    std::unordered_set<ustring> module_attrs;
+public:
+    virtual void init(Bytecode *bc) override;
+    virtual void run(BCBlob *bcb) override;
+    virtual const char *get_name() const override { return "CSE"; }
+    virtual bool needs_whole_module() override { return true; }
+};
+
+}
+}
+
+#endif//_CSE_PASS_HPP_
@@ -0,0 +1,230 @@
+#include "loop_invariant_pass.hpp"
+#include "bc_analysis.hpp"
+#include "opcode.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace moss;
+using namespace opcode;
+
+namespace {
+
+/// Each cached load adds a flag register and opcodes setting it
+constexpr size_t MAX_CACHED_LOADS = 64;
+
+/// Loop in the function's frame
+struct Loop {
+    size_t begin; ///< Index of LOOP_BEGIN in frame opcodes
+    size_t end;   ///< Index of LOOP_END in frame opcodes
+    std::unordered_set<ustring> stored; ///< Names stored in the loop
+    bool calls;   ///< Loop might run code of other modules
+    bool unknown; ///< Loop binds names in a way which is not tracked
+};
+
+/// Chain of a name load and attribute loads of its value
+struct Chain {
+    Address start;
+    Address end;  ///< Address after the last cached load
+    size_t loop;  ///< Outermost loop the loads are invariant in
+    Register flag;
+};
+
+/// Opcodes inserted before an address
+struct Insertion {
+    std::vector<OpCode *> set;   ///< Setting flag of a chain ending here
+    std::vector<OpCode *> clear; ///< Clearing flags of a loop starting here
+    OpCode *guard = nullptr;     ///< Guard of a chain starting here
+
+    size_t size() const { return set.size() + clear.size() + (guard ? 1 : 0); }
+    /// Index of the opcode jumps to this address lead to, which is the guard
+    /// or the original opcode (jumps back in loop skip the flags clearing)
+    size_t landing() const { return set.size() + clear.size(); }
+};
+
+}
+
+void LoopInvariantPass::init(Bytecode *bc) {
+    get_module_stores(*bc, module_names, module_attrs);
+}
+
+void LoopInvariantPass::run(BCBlob *bcb) {
+    LOGMAX("Running loop invariant pass on " << bcb->get_debug_name());
+    FunBody body;
+    if (!get_fun_body(bcb, body))
+        return;
+    auto &bc = bcb->get_bc();
+    auto &code = bc.get_code();
+    std::vector<Address> insts;
+    if (!get_frame_insts(bc, body, insts))
+        return;
+
+    // Arguments (and this) are stored by the call into the first registers
+    Register first_temp = 1;
+    std::unordered_set<ustring> local_names{"this"};
+    auto &arg_names = body.create->arg_names;
+    for (size_t s = 0; !arg_names.empty() && s <= arg_names.size();) {
+        auto e = arg_names.find(',', s);
+        if (e == ustring::npos)
+            e = arg_names.size();
+        local_names.insert(arg_names.substr(s, e - s));
+        ++first_temp;
+        s = e + 1;
+    }
+
+    // Registers, names and loops of the frame
+    Register max_reg = 0;
+    Register max_creg = 0;
+    std::unordered_map<Register, unsigned> defs;
+    std::unordered_set<Register> named;
+    std::vector<Loop> loops;
+    std::vector<size_t> open_loops;
+    std::vector<Operand> ops;
+    for (size_t i = 0; i < insts.size(); ++i) {
+        auto op = code[insts[i]];
+        ops.clear();
+        if (!get_operands(op, ops)) {
+            LOGMAX("Loop invariant pass skipped as " << op->get_mnem() << " is used");
+            return;
+        }
+        for (auto &o: ops) {
+            if (o.constant) {
+                max_creg = std::max(max_creg, *o.reg);
+                continue;
+            }
+            max_reg = std::max(max_reg, *o.reg);
+            if (o.access == Access::DEF || o.access == Access::MAY_DEF)
+                ++defs[*o.reg];
+            else if (o.access == Access::NAMED)
+                named.insert(*o.reg);
+        }
+        if (auto sn = dyn_cast<StoreName>(op))
+            local_names.insert(sn->name);
+
+        if (isa<LoopBegin>(op)) {
+            open_loops.push_back(loops.size());
+            loops.push_back(Loop{i, 0, {}, false, false});
+            continue;
+        } else if (isa<LoopEnd>(op)) {
+            if (open_loops.empty())
+                return;
+            loops[open_loops.back()].end = i;
+            open_loops.pop_back();
+            continue;
+        }
+        for (auto l: open_loops) {
+            auto &loop = loops[l];
+            if (auto sn = dyn_cast<StoreName>(op)) {
+                loop.stored.insert(sn->name);
+            } else if (auto cf = dyn_cast<CreateFun>(op)) {
+                loop.stored.insert(cf->name);
+            } else if (auto be = dyn_cast<BuildEnum>(op)) {
+                loop.stored.insert(be->name);
+            } else if (isa<Call>(op) || isa<TailCall>(op) || isa<CallFormatter>(op)) {
+                loop.calls = true;
+            } else if (isa<Import>(op) || isa<ImportAll>(op)) {
+                loop.unknown = true;
+            }
+        }
+    }
+    if (!open_loops.empty())
+        return;
+    if (loops.empty())
+        return;
+
+    // Value of a register defined only by its load is kept for the rest of
+    // the loop
+    auto is_cacheable = [&](Register r) {
+        return r >= first_temp && defs[r] == 1 && named.count(r) == 0;
+    };
+    std::vector<Chain> chains;
+    for (size_t i = 0; i < insts.size() && chains.size() < MAX_CACHED_LOADS; ++i) {
+        auto load = dyn_cast<Load>(code[insts[i]]);
+        if (!load || load->name == "super" || !is_cacheable(load->dst))
+            continue;
+        // Already cached by previous run of this pass
+        if (i > 0 && isa<JmpIfTrue>(code[insts[i] - 1]))
+            continue;
+        size_t length = 1;
+        for (Register prev = load->dst; i + length < insts.size(); ++length) {
+            auto la = dyn_cast<LoadAttr>(code[insts[i + length]]);
+            if (!la || la->src != prev || !is_cacheable(la->dst) || insts[i + length] != insts[i] + length)
+                break;
+            prev = la->dst;
+        }
+
+        // Loads are cached in the outermost loop with the longest cacheable
+        // chain of them
+        size_t best_length = 0;
+        size_t best_loop = 0;
+        for (size_t l = 0; l < loops.size(); ++l) {
+            auto &loop = loops[l];
+            if (i <= loop.begin || i >= loop.end || loop.unknown)
+                continue;
+            if (loop.stored.count(load->name) || module_names.count(load->name))
+                continue;
+            size_t cacheable = 1;
+            if (!loop.calls) {
+                for (; cacheable < length; ++cacheable) {
+                    if (module_attrs.count(dyn_cast<LoadAttr>(code[insts[i + cacheable]])->name))
+                        break;
+                }
+            }
+            if (cacheable > best_length) {
+                best_length = cacheable;
+                best_loop = l;
+            }
+        }
+        // Name in this frame is found by the first lookup
+        if (best_length == 0 || (best_length == 1 && local_names.count(load->name))) {
+            i += length - 1;
+            continue;
+        }
+        chains.push_back(Chain{insts[i], static_cast<Address>(insts[i] + best_length), best_loop, 0});
+        i += length - 1;
+    }
+    if (chains.empty())
+        return;
+
+    // Each chain is guarded by a flag, which is cleared when the loop is
+    // entered and set after the loads are done:
+    //   LOOP_BEGIN
+    //   STORE_BOOL_CONST #c, false
+    //   STORE_CONST %flag, #c
+    //   ...
+    //   JMP_IF_TRUE %flag, done
+    //   LOAD %r, "name"
+    //   STORE_BOOL_CONST #c, true
+    //   STORE_CONST %flag, #c
+    // done:
+    const Register cflag = max_creg + 1;
+    std::map<Address, Insertion, std::greater<Address>> insertions;
+    for (auto &c: chains) {
+        c.flag = ++max_reg;
+        // Loop is entered through LOOP_BEGIN and jumps back lead after it
+        auto &clear = insertions[insts[loops[c.loop].begin] + 1].clear;
+        if (clear.empty())
+            clear.push_back(new StoreBoolConst(cflag, false));
+        clear.push_back(new StoreConst(c.flag, cflag));
+        auto &set = insertions[c.end].set;
+        set.push_back(new StoreBoolConst(cflag, true));
+        set.push_back(new StoreConst(c.flag, cflag));
+    }
+    for (auto &c: chains) {
+        // Guard jumps after the flag is set, where jumps to the chain's end
+        // lead once opcodes are inserted at and after the chain's start
+        auto &start = insertions[c.start];
+        start.guard = new JmpIfTrue(c.flag, c.end + insertions[c.end].landing() + start.landing() + 1);
+    }
+    LOG2("Loop invariant pass cached " << chains.size() << " loads in " << body.create->name);
+    // Inserting from the last address keeps the addresses not yet used
+    for (auto &[addr, ins]: insertions) {
+        std::vector<OpCode *> new_ops = ins.set;
+        new_ops.insert(new_ops.end(), ins.clear.begin(), ins.clear.end());
+        if (ins.guard)
+            new_ops.push_back(ins.guard);
+        bc.insert(new_ops, addr, ins.landing());
+    }
+}
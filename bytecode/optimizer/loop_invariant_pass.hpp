@@ -0,0 +1,54 @@
+///
+/// \file loop_invariant_pass.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Bytecode optimization pass for loop invariant loads.
+///
+/// Loads of names and chains of attribute loads (`Math.pi`,
+/// `obj.config.limit`) are evaluated on every iteration of a loop even when
+/// nothing in the loop can change their value. This pass caches such loads
+/// in function bodies, the load is done only the first time it is reached
+/// in the loop and its register is then kept for the rest of the loop.
+/// Loads are not hoisted before the loop, since a name or attribute which
+/// does not exist would raise even if the loop is never run (or raise
+/// before other code of the loop).
+///
+/// Load is invariant in a loop when:
+///  - its name is not stored in the loop and not stored by `$` or `::`
+///    anywhere in the module (nor assigned as an attribute of the module),
+///  - its attributes are not assigned anywhere in the module and the loop
+///    does not call anything (calls can run code of other modules).
+/// Operator and iterator methods of objects are expected not to assign
+/// attributes of other values.
+///
+
+#ifndef _LOOP_INVARIANT_PASS_HPP_
+#define _LOOP_INVARIANT_PASS_HPP_
+
+#include "bytecode.hpp"
+#include "bc_pass.hpp"
+#include "bytecode_blob.hpp"
+#include <unordered_set>
+
+namespace moss {
+namespace opcode {
+
+class LoopInvariantPass : public BCPass {
+private:
+    /// Names stored by `$` or `::` or assigned as attributes in the module
+    std::unordered_set<ustring> module_names;
+    /// Attributes assigned in the module
+    std::unordered_set<ustring> module_attrs;
+public:
+    virtual void init(Bytecode *bc) override;
+    virtual void run(BCBlob *bcb) override;
+    virtual const char *get_name() const override { return "LoopInvariant"; }
+    virtual bool needs_whole_module() override { return true; }
+};
+
+}
+}
+
+#endif//_LOOP_INVARIANT_PASS_HPP_
@@ -1,8 +1,264 @@
 #include "register_reuse_pass.hpp"
+#include "bc_analysis.hpp"
+#include "opcode.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 using namespace moss;
 using namespace opcode;
 
+namespace {
+
+/// Functions with more temporaries are left as they are, because the
+/// interference matrix grows quadratically
+constexpr size_t MAX_CANDIDATES = 4096;
+
+inline bool test_bit(const uint64_t *set, size_t i) {
+    return (set[i / 64] >> (i % 64)) & 1;
+}
+
+inline void set_bit(uint64_t *set, size_t i) {
+    set[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+}
+
 void RegisterReusePass::run(BCBlob *bcb) {
     LOGMAX("Running register reuse pass on " << bcb->get_debug_name());
-}
\ No newline at end of file
+    FunBody body;
+    if (!get_fun_body(bcb, body))
+        return;
+    auto &code = bcb->get_bc().get_code();
+    auto create = body.create;
+    const Address body_start = body.start;
+    const Address body_end = body.end;
+
+    // Arguments (and this) are stored by the call into the first registers
+    Register first_temp = 1;
+    if (!create->arg_names.empty())
+        first_temp += std::count(create->arg_names.begin(), create->arg_names.end(), ',') + 1;
+
+    std::vector<Address> insts;
+    if (!get_frame_insts(bcb->get_bc(), body, insts))
+        return;
+    std::vector<long> inst_index(body_end - body_start, -1);
+    for (size_t i = 0; i < insts.size(); ++i)
+        inst_index[insts[i] - body_start] = i;
+
+    const size_t n = insts.size();
+    std::vector<std::vector<Operand>> operands(n);
+    std::unordered_set<Register> named;
+    for (size_t i = 0; i < n; ++i) {
+        if (!get_operands(code[insts[i]], operands[i])) {
+            LOGMAX("Register reuse skipped as " << code[insts[i]]->get_mnem() << " is used");
+            return;
+        }
+        for (auto &o: operands[i]) {
+            if (o.access == Access::NAMED)
+                named.insert(*o.reg);
+        }
+    }
+
+    // Registers which are defined in this frame and not accessible by name
+    std::unordered_map<uint64_t, long> cand_index;
+    std::vector<std::pair<Register, bool>> cands;
+    auto key = [](Register r, bool constant) { return (static_cast<uint64_t>(constant) << 32) | r; };
+    for (auto &ops: operands) {
+        for (auto &o: ops) {
+            if (o.access != Access::DEF && o.access != Access::MAY_DEF)
+                continue;
+            if (!o.constant && (*o.reg < first_temp || named.count(*o.reg)))
+                continue;
+            if (cand_index.emplace(key(*o.reg, o.constant), cands.size()).second)
+                cands.push_back({*o.reg, o.constant});
+        }
+    }
+    if (cands.empty())
+        return;
+    if (cands.size() > MAX_CANDIDATES) {
+        LOGMAX("Register reuse skipped as there are too many registers: " << cands.size());
+        return;
+    }
+    for (auto &ops: operands) {
+        for (auto &o: ops) {
+            auto c = cand_index.find(key(*o.reg, o.constant));
+            if (c != cand_index.end() && o.access != Access::NAMED)
+                o.cand = c->second;
+        }
+    }
+
+    // Switch jumps to addresses pushed into a list as int constants
+    std::unordered_map<Register, IntConst> int_consts;
+    std::unordered_map<Register, std::vector<Address>> list_addrs;
+    std::unordered_set<Register> unknown_lists;
+    for (auto a: insts) {
+        auto op = code[a];
+        if (auto sic = dyn_cast<StoreIntConst>(op)) {
+            int_consts[sic->dst] = sic->val;
+        } else if (auto lpc = dyn_cast<ListPushConst>(op)) {
+            auto ic = int_consts.find(lpc->csrc);
+            if (ic != int_consts.end())
+                list_addrs[lpc->dst].push_back(static_cast<Address>(ic->second));
+            else
+                unknown_lists.insert(lpc->dst);
+        } else if (auto lp = dyn_cast<ListPush>(op)) {
+            unknown_lists.insert(lp->dst);
+        } else if (op->get_type() >= OpCodes::STORE_FLOAT_CONST && op->get_type() <= OpCodes::STORE_NIL_CONST) {
+            for (auto &o: operands[inst_index[a - body_start]])
+                int_consts.erase(*o.reg);
+        }
+    }
+
+    // Control flow graph
+    std::vector<std::vector<size_t>> succs(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto op = code[insts[i]];
+        bool valid = true;
+        auto target = [&](Address addr) {
+            if (addr < body_start || addr >= body_end || inst_index[addr - body_start] < 0)
+                valid = false;
+            else
+                succs[i].push_back(inst_index[addr - body_start]);
+        };
+        auto next = [&]() {
+            if (i + 1 < n)
+                succs[i].push_back(i + 1);
+            else
+                valid = false;
+        };
+        switch (op->get_type()) {
+        case OpCodes::JMP: target(dyn_cast<Jmp>(op)->addr); break;
+        case OpCodes::BREAK_TO: target(dyn_cast<BreakTo>(op)->addr); break;
+        case OpCodes::JMP_IF_TRUE: next(); target(dyn_cast<JmpIfTrue>(op)->addr); break;
+        case OpCodes::JMP_IF_FALSE: next(); target(dyn_cast<JmpIfFalse>(op)->addr); break;
+        case OpCodes::FOR: next(); target(dyn_cast<For>(op)->addr); break;
+        case OpCodes::SWITCH: {
+            auto sw = dyn_cast<Switch>(op);
+            if (unknown_lists.count(sw->addrs)) {
+                valid = false;
+                break;
+            }
+            for (auto a: list_addrs[sw->addrs])
+                target(a);
+            target(sw->default_addr);
+        } break;
+        case OpCodes::RETURN:
+        case OpCodes::RETURN_CONST:
+        case OpCodes::RAISE:
+            break;
+        default: next(); break;
+        }
+        if (!valid) {
+            LOGMAX("Register reuse skipped as jump target of " << *op << " is not known");
+            return;
+        }
+    }
+
+    // Liveness
+    const size_t nc = cands.size();
+    const size_t words = (nc + 63) / 64;
+    std::vector<uint64_t> live_in(n * words, 0);
+    std::vector<uint64_t> live_out(n * words, 0);
+    std::vector<uint64_t> uses(n * words, 0);
+    std::vector<uint64_t> kills(n * words, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto &o: operands[i]) {
+            if (o.cand < 0)
+                continue;
+            if (o.access == Access::USE)
+                set_bit(&uses[i * words], o.cand);
+            else if (o.access == Access::DEF)
+                set_bit(&kills[i * words], o.cand);
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = n; i-- > 0;) {
+            uint64_t *out = &live_out[i * words];
+            for (auto s: succs[i]) {
+                const uint64_t *sin = &live_in[s * words];
+                for (size_t w = 0; w < words; ++w)
+                    out[w] |= sin[w];
+            }
+            uint64_t *in = &live_in[i * words];
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t v = uses[i * words + w] | (out[w] & ~kills[i * words + w]);
+                if (v != in[w]) {
+                    in[w] = v;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Interference graph, registers of different pools do not interfere
+    std::vector<uint64_t> interf(nc * words, 0);
+    auto interfere = [&](size_t a, size_t b) {
+        if (a == b || cands[a].second != cands[b].second)
+            return;
+        set_bit(&interf[a * words], b);
+        set_bit(&interf[b * words], a);
+    };
+    for (size_t i = 0; i < n; ++i) {
+        for (auto &d: operands[i]) {
+            if (d.cand < 0 || (d.access != Access::DEF && d.access != Access::MAY_DEF))
+                continue;
+            const uint64_t *out = &live_out[i * words];
+            for (size_t c = 0; c < nc; ++c) {
+                if (test_bit(out, c))
+                    interfere(d.cand, c);
+            }
+            // Opcode might store the result before it is done with operands
+            for (auto &o: operands[i]) {
+                if (o.cand >= 0)
+                    interfere(d.cand, o.cand);
+            }
+        }
+    }
+    // Registers read before being set are all live at the function start
+    for (size_t a = 0; a < nc; ++a) {
+        if (!test_bit(&live_in[0], a))
+            continue;
+        for (size_t b = a + 1; b < nc; ++b) {
+            if (test_bit(&live_in[0], b))
+                interfere(a, b);
+        }
+    }
+
+    // Greedy coloring in order of first appearance, colors are mapped onto
+    // the lowest of the original registers of each pool
+    std::vector<long> color(nc, -1);
+    std::vector<bool> used;
+    size_t colors[2] = {0, 0};
+    for (size_t c = 0; c < nc; ++c) {
+        used.assign(nc, false);
+        for (size_t o = 0; o < nc; ++o) {
+            if (color[o] >= 0 && test_bit(&interf[c * words], o))
+                used[color[o]] = true;
+        }
+        size_t col = 0;
+        while (used[col])
+            ++col;
+        color[c] = col;
+        colors[cands[c].second] = std::max(colors[cands[c].second], col + 1);
+    }
+    std::vector<Register> pool_regs[2];
+    for (auto &c: cands)
+        pool_regs[c.second].push_back(c.first);
+    std::sort(pool_regs[0].begin(), pool_regs[0].end());
+    std::sort(pool_regs[1].begin(), pool_regs[1].end());
+
+    LOG2("Register reuse in " << create->name << ": " << pool_regs[0].size() << " -> " << colors[0] << " registers, "
+         << pool_regs[1].size() << " -> " << colors[1] << " constant registers");
+    for (auto &ops: operands) {
+        for (auto &o: ops) {
+            if (o.cand >= 0)
+                *o.reg = pool_regs[cands[o.cand].second][color[o.cand]];
+        }
+    }
+}
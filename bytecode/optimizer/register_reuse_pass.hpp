@@ -6,6 +6,13 @@
 /// 
 /// \brief Bytecode optimization pass for reuse of registers.
 ///
+/// Bytecode generator never reuses registers, so every temporary value in
+/// a function gets its own register. This pass computes liveness of
+/// registers in function bodies and renumbers temporaries (in both register
+/// and constant pool) so that registers whose value is no longer needed are
+/// reused. Registers bound to names are never changed as they can be
+/// accessed by name (from closures as well).
+///
 
 #ifndef _REGISTER_REUSE_PASS_HPP_
 #define _REGISTER_REUSE_PASS_HPP_
@@ -20,6 +27,7 @@ namespace opcode {
 class RegisterReusePass : public BCPass {
 public:
     virtual void run(BCBlob *bcb) override;
+    virtual const char *get_name() const override { return "RegisterReuse"; }
 };
 
 }
@@ -5,6 +5,7 @@
 #include "errors.hpp"
 #include "clopts.hpp"
 #include "builtins.hpp"
+#include "pass_stats.hpp"
 #include <cassert>
 #include <climits>
 #include <cmath>
@@ -61,7 +62,7 @@ void Parser::check_code_output(Module *m, ir::IR *decl) {
             code_str << "```moss\n";
             auto src_i = decl->get_src_info();
             for (unsigned l = src_i.get_lines().first; l <= src_i.get_lines().second; ++l) {
-                code_str << scanner->get_src_text()[l] << "\n";
+                code_str << scanner->get_src_line(l) << "\n";
             }
             code_str << "```\n";
             m->push_back(new ir::Note("md", new ir::StringLiteral(code_str.str(), src_i), src_i));
@@ -72,18 +73,24 @@ void Parser::check_code_output(Module *m, ir::IR *decl) {
 IR *Parser::parse() {
     LOG1("Started parsing module");
     reading_by_lines = false;
+    ArenaScope arena_scope(&arena);
     SourceInfo mod_src_i(src_file, 0, 0, 0, 0);
     Module *m = new Module(this->src_file.get_module_name(), mod_src_i);
     parents.push_back(m);
 
     LOG2("Running scanner");
-    Token *t = nullptr;
-    do {
-        t = scanner->next_token();
-        tokens.push_back(t);
-    } while(t->get_type() != TokenType::END_OF_FILE);
+    {
+        passstats::PhaseTimer scan_timer(src_file.get_name(), "scanner");
+        Token *t = nullptr;
+        do {
+            t = scanner->next_token();
+            tokens.push_back(t);
+        } while(t->get_type() != TokenType::END_OF_FILE);
+        scan_timer.count = tokens.size();
+    }
     LOG2("Finished scanning");
 
+    passstats::PhaseTimer parse_timer(src_file.get_name(), "parser");
     try {
         bind_docstring();
     } catch (Raise *raise) {
@@ -102,6 +109,7 @@ IR *Parser::parse() {
         assert(decl && "Declaration in parser is nullptr");
         check_code_output(m, decl);
         m->push_back(decl);
+        ++parse_timer.count;
     }
 
     // Append EOF, but only when not already present as it may be added by
@@ -113,6 +121,66 @@ IR *Parser::parse() {
     return m;
 }
 
+IR *Parser::parse_chunk(size_t max_decls) {
+    LOG1("Started parsing module chunk");
+    reading_by_lines = false;
+    streaming = true;
+    ArenaScope arena_scope(get_arena());
+    SourceInfo mod_src_i(src_file, 0, 0, 0, 0);
+    Module *m = new Module(this->src_file.get_module_name(), mod_src_i);
+    // Tokens are scanned while parsing, so scanner is timed as a part of it
+    passstats::PhaseTimer parse_timer(src_file.get_name(), "parser");
+    if (parents.empty()) {
+        parents.push_back(m);
+        try {
+            bind_docstring();
+        } catch (Raise *raise) {
+            delete m;
+            return raise;
+        }
+    } else {
+        // Previous chunk was already deleted
+        parents.front() = m;
+    }
+
+    for (size_t i = 0; i < max_decls && !check(TokenType::END_OF_FILE); ++i) {
+        drop_parsed_tokens();
+        IR *decl;
+        try {
+            decl = declaration();
+        } catch (Raise *raise) {
+            delete m;
+            return raise;
+        }
+        assert(decl && "Declaration in parser is nullptr");
+        check_code_output(m, decl);
+        m->push_back(decl);
+        ++parse_timer.count;
+    }
+
+    if (check(TokenType::END_OF_FILE) && (m->empty() || !isa<EndOfFile>(m->back())))
+        m->push_back(new ir::EndOfFile(curr_src_info()));
+
+    LOG1("Finished parsing module chunk");
+    return m;
+}
+
+Token *Parser::scan_token(size_t i) {
+    if (streaming) {
+        while (i >= tokens.size() && (tokens.empty() || tokens.back()->get_type() != TokenType::END_OF_FILE)) {
+            tokens.push_back(scanner->next_token());
+        }
+    }
+    return i < tokens.size() ? tokens[i] : tokens.back();
+}
+
+void Parser::drop_parsed_tokens() {
+    for (size_t i = 0; i < curr_token; ++i)
+        delete tokens[i];
+    tokens.erase(tokens.begin(), tokens.begin() + curr_token);
+    curr_token = 0;
+}
+
 void Parser::scan_line() {
     Token *t = nullptr;
     bool padding_start = true;
@@ -175,7 +243,7 @@ void Parser::next_decl() {
 }
 
 bool Parser::check_ws(TokenType type) {
-    return tokens[curr_token]->get_type() == type;
+    return token_at(curr_token)->get_type() == type;
 }
 
 /*bool Parser::match_ws(TokenType type) {
@@ -209,10 +277,10 @@ Token *Parser::advance_ws() {
 
 bool Parser::check(TokenType type) {
     int offset = 0;
-    while (tokens[curr_token+offset]->get_type() == TokenType::WS) {
+    while (token_at(curr_token+offset)->get_type() == TokenType::WS) {
         ++offset;
     }
-    return tokens[curr_token+offset]->get_type() == type;
+    return token_at(curr_token+offset)->get_type() == type;
 }
 
 bool Parser::check(std::initializer_list<TokenType> types) {
@@ -223,20 +291,19 @@ bool Parser::check(std::initializer_list<TokenType> types) {
 }
 
 Token *Parser::peek(int offset) {
-    if (curr_token + offset > tokens.size()) return tokens.back();
     int gen_off = 0;
     int i = 0;
     assert(offset >= 0);
-    while (tokens[curr_token+i]->get_type() == TokenType::WS) {
+    while (token_at(curr_token+i)->get_type() == TokenType::WS) {
         ++i;
     }
     while (gen_off != offset) {
-        auto tt = tokens[curr_token+i]->get_type();
+        auto tt = token_at(curr_token+i)->get_type();
         ++i;
         if (tt == TokenType::WS) continue;
         ++gen_off;
     }
-    return tokens[curr_token+i];
+    return token_at(curr_token+i);
 }
 
 bool Parser::match(TokenType type) {
@@ -256,7 +323,7 @@ Token *Parser::expect(TokenType type, diags::Diagnostic msg) {
 }
 
 Token *Parser::advance() {
-    while (tokens[curr_token]->get_type() == TokenType::WS) {
+    while (token_at(curr_token)->get_type() == TokenType::WS) {
         ++curr_token;
     }
     if (multi_line_parsing && reading_by_lines && tokens[curr_token]->get_type() == TokenType::END_NL) {
@@ -32,12 +32,15 @@ class Parser {
 private:
     SourceFile &src_file;
     Scanner *scanner;
+    /// Tokens and IR of parsed module, freed with the parser
+    Arena arena;
     
     size_t curr_token;
     std::vector<Token *> tokens;
 
     int lower_range_prec;
     bool reading_by_lines;
+    bool streaming;
     int multi_line_parsing;
     bool enable_code_output;
     int parenth_depth;
@@ -102,6 +105,18 @@ private:
     ir::Expression *note();
     ir::Expression *scope();
 
+    /// \return Token at index i, when streaming it is scanned only once needed.
+    ///         Indices past the last token return the last token.
+    Token *token_at(size_t i) {
+        if (i < tokens.size())
+            return tokens[i];
+        return scan_token(i);
+    }
+    Token *scan_token(size_t i);
+    /// Deletes tokens before the current one (which cannot be accessed anymore
+    /// once a top level declaration was parsed)
+    void drop_parsed_tokens();
+
     bool check(TokenType type);
     bool check(std::initializer_list<TokenType> types);
     bool match(TokenType type);
@@ -148,13 +163,12 @@ private:
 
     /// \return SourceInfo for the currently parsed token
     SourceInfo curr_src_info() {
-        assert(curr_token < tokens.size() && "oob");
-        return tokens[curr_token]->get_src_info();
+        return token_at(curr_token)->get_src_info();
     }
 
     template<typename ... Args>
     inline diags::Diagnostic create_diag(diags::DiagID id, Args ... args) {
-        return diags::Diagnostic(this->src_file, tokens[curr_token]->get_src_info(), scanner, id, args ...);
+        return diags::Diagnostic(this->src_file, token_at(curr_token)->get_src_info(), scanner, id, args ...);
     }
 
     template<typename ... Args>
@@ -168,7 +182,7 @@ public:
     }
 
     Parser(SourceFile &file) : src_file(file), scanner(new Scanner(file)), curr_token(0),
-                               lower_range_prec(0), reading_by_lines(false),
+                               lower_range_prec(0), reading_by_lines(false), streaming(false),
                                multi_line_parsing(0), enable_code_output(false),
                                parenth_depth(0) {
         static_assert(sizeof(long long) * CHAR_BIT >= 64, "long long on this platform is less than 64bit, parsing will be incorrect");                            
@@ -180,6 +194,8 @@ public:
     }
 
     /// Parses a moss file into an AST
+    /// Tokens and IR are allocated in the parser's arena, so the returned IR
+    /// has to be deleted before the parser.
     /// \return File parsed into a ir::Module. If there is an error then ir::Raise is thrown
     /// \throw ir::Raise with parser/scanner error to be rethrown by moss
     ir::IR *parse();
@@ -189,9 +205,27 @@ public:
     /// \throw ir::Raise with parser/scanner error to be rethrown by moss
     std::vector<ir::IR *> parse_line();
 
+    /// Parses next at most max_decls top level declarations of a moss file,
+    /// so that the module can be compiled and run while it is being parsed.
+    /// Tokens are scanned only when needed and freed once parsed, the IR is
+    /// allocated on the heap so that it can be freed after each chunk.
+    /// \return ir::Module with the parsed declarations (its first chunk
+    ///         holds the module documentation and the last one ends with
+    ///         ir::EndOfFile). If there is an error then ir::Raise is returned.
+    ir::IR *parse_chunk(size_t max_decls);
+
     static bool is_operator_fun(ustring name);
     SourceFile &get_src_file() { return this->src_file; }
     Scanner *get_scanner() { return this->scanner; }
+
+    /// \return Arena for the parsed module's IR or nullptr if IR should be
+    ///         heap allocated (REPL lines and streamed chunks are freed one
+    ///         by one while the parser is still used)
+    Arena *get_arena() { return (reading_by_lines || streaming) ? nullptr : &this->arena; }
+
+    /// \return true if the whole module is parsed at once, otherwise later
+    ///         lines or chunks might redefine names of already parsed code
+    bool is_whole_module() { return !reading_by_lines && !streaming; }
 };
 
 }
@@ -5,31 +5,223 @@
 #include <iostream>
 #include <cstring>
 #include <sstream>
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
 
 using namespace moss;
 
-UTF8Char Scanner::advance() {
-    if (this->curr_byte >= curr_line.size()) {
-        std::string l;
-        if (!std::getline(*stream, l)) {
-            std::cin.clear();
-            ++this->len;
-            return EOF;
+namespace {
+
+/// Keyword with its token type for the keyword table
+struct Keyword {
+    const char *name;
+    TokenType type;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"and", TokenType::AND},
+    {"or", TokenType::OR},
+    {"not", TokenType::NOT},
+    {"xor", TokenType::XOR},
+    {"in", TokenType::IN},
+
+    {"import", TokenType::IMPORT},
+    {"as", TokenType::AS},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"while", TokenType::WHILE},
+    {"do", TokenType::DO},
+    {"for", TokenType::FOR},
+    {"switch", TokenType::SWITCH},
+    {"case", TokenType::CASE},
+    {"default", TokenType::DEFAULT},
+    {"try", TokenType::TRY},
+    {"catch", TokenType::CATCH},
+    {"finally", TokenType::FINALLY},
+    {"assert", TokenType::ASSERT},
+
+    {"break", TokenType::BREAK},
+    {"continue", TokenType::CONTINUE},
+    {"raise", TokenType::RAISE},
+    {"return", TokenType::RETURN},
+
+    {"enum", TokenType::ENUM},
+    {"class", TokenType::CLASS},
+    {"space", TokenType::SPACE},
+    {"fun", TokenType::FUN},
+
+    {"nil", TokenType::NIL},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+    {"super", TokenType::SUPER},
+    {"this", TokenType::THIS}
+};
+
+constexpr size_t KEYWORD_TABLE_SIZE = 64;
+
+constexpr size_t const_strlen(const char *s) {
+    size_t l = 0;
+    while (s[l] != '\0')
+        ++l;
+    return l;
+}
+
+/// Perfect hash of keywords, when a keyword is added, the constants might
+/// need to change so that there are no collisions
+constexpr size_t keyword_hash(const char *s, size_t len) {
+    return (len + static_cast<unsigned char>(s[0]) * 44 + static_cast<unsigned char>(s[len-1]) * 4) % KEYWORD_TABLE_SIZE;
+}
+
+struct KeywordTable {
+    /// Index into KEYWORDS + 1 (0 is an empty slot)
+    unsigned char slots[KEYWORD_TABLE_SIZE] = {};
+    bool collision = false;
+
+    constexpr KeywordTable() {
+        for (size_t i = 0; i < std::size(KEYWORDS); ++i) {
+            auto h = keyword_hash(KEYWORDS[i].name, const_strlen(KEYWORDS[i].name));
+            if (slots[h] != 0)
+                collision = true;
+            slots[h] = i + 1;
         }
-        src_text.push_back(l);
-        curr_line.assign(l.begin(), l.end());
-        curr_byte = 0;
-        if(file.get_type() == SourceFile::SourceType::REPL || stream->peek() != EOF)
-            curr_line += '\n';
     }
+};
+
+constexpr KeywordTable KEYWORD_TABLE;
+static_assert(!KEYWORD_TABLE.collision, "Keyword hash has a collision");
+
+/// \return Keyword token type for id or nullptr if it is not a keyword
+const TokenType *find_keyword(const ustring &id) {
+    if (id.empty())
+        return nullptr;
+    auto slot = KEYWORD_TABLE.slots[keyword_hash(id.data(), id.size())];
+    if (slot == 0)
+        return nullptr;
+    auto &kw = KEYWORDS[slot - 1];
+    if (std::strcmp(kw.name, id.c_str()) != 0)
+        return nullptr;
+    return &kw.type;
+}
+
+/// Character classes of ASCII bytes for the scanning fast paths
+enum CharClass : unsigned char {
+    CC_ID = 1,      ///< Letter, digit or _
+    CC_DIGIT = 2,   ///< Decimal digit
+    CC_SPACE = 4,   ///< Whitespace other than new line
+};
+
+struct CharClasses {
+    unsigned char classes[256] = {};
+
+    constexpr CharClasses() {
+        for (int c = 'a'; c <= 'z'; ++c)
+            classes[c] |= CC_ID;
+        for (int c = 'A'; c <= 'Z'; ++c)
+            classes[c] |= CC_ID;
+        for (int c = '0'; c <= '9'; ++c)
+            classes[c] |= CC_ID | CC_DIGIT;
+        classes[static_cast<unsigned char>('_')] |= CC_ID;
+        for (char c: {' ', '\t', '\v', '\f', '\r'})
+            classes[static_cast<unsigned char>(c)] |= CC_SPACE;
+    }
+};
+
+constexpr CharClasses CHAR_CLASSES;
+
+inline bool has_class(char c, CharClass cc) {
+    return CHAR_CLASSES.classes[static_cast<unsigned char>(c)] & cc;
+}
+
+/// \return Length of the prefix of [p, end) that is plain string content, this
+///         is ASCII which does not end the string or start an escape sequence,
+///         fstring expression or a new line.
+/// Checks 8 bytes at a time.
+size_t plain_string_run(const char *p, const char *end, bool fstring) {
+    constexpr std::uint64_t ONES = 0x0101010101010101ULL;
+    constexpr std::uint64_t HIGHS = 0x8080808080808080ULL;
+    auto has_byte = [](std::uint64_t w, unsigned char c) {
+        auto x = w ^ (ONES * c);
+        return (x - ONES) & ~x & HIGHS;
+    };
+    const char *start = p;
+    while (end - p >= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p, sizeof(w));
+        auto stop = (w & HIGHS) | has_byte(w, '"') | has_byte(w, '\\') | has_byte(w, '\n');
+        if (fstring)
+            stop |= has_byte(w, '{') | has_byte(w, '}');
+        if (stop)
+            break;
+        p += 8;
+    }
+    for (; p < end; ++p) {
+        auto c = static_cast<unsigned char>(*p);
+        if (c >= 0x80 || c == '"' || c == '\\' || c == '\n' || (fstring && (c == '{' || c == '}')))
+            break;
+    }
+    // Byte followed by utf-8 continuation is a part of utf-8 character
+    if (p > start && p < end && (*p & 0b11000000) == 0b10000000)
+        --p;
+    return p - start;
+}
 
-    int c = curr_line[curr_byte];
+}
+
+Scanner::Scanner(SourceFile &file) : file(file), stream(nullptr), line(0), col(0), len(0),
+                                     curr_line(), buf(nullptr), buf_size(0), curr_byte(0) {
+    switch (file.get_type()) {
+        case SourceFile::SourceType::FILE: {
+            contents = FileContents::map(file.get_path_or_code());
+            if (!contents) {
+                error::error(error::ErrorCode::FILE_ACCESS, std::strerror(errno), &file, true);
+            }
+        } break;
+        case SourceFile::SourceType::STRING: {
+            contents = std::make_unique<FileContents>(file.get_path_or_code());
+        } break;
+        default: {
+            this->stream = file.get_new_stream();
+            return;
+        }
+    }
+    buf = contents->data();
+    buf_size = contents->size();
+    // Last new line is not part of the code (as with reading by lines)
+    if (buf_size > 0 && buf[buf_size-1] == '\n')
+        --buf_size;
+}
+
+bool Scanner::read_line() {
+    if (!stream)
+        return false;
+    std::string l;
+    if (!std::getline(*stream, l)) {
+        std::cin.clear();
+        return false;
+    }
+    src_text.push_back(l);
+    curr_line.assign(l.begin(), l.end());
+    if(file.get_type() == SourceFile::SourceType::REPL || stream->peek() != EOF)
+        curr_line += '\n';
+    buf = curr_line.data();
+    buf_size = curr_line.size();
+    curr_byte = 0;
+    return true;
+}
+
+UTF8Char Scanner::advance() {
+    if (this->curr_byte >= buf_size && !read_line()) {
+        ++this->len;
+        return EOF;
+    }
+
+    int c = buf[curr_byte];
     // Read bytes that are continuation of utf-8
     // FIXME: On Windows this does seem to work correctly
     int substr_len = 1;
-    while (curr_byte < curr_line.size()) {
-        int cn = curr_line[curr_byte+1];
+    while (curr_byte + 1 < buf_size) {
+        int cn = buf[curr_byte+1];
         if ((cn & 0b11000000) == 0b10000000) {
             ++substr_len;
             ++curr_byte;
@@ -41,18 +233,29 @@ UTF8Char Scanner::advance() {
     if (substr_len > 1) {
         ++curr_byte;
         ++this->len;
-        std::string utf8 = curr_line.substr(curr_byte-substr_len, substr_len);
-        return UTF8Char(utf8);
+        return UTF8Char(std::string(buf + curr_byte - substr_len, substr_len));
     }
     ++curr_byte;
     ++this->len;
     return UTF8Char(c);
 }
 
+template<typename F>
+size_t Scanner::advance_ascii_while(F pred) {
+    // Byte followed by utf-8 continuation is a part of utf-8 character,
+    // so the last byte is left for advance to decide
+    size_t start = curr_byte;
+    while (curr_byte + 1 < buf_size && pred(buf[curr_byte]) && (buf[curr_byte+1] & 0b11000000) != 0b10000000)
+        ++curr_byte;
+    size_t amount = curr_byte - start;
+    this->len += amount;
+    return amount;
+}
+
 UTF8Char Scanner::peek() {
     // Peek should never happen after a new line, but might on last line
     // Which means its eof
-    if (this->curr_byte >= curr_line.size()) {
+    if (this->curr_byte >= buf_size) {
         return UTF8Char(EOF);
     }
 
@@ -123,6 +326,9 @@ static bool is_part_of_id(UTF8Char c) {
 
 Token *Scanner::parse_id_or_keyword(ustring start) {
     ustring id_str = start;
+    size_t run_start = curr_byte;
+    if (advance_ascii_while([](char c) { return has_class(c, CC_ID); }) > 0)
+        id_str.append(buf + run_start, curr_byte - run_start);
     auto next_c = peek();
     while (is_part_of_id(next_c)) {
         id_str += next_c.to_str();
@@ -131,8 +337,8 @@ Token *Scanner::parse_id_or_keyword(ustring start) {
     }
 
     // Check if id_str matches any keyword
-    if (this->KEYWORDS.find(id_str) != this->KEYWORDS.end()) {
-        return tokenize(id_str, KEYWORDS.at(id_str));
+    if (auto kw = find_keyword(id_str)) {
+        return tokenize(id_str, *kw);
     }
 
     return tokenize(id_str, TokenType::ID);
@@ -203,6 +409,11 @@ Token *Scanner::parse_number(int start) {
         advance();
         if (next_c != DIGIT_SEPARATOR) {
             number_str += ustring(1, next_c);
+            if (base == 10) {
+                size_t run_start = curr_byte;
+                if (advance_ascii_while([](char c) { return has_class(c, CC_DIGIT); }) > 0)
+                    number_str.append(buf + run_start, curr_byte - run_start);
+            }
             was_number = true;
             is_last_dig_base = false;
         } else {
@@ -343,12 +554,19 @@ Token *Scanner::parse_multi_comment() {
             this->len = 0;
             newlines += "\n";
         }
+        // Skip bytes which cannot end the comment or start a new line
+        advance_ascii_while([](char c) { return c != '\0' && !(c & 0x80) && c != '*' && c != '\n'; });
         next_c = advance();
     }
     return err_tokenize("/*", "", error::msgs::UNTERMINATED_COMMENT, "");
 }
 
 Token *Scanner::parse_comment_or_shebang() {
+    // Comment contents do not matter, so skip right to the new line
+    if (!stream) {
+        auto nl = static_cast<const char *>(std::memchr(buf + curr_byte, '\n', buf_size - curr_byte));
+        curr_byte = nl ? nl - buf : buf_size;
+    }
     auto next_c = advance();
     while(next_c.is_utf || (next_c.c != '\n' && next_c.c != EOF)) {
         next_c = advance();
@@ -470,6 +688,10 @@ Token *Scanner::parse_string(bool triple_quote, bool fstring) {
             }
         }
         value += next_c.to_str();
+        size_t run = plain_string_run(buf + curr_byte, buf + buf_size, fstring);
+        value.append(buf + curr_byte, run);
+        curr_byte += run;
+        this->len += run;
         next_c = advance();
     }
     return err_tokenize(value, "", error::msgs::UNTERMINATED_STRING_LITERAL, "");
@@ -500,6 +722,9 @@ Token *Scanner::next_token() {
         // Consume all whitespace as one
         if (std::isspace(c) && c != '\n') {
             ustring space_str(1, c);
+            size_t run_start = curr_byte;
+            if (advance_ascii_while([](char c) { return has_class(c, CC_SPACE); }) > 0)
+                space_str.append(buf + run_start, curr_byte - run_start);
             c = peek_nonutf();
             while (std::isspace(c) && c != '\n') {
                 space_str.append(1, advance().c);
@@ -688,41 +913,27 @@ Token *Scanner::next_token() {
     }
 }
 
-const std::unordered_map<ustring, TokenType> Scanner::KEYWORDS = {
-    {"and", TokenType::AND},
-    {"or", TokenType::OR},
-    {"not", TokenType::NOT},
-    {"xor", TokenType::XOR},
-    {"in", TokenType::IN},
-    
-    {"import", TokenType::IMPORT},
-    {"as", TokenType::AS},
-    {"if", TokenType::IF},
-    {"else", TokenType::ELSE},
-    {"while", TokenType::WHILE},
-    {"do", TokenType::DO},
-    {"for", TokenType::FOR},
-    {"switch", TokenType::SWITCH},
-    {"case", TokenType::CASE},
-    {"default", TokenType::DEFAULT},
-    {"try", TokenType::TRY},
-    {"catch", TokenType::CATCH},
-    {"finally", TokenType::FINALLY},
-    {"assert", TokenType::ASSERT},
-
-    {"break", TokenType::BREAK},
-    {"continue", TokenType::CONTINUE},
-    {"raise", TokenType::RAISE},
-    {"return", TokenType::RETURN},
+size_t Scanner::get_src_line_count() {
+    if (!contents)
+        return src_text.size();
+    return std::count(buf, buf + buf_size, '\n') + 1;
+}
 
-    {"enum", TokenType::ENUM},
-    {"class", TokenType::CLASS},
-    {"space", TokenType::SPACE},
-    {"fun", TokenType::FUN},
-    
-    {"nil", TokenType::NIL},
-    {"true", TokenType::TRUE},
-    {"false", TokenType::FALSE},
-    {"super", TokenType::SUPER},
-    {"this", TokenType::THIS}
-};
\ No newline at end of file
+ustring Scanner::get_src_line(unsigned line) {
+    if (!contents) {
+        assert(line < src_text.size() && "Getting out of bounds line");
+        return src_text[line];
+    }
+    // Only offsets of lines are kept and only once they are needed
+    if (line_offsets.empty()) {
+        line_offsets.push_back(0);
+        for (size_t i = 0; i < buf_size; ++i) {
+            if (buf[i] == '\n')
+                line_offsets.push_back(i + 1);
+        }
+    }
+    assert(line < line_offsets.size() && "Getting out of bounds line");
+    size_t start = line_offsets[line];
+    size_t end = line + 1 < line_offsets.size() ? line_offsets[line + 1] - 1 : buf_size;
+    return ustring(buf + start, end - start);
+}
@@ -14,13 +14,16 @@
 #include "source.hpp"
 #include "utils.hpp"
 #include "errors.hpp"
+#include "arena.hpp"
 #include <string>
 #include <fstream>
 #include <cassert>
 #include <istream>
 #include <cstdio>
-#include <unordered_map>
+#include <iostream>
 #include <list>
+#include <memory>
+#include <vector>
 
 namespace moss {
 
@@ -236,7 +239,7 @@ inline std::ostream& operator<< (std::ostream& os, const TokenType tt) {
 
 
 /// Object represents a scanner token
-class Token {
+class Token : public ArenaObject {
 protected:
     ustring value;
     TokenType type;
@@ -245,7 +248,7 @@ public:
     Token(ustring value, TokenType type, SourceInfo src_info) : value(value), type(type), src_info(src_info) {}
     virtual ~Token() {}
 
-    ustring get_value() { return this->value; }
+    const ustring &get_value() { return this->value; }
     const char *get_cstr() { return this->value.c_str(); }
     TokenType get_type() { return this->type; }
     SourceInfo get_src_info() { return this->src_info; }
@@ -330,18 +333,19 @@ struct UTF8Char {
 /// \brief Syntactic analyzer and tokenizer for moss language
 /// 
 /// Scanner works always with one file/module, this might be input file passed
-/// by the user or just string of moss code or stdin. Scanner does not care for
-/// this as this is handled by SourceFile class that provides the stream to
-/// read from.
+/// by the user or just string of moss code or stdin. Files and strings of code
+/// are scanned straight from a buffer holding the whole source (files are
+/// memory mapped), stdin and repl input is read line by line from a stream.
 class Scanner {
 private:
     SourceFile &file;
-    std::istream *stream;
+    std::istream *stream;       ///< Input for stdin and repl, nullptr otherwise
+    std::unique_ptr<FileContents> contents; ///< Whole source for files and strings
     unsigned line;
     unsigned col;
     unsigned len;
-    std::vector<ustring> src_text;
-    static const std::unordered_map<ustring, TokenType> KEYWORDS;
+    std::vector<ustring> src_text;      ///< Read lines of stdin or repl input
+    std::vector<size_t> line_offsets;   ///< Line starts in contents (computed for diagnostics)
 
     Token *tokenize(ustring value, TokenType type);
     Token *tokenize(int value, TokenType type);
@@ -362,18 +366,21 @@ private:
     Token *parse_comment_or_shebang();
 
     ustring curr_line;
-    unsigned curr_byte;
+    const char *buf;    ///< Scanned bytes, whole source or the current line
+    size_t buf_size;
+    size_t curr_byte;
+    bool read_line();
     UTF8Char advance();
     UTF8Char peek();
     int peek_nonutf();
     void unput();
+    template<typename F>
+    size_t advance_ascii_while(F pred);
 public:
-    Scanner(SourceFile &file) : file(file), line(0), col(0), len(0), src_text(), curr_line(), curr_byte(0) {
-        this->stream = file.get_new_stream();
-    }
+    Scanner(SourceFile &file);
     ~Scanner() {
-        // Only file stream and string stream are allocated
-        if (file.get_type() == SourceFile::SourceType::FILE || file.get_type() == SourceFile::SourceType::STRING) {
+        // Stdin and repl read from std::cin
+        if (this->stream && this->stream != &std::cin) {
             delete this->stream;
         }
     }
@@ -383,8 +390,10 @@ public:
     /// \return Next token from the current file, that is not a whitespace token
     Token *next_nonws_token();
 
-    /// \return Vector that contains lines from the source file (for error reporting)
-    std::vector<ustring> get_src_text() { return this->src_text; }
+    /// \return Amount of source lines known to the scanner
+    size_t get_src_line_count();
+    /// \return Source line (without new line) for error reporting
+    ustring get_src_line(unsigned line);
 };
 
 }
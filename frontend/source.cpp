@@ -1,6 +1,7 @@
 #include "source.hpp"
 #include "errors.hpp"
 #include "logging.hpp"
+#include "utils.hpp"
 #include <cstring>
 #include <fstream>
 #include <filesystem>
@@ -39,6 +40,14 @@ std::istream *BytecodeFile::get_new_stream() {
     return f;
 }
 
+std::unique_ptr<FileContents> BytecodeFile::read_contents() {
+    auto contents = FileContents::map(this->path);
+    if (!contents) {
+        error::error(error::ErrorCode::FILE_ACCESS, std::strerror(errno), this, true);
+    }
+    return contents;
+}
+
 std::ostream *BytecodeFile::create_out_stream() {
     std::ofstream *f = new std::ofstream(this->path, std::ios_base::binary);
     if (f->fail()) {
@@ -48,6 +57,65 @@ std::ostream *BytecodeFile::create_out_stream() {
     return f;
 }
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::unique_ptr<FileContents> FileContents::map(const ustring &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    // Pipes and other special files have no size and cannot be mapped
+    if (!S_ISREG(st.st_mode)) {
+        ustring data;
+        char chunk[4096];
+        ssize_t amount;
+        while ((amount = ::read(fd, chunk, sizeof(chunk))) > 0)
+            data.append(chunk, amount);
+        ::close(fd);
+        if (amount < 0)
+            return nullptr;
+        return std::make_unique<FileContents>(std::move(data));
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    // Empty file cannot be mapped
+    if (size == 0) {
+        ::close(fd);
+        return std::make_unique<FileContents>("");
+    }
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+    auto contents = std::make_unique<FileContents>("");
+    contents->mapping = mapping;
+    contents->data_ = static_cast<const char *>(mapping);
+    contents->size_ = size;
+    return contents;
+}
+
+FileContents::~FileContents() {
+    if (mapping)
+        ::munmap(mapping, size_);
+}
+#else
+std::unique_ptr<FileContents> FileContents::map(const ustring &path) {
+    auto data = utils::read_file(path);
+    if (!data)
+        return nullptr;
+    return std::make_unique<FileContents>(std::move(*data));
+}
+
+FileContents::~FileContents() {}
+#endif
+
 #ifdef __windows__
 #include <windows.h>
 #include <shlobj.h>
@@ -59,9 +127,8 @@ ustring moss::get_local_app_data_path() {
 }
 #endif
 
-static std::vector<ustring> paths;
-
-static void init_lookup_path() {
+static std::vector<ustring> init_lookup_path() {
+    std::vector<ustring> paths;
     // See if there is MOSSPATH
     if (const char* value = std::getenv("MOSSPATH")) {
         // On linux and mac the convention for separator is :, on windows it is ;
@@ -83,14 +150,13 @@ static void init_lookup_path() {
     static std::filesystem::path LIB_PATH = std::filesystem::path(get_local_app_data_path()+"/moss");
     paths.push_back(LIB_PATH.string());
 #endif
+    return paths;
 }
 
 std::vector<ustring> &moss::get_lookup_path() {
-    static bool initialized = false;
-    if (!initialized) {
-        init_lookup_path();
-        initialized = true;
-    }
+    // Static initialization is thread safe as imports might be looked up
+    // from multiple threads
+    static std::vector<ustring> paths = init_lookup_path();
     return paths;
 }
 
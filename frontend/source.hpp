@@ -15,6 +15,7 @@
 #include <filesystem>
 #include <fstream>
 #include <optional>
+#include <memory>
 
 namespace moss {
 
@@ -101,6 +102,30 @@ public:
     }
 };
 
+/// \brief Read-only contents of a whole file held in memory
+/// Files are memory mapped where it is supported, otherwise they are read.
+class FileContents {
+private:
+    ustring buffer;
+    const char *data_;
+    size_t size_;
+    void *mapping;
+public:
+    /// Creates contents owning the data
+    FileContents(ustring data) : buffer(std::move(data)), data_(buffer.data()), size_(buffer.size()), mapping(nullptr) {}
+    ~FileContents();
+
+    FileContents(const FileContents &) = delete;
+    FileContents &operator=(const FileContents &) = delete;
+
+    /// Maps (or reads) file on path
+    /// \return File contents or nullptr if the file could not be opened
+    static std::unique_ptr<FileContents> map(const ustring &path);
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+};
+
 /// \brief Bytecode source file
 /// A source file that contains moss bytecode (.msb file)
 class BytecodeFile : public File {
@@ -109,9 +134,12 @@ public:
 
     virtual std::istream *get_new_stream() override;
 
+    /// \return Contents of the whole file (memory mapped if possible)
+    virtual std::unique_ptr<FileContents> read_contents();
+
     /// Creates a new binary std::ofstream for writing a bytecode into this file
     /// \return Created output stream 
-    std::ostream *create_out_stream();
+    virtual std::ostream *create_out_stream();
 };
 
 /// Stores source file information for a given token
@@ -0,0 +1,52 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+using namespace moss;
+
+thread_local Arena *Arena::current = nullptr;
+
+/// Space before each ArenaObject holding its arena
+static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+Arena::~Arena() {
+    for (auto b: blocks)
+        ::operator delete(b);
+}
+
+void *Arena::allocate(size_t size) {
+    constexpr size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    if (static_cast<size_t>(end - pos) < size) {
+        auto block_size = std::max(BLOCK_SIZE, size);
+        pos = static_cast<char *>(::operator new(block_size));
+        end = pos + block_size;
+        blocks.push_back(pos);
+    }
+    void *mem = pos;
+    pos += size;
+    allocated += size;
+    return mem;
+}
+
+void *ArenaObject::operator new(size_t size) {
+    auto arena = Arena::current;
+    char *mem;
+    if (arena)
+        mem = static_cast<char *>(arena->allocate(HEADER_SIZE + size));
+    else
+        mem = static_cast<char *>(::operator new(HEADER_SIZE + size));
+    assert(mem && "Allocation failed?");
+    *reinterpret_cast<Arena **>(mem) = arena;
+    return mem + HEADER_SIZE;
+}
+
+void ArenaObject::operator delete(void *p, size_t size) {
+    if (!p)
+        return;
+    char *mem = static_cast<char *>(p) - HEADER_SIZE;
+    // Arena memory is released with the arena
+    if (*reinterpret_cast<Arena **>(mem) == nullptr)
+        ::operator delete(mem, HEADER_SIZE + size);
+}
@@ -0,0 +1,80 @@
+///
+/// \file arena.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Bump allocator for short lived compilation objects
+///
+/// Tokens and IR nodes of a module are allocated in its parser's arena and
+/// the whole arena is released at once when the parser is deleted, instead
+/// of freeing each object separately.
+///
+
+#ifndef _ARENA_HPP_
+#define _ARENA_HPP_
+
+#include <cstddef>
+#include <vector>
+
+namespace moss {
+
+/// \brief Chunked bump allocator
+///
+/// Memory is taken from blocks, which are freed only once the arena is
+/// destroyed. Objects inside are never freed separately.
+class Arena {
+private:
+    std::vector<char *> blocks;
+    char *pos;
+    char *end;
+    size_t allocated;
+
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+public:
+    /// Arena new ArenaObject instances are allocated in. When nullptr they
+    /// are allocated on the heap.
+    /// It is per thread as modules might be compiled on multiple threads.
+    static thread_local Arena *current;
+
+    Arena() : pos(nullptr), end(nullptr), allocated(0) {}
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /// \return size bytes of memory aligned for any type
+    void *allocate(size_t size);
+
+    /// \return Amount of bytes allocated in this arena
+    size_t get_allocated() { return this->allocated; }
+};
+
+/// Sets Arena::current for the lifetime of this object
+class ArenaScope {
+private:
+    Arena *prev;
+public:
+    ArenaScope(Arena *arena) : prev(Arena::current) {
+        Arena::current = arena;
+    }
+    ~ArenaScope() {
+        Arena::current = prev;
+    }
+};
+
+/// \brief Base for classes that should be allocated in Arena::current
+///
+/// Destructors are still run by delete, so members are freed, but the object
+/// memory is released only with its arena. Each object remembers where it
+/// was allocated so that objects allocated with no arena set (e.g. in REPL)
+/// can be mixed with arena ones.
+class ArenaObject {
+public:
+    static void *operator new(size_t size);
+    static void operator delete(void *p, size_t size);
+};
+
+}
+
+#endif//_ARENA_HPP_
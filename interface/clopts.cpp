@@ -2,6 +2,7 @@
 #include "commons.hpp"
 #include "errors.hpp"
 #include "moss.hpp"
+#include "jit.hpp"
 #include "args.hpp"
 #include <string>
 #include <iostream>
@@ -66,6 +67,10 @@ void moss::clopts::parse_clopts(int argc, const char *argv[]) {
             error::error(error::ErrorCode::ARGUMENT, ustring("Unknown -W value '" + args::get(warning) + "'! Value can be one for these: all, error, ignore").c_str());
         }
     }
+
+    if (opt_level && args::get(opt_level) > MAX_OPT_LEVEL) {
+        error::error(error::ErrorCode::ARGUMENT, ustring("Unknown --opt-level value '" + std::to_string(args::get(opt_level)) + "'! Value has to be between 0 and " + std::to_string(MAX_OPT_LEVEL)).c_str());
+    }
 }
 
 std::vector<ustring> moss::clopts::get_program_args() {
@@ -119,4 +124,16 @@ ustring moss::clopts::get_note_format() {
 
 WarningLevel moss::clopts::get_warning_level() {
     return warn_level;
-}
\ No newline at end of file
+}
+
+unsigned moss::clopts::get_opt_level() {
+    if (opt_level)
+        return args::get(opt_level);
+    return DEFAULT_OPT_LEVEL;
+}
+
+unsigned moss::clopts::get_jit_threshold() {
+    if (jit_threshold)
+        return args::get(jit_threshold);
+    return jit::DEFAULT_HOT_THRESHOLD;
+}
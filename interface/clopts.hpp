@@ -25,6 +25,20 @@ inline args::Positional<std::string> file_name(interpreter_group, "<file name>",
 inline args::ValueFlag<std::string> code(interpreter_group, "<code>", "String of moss code to be run", {'e', "execute"});
 // Note: values in here must match those in enum WarningLevels bellow
 inline args::ValueFlag<std::string> warning(interpreter_group, "[all, error, ignore]", "Warning level", {'W', "warning"});
+inline args::Flag use_jit(interpreter_group, "jit", "Compiles hot functions into native code (x86-64 Linux only)", {"jit"});
+inline args::ValueFlag<unsigned> jit_threshold(interpreter_group, "<count>", "Number of calls or loop iterations after which a function is compiled by JIT", {"jit-threshold"});
+inline args::ValueFlag<std::string> profile(interpreter_group, "<file>", "Samples moss call stacks and outputs them as folded stacks into a file", {"profile"});
+inline args::Flag opcode_stats(interpreter_group, "opcode-stats", "Counts and times executed opcodes and outputs the statistics on exit", {"opcode-stats"});
+inline args::Flag time_passes(interpreter_group, "time-passes", "Times compilation phases and passes of each module and outputs the statistics on exit", {"time-passes"});
+inline args::Flag gc_stats(interpreter_group, "gc-stats", "Outputs garbage collector statistics on exit", {"gc-stats"});
+inline args::Flag no_quickening(interpreter_group, "no-quickening", "Disables runtime specialization of opcodes for observed operand types", {"no-quickening"});
+inline args::Flag no_libms_snapshot(interpreter_group, "no-libms-snapshot", "Loads standard library by running it instead of restoring its snapshot", {"no-libms-snapshot"});
+inline args::Flag no_module_cache(interpreter_group, "no-module-cache", "Compiles imported modules without reading or writing their cached bytecode", {"no-module-cache"});
+inline args::ValueFlag<std::string> module_cache_dir(interpreter_group, "<dir>", "Directory for cached bytecode of imported modules (instead of __mosscache__ next to them)", {"module-cache-dir"});
+inline args::Flag stream(interpreter_group, "stream", "Compiles and runs the main module in chunks of declarations while it is being parsed", {"stream"});
+inline args::ValueFlag<unsigned> import_jobs(interpreter_group, "<count>", "Compiles imported modules ahead of their import using this many threads", {"import-jobs"});
+inline args::ValueFlag<unsigned> opt_level(interpreter_group, "<0-3>", "Optimization level for compiled modules (0 only checks the code, default is 2)", {"opt-level"});
+inline args::ValueFlag<unsigned> stack_size(interpreter_group, "<MiB>", "Runs moss on a native stack of this size for deeper recursion through functions of other modules and runtime calls", {"stack-size"});
 
 // Bytecode flags
 inline args::Group bc_group(arg_parser, "Moss bytecode options:");
@@ -35,12 +49,14 @@ inline args::Flag annotate_bc(bc_group, "annotate-bc", "Adds comments to bytecod
 
 inline args::Flag input_bc(bc_group, "bytecode", "Treats input file as bytecode file", {"bytecode"});
 inline args::Flag print_bc_info(bc_group, "print-bc-header", "Prints bytecode file (.msb) header and exits", {"print-bc-header"});
+inline args::ValueFlag<std::string> create_libms_snapshot(bc_group, "<file>", "Creates snapshot of standard library heap for faster startup and exits", {"create-libms-snapshot"});
 
 // Note flags
 inline args::Group note_group(arg_parser, "Note and output options:");
 inline args::ValueFlag<std::string> note_file(note_group, "<note file name>", "Outputs moss notes to this file", {'O', "output-file"});
 inline args::Flag disable_notes(note_group, "disable-notes", "Disables outputting notes (prints will still output)", {'q', "disable-notes"});
 inline args::Flag print_notes(note_group, "print-notes", "Outputs notes also to stdout", {'p', "print-notes"});
+inline args::ValueFlag<std::string> note_cache_dir(note_group, "<dir>", "Replays notes of unchanged top-level expressions cached in this directory instead of running them", {"note-cache"});
 
 // GC flags
 inline args::Group gc_group(arg_parser, "Garbage collector options:");
@@ -70,6 +86,11 @@ inline args::Flag no_load_libms(debugging_group, "no-load-libms", "Standard libr
 
 inline args::Group interface_group(arg_parser, "Interface options:");
 
+/// Optimization level used when --opt-level is not set
+constexpr unsigned DEFAULT_OPT_LEVEL = 2;
+/// Highest accepted optimization level
+constexpr unsigned MAX_OPT_LEVEL = 3;
+
 /// Possible values for -W option
 enum WarningLevel {
     WL_IGNORE,
@@ -104,6 +125,12 @@ bool use_color();
 /// \return Arguments for the interpreted moss program
 std::vector<ustring> get_program_args();
 
+/// \return Amount of calls or back-edges after which JIT compiles a function
+unsigned get_jit_threshold();
+
+/// \return Optimization level selected by user or the default one
+unsigned get_opt_level();
+
 /// \return Wargning level selected by user
 WarningLevel get_warning_level();
 
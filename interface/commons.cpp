@@ -7,4 +7,10 @@ bool global_controls::trigger_gc = false;
 
 bool global_controls::exit_called = false;
 
-std::filesystem::path global_controls::pwd = "./";
\ No newline at end of file
+volatile std::sig_atomic_t global_controls::profile_tick = 0;
+
+std::filesystem::path global_controls::pwd = "./";
+
+std::uintptr_t global_controls::native_stack_base = 0;
+
+std::size_t global_controls::native_stack_size = 0;
\ No newline at end of file
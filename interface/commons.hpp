@@ -17,6 +17,7 @@
 #include <filesystem>
 #include <vector>
 #include <limits>
+#include <csignal>
 
 namespace moss {
 
@@ -106,10 +107,16 @@ extern bool trigger_gc; ///< Global flag for triggering GC
 
 extern bool exit_called; ///< Global flag for repl when exit is called (as it cannot jump to END)
 
+extern volatile std::sig_atomic_t profile_tick; ///< Amount of profiler's timer expirations since the last sample
+
 constexpr float gc_grow_factor = 2.0; ///< By how much will the gc threshold grow
 
 extern std::filesystem::path pwd; ///< Current working directory based of main file
 
+extern std::uintptr_t native_stack_base; ///< Address near the start of the native stack moss runs on
+
+extern std::size_t native_stack_size; ///< Part of the native stack usable for nested interpreter runs (0 if unchecked)
+
 }
 
 }
@@ -107,8 +107,8 @@ ustring error::format_error(diags::Diagnostic msg, bool warning_as_error) {
         const int64_t LINE_LEN_PRE = 100; // Max length of line to be displayed, but will be cut at first
         const int64_t LINE_LEN_POST = 20;
 
-        assert(msg.scanner->get_src_text().size() > info.get_lines().first && "Getting out of bounds line");
-        std::string curr_line = msg.scanner->get_src_text()[info.get_lines().first];
+        assert(msg.scanner->get_src_line_count() > info.get_lines().first && "Getting out of bounds line");
+        std::string curr_line = msg.scanner->get_src_line(info.get_lines().first);
         unsigned col_start = info.get_cols().first;
         unsigned col_end = info.get_cols().second;
         
@@ -0,0 +1,85 @@
+#include "pass_stats.hpp"
+#include "clopts.hpp"
+#include <vector>
+#include <mutex>
+#include <iomanip>
+
+using namespace moss;
+using namespace moss::passstats;
+
+namespace {
+
+struct PhaseStats {
+    ustring phase;
+    unsigned long ns;
+    unsigned long count;
+};
+
+/// Phases of one module in the order they were first run
+struct ModuleStats {
+    ustring module;
+    std::vector<PhaseStats> phases;
+};
+
+std::mutex stats_mtx;
+std::vector<ModuleStats> modules;
+
+}
+
+bool moss::passstats::is_enabled() {
+    return clopts::time_passes;
+}
+
+void moss::passstats::record(const ustring &module, const ustring &phase, Clock::duration time, unsigned long count) {
+    unsigned long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    std::lock_guard<std::mutex> lock(stats_mtx);
+    ModuleStats *mod = nullptr;
+    for (auto &m: modules) {
+        if (m.module == module) {
+            mod = &m;
+            break;
+        }
+    }
+    if (!mod) {
+        modules.push_back(ModuleStats{module, {}});
+        mod = &modules.back();
+    }
+    for (auto &p: mod->phases) {
+        if (p.phase == phase) {
+            p.ns += ns;
+            p.count += count;
+            return;
+        }
+    }
+    mod->phases.push_back(PhaseStats{phase, ns, count});
+}
+
+static double as_ms(unsigned long ns) {
+    return ns / 1'000'000.0;
+}
+
+void moss::passstats::report(std::ostream &os) {
+    std::lock_guard<std::mutex> lock(stats_mtx);
+    unsigned long total_ns = 0;
+    for (auto &m: modules) {
+        for (auto &p: m.phases)
+            total_ns += p.ns;
+    }
+    os << "\n=== Compilation pass statistics: " << modules.size() << " module(s) in "
+       << std::fixed << std::setprecision(3) << as_ms(total_ns) << " ms ===\n";
+    for (auto &m: modules) {
+        unsigned long mod_ns = 0;
+        for (auto &p: m.phases)
+            mod_ns += p.ns;
+        os << "Module " << m.module << ":\n"
+           << std::setw(13) << "time (ms)" << std::setw(9) << "time %"
+           << std::setw(12) << "count" << "  phase\n";
+        for (auto &p: m.phases) {
+            os << std::setw(13) << std::setprecision(3) << as_ms(p.ns)
+               << std::setw(8) << std::setprecision(2) << (mod_ns ? 100.0 * p.ns / mod_ns : 0.0) << "%"
+               << std::setw(12) << p.count
+               << "  " << p.phase << "\n";
+        }
+    }
+    os << std::defaultfloat;
+}
@@ -0,0 +1,74 @@
+///
+/// \file pass_stats.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Timing and statistics of compilation phases
+///
+/// Statistics are recorded only when --time-passes is set. Each module
+/// compiled by moss has its own records for the scanner, parser, each IR
+/// pass, bytecode generation and each bytecode pass. Next to the time every
+/// phase records a count of items it produced or changed:
+/// tokens (scanner), declarations (parser), replaced, removed or changed IR
+/// nodes (IR passes), generated opcodes (bytecode generation) and added, removed
+/// or rewritten opcodes (bytecode passes).
+/// Modules might be compiled by import threads, so recording is synchronized.
+///
+
+#ifndef _PASS_STATS_HPP_
+#define _PASS_STATS_HPP_
+
+#include "commons.hpp"
+#include <chrono>
+
+namespace moss {
+
+/// Namespace for compilation phase statistics
+namespace passstats {
+
+using Clock = std::chrono::steady_clock;
+
+/// \return true if statistics should be recorded
+bool is_enabled();
+
+/// \brief Adds time and count to a phase of a module
+/// Phase recorded multiple times for the same module (e.g. for chunks of
+/// streamed module) accumulates its values.
+/// \param module Name of the compiled module
+/// \param phase Name of the phase (pass)
+/// \param time Time the phase took
+/// \param count Amount of items produced or changed by the phase
+void record(const ustring &module, const ustring &phase, Clock::duration time, unsigned long count);
+
+/// \brief Outputs collected statistics
+void report(std::ostream &os);
+
+/// \brief Measures time of a phase from its construction to its destruction
+/// Does nothing if statistics are not enabled.
+class PhaseTimer {
+private:
+    ustring module;
+    const char *phase;
+    bool enabled;
+    Clock::time_point start;
+public:
+    /// Amount of items produced or changed, which will be recorded
+    unsigned long count;
+
+    PhaseTimer(ustring module, const char *phase)
+        : module(module), phase(phase), enabled(is_enabled()), count(0) {
+        if (enabled)
+            start = Clock::now();
+    }
+    ~PhaseTimer() {
+        if (enabled)
+            record(module, phase, Clock::now() - start, count);
+    }
+};
+
+}
+
+}
+
+#endif//_PASS_STATS_HPP_
@@ -36,7 +36,7 @@ int Repl::run() {
     bcgen::BytecodeGen cgen(bc);
 
     Interpreter *interpreter = new Interpreter(bc, &src_file, true);
-    ir::IRPipeline ipl(parser);
+    ir::IRPipeline ipl(parser, clopts::get_opt_level());
 
     bool eof_reached = false;
     while (!eof_reached && !global_controls::exit_called) {
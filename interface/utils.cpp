@@ -7,6 +7,8 @@
 #include <vector>
 #include <memory>
 #include <cctype>
+#include <cstring>
+#include <fstream>
 
 using namespace utils;
 
@@ -58,3 +60,79 @@ ustring utils::sanitize(const ustring &text) {
     }
     return oss.str();
 }
+
+static constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+uint64_t utils::fnv1a(const char *data, size_t size, uint64_t h) {
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+uint64_t utils::checksum(const char *data, size_t size) {
+    uint64_t h = fnv1a(nullptr, 0);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t w;
+        std::memcpy(&w, data + i, sizeof(w));
+        h = (h ^ w) * FNV_PRIME;
+    }
+    return fnv1a(data + i, size - i, h);
+}
+
+std::optional<ustring> utils::read_file(const ustring &path) {
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f)
+        return std::nullopt;
+    auto size = f.tellg();
+    ustring data(static_cast<size_t>(size), '\0');
+    f.seekg(0);
+    if (!f.read(data.data(), size))
+        return std::nullopt;
+    return data;
+}
+
+namespace {
+
+/// Lookup tables for slicing-by-8 CRC-32
+struct CRC32Tables {
+    uint32_t t[8][256];
+
+    constexpr CRC32Tables() : t() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int j = 0; j < 8; ++j)
+                c = (c >> 1) ^ (0xEDB88320 & -(c & 1));
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int k = 1; k < 8; ++k)
+                t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xFF];
+        }
+    }
+};
+
+constexpr CRC32Tables CRC32_TABLES;
+
+}
+
+uint32_t utils::crc32_update(uint32_t crc, const char *data, size_t size) {
+    const auto &t = CRC32_TABLES.t;
+    auto p = reinterpret_cast<const unsigned char *>(data);
+    // Slicing-by-8 expects little endian words
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; size >= 8; size -= 8, p += 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+#endif
+    for (; size > 0; --size, ++p)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    return crc;
+}
@@ -18,6 +18,8 @@
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <cstdint>
+#include <optional>
 
 namespace utils {
 
@@ -117,6 +119,21 @@ inline std::string wstr2str(const std::wstring &wstr_text) {
     return std::string(buf.data());
 }
 
+/// Reads whole file in binary mode
+/// \return File contents or nullopt if it could not be read
+std::optional<ustring> read_file(const ustring &path);
+
+/// FNV-1a 64 bit hash of bytes
+/// \param h Hash to continue from, allows for hashing of multiple chunks
+uint64_t fnv1a(const char *data, size_t size, uint64_t h=14695981039346656037ULL);
+
+/// Fast non-cryptographic checksum of bytes (FNV-1a over 8 byte words)
+uint64_t checksum(const char *data, size_t size);
+
+/// Updates CRC-32 (IEEE 802.3 polynomial) with bytes.
+/// This does not do the initial and final inversion of the crc.
+uint32_t crc32_update(uint32_t crc, const char *data, size_t size);
+
 inline void to_lower(ustring &s) {
     for (auto &c: s) {
         c = std::toupper(c);
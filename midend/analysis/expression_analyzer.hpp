@@ -24,6 +24,7 @@ private:
     void check_call_arg(Expression *arg, std::unordered_set<ustring> &named_args);
 public:
     ExpressionAnalyzer(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "ExpressionAnalyzer"; }
     
     virtual IR *visit(class BinaryExpr &be) override;
     virtual IR *visit(class UnaryExpr &be) override;
@@ -86,4 +86,108 @@ IR *FunctionAnalyzer::visit(Lambda &lf) {
     if (!lf.get_annotations().empty())
         check_annotated_fun(lf, lf.get_args());
     return &lf;
-}
\ No newline at end of file
+}
+
+/// \return true if expression e can be a part of an inlined function body,
+///         budget is decreased by the amount of its nodes
+static bool is_inlinable(Expression *e, unsigned &budget) {
+    if (!e)
+        return true;
+    if (budget == 0)
+        return false;
+    --budget;
+    if (e->is_constant())
+        return true;
+    if (auto v = dyn_cast<Variable>(e))
+        return !v->is_non_local();
+    if (auto be = dyn_cast<BinaryExpr>(e)) {
+        auto opk = be->get_op().get_kind();
+        // Assignment would write into the caller's frame
+        if (is_set_op(be->get_op()) || opk == OperatorKind::OP_SCOPE)
+            return false;
+        // Right is the attribute name
+        if (opk == OperatorKind::OP_ACCESS)
+            return isa<Variable>(be->get_right()) && is_inlinable(be->get_left(), budget);
+        return is_inlinable(be->get_left(), budget) && is_inlinable(be->get_right(), budget);
+    }
+    if (auto ue = dyn_cast<UnaryExpr>(e))
+        return ue->get_op().get_kind() != OperatorKind::OP_SCOPE && is_inlinable(ue->get_expr(), budget);
+    if (auto cl = dyn_cast<Call>(e)) {
+        if (!is_inlinable(cl->get_fun(), budget))
+            return false;
+        for (auto a: cl->get_args()) {
+            auto be = dyn_cast<BinaryExpr>(a);
+            if (be && be->get_op().get_kind() == OperatorKind::OP_SET) {
+                // Named argument
+                if (!isa<Variable>(be->get_left()) || !is_inlinable(be->get_right(), budget))
+                    return false;
+            } else if (!is_inlinable(a, budget)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (auto ic = dyn_cast<InlinedCall>(e))
+        return is_inlinable(ic->get_body(), budget);
+    if (auto ti = dyn_cast<TernaryIf>(e))
+        return is_inlinable(ti->get_condition(), budget) && is_inlinable(ti->get_value_true(), budget)
+            && is_inlinable(ti->get_value_false(), budget);
+    if (auto r = dyn_cast<Range>(e))
+        return is_inlinable(r->get_start(), budget) && is_inlinable(r->get_second(), budget)
+            && is_inlinable(r->get_end(), budget);
+    if (auto lst = dyn_cast<List>(e)) {
+        // Comprehension declares its own variables
+        if (lst->is_comprehension())
+            return false;
+        for (auto v: lst->get_value()) {
+            if (!is_inlinable(v, budget))
+                return false;
+        }
+        return true;
+    }
+    if (auto dct = dyn_cast<Dict>(e)) {
+        for (size_t i = 0; i < dct->get_keys().size(); ++i) {
+            if (!is_inlinable(dct->get_keys()[i], budget) || !is_inlinable(dct->get_values()[i], budget))
+                return false;
+        }
+        return true;
+    }
+    // Lambdas would capture the caller's frame, this and super are bound
+    // to methods
+    return false;
+}
+
+Expression *FunctionAnalyzer::get_inlinable_body(IR &fun, unsigned max_size) {
+    std::vector<Argument *> *args = nullptr;
+    Expression *body = nullptr;
+    if (auto f = dyn_cast<Function>(&fun)) {
+        if (f->is_method() || f->is_constructor() || f->get_body().size() != 1)
+            return nullptr;
+        auto ret = dyn_cast<Return>(f->get_body().front());
+        if (!ret)
+            return nullptr;
+        args = &f->get_args();
+        body = ret->get_expr();
+    } else if (auto lf = dyn_cast<Lambda>(&fun)) {
+        if (lf->is_method() || lf->is_anonymous())
+            return nullptr;
+        args = &lf->get_args();
+        body = lf->get_body();
+    } else {
+        return nullptr;
+    }
+    // Annotations change how the function is called
+    if (!fun.get_annotations().empty())
+        return nullptr;
+    for (auto a: *args) {
+        // Types are checked when the function is called
+        if (a->is_vararg() || a->is_typed())
+            return nullptr;
+        if (a->has_default_value() && !a->get_default_value()->is_constant())
+            return nullptr;
+    }
+    unsigned budget = max_size;
+    if (!is_inlinable(body, budget))
+        return nullptr;
+    return body;
+}
@@ -25,10 +25,23 @@ private:
     void check_annotated_fun(class IR &fun, const std::vector<ir::Argument *> &args);
 public:
     FunctionAnalyzer(Parser &parser) : IRVisitor(parser), has_main(false) {}
+    virtual const char *get_name() const override { return "FunctionAnalyzer"; }
     
     virtual IR *visit(class Function &fun) override;
     virtual IR *visit(class Lambda &lf) override;
     virtual IR *visit(class Return &ret) override;
+
+    /// Maximum amount of IR nodes in a function body to be inlined
+    static constexpr unsigned INLINE_MAX_SIZE = 16;
+    /// Maximum amount of IR nodes in a function body to be inlined with
+    /// the highest optimization level
+    static constexpr unsigned INLINE_MAX_SIZE_AGGRESSIVE = 48;
+
+    /// \param max_size Maximum amount of IR nodes in the body
+    /// \return Expression returned by function or named lambda fun if it is
+    ///         small and simple enough to be inlined into its calls,
+    ///         otherwise nullptr
+    static Expression *get_inlinable_body(IR &fun, unsigned max_size=INLINE_MAX_SIZE);
 };
 
 }
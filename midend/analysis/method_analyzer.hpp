@@ -27,6 +27,7 @@ private:
     void check_constructor(class Function &method, class Class &cls);
 public:
     MethodAnalyzer(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "MethodAnalyzer"; }
     
     virtual IR *visit(class Class &cls) override;
     virtual IR *visit(class Function &fun) override;
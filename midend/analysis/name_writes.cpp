@@ -0,0 +1,190 @@
+#include "name_writes.hpp"
+
+using namespace moss;
+using namespace ir;
+
+static bool is_named_arg(Expression *arg) {
+    auto be = dyn_cast<BinaryExpr>(arg);
+    return be && be->get_op().get_kind() == OperatorKind::OP_SET;
+}
+
+void NameWrites::add_write(const ustring &name) {
+    // Write is in the scope and all scopes it is nested in
+    for (auto s: scope_stack) {
+        ++s->counts[name];
+    }
+}
+
+void NameWrites::add_target(Expression *target) {
+    if (auto v = dyn_cast<Variable>(target)) {
+        if (v->is_non_local())
+            non_local_writes.insert(v->get_name());
+        else
+            add_write(v->get_name());
+    } else if (auto mv = dyn_cast<Multivar>(target)) {
+        for (auto v: mv->get_vars()) {
+            add_target(v);
+        }
+    } else if (auto ue = dyn_cast<UnaryExpr>(target)) {
+        // ::name
+        if (ue->get_op().get_kind() == OperatorKind::OP_SCOPE && isa<Variable>(ue->get_expr()))
+            non_local_writes.insert(ue->get_expr()->get_name());
+    } else if (auto be = dyn_cast<BinaryExpr>(target)) {
+        // Attribute set on a class or space is visible in its methods by name
+        if (be->get_op().get_kind() == OperatorKind::OP_ACCESS && isa<Variable>(be->get_right()))
+            add_write(be->get_right()->get_name());
+        collect_writes(be->get_left());
+        collect_writes(be->get_right());
+    }
+}
+
+void NameWrites::collect(IR *scope, std::vector<Argument *> *args, std::list<IR *> &body) {
+    scope_stack.push_back(&writes[scope]);
+    if (args) {
+        for (auto a: *args) {
+            add_write(a->get_name());
+            collect_writes(a->get_default_value());
+        }
+    }
+    for (auto i: body) {
+        collect_writes(i);
+    }
+    scope_stack.pop_back();
+}
+
+void NameWrites::collect_writes(IR *ir) {
+    if (!ir)
+        return;
+    auto collect_body = [this](std::list<IR *> &body) {
+        for (auto i: body)
+            collect_writes(i);
+    };
+
+    if (auto be = dyn_cast<BinaryExpr>(ir)) {
+        if (is_set_op(be->get_op()))
+            add_target(be->get_left());
+        else
+            collect_writes(be->get_left());
+        collect_writes(be->get_right());
+    } else if (auto ue = dyn_cast<UnaryExpr>(ir)) {
+        collect_writes(ue->get_expr());
+    } else if (auto cl = dyn_cast<Call>(ir)) {
+        collect_writes(cl->get_fun());
+        for (auto a: cl->get_args()) {
+            // Named argument is not an assignment
+            if (is_named_arg(a))
+                collect_writes(dyn_cast<BinaryExpr>(a)->get_right());
+            else
+                collect_writes(a);
+        }
+    } else if (auto ic = dyn_cast<InlinedCall>(ir)) {
+        collect_writes(ic->get_body());
+    } else if (auto ti = dyn_cast<TernaryIf>(ir)) {
+        collect_writes(ti->get_condition());
+        collect_writes(ti->get_value_true());
+        collect_writes(ti->get_value_false());
+    } else if (auto r = dyn_cast<Range>(ir)) {
+        collect_writes(r->get_start());
+        collect_writes(r->get_second());
+        collect_writes(r->get_end());
+    } else if (auto lst = dyn_cast<List>(ir)) {
+        for (auto v: lst->get_value())
+            collect_writes(v);
+        if (lst->is_comprehension()) {
+            collect_writes(lst->get_result());
+            collect_writes(lst->get_else_result());
+            collect_writes(lst->get_condition());
+            for (auto a: lst->get_assignments())
+                collect_writes(a);
+        }
+    } else if (auto dct = dyn_cast<Dict>(ir)) {
+        for (auto k: dct->get_keys())
+            collect_writes(k);
+        for (auto v: dct->get_values())
+            collect_writes(v);
+    } else if (auto lf = dyn_cast<Lambda>(ir)) {
+        if (!lf->is_anonymous())
+            add_write(lf->get_name());
+        std::list<IR *> body{lf->get_body()};
+        collect(lf, &lf->get_args(), body);
+    } else if (auto fun = dyn_cast<Function>(ir)) {
+        add_write(fun->get_name());
+        collect(fun, &fun->get_args(), fun->get_body());
+    } else if (auto cls = dyn_cast<Class>(ir)) {
+        add_write(cls->get_name());
+        collect(cls, nullptr, cls->get_body());
+    } else if (auto spc = dyn_cast<Space>(ir)) {
+        // Anonymous space spills its names into this scope, which is
+        // covered by writes being added to all outer scopes
+        if (!spc->is_anonymous())
+            add_write(spc->get_name());
+        collect(spc, nullptr, spc->get_body());
+    } else if (auto enm = dyn_cast<Enum>(ir)) {
+        add_write(enm->get_name());
+    } else if (auto imp = dyn_cast<Import>(ir)) {
+        for (unsigned i = 0; i < imp->get_names().size(); ++i) {
+            auto alias = imp->get_alias(i);
+            std::list<Expression *> parts{imp->get_name(i)};
+            while (!parts.empty()) {
+                auto p = parts.front();
+                parts.pop_front();
+                if (auto be = dyn_cast<BinaryExpr>(p)) {
+                    parts.push_back(be->get_left());
+                    parts.push_back(be->get_right());
+                } else if (auto ue = dyn_cast<UnaryExpr>(p)) {
+                    parts.push_back(ue->get_expr());
+                } else if (isa<AllSymbols>(p)) {
+                    alias = "*";
+                } else if (isa<Variable>(p)) {
+                    add_write(p->get_name());
+                }
+            }
+            if (alias == "*") {
+                for (auto s: scope_stack)
+                    s->unknown = true;
+            } else if (!alias.empty()) {
+                add_write(alias);
+            }
+        }
+    } else if (auto i = dyn_cast<If>(ir)) {
+        collect_writes(i->get_cond());
+        collect_body(i->get_body());
+        collect_writes(i->get_else());
+    } else if (auto els = dyn_cast<Else>(ir)) {
+        collect_body(els->get_body());
+    } else if (auto swt = dyn_cast<Switch>(ir)) {
+        collect_writes(swt->get_cond());
+        collect_body(swt->get_body());
+    } else if (auto cs = dyn_cast<Case>(ir)) {
+        for (auto v: cs->get_values())
+            collect_writes(v);
+        collect_body(cs->get_body());
+    } else if (auto tr = dyn_cast<Try>(ir)) {
+        collect_body(tr->get_body());
+        for (auto c: tr->get_catches())
+            collect_writes(c);
+        collect_writes(tr->get_finally());
+    } else if (auto ct = dyn_cast<Catch>(ir)) {
+        add_write(ct->get_arg()->get_name());
+        collect_body(ct->get_body());
+    } else if (auto fnl = dyn_cast<Finally>(ir)) {
+        collect_body(fnl->get_body());
+    } else if (auto whl = dyn_cast<While>(ir)) {
+        collect_writes(whl->get_cond());
+        collect_body(whl->get_body());
+    } else if (auto dwhl = dyn_cast<DoWhile>(ir)) {
+        collect_writes(dwhl->get_cond());
+        collect_body(dwhl->get_body());
+    } else if (auto frl = dyn_cast<ForLoop>(ir)) {
+        add_target(frl->get_iterator());
+        collect_writes(frl->get_collection());
+        collect_body(frl->get_body());
+    } else if (auto ret = dyn_cast<Return>(ir)) {
+        collect_writes(ret->get_expr());
+    } else if (auto rs = dyn_cast<Raise>(ir)) {
+        collect_writes(rs->get_exception());
+    } else if (auto asr = dyn_cast<Assert>(ir)) {
+        collect_writes(asr->get_cond());
+        collect_writes(asr->get_msg());
+    }
+}
@@ -0,0 +1,68 @@
+///
+/// \file name_writes.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Analysis of names written in scopes.
+///
+
+#ifndef _NAME_WRITES_HPP_
+#define _NAME_WRITES_HPP_
+
+#include "ir.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <list>
+
+namespace moss {
+namespace ir {
+
+/// \brief Collects names written (assigned, declared or imported) in a scope
+/// and all the scopes nested in it.
+/// Write in a nested scope counts as a write in all the scopes it is nested
+/// in. Attribute set `a.x = v` counts as a write of `x`, since class and
+/// space attributes are visible by their name in their methods.
+class NameWrites {
+public:
+    /// Names written in a scope or any of its nested scopes
+    struct ScopeWrites {
+        std::unordered_map<ustring, unsigned> counts;
+        bool unknown; ///< Import of all symbols might define any name
+        ScopeWrites() : unknown(false) {}
+
+        /// \return How many times is name written in the scope
+        unsigned count(const ustring &name) const {
+            auto c = counts.find(name);
+            return c == counts.end() ? 0 : c->second;
+        }
+    };
+private:
+    std::unordered_map<IR *, ScopeWrites> writes;
+    std::vector<ScopeWrites *> scope_stack;
+    std::unordered_set<ustring> non_local_writes;
+
+    void add_write(const ustring &name);
+    void add_target(Expression *target);
+    void collect_writes(IR *ir);
+public:
+    /// Collects writes of scope, its arguments and body
+    void collect(IR *scope, std::vector<Argument *> *args, std::list<IR *> &body);
+
+    /// \return Writes in scope (or its nested scopes), which was collected
+    ScopeWrites &get(IR *scope) { return writes[scope]; }
+
+    /// \return true if name is written by `$name` or `::name` assignment
+    bool is_non_local(const ustring &name) { return non_local_writes.find(name) != non_local_writes.end(); }
+
+    void clear() {
+        writes.clear();
+        non_local_writes.clear();
+    }
+};
+
+}
+}
+
+#endif//_NAME_WRITES_HPP_
@@ -0,0 +1,423 @@
+#include "type_analyzer.hpp"
+#include "parser.hpp"
+#include "ir.hpp"
+#include "logging.hpp"
+
+using namespace moss;
+using namespace ir;
+
+static bool is_numeric(TypeAnalyzer::Type t) {
+    return t.type == StaticType::INT || t.type == StaticType::FLOAT;
+}
+
+/// \return Operator of compound assignment op without the assignment
+static OperatorKind get_arith_kind(OperatorKind op) {
+    switch (op) {
+        case OperatorKind::OP_SET_CONCAT: return OperatorKind::OP_CONCAT;
+        case OperatorKind::OP_SET_EXP: return OperatorKind::OP_EXP;
+        case OperatorKind::OP_SET_PLUS: return OperatorKind::OP_PLUS;
+        case OperatorKind::OP_SET_MINUS: return OperatorKind::OP_MINUS;
+        case OperatorKind::OP_SET_DIV: return OperatorKind::OP_DIV;
+        case OperatorKind::OP_SET_MUL: return OperatorKind::OP_MUL;
+        case OperatorKind::OP_SET_MOD: return OperatorKind::OP_MOD;
+        default: return op;
+    }
+}
+
+TypeAnalyzer::State TypeAnalyzer::merge(const State &s1, const State &s2) {
+    if (!s1.reachable)
+        return s2;
+    if (!s2.reachable)
+        return s1;
+    State merged;
+    for (auto &[name, t]: s1.vars) {
+        auto t2 = s2.vars.find(name);
+        if (t2 == s2.vars.end() || t2->second.type != t.type)
+            continue;
+        merged.vars[name] = Type(t.type, t.exact && t2->second.exact);
+    }
+    return merged;
+}
+
+TypeAnalyzer::Type TypeAnalyzer::get_result_type(OperatorKind op, Type t1, Type t2) {
+    // Subclass might overload the operator
+    if (!t1.exact || !t2.exact)
+        return Type();
+    switch (op) {
+        case OperatorKind::OP_CONCAT:
+            return Type(StaticType::STRING, true);
+        case OperatorKind::OP_EXP:
+        case OperatorKind::OP_PLUS:
+        case OperatorKind::OP_MINUS:
+        case OperatorKind::OP_DIV:
+        case OperatorKind::OP_MUL:
+        case OperatorKind::OP_MOD:
+            if (!is_numeric(t1) || !is_numeric(t2))
+                return Type();
+            if (t1.type == StaticType::INT && t2.type == StaticType::INT)
+                return Type(StaticType::INT, true);
+            return Type(StaticType::FLOAT, true);
+        case OperatorKind::OP_EQ:
+        case OperatorKind::OP_NEQ:
+        case OperatorKind::OP_BT:
+        case OperatorKind::OP_LT:
+        case OperatorKind::OP_BEQ:
+        case OperatorKind::OP_LEQ:
+            if (!is_numeric(t1) || !is_numeric(t2))
+                return Type();
+            return Type(StaticType::BOOL, true);
+        default:
+            return Type();
+    }
+}
+
+bool TypeAnalyzer::get_builtin_type(Expression *e, StaticType &t) {
+    auto v = dyn_cast<Variable>(e);
+    if (!v || v->is_non_local())
+        return false;
+    auto name = v->get_name();
+    if (name == "Int")
+        t = StaticType::INT;
+    else if (name == "Float")
+        t = StaticType::FLOAT;
+    else if (name == "String")
+        t = StaticType::STRING;
+    else if (name == "Bool")
+        t = StaticType::BOOL;
+    else
+        return false;
+    // The name could be redefined
+    return writes.get(module).count(name) == 0 && !writes.is_non_local(name);
+}
+
+TypeAnalyzer::State TypeAnalyzer::get_args_state(std::vector<Argument *> &args) {
+    State st;
+    for (auto a: args) {
+        StaticType t;
+        if (a->is_vararg() || a->types_size() != 1 || !get_builtin_type(a->get_type(0), t))
+            continue;
+        if (writes.is_non_local(a->get_name()))
+            continue;
+        // Default value is not checked against the type
+        if (a->has_default_value()) {
+            auto dv = a->get_default_value();
+            bool matches = (t == StaticType::INT && isa<IntLiteral>(dv)) ||
+                           (t == StaticType::FLOAT && isa<FloatLiteral>(dv)) ||
+                           (t == StaticType::STRING && isa<StringLiteral>(dv)) ||
+                           (t == StaticType::BOOL && isa<BoolLiteral>(dv));
+            if (!matches)
+                continue;
+        }
+        st.vars[a->get_name()] = Type(t, false);
+    }
+    return st;
+}
+
+void TypeAnalyzer::assign(Expression *target, Type t, State &st) {
+    if (auto v = dyn_cast<Variable>(target)) {
+        if (v->is_non_local() || writes.is_non_local(v->get_name()))
+            return;
+        if (t.type == StaticType::UNKNOWN)
+            st.vars.erase(v->get_name());
+        else
+            st.vars[v->get_name()] = t;
+    } else if (auto mv = dyn_cast<Multivar>(target)) {
+        for (auto v: mv->get_vars())
+            assign(v, Type(), st);
+    } else {
+        // Attribute or subscript set
+        get_type(target, st);
+    }
+}
+
+void TypeAnalyzer::invalidate(IR *ir, State &st) {
+    NameWrites ir_writes;
+    std::list<IR *> body{ir};
+    ir_writes.collect(ir, nullptr, body);
+    auto &w = ir_writes.get(ir);
+    if (w.unknown) {
+        st.vars.clear();
+        return;
+    }
+    for (auto &[name, count]: w.counts) {
+        (void)count;
+        st.vars.erase(name);
+    }
+}
+
+TypeAnalyzer::Type TypeAnalyzer::get_type(BinaryExpr *be, State &st) {
+    auto op = be->get_op().get_kind();
+    be->set_operands_type(StaticType::UNKNOWN);
+    if (op == OperatorKind::OP_SET) {
+        auto t = get_type(be->get_right(), st);
+        assign(be->get_left(), t, st);
+        return t;
+    }
+    if (op == OperatorKind::OP_ACCESS) {
+        get_type(be->get_left(), st);
+        return Type();
+    }
+    if (op == OperatorKind::OP_SHORT_C_AND || op == OperatorKind::OP_SHORT_C_OR) {
+        get_type(be->get_left(), st);
+        // Right side might not be evaluated
+        State right = st;
+        get_type(be->get_right(), right);
+        st = merge(st, right);
+        return Type();
+    }
+
+    auto t1 = get_type(be->get_left(), st);
+    auto t2 = get_type(be->get_right(), st);
+    auto arith_op = get_arith_kind(op);
+    switch (arith_op) {
+        case OperatorKind::OP_EXP:
+        case OperatorKind::OP_PLUS:
+        case OperatorKind::OP_MINUS:
+        case OperatorKind::OP_DIV:
+        case OperatorKind::OP_MUL:
+        case OperatorKind::OP_MOD:
+        case OperatorKind::OP_BT:
+        case OperatorKind::OP_LT:
+        case OperatorKind::OP_BEQ:
+        case OperatorKind::OP_LEQ:
+            if (is_numeric(t1) && t1.type == t2.type)
+                be->set_operands_type(t1.type);
+        break;
+        default: break;
+    }
+    auto res = get_result_type(arith_op, t1, t2);
+    if (is_set_op(be->get_op()))
+        assign(be->get_left(), res, st);
+    return res;
+}
+
+TypeAnalyzer::Type TypeAnalyzer::get_type(Expression *e, State &st) {
+    if (!e)
+        return Type();
+    switch (e->get_type()) {
+        case IRType::INT_LITERAL: return Type(StaticType::INT, true);
+        case IRType::FLOAT_LITERAL: return Type(StaticType::FLOAT, true);
+        case IRType::BOOL_LITERAL: return Type(StaticType::BOOL, true);
+        case IRType::STRING_LITERAL: return Type(StaticType::STRING, true);
+        case IRType::NIL_LITERAL:
+        case IRType::THIS_LITERAL:
+        case IRType::SUPER_LITERAL:
+        case IRType::OPERATOR_LITERAL:
+            return Type();
+        default: break;
+    }
+    if (auto v = dyn_cast<Variable>(e)) {
+        if (v->is_non_local())
+            return Type();
+        auto t = st.vars.find(v->get_name());
+        return t == st.vars.end() ? Type() : t->second;
+    }
+    if (auto be = dyn_cast<BinaryExpr>(e))
+        return get_type(be, st);
+    if (auto ue = dyn_cast<UnaryExpr>(e)) {
+        auto op = ue->get_op().get_kind();
+        // ::name is a global
+        if (op == OperatorKind::OP_SCOPE)
+            return Type();
+        auto t = get_type(ue->get_expr(), st);
+        if (op == OperatorKind::OP_SILENT)
+            return t;
+        if (!t.exact)
+            return Type();
+        if (op == OperatorKind::OP_MINUS && is_numeric(t))
+            return t;
+        if (op == OperatorKind::OP_NOT && t.type == StaticType::BOOL)
+            return t;
+        return Type();
+    }
+    if (auto cl = dyn_cast<Call>(e)) {
+        if (!isa<Variable>(cl->get_fun()))
+            get_type(cl->get_fun(), st);
+        for (auto a: cl->get_args()) {
+            auto be = dyn_cast<BinaryExpr>(a);
+            // Named argument is not an assignment
+            if (be && be->get_op().get_kind() == OperatorKind::OP_SET)
+                get_type(be->get_right(), st);
+            else
+                get_type(a, st);
+        }
+        StaticType t;
+        if (get_builtin_type(cl->get_fun(), t))
+            return Type(t, true);
+        return Type();
+    }
+    if (auto ic = dyn_cast<InlinedCall>(e))
+        return get_type(ic->get_body(), st);
+    if (auto ti = dyn_cast<TernaryIf>(e)) {
+        get_type(ti->get_condition(), st);
+        State st_false = st;
+        auto t_true = get_type(ti->get_value_true(), st);
+        auto t_false = get_type(ti->get_value_false(), st_false);
+        st = merge(st, st_false);
+        return t_true == t_false ? t_true : Type();
+    }
+    if (auto r = dyn_cast<Range>(e)) {
+        get_type(r->get_start(), st);
+        get_type(r->get_second(), st);
+        get_type(r->get_end(), st);
+        return Type();
+    }
+    if (auto lst = dyn_cast<List>(e)) {
+        if (lst->is_comprehension()) {
+            invalidate(lst, st);
+            return Type();
+        }
+        for (auto v: lst->get_value())
+            get_type(v, st);
+        return Type();
+    }
+    if (auto dct = dyn_cast<Dict>(e)) {
+        for (auto k: dct->get_keys())
+            get_type(k, st);
+        for (auto v: dct->get_values())
+            get_type(v, st);
+        return Type();
+    }
+    // Lambdas are analyzed on their own, this only sets their names
+    invalidate(e, st);
+    return Type();
+}
+
+TypeAnalyzer::Type TypeAnalyzer::get_element_type(Expression *collection, State &st) {
+    get_type(collection, st);
+    // Range creation raises for non-Int bounds and the range yields Ints
+    if (isa<Range>(collection))
+        return Type(StaticType::INT, true);
+    return Type();
+}
+
+TypeAnalyzer::State TypeAnalyzer::analyze_iteration(IR *loop, Type element, State head, std::vector<State> &exits) {
+    loops.push_back(LoopStates());
+    if (auto whl = dyn_cast<While>(loop)) {
+        get_type(whl->get_cond(), head);
+        exits.push_back(head);
+        analyze_body(whl->get_body(), head);
+    } else if (auto dwhl = dyn_cast<DoWhile>(loop)) {
+        analyze_body(dwhl->get_body(), head);
+        for (auto &c: loops.back().continues)
+            head = merge(head, c);
+        loops.back().continues.clear();
+        get_type(dwhl->get_cond(), head);
+        exits.push_back(head);
+    } else if (auto frl = dyn_cast<ForLoop>(loop)) {
+        exits.push_back(head);
+        assign(frl->get_iterator(), element, head);
+        analyze_body(frl->get_body(), head);
+    } else {
+        assert(false && "Unknown loop");
+    }
+    for (auto &c: loops.back().continues)
+        head = merge(head, c);
+    for (auto &b: loops.back().breaks)
+        exits.push_back(b);
+    loops.pop_back();
+    return head;
+}
+
+void TypeAnalyzer::analyze_loop(IR *loop, State &st) {
+    Type element;
+    if (auto frl = dyn_cast<ForLoop>(loop))
+        element = get_element_type(frl->get_collection(), st);
+
+    // Types only become less known with each iteration, so this ends, but
+    // for the case it would not, nothing is known after the limit is hit
+    State head = st;
+    std::vector<State> exits;
+    for (unsigned i = 1; ; ++i) {
+        exits.clear();
+        auto back = analyze_iteration(loop, element, head, exits);
+        if (head.vars.empty())
+            break;
+        auto next = merge(st, back);
+        if (next == head)
+            break;
+        head = next;
+        if (i == MAX_LOOP_ITERATIONS)
+            head.vars.clear();
+    }
+
+    State end;
+    end.reachable = false;
+    for (auto &e: exits)
+        end = merge(end, e);
+    st = end;
+}
+
+void TypeAnalyzer::analyze(IR *ir, State &st) {
+    if (!st.reachable)
+        return;
+    if (auto e = dyn_cast<Expression>(ir)) {
+        get_type(e, st);
+    } else if (auto i = dyn_cast<If>(ir)) {
+        get_type(i->get_cond(), st);
+        State st_else = st;
+        analyze_body(i->get_body(), st);
+        if (i->get_else())
+            analyze_body(i->get_else()->get_body(), st_else);
+        st = merge(st, st_else);
+    } else if (isa<While>(ir) || isa<DoWhile>(ir) || isa<ForLoop>(ir)) {
+        analyze_loop(ir, st);
+    } else if (auto ret = dyn_cast<Return>(ir)) {
+        get_type(ret->get_expr(), st);
+        st.reachable = false;
+    } else if (auto rs = dyn_cast<Raise>(ir)) {
+        get_type(rs->get_exception(), st);
+        st.reachable = false;
+    } else if (isa<Break>(ir) || isa<Continue>(ir)) {
+        if (!loops.empty()) {
+            if (isa<Break>(ir))
+                loops.back().breaks.push_back(st);
+            else
+                loops.back().continues.push_back(st);
+        }
+        st.reachable = false;
+    } else {
+        invalidate(ir, st);
+        // Break or continue might be nested in them
+        if (!loops.empty() && (isa<Try>(ir) || isa<Switch>(ir))) {
+            loops.back().breaks.push_back(st);
+            loops.back().continues.push_back(st);
+        }
+    }
+}
+
+void TypeAnalyzer::analyze_body(std::list<IR *> &body, State &st) {
+    for (auto i: body) {
+        analyze(i, st);
+    }
+}
+
+IR *TypeAnalyzer::visit(Module &mod) {
+    writes.clear();
+    module = nullptr;
+    // Later REPL lines or streamed chunks might redefine builtin types
+    if (!parser.is_whole_module())
+        return &mod;
+    writes.collect(&mod, nullptr, mod.get_body());
+    if (!writes.get(&mod).unknown)
+        module = &mod;
+    return &mod;
+}
+
+IR *TypeAnalyzer::visit(Function &fun) {
+    if (!module)
+        return &fun;
+    LOGMAX("Inferring types in " << fun.get_name());
+    auto st = get_args_state(fun.get_args());
+    analyze_body(fun.get_body(), st);
+    return &fun;
+}
+
+IR *TypeAnalyzer::visit(Lambda &lf) {
+    if (!module)
+        return &lf;
+    LOGMAX("Inferring types in " << lf.get_name());
+    auto st = get_args_state(lf.get_args());
+    get_type(lf.get_body(), st);
+    return &lf;
+}
@@ -0,0 +1,97 @@
+///
+/// \file type_analyzer.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Static type inference of local variables.
+///
+
+#ifndef _TYPE_ANALYZER_HPP_
+#define _TYPE_ANALYZER_HPP_
+
+#include "ir.hpp"
+#include "ir_visitor.hpp"
+#include "analysis/name_writes.hpp"
+#include <unordered_map>
+#include <vector>
+#include <list>
+
+namespace moss {
+namespace ir {
+
+/// \brief Infers types of function's local variables and sets operands type
+/// of binary expressions, whose operands are both Ints or both Floats.
+/// Types come from literals, declared argument types and calls to builtin
+/// type constructors (`Int`, `Float`, `String` and `Bool`). The analysis
+/// goes through the function's body in order, merges types of if branches
+/// and repeats loops until the types do not change.
+/// Names written by `$` or `::` anywhere in the module are not tracked, nor
+/// are the builtin types if the module writes their name.
+/// Argument declared as `Int` might be an instance of Int's subclass, which
+/// can overload operators, so results of operations with such operands are
+/// not known.
+class TypeAnalyzer : public IRVisitor {
+public:
+    /// Type of a value known at compile time
+    struct Type {
+        StaticType type;
+        bool exact; ///< Value cannot be an instance of type's subclass
+
+        Type() : type(StaticType::UNKNOWN), exact(false) {}
+        Type(StaticType type, bool exact) : type(type), exact(exact) {}
+
+        bool operator==(const Type &other) const { return type == other.type && exact == other.exact; }
+        bool operator!=(const Type &other) const { return !(*this == other); }
+    };
+private:
+    /// Known types of variables at a point in the function
+    struct State {
+        std::unordered_map<ustring, Type> vars;
+        bool reachable;
+        State() : reachable(true) {}
+
+        bool operator==(const State &other) const { return reachable == other.reachable && vars == other.vars; }
+    };
+
+    /// States at break and continue of the loop being analyzed
+    struct LoopStates {
+        std::vector<State> breaks;
+        std::vector<State> continues;
+    };
+
+    /// Maximum number of times a loop body is analyzed before giving up
+    /// on the types of variables it uses
+    static constexpr unsigned MAX_LOOP_ITERATIONS = 8;
+
+    NameWrites writes;
+    IR *module;
+    std::vector<LoopStates> loops;
+
+    static State merge(const State &s1, const State &s2);
+    static Type get_result_type(OperatorKind op, Type t1, Type t2);
+
+    bool get_builtin_type(Expression *e, StaticType &t);
+    State get_args_state(std::vector<Argument *> &args);
+    void assign(Expression *target, Type t, State &st);
+    void invalidate(IR *ir, State &st);
+    Type get_type(Expression *e, State &st);
+    Type get_type(BinaryExpr *be, State &st);
+    Type get_element_type(Expression *collection, State &st);
+    State analyze_iteration(IR *loop, Type element, State head, std::vector<State> &exits);
+    void analyze_loop(IR *loop, State &st);
+    void analyze(IR *ir, State &st);
+    void analyze_body(std::list<IR *> &body, State &st);
+public:
+    TypeAnalyzer(Parser &parser) : IRVisitor(parser), module(nullptr) {}
+    virtual const char *get_name() const override { return "TypeAnalyzer"; }
+
+    virtual IR *visit(class Module &mod) override;
+    virtual IR *visit(class Function &fun) override;
+    virtual IR *visit(class Lambda &lf) override;
+};
+
+}
+}
+
+#endif//_TYPE_ANALYZER_HPP_
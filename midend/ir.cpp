@@ -4,9 +4,9 @@
 using namespace moss;
 using namespace ir;
 
-uint64_t ir::Space::anonymous_id = 0;
-uint64_t ir::Lambda::anonymous_id = 0;
-uint64_t ir::List::anonymous_id = 0;
+std::atomic<uint64_t> ir::Space::anonymous_id = 0;
+std::atomic<uint64_t> ir::Lambda::anonymous_id = 0;
+std::atomic<uint64_t> ir::List::anonymous_id = 0;
 
 std::list<IR *> List::as_for() {
     std::vector<Expression *> empty_list;
@@ -238,6 +238,10 @@ IR *Call::accept(IRVisitor& visitor) {
     return visitor.visit(*this);
 }
 
+IR *InlinedCall::accept(IRVisitor& visitor) {
+    return visitor.visit(*this);
+}
+
 IR *List::accept(IRVisitor& visitor) {
     return visitor.visit(*this);
 }
@@ -15,6 +15,8 @@
 #include "commons.hpp"
 #include "utils.hpp"
 #include "ir_visitor.hpp"
+#include "arena.hpp"
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <cassert>
@@ -75,6 +77,7 @@ enum IRType {
     TERNARY_IF,
     RANGE,
     CALL,
+    INLINED_CALL,
     THIS_LITERAL,
     SUPER_LITERAL,
     OPERATOR_LITERAL,
@@ -90,7 +93,7 @@ enum IRType {
 class Annotation;
 
 /// Base class for any IR value
-class IR {
+class IR : public ArenaObject {
 protected:
     IRType ir_type;
     ustring name;
@@ -278,7 +281,7 @@ public:
 
 class Space : public Construct {
 private:
-    static uint64_t anonymous_id;
+    static std::atomic<uint64_t> anonymous_id; ///< Imports might be parsed in parallel
     bool anonymous;
 public:
     static const IRType ClassType = IRType::SPACE;
@@ -1195,17 +1198,27 @@ inline std::ostream& operator<< (std::ostream& os, const Operator &op) {
     return op.debug(os);
 }
 
+/// Type of a value known at compile time
+enum class StaticType {
+    UNKNOWN,
+    INT,
+    FLOAT,
+    BOOL,
+    STRING
+};
+
 class BinaryExpr : public Expression {
 private:
     Expression *left;
     Expression *right;
     const Operator op;
+    StaticType operands_type; ///< Type of both operands if known by TypeAnalyzer
 public:
     static const IRType ClassType = IRType::BINARY_EXPR;
 
     BinaryExpr(Expression *left, Expression *right, Operator op, SourceInfo src_info) 
               : Expression(ClassType, "<binary-expression>", src_info),
-                left(left), right(right), op(op) {
+                left(left), right(right), op(op), operands_type(StaticType::UNKNOWN) {
         left->set_parent(this);
         right->set_parent(this);
     }
@@ -1233,6 +1246,8 @@ public:
             this->right->set_parent(this);
     }
     Operator get_op() { return this->op; }
+    StaticType get_operands_type() { return this->operands_type; }
+    void set_operands_type(StaticType t) { this->operands_type = t; }
 
     virtual ustring as_string() override {
         return left->as_string() + op.as_string() + right->as_string();
@@ -1391,7 +1406,7 @@ public:
 
 class Lambda : public Expression {
 private:
-    static uint64_t anonymous_id;
+    static std::atomic<uint64_t> anonymous_id; ///< Imports might be parsed in parallel
     bool anonymous;
     FunctionInfo info;
     Expression *body;
@@ -1534,6 +1549,45 @@ public:
     }
 };
 
+/// Call whose callee's body was inlined in its place, it is kept so that
+/// the stack trace can still show the inlined function
+class InlinedCall : public Expression {
+private:
+    ustring args_str;
+    Expression *body;
+public:
+    static const IRType ClassType = IRType::INLINED_CALL;
+
+    /// \param name Name of the inlined function
+    /// \param args_str Arguments of the inlined function as in stack trace
+    /// \param body Function's body with arguments substituted by the call's ones
+    InlinedCall(ustring name, ustring args_str, Expression *body, SourceInfo src_info)
+            : Expression(ClassType, name, src_info), args_str(args_str), body(body) {
+        body->set_parent(this);
+    }
+    ~InlinedCall() {
+        if (body)
+            delete body;
+    }
+
+    Expression *get_body() { return this->body; }
+    void set_body(Expression *b) {
+        this->body = b;
+        if (this->body)
+            this->body->set_parent(this);
+    }
+    ustring get_args_str() { return this->args_str; }
+    /// \return Inlined function's signature as shown in stack trace
+    ustring get_signature() { return name + "(" + args_str + ")"; }
+
+    IR *accept(IRVisitor& visitor) override;
+
+    virtual inline std::ostream& debug(std::ostream& os) const override {
+        os << "(inlined " << name << "(" << args_str << ") = " << *body << ")";
+        return os;
+    }
+};
+
 class IntLiteral : public Expression {
 private:
     opcode::IntConst value;
@@ -1697,7 +1751,7 @@ public:
 
 class List : public Expression {
 private:
-    static uint64_t anonymous_id;
+    static std::atomic<uint64_t> anonymous_id; ///< Imports might be parsed in parallel
     std::vector<Expression *> value;
     bool comprehension;
     Expression *result;
@@ -1897,6 +1951,7 @@ template<> inline ir::Expression *dyn_cast<>(ir::IR* i) {
         else if (auto e = dyn_cast<ir::TernaryIf>(i)) return e;
         else if (auto e = dyn_cast<ir::Range>(i)) return e;
         else if (auto e = dyn_cast<ir::Call>(i)) return e;
+        else if (auto e = dyn_cast<ir::InlinedCall>(i)) return e;
         else if (auto e = dyn_cast<ir::ThisLiteral>(i)) return e;
         else if (auto e = dyn_cast<ir::SuperLiteral>(i)) return e;
         else if (auto e = dyn_cast<ir::OperatorLiteral>(i)) return e;
@@ -2,26 +2,45 @@
 #include "analysis/method_analyzer.hpp"
 #include "analysis/function_analyzer.hpp"
 #include "analysis/expression_analyzer.hpp"
+#include "analysis/type_analyzer.hpp"
 #include "transforms/constant_folding.hpp"
+#include "transforms/constant_propagation.hpp"
+#include "transforms/inlining.hpp"
 #include "transforms/dead_code_elimination.hpp"
 #include "ir.hpp"
+#include "parser.hpp"
 
 using namespace moss;
 using namespace ir;
 
-IRPipeline::IRPipeline(Parser &parser) : pm(parser) {
+IRPipeline::IRPipeline(Parser &parser, unsigned opt_level) : pm(parser), parser(parser) {
     // Method analyzer
     add_pass(new MethodAnalyzer(parser)); // Method analyzer has to be run before function analyzer (it uses method tag).
     add_pass(new FunctionAnalyzer(parser));
     add_pass(new ExpressionAnalyzer(parser));
+    if (opt_level == 0)
+        return;
 
     // Transforms
     LOG2("Adding DeadCodeElimination pass");
     add_pass(new DeadCodeEliminationPass(parser));
+    if (opt_level >= 2) {
+        LOG2("Adding Inlining pass");
+        add_pass(new InliningPass(parser, opt_level >= 3 ? FunctionAnalyzer::INLINE_MAX_SIZE_AGGRESSIVE
+                                                        : FunctionAnalyzer::INLINE_MAX_SIZE));
+    }
+    LOG2("Adding ConstantPropagation pass");
+    add_pass(new ConstantPropagationPass(parser));
     LOG2("Adding ConstantFolding pass");
     add_pass(new ConstantFoldingPass(parser));
     LOG2("Adding DeadBranchElimination pass");
     add_pass(new DeadBranchEliminationPass(parser));
+
+    if (opt_level >= 2) {
+        // Types are inferred once inlined calls are in place
+        LOG2("Adding TypeAnalyzer pass");
+        add_pass(new TypeAnalyzer(parser));
+    }
 }
 
 IRPipeline::~IRPipeline() {
@@ -31,11 +50,19 @@ IRPipeline::~IRPipeline() {
 }
 
 ir::IR *IRPipeline::run(ir::IR *decl) {
+    // IR created by passes belongs to the same module
+    ArenaScope arena_scope(parser.get_arena());
     try {
         decl->accept(pm);
     } catch (Raise *raise) {
         return raise;
     }
+    if (passstats::is_enabled()) {
+        for (auto p: pass_instances) {
+            passstats::record(parser.get_src_file().get_name(), p->get_name(), p->stats.time, p->stats.changes);
+            p->stats = IRVisitor::Stats();
+        }
+    }
     return nullptr;
 }
 
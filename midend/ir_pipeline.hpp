@@ -12,6 +12,7 @@
 
 #include "ir.hpp"
 #include "ir_visitor.hpp"
+#include "clopts.hpp"
 #include <list>
 
 namespace moss {
@@ -22,9 +23,13 @@ class IRPipeline {
 private:
     std::list<IRVisitor *> pass_instances;
     PassManager pm;
+    Parser &parser;
 public:
-    /// Constructs new default pipeline 
-    IRPipeline(Parser &parser);
+    /// Constructs new pipeline with passes for optimization level
+    /// (0 runs only analyses needed to generate the code, 1 adds constant
+    /// and dead code passes, 2 adds inlining and type inference and 3 inlines
+    /// larger functions)
+    IRPipeline(Parser &parser, unsigned opt_level=clopts::DEFAULT_OPT_LEVEL);
     ~IRPipeline();
 
     /// Runs the whole pipeline
@@ -68,10 +68,30 @@ T* PassManager::visit_child(T* old_child, Setter set_func, const char* err_msg,
     return new_child;
 }
 
+template <typename T>
+IR* PassManager::run_pass(IRVisitor *p, T& node) {
+    if (!timed)
+        return p->visit(node);
+    // Pass running its own pass manager (inlining) is timed only once
+    static thread_local bool timing = false;
+    struct TimingScope {
+        bool outer;
+        TimingScope() : outer(!timing) { timing = true; }
+        ~TimingScope() { if (outer) timing = false; }
+    } scope;
+    auto start = passstats::Clock::now();
+    IR* replaced = p->visit(node);
+    if (scope.outer)
+        p->stats.time += passstats::Clock::now() - start;
+    if (replaced != &node)
+        ++p->stats.changes;
+    return replaced;
+}
+
 template <typename T>
 IR* PassManager::try_replace(T& node) {
     for (auto p : passes) {
-        IR* replaced = p->visit(node);
+        IR* replaced = run_pass(p, node);
         if (!replaced)
             return replaced;
         if (replaced != &node)
@@ -82,7 +102,7 @@ IR* PassManager::try_replace(T& node) {
 
 IR *PassManager::visit(Module &mod) {
     for (auto p: passes) {
-        IR *replaced = mod.accept(*p);
+        IR* replaced = run_pass(p, mod);
         assert(replaced == &mod && "Pass attempted to replace Module node");
         (void)replaced;
     }
@@ -93,7 +113,7 @@ IR *PassManager::visit(Module &mod) {
 
 IR *PassManager::visit(Class &cls) {
     for (auto p : passes) {
-        IR* replaced = cls.accept(*p);
+        IR* replaced = run_pass(p, cls);
         assert(replaced == &cls && "Pass attempted to replace Class node");
         (void)replaced;
     }
@@ -104,7 +124,7 @@ IR *PassManager::visit(Class &cls) {
 
 IR *PassManager::visit(Space &spc) {
     for (auto p : passes) {
-        IR* replaced = spc.accept(*p);
+        IR* replaced = run_pass(p, spc);
         assert(replaced == &spc && "Pass attempted to replace Space node");
         (void)replaced;
     }
@@ -121,7 +141,7 @@ IR *PassManager::visit(Argument &a) {
 
 IR *PassManager::visit(Function &fun) {
     for (auto p : passes) {
-        IR* replaced = fun.accept(*p);
+        IR* replaced = run_pass(p, fun);
         assert(replaced == &fun && "Pass attempted to replace Fun node");
         (void)replaced;
     }
@@ -181,7 +201,7 @@ IR *PassManager::visit(Case &cs) {
 
 IR *PassManager::visit(Catch &ct) {
     for (auto p : passes) {
-        IR* replaced = ct.accept(*p);
+        IR* replaced = run_pass(p, ct);
         assert (replaced == &ct && "Pass attempted to replace Catch node");
         (void)replaced;
     }
@@ -193,7 +213,7 @@ IR *PassManager::visit(Catch &ct) {
 
 IR *PassManager::visit(Finally &fnl) {
     for (auto p : passes) {
-        IR* replaced = fnl.accept(*p);
+        IR* replaced = run_pass(p, fnl);
         assert (replaced == &fnl && "Pass attempted to replace Finally node");
         (void)replaced;
     }
@@ -204,7 +224,7 @@ IR *PassManager::visit(Finally &fnl) {
 
 IR *PassManager::visit(Try &tr) {
     for (auto p : passes) {
-        IR* replaced = tr.accept(*p);
+        IR* replaced = run_pass(p, tr);
         assert (replaced == &tr && "Pass attempted to replace Try node");
         (void)replaced;
     }
@@ -238,7 +258,7 @@ IR *PassManager::visit(DoWhile &dwhl) {
 
 IR *PassManager::visit(ForLoop &frl) {
     for (auto p : passes) {
-        IR* replaced = frl.accept(*p);
+        IR* replaced = run_pass(p, frl);
         assert (replaced == &frl && "Pass attempted to replace For node");
         (void)replaced;
     }
@@ -251,7 +271,7 @@ IR *PassManager::visit(ForLoop &frl) {
 
 IR *PassManager::visit(Import &imp) {
     for (auto p : passes) {
-        IR* replaced = imp.accept(*p);
+        IR* replaced = run_pass(p, imp);
         assert (replaced == &imp && "Pass attempted to replace Import node");
         (void)replaced;
     }
@@ -262,7 +282,7 @@ IR *PassManager::visit(Import &imp) {
 
 IR *PassManager::visit(Assert &a) {
     for (auto p : passes) {
-        IR* replaced = a.accept(*p);
+        IR* replaced = run_pass(p, a);
         assert (replaced == &a && "Pass attempted to replace Assert node");
         (void)replaced;
     }
@@ -276,7 +296,7 @@ IR *PassManager::visit(Assert &a) {
 
 IR *PassManager::visit(Raise &r) {
     for (auto p : passes) {
-        IR* replaced = r.accept(*p);
+        IR* replaced = run_pass(p, r);
         assert (replaced == &r && "Pass attempted to replace Raise node");
         (void)replaced;
     }
@@ -337,7 +357,7 @@ IR *PassManager::visit(UnaryExpr &ue) {
 
 IR *PassManager::visit(Multivar &mv) {
     for (auto p : passes) {
-        IR* replaced = mv.accept(*p);
+        IR* replaced = run_pass(p, mv);
         assert (replaced == &mv && "Pass attempted to replace Multivar node");
         (void)replaced;
     }
@@ -394,6 +414,16 @@ IR *PassManager::visit(Call &cl) {
     return try_replace(cl);
 }
 
+IR *PassManager::visit(InlinedCall &ic) {
+    IR* self = try_replace(ic);
+    if (self != &ic)
+        return self;
+
+    visit_child(ic.get_body(), [&ic](Expression *new_i) { ic.set_body(new_i); }, "Inlined call body cannot be removed");
+
+    return try_replace(ic);
+}
+
 IR *PassManager::visit(List &lst) {
     IR* self = try_replace(lst);
     if (self != &lst)
@@ -459,5 +489,6 @@ IR *IRVisitor::visit(class Multivar &i) { return &i; }
 IR *IRVisitor::visit(class TernaryIf &i) { return &i; }
 IR *IRVisitor::visit(class Range &i) { return &i; }
 IR *IRVisitor::visit(class Call &i) { return &i; }
+IR *IRVisitor::visit(class InlinedCall &i) { return &i; }
 IR *IRVisitor::visit(class List &i) { return &i; }
 IR *IRVisitor::visit(class Dict &i) { return &i; }
\ No newline at end of file
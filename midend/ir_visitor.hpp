@@ -13,6 +13,7 @@
 #include "ir.hpp"
 #include "logging.hpp"
 #include "diagnostics.hpp"
+#include "pass_stats.hpp"
 
 namespace moss {
 
@@ -26,6 +27,16 @@ protected:
     Parser &parser;
     class IR *currently_visiting;
 public:
+    /// Statistics collected by PassManager when --time-passes is set,
+    /// passes which change nodes in place count these changes themselves
+    struct Stats {
+        passstats::Clock::duration time{0};
+        unsigned long changes = 0; ///< Amount of replaced, removed or changed nodes
+    } stats;
+
+    /// \return Name of the pass used in statistics
+    virtual const char *get_name() const { return "IRVisitor"; }
+
     virtual IR *visit(class Module &i);
     virtual IR *visit(class Space &i);
     virtual IR *visit(class Class &i);
@@ -56,6 +67,7 @@ public:
     virtual IR *visit(class TernaryIf &i);
     virtual IR *visit(class Range &i);
     virtual IR *visit(class Call &i);
+    virtual IR *visit(class InlinedCall &i);
     virtual IR *visit(class List &i);
     virtual IR *visit(class Dict &i);
 
@@ -67,6 +79,7 @@ public:
 class PassManager : public IRVisitor {
 private:
     std::list<IRVisitor *> passes;
+    bool timed; ///< Records pass statistics
 protected:
     template <typename T, typename Container>
     void visit_body(Container& nodes);
@@ -76,6 +89,10 @@ protected:
 
     template <typename T>
     IR* try_replace(T& node);
+
+    /// Runs pass p on node and records its statistics if timed
+    template <typename T>
+    IR* run_pass(IRVisitor *p, T& node);
 public:
     virtual IR *visit(class Module &mod) override;
     virtual IR *visit(class Space &spc) override;
@@ -106,6 +123,7 @@ public:
     virtual IR *visit(class TernaryIf &ti) override;
     virtual IR *visit(class Range &r) override;
     virtual IR *visit(class Call &cl) override;
+    virtual IR *visit(class InlinedCall &ic) override;
     virtual IR *visit(class List &lst) override;
     virtual IR *visit(class Dict &dct) override;
 
@@ -113,7 +131,9 @@ public:
     void add_pass(IRVisitor *p);
     void clear_passes() { passes.clear(); }
 
-    PassManager(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "PassManager"; }
+
+    PassManager(Parser &parser) : IRVisitor(parser), timed(passstats::is_enabled()) {}
 };
 
 }
@@ -50,6 +50,10 @@ IR *ConstantFoldingPass::visit(BinaryExpr &be) {
             ? dyn_cast<FloatLiteral>(right)->get_value()
             : dyn_cast<IntLiteral>(right)->get_value();
 
+        // Division by zero is left for the interpreter to raise
+        if ((opk == OperatorKind::OP_DIV || opk == OperatorKind::OP_MOD) && rf == 0)
+            return &be;
+
         switch(opk) {
             case OperatorKind::OP_PLUS: {
                 if (float_op)
@@ -240,4 +244,14 @@ IR *ConstantFoldingPass::visit(UnaryExpr &ue) {
     }
 
     return &ue;
-}
\ No newline at end of file
+}
+
+IR *ConstantFoldingPass::visit(InlinedCall &ic) {
+    // Inlined call folded into a constant cannot raise, so there is no need
+    // to keep it for the stack trace
+    auto body = ic.get_body();
+    if (!body->is_constant())
+        return &ic;
+    ic.set_body(nullptr);
+    return body;
+}
@@ -20,9 +20,11 @@ namespace ir {
 class ConstantFoldingPass : public IRVisitor {
 public:
     ConstantFoldingPass(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "ConstantFolding"; }
     
     virtual IR *visit(class BinaryExpr &be) override;
     virtual IR *visit(class UnaryExpr &ue) override;
+    virtual IR *visit(class InlinedCall &ic) override;
 };
 
 }
@@ -0,0 +1,280 @@
+#include "constant_propagation.hpp"
+#include "parser.hpp"
+#include "ir.hpp"
+#include "logging.hpp"
+#include "values.hpp"
+
+using namespace moss;
+using namespace ir;
+
+static Expression *clone_constant(Expression *c, SourceInfo src_info) {
+    switch (c->get_type()) {
+        case IRType::INT_LITERAL: return new IntLiteral(dyn_cast<IntLiteral>(c)->get_value(), src_info);
+        case IRType::FLOAT_LITERAL: return new FloatLiteral(dyn_cast<FloatLiteral>(c)->get_value(), src_info);
+        case IRType::BOOL_LITERAL: return new BoolLiteral(dyn_cast<BoolLiteral>(c)->get_value(), src_info);
+        case IRType::STRING_LITERAL: return new StringLiteral(dyn_cast<StringLiteral>(c)->get_value(), src_info);
+        case IRType::NIL_LITERAL: return new NilLiteral(src_info);
+        default:
+            assert(false && "Cloning non-constant expression");
+            return nullptr;
+    }
+}
+
+/// \return true if any use of the constant is the same object, so it can be
+///         propagated even where its identity might be checked (id())
+static bool is_identity_free(Expression *c) {
+    if (auto i = dyn_cast<IntLiteral>(c))
+        return IntValue::is_interned(i->get_value());
+    return isa<BoolLiteral>(c) || isa<NilLiteral>(c);
+}
+
+static bool is_named_arg(Expression *arg) {
+    auto be = dyn_cast<BinaryExpr>(arg);
+    return be && be->get_op().get_kind() == OperatorKind::OP_SET;
+}
+
+ConstantPropagationPass::ConstEnv ConstantPropagationPass::nested_env(IR *scope, ConstEnv &env) {
+    // Names written in the nested scope shadow the outer ones
+    ConstEnv nested;
+    auto &w = writes.get(scope);
+    if (w.unknown)
+        return nested;
+    for (auto &c: env) {
+        if (w.count(c.first) == 0)
+            nested.insert(c);
+    }
+    return nested;
+}
+
+Expression *ConstantPropagationPass::propagate(Expression *e, ConstEnv &env, bool operand) {
+    if (auto v = dyn_cast<Variable>(e)) {
+        if (v->is_non_local())
+            return e;
+        auto c = env.find(v->get_name());
+        if (c == env.end() || (!operand && !is_identity_free(c->second)))
+            return e;
+        auto value = clone_constant(c->second, v->get_src_info());
+        delete v;
+        ++propagated;
+        return value;
+    } else if (auto be = dyn_cast<BinaryExpr>(e)) {
+        auto opk = be->get_op().get_kind();
+        if (is_set_op(be->get_op())) {
+            // Target is not a read, but set into attribute or subscript is
+            // left as is as well
+            be->set_right(propagate(be->get_right(), env, false));
+            return be;
+        }
+        if (opk == OperatorKind::OP_SCOPE)
+            return be;
+        if (opk == OperatorKind::OP_ACCESS) {
+            // Right is the attribute name
+            if (!isa<Variable>(be->get_left()))
+                be->set_left(propagate(be->get_left(), env, true));
+            return be;
+        }
+        // Operators create new values, so operands can be any constants
+        be->set_left(propagate(be->get_left(), env, true));
+        be->set_right(propagate(be->get_right(), env, true));
+        if (be->get_left()->is_constant() && be->get_right()->is_constant()) {
+            auto folded = folder.visit(*be);
+            if (folded != be) {
+                delete be;
+                ++stats.changes;
+                return dyn_cast<Expression>(folded);
+            }
+        }
+        return be;
+    } else if (auto ue = dyn_cast<UnaryExpr>(e)) {
+        auto opk = ue->get_op().get_kind();
+        if (opk == OperatorKind::OP_SCOPE)
+            return ue;
+        ue->set_expr(propagate(ue->get_expr(), env, operand || opk != OperatorKind::OP_UNPACK));
+        // Silenced constant is removed by constant folding as a statement
+        if (opk != OperatorKind::OP_SILENT && ue->get_expr()->is_constant()) {
+            auto folded = folder.visit(*ue);
+            if (folded != ue) {
+                delete ue;
+                ++stats.changes;
+                return dyn_cast<Expression>(folded);
+            }
+        }
+        return ue;
+    } else if (auto cl = dyn_cast<Call>(e)) {
+        if (!isa<Variable>(cl->get_fun()))
+            cl->set_fun(propagate(cl->get_fun(), env, true));
+        for (auto &a: cl->get_args()) {
+            if (is_named_arg(a))
+                propagate(a, env, false);
+            else
+                a = propagate(a, env, false);
+        }
+    } else if (auto ic = dyn_cast<InlinedCall>(e)) {
+        ic->set_body(propagate(ic->get_body(), env, operand));
+        if (ic->get_body()->is_constant()) {
+            auto folded = folder.visit(*ic);
+            delete ic;
+            ++stats.changes;
+            return dyn_cast<Expression>(folded);
+        }
+    } else if (auto ti = dyn_cast<TernaryIf>(e)) {
+        ti->set_condition(propagate(ti->get_condition(), env, true));
+        ti->set_value_true(propagate(ti->get_value_true(), env, operand));
+        ti->set_value_false(propagate(ti->get_value_false(), env, operand));
+    } else if (auto r = dyn_cast<Range>(e)) {
+        // Start might be the range's first value
+        r->set_start(propagate(r->get_start(), env, false));
+        if (r->get_second())
+            r->set_second(propagate(r->get_second(), env, true));
+        r->set_end(propagate(r->get_end(), env, true));
+    } else if (auto lst = dyn_cast<List>(e)) {
+        for (auto &v: lst->get_value())
+            v = propagate(v, env, false);
+        if (lst->is_comprehension()) {
+            lst->set_result(propagate(lst->get_result(), env, false));
+            if (lst->get_else_result())
+                lst->set_else_result(propagate(lst->get_else_result(), env, false));
+            if (lst->get_condition())
+                lst->set_condition(propagate(lst->get_condition(), env, true));
+            for (auto a: lst->get_assignments())
+                propagate(a, env, false);
+        }
+    } else if (auto dct = dyn_cast<Dict>(e)) {
+        for (auto &k: dct->get_keys())
+            k = propagate(k, env, false);
+        for (auto &v: dct->get_values())
+            v = propagate(v, env, false);
+    } else if (auto lf = dyn_cast<Lambda>(e)) {
+        auto lenv = nested_env(lf, env);
+        propagate_args(lf->get_args(), lenv);
+        lf->set_body(propagate(lf->get_body(), lenv, false));
+    }
+    return e;
+}
+
+void ConstantPropagationPass::propagate_args(std::vector<Argument *> &args, ConstEnv &env) {
+    for (auto a: args) {
+        if (a->get_default_value())
+            a->set_default_value(propagate(a->get_default_value(), env, false));
+    }
+}
+
+void ConstantPropagationPass::propagate_body(std::list<IR *> &body, ConstEnv &env, ScopeWrites *own) {
+    for (auto it = body.begin(); it != body.end(); ++it) {
+        if (!isa<Expression>(*it)) {
+            propagate_stmt(*it, env);
+            continue;
+        }
+        auto e = static_cast<Expression *>(*it);
+        auto be = dyn_cast<BinaryExpr>(e);
+        if (own && be && be->get_op().get_kind() == OperatorKind::OP_SET && isa<Variable>(be->get_left())
+                && !dyn_cast<Variable>(be->get_left())->is_non_local()) {
+            // Assignment directly in the scope's body is always run before
+            // the code following it
+            be->set_right(propagate(be->get_right(), env, false));
+            auto name = be->get_left()->get_name();
+            if (be->get_right()->is_constant() && !own->unknown && own->count(name) == 1
+                    && !writes.is_non_local(name)) {
+                env[name] = be->get_right();
+            }
+            continue;
+        }
+        // Value of an expression statement is only output
+        *it = propagate(e, env, true);
+    }
+}
+
+void ConstantPropagationPass::propagate_stmt(IR *ir, ConstEnv &env) {
+    if (auto i = dyn_cast<If>(ir)) {
+        i->set_cond(propagate(i->get_cond(), env, true));
+        propagate_body(i->get_body(), env, nullptr);
+        if (i->get_else())
+            propagate_body(i->get_else()->get_body(), env, nullptr);
+    } else if (auto swt = dyn_cast<Switch>(ir)) {
+        swt->set_cond(propagate(swt->get_cond(), env, true));
+        for (auto c: swt->get_body()) {
+            auto cs = dyn_cast<Case>(c);
+            assert(cs && "Switch body is not a case");
+            for (auto &v: cs->get_values())
+                v = propagate(v, env, true);
+            propagate_body(cs->get_body(), env, nullptr);
+        }
+    } else if (auto tr = dyn_cast<Try>(ir)) {
+        propagate_body(tr->get_body(), env, nullptr);
+        for (auto c: tr->get_catches())
+            propagate_body(c->get_body(), env, nullptr);
+        if (tr->get_finally())
+            propagate_body(tr->get_finally()->get_body(), env, nullptr);
+    } else if (auto whl = dyn_cast<While>(ir)) {
+        whl->set_cond(propagate(whl->get_cond(), env, true));
+        propagate_body(whl->get_body(), env, nullptr);
+    } else if (auto dwhl = dyn_cast<DoWhile>(ir)) {
+        propagate_body(dwhl->get_body(), env, nullptr);
+        dwhl->set_cond(propagate(dwhl->get_cond(), env, true));
+    } else if (auto frl = dyn_cast<ForLoop>(ir)) {
+        frl->set_collection(propagate(frl->get_collection(), env, false));
+        propagate_body(frl->get_body(), env, nullptr);
+    } else if (auto ret = dyn_cast<Return>(ir)) {
+        ret->set_expr(propagate(ret->get_expr(), env, false));
+    } else if (auto rs = dyn_cast<Raise>(ir)) {
+        rs->set_exception(propagate(rs->get_exception(), env, false));
+    } else if (auto asr = dyn_cast<Assert>(ir)) {
+        asr->set_cond(propagate(asr->get_cond(), env, true));
+        if (asr->get_msg())
+            asr->set_msg(propagate(asr->get_msg(), env, false));
+    } else if (auto fun = dyn_cast<Function>(ir)) {
+        processed.insert(fun);
+        auto fenv = nested_env(fun, env);
+        propagate_args(fun->get_args(), fenv);
+        propagate_body(fun->get_body(), fenv, &writes.get(fun));
+    } else if (auto cls = dyn_cast<Class>(ir)) {
+        // Class and space attributes can be changed from outside, so their
+        // own values are not propagated
+        processed.insert(cls);
+        auto cenv = nested_env(cls, env);
+        propagate_body(cls->get_body(), cenv, nullptr);
+    } else if (auto spc = dyn_cast<Space>(ir)) {
+        processed.insert(spc);
+        auto senv = nested_env(spc, env);
+        propagate_body(spc->get_body(), senv, nullptr);
+    }
+}
+
+void ConstantPropagationPass::propagate_root(IR *root, std::list<IR *> &body, std::vector<Argument *> *args, bool own_constants) {
+    writes.clear();
+    processed.clear();
+    propagated = 0;
+
+    writes.collect(root, args, body);
+    ConstEnv env;
+    propagate_body(body, env, own_constants ? &writes.get(root) : nullptr);
+    stats.changes += propagated;
+    LOG2("Propagated " << propagated << " constants in " << root->get_name());
+}
+
+IR *ConstantPropagationPass::visit(Module &mod) {
+    // Later REPL lines or streamed chunks might overwrite module's variables
+    propagate_root(&mod, mod.get_body(), nullptr, parser.is_whole_module());
+    return &mod;
+}
+
+IR *ConstantPropagationPass::visit(Space &spc) {
+    if (processed.erase(&spc))
+        return &spc;
+    propagate_root(&spc, spc.get_body(), nullptr, false);
+    return &spc;
+}
+
+IR *ConstantPropagationPass::visit(Class &cls) {
+    if (processed.erase(&cls))
+        return &cls;
+    propagate_root(&cls, cls.get_body(), nullptr, false);
+    return &cls;
+}
+
+IR *ConstantPropagationPass::visit(Function &fun) {
+    if (processed.erase(&fun))
+        return &fun;
+    propagate_root(&fun, fun.get_body(), &fun.get_args(), true);
+    return &fun;
+}
@@ -0,0 +1,67 @@
+///
+/// \file constant_propagation.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Constant propagation pass.
+///
+
+#ifndef _CONSTANT_PROPAGATION_HPP_
+#define _CONSTANT_PROPAGATION_HPP_
+
+#include "ir.hpp"
+#include "ir_visitor.hpp"
+#include "constant_folding.hpp"
+#include "analysis/name_writes.hpp"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace moss {
+namespace ir {
+
+/// \brief Propagates constants assigned into variables to their uses.
+/// Variable is replaced by its value after a statement directly in module
+/// or function body assigns it a constant, when it is not written anywhere
+/// else in the scope (nested functions and classes included) nor by `$` or
+/// `::` assignment. Names are looked up through all the frames on the stack,
+/// so for module variables any write in the whole module disqualifies them.
+/// Floats, strings and big ints are new objects on every load, so they are
+/// propagated only into operands of operators and conditions, not where the
+/// value itself is passed on (its id() would change).
+/// Replaced expressions are folded right away, so that constants can be
+/// propagated further and dead branches depending on them eliminated.
+class ConstantPropagationPass : public IRVisitor {
+private:
+    using ScopeWrites = NameWrites::ScopeWrites;
+    using ConstEnv = std::unordered_map<ustring, Expression *>;
+
+    ConstantFoldingPass folder;
+    NameWrites writes;
+    /// Scopes handled as part of an outer one, which the pass manager visits
+    /// afterwards
+    std::unordered_set<IR *> processed;
+    unsigned propagated;
+
+    ConstEnv nested_env(IR *scope, ConstEnv &env);
+    /// \param operand true if the expression's value is only used by an
+    ///        operator, so its identity cannot be observed
+    Expression *propagate(Expression *e, ConstEnv &env, bool operand);
+    void propagate_body(std::list<IR *> &body, ConstEnv &env, ScopeWrites *own);
+    void propagate_stmt(IR *ir, ConstEnv &env);
+    void propagate_args(std::vector<Argument *> &args, ConstEnv &env);
+    void propagate_root(IR *root, std::list<IR *> &body, std::vector<Argument *> *args, bool own_constants);
+public:
+    ConstantPropagationPass(Parser &parser) : IRVisitor(parser), folder(parser), propagated(0) {}
+    virtual const char *get_name() const override { return "ConstantPropagation"; }
+
+    virtual IR *visit(class Module &mod) override;
+    virtual IR *visit(class Space &spc) override;
+    virtual IR *visit(class Class &cls) override;
+    virtual IR *visit(class Function &fun) override;
+};
+
+}
+}
+
+#endif//_CONSTANT_PROPAGATION_HPP_
\ No newline at end of file
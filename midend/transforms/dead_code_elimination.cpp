@@ -21,6 +21,7 @@ IR *DeadCodeEliminationPass::visit(Function &fun) {
         if (isa<ir::Return>(*it)) {
             // We found return, delete all IR after it in this block, if there
             // are any.
+            stats.changes += std::distance(std::next(it), body.end());
             body.erase(std::next(it), body.end());
             break;
         }
@@ -28,59 +29,62 @@ IR *DeadCodeEliminationPass::visit(Function &fun) {
     return &fun;
 }
 
-static void eliminate_code_after_break_continue(std::list<IR *>& body) {
+/// \return Amount of removed declarations
+static unsigned long eliminate_code_after_break_continue(std::list<IR *>& body) {
     for (auto it = body.begin(); it != body.end(); ++it) {
         if (isa<ir::Break>(*it) || isa<ir::Continue>(*it)) {
             // We found break/continue, delete all IR after it in this block,
             // if there are any.
+            unsigned long removed = std::distance(std::next(it), body.end());
             body.erase(std::next(it), body.end());
-            break;
+            return removed;
         }
     }
+    return 0;
 }
 
 IR *DeadCodeEliminationPass::visit(ForLoop &fl) {
-    eliminate_code_after_break_continue(fl.get_body());
+    stats.changes += eliminate_code_after_break_continue(fl.get_body());
     return &fl;
 }
 
 IR *DeadCodeEliminationPass::visit(While &whl) {
-    eliminate_code_after_break_continue(whl.get_body());
+    stats.changes += eliminate_code_after_break_continue(whl.get_body());
     return &whl;
 }
 
 IR *DeadCodeEliminationPass::visit(DoWhile &whl) {
-    eliminate_code_after_break_continue(whl.get_body());
+    stats.changes += eliminate_code_after_break_continue(whl.get_body());
     return &whl;
 }
 
 IR *DeadCodeEliminationPass::visit(If &i) {
-    eliminate_code_after_break_continue(i.get_body());
+    stats.changes += eliminate_code_after_break_continue(i.get_body());
     return &i;
 }
 
 IR *DeadCodeEliminationPass::visit(Else &e) {
-    eliminate_code_after_break_continue(e.get_body());
+    stats.changes += eliminate_code_after_break_continue(e.get_body());
     return &e;
 }
 
 IR *DeadCodeEliminationPass::visit(Case &c) {
-    eliminate_code_after_break_continue(c.get_body());
+    stats.changes += eliminate_code_after_break_continue(c.get_body());
     return &c;
 }
 
 IR *DeadCodeEliminationPass::visit(Catch &c) {
-    eliminate_code_after_break_continue(c.get_body());
+    stats.changes += eliminate_code_after_break_continue(c.get_body());
     return &c;
 }
 
 IR *DeadCodeEliminationPass::visit(Finally &f) {
-    eliminate_code_after_break_continue(f.get_body());
+    stats.changes += eliminate_code_after_break_continue(f.get_body());
     return &f;
 }
 
 IR *DeadCodeEliminationPass::visit(Try &t) {
-    eliminate_code_after_break_continue(t.get_body());
+    stats.changes += eliminate_code_after_break_continue(t.get_body());
     return &t;
 }
 
@@ -101,6 +105,7 @@ IR *DeadBranchEliminationPass::visit(If &i) {
         if (auto e = i.get_else()) {
             delete e;
             i.set_else(nullptr);
+            ++stats.changes;
         }
     } else {
         // if (false) -> delete if, but keep else
@@ -117,6 +122,7 @@ IR *DeadBranchEliminationPass::visit(If &i) {
             i.move_body(std::move(else_body));
             i.set_else(nullptr);
             delete e;
+            ++stats.changes;
         }
     }
 
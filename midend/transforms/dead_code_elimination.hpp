@@ -22,6 +22,7 @@ namespace ir {
 class DeadCodeEliminationPass : public IRVisitor {
 public:
     DeadCodeEliminationPass(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "DeadCodeElimination"; }
     
     virtual IR *visit(class Function &fun) override;
     virtual IR *visit(class ForLoop &fl) override;
@@ -43,6 +44,7 @@ public:
 class DeadBranchEliminationPass : public IRVisitor {
 public:
     DeadBranchEliminationPass(Parser &parser) : IRVisitor(parser) {}
+    virtual const char *get_name() const override { return "DeadBranchElimination"; }
     
     virtual IR *visit(class While &whl) override;
     // TODO: DoWhile where if false just the block is kept.
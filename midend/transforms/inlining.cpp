@@ -0,0 +1,207 @@
+#include "inlining.hpp"
+#include "analysis/function_analyzer.hpp"
+#include "parser.hpp"
+#include "ir.hpp"
+#include "logging.hpp"
+#include "utils.hpp"
+
+using namespace moss;
+using namespace ir;
+
+/// \return Argument's default value as it is dumped in the stack trace
+static ustring default_as_string(Expression *c) {
+    switch (c->get_type()) {
+        case IRType::INT_LITERAL: return std::to_string(dyn_cast<IntLiteral>(c)->get_value());
+        case IRType::FLOAT_LITERAL: return std::to_string(dyn_cast<FloatLiteral>(c)->get_value());
+        case IRType::BOOL_LITERAL: return dyn_cast<BoolLiteral>(c)->get_value() ? "true" : "false";
+        case IRType::STRING_LITERAL: return "\"" + utils::sanitize(dyn_cast<StringLiteral>(c)->get_value()) + "\"";
+        case IRType::NIL_LITERAL: return "nil";
+        default:
+            assert(false && "Non-constant default value of inlined function");
+            return "";
+    }
+}
+
+void InliningPass::add_callee(IR *decl) {
+    auto body = FunctionAnalyzer::get_inlinable_body(*decl, max_size);
+    if (!body)
+        return;
+    // Function has to be the only value its name can have
+    auto name = decl->get_name();
+    if (writes.get(module).count(name) != 1 || writes.is_non_local(name))
+        return;
+    auto args = isa<Function>(decl) ? &dyn_cast<Function>(decl)->get_args() : &dyn_cast<Lambda>(decl)->get_args();
+    ustring args_str;
+    for (auto a: *args) {
+        if (!args_str.empty())
+            args_str += ", ";
+        args_str += a->get_name();
+        if (a->has_default_value())
+            args_str += "=" + default_as_string(a->get_default_value());
+    }
+    callees[name] = Callee{args, body, args_str};
+}
+
+Expression *InliningPass::clone(Expression *e, std::unordered_map<ustring, Expression *> &args, std::unordered_set<ustring> &used) {
+    if (!e)
+        return nullptr;
+    auto src_info = e->get_src_info();
+    switch (e->get_type()) {
+        case IRType::INT_LITERAL: return new IntLiteral(dyn_cast<IntLiteral>(e)->get_value(), src_info);
+        case IRType::FLOAT_LITERAL: return new FloatLiteral(dyn_cast<FloatLiteral>(e)->get_value(), src_info);
+        case IRType::BOOL_LITERAL: return new BoolLiteral(dyn_cast<BoolLiteral>(e)->get_value(), src_info);
+        case IRType::STRING_LITERAL: return new StringLiteral(dyn_cast<StringLiteral>(e)->get_value(), src_info);
+        case IRType::NIL_LITERAL: return new NilLiteral(src_info);
+        default: break;
+    }
+    if (auto v = dyn_cast<Variable>(e)) {
+        auto a = args.find(v->get_name());
+        if (a == args.end())
+            return new Variable(v->get_name(), src_info, v->is_non_local());
+        used.insert(a->first);
+        std::unordered_map<ustring, Expression *> no_args;
+        return clone(a->second, no_args, used);
+    }
+    if (auto be = dyn_cast<BinaryExpr>(e)) {
+        Expression *right = nullptr;
+        if (be->get_op().get_kind() == OperatorKind::OP_ACCESS) {
+            // Attribute name is not an argument
+            std::unordered_map<ustring, Expression *> no_args;
+            right = clone(be->get_right(), no_args, used);
+        } else {
+            right = clone(be->get_right(), args, used);
+        }
+        return new BinaryExpr(clone(be->get_left(), args, used), right, be->get_op(), src_info);
+    }
+    if (auto ue = dyn_cast<UnaryExpr>(e))
+        return new UnaryExpr(clone(ue->get_expr(), args, used), ue->get_op(), src_info);
+    if (auto cl = dyn_cast<Call>(e)) {
+        std::vector<Expression *> call_args;
+        for (auto a: cl->get_args()) {
+            auto be = dyn_cast<BinaryExpr>(a);
+            if (be && be->get_op().get_kind() == OperatorKind::OP_SET) {
+                // Named argument's name is not an argument of the callee
+                auto name = be->get_left();
+                call_args.push_back(new BinaryExpr(new Variable(name->get_name(), name->get_src_info()),
+                    clone(be->get_right(), args, used), be->get_op(), a->get_src_info()));
+            } else {
+                call_args.push_back(clone(a, args, used));
+            }
+        }
+        auto new_cl = new Call(clone(cl->get_fun(), args, used), call_args, src_info);
+        cloned_calls.insert(new_cl);
+        return new_cl;
+    }
+    if (auto ic = dyn_cast<InlinedCall>(e))
+        return new InlinedCall(ic->get_name(), ic->get_args_str(), clone(ic->get_body(), args, used), src_info);
+    if (auto ti = dyn_cast<TernaryIf>(e))
+        return new TernaryIf(clone(ti->get_condition(), args, used), clone(ti->get_value_true(), args, used),
+            clone(ti->get_value_false(), args, used), src_info);
+    if (auto r = dyn_cast<Range>(e))
+        return new Range(clone(r->get_start(), args, used), clone(r->get_end(), args, used),
+            clone(r->get_second(), args, used), src_info);
+    if (auto lst = dyn_cast<List>(e)) {
+        std::vector<Expression *> values;
+        for (auto v: lst->get_value())
+            values.push_back(clone(v, args, used));
+        return new List(values, src_info);
+    }
+    if (auto dct = dyn_cast<Dict>(e)) {
+        std::vector<Expression *> keys;
+        std::vector<Expression *> values;
+        for (auto k: dct->get_keys())
+            keys.push_back(clone(k, args, used));
+        for (auto v: dct->get_values())
+            values.push_back(clone(v, args, used));
+        return new Dict(keys, values, src_info);
+    }
+    assert(false && "Cloning expression which cannot be inlined");
+    return nullptr;
+}
+
+IR *InliningPass::visit(Call &cl) {
+    if (!module || cloned_calls.find(&cl) != cloned_calls.end())
+        return &cl;
+    auto fun = dyn_cast<Variable>(cl.get_fun());
+    if (!fun || fun->is_non_local())
+        return &cl;
+    auto c = callees.find(fun->get_name());
+    if (c == callees.end())
+        return &cl;
+    auto &callee = c->second;
+    auto &params = *callee.args;
+
+    // Bind call's arguments to the parameters
+    std::vector<Expression *> bound(params.size(), nullptr);
+    size_t position = 0;
+    for (auto a: cl.get_args()) {
+        size_t index = 0;
+        Expression *value = a;
+        auto be = dyn_cast<BinaryExpr>(a);
+        if (be && be->get_op().get_kind() == OperatorKind::OP_SET) {
+            auto name = be->get_left()->get_name();
+            while (index < params.size() && params[index]->get_name() != name)
+                ++index;
+            value = be->get_right();
+        } else {
+            index = position++;
+        }
+        // Incorrect calls are left to raise in runtime
+        if (index >= params.size() || bound[index])
+            return &cl;
+        // Argument is evaluated only once the body uses it
+        auto v = dyn_cast<Variable>(value);
+        if (!value->is_constant() && (!v || v->is_non_local() || writes.is_non_local(v->get_name())))
+            return &cl;
+        bound[index] = value;
+    }
+    std::unordered_map<ustring, Expression *> args;
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (!bound[i]) {
+            if (!params[i]->has_default_value())
+                return &cl;
+            bound[i] = params[i]->get_default_value();
+        }
+        args[params[i]->get_name()] = bound[i];
+    }
+
+    std::unordered_set<ustring> used;
+    auto body = clone(callee.body, args, used);
+    for (size_t i = 0; i < params.size(); ++i) {
+        // Unused variable would not raise if it does not exist
+        if (isa<Variable>(bound[i]) && used.find(params[i]->get_name()) == used.end()) {
+            delete body;
+            return &cl;
+        }
+    }
+    ++inlined;
+    return new InlinedCall(fun->get_name(), callee.args_str, body, cl.get_src_info());
+}
+
+IR *InliningPass::visit(Module &mod) {
+    // Later REPL lines or streamed chunks might redefine the functions
+    if (!parser.is_whole_module())
+        return &mod;
+    writes.clear();
+    writes.collect(&mod, nullptr, mod.get_body());
+    if (writes.get(&mod).unknown)
+        return &mod;
+
+    callees.clear();
+    cloned_calls.clear();
+    inlined = 0;
+    module = &mod;
+    // Functions are available only to the declarations following them
+    for (auto &decl: mod.get_body()) {
+        auto new_decl = decl->accept(calls_pm);
+        assert(new_decl && "Inlining removed a declaration");
+        if (new_decl != decl) {
+            delete decl;
+            decl = new_decl;
+        }
+        add_callee(decl);
+    }
+    module = nullptr;
+    LOG2("Inlined " << inlined << " calls in " << mod.get_name());
+    return &mod;
+}
@@ -0,0 +1,71 @@
+///
+/// \file inlining.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Function inlining pass.
+///
+
+#ifndef _INLINING_HPP_
+#define _INLINING_HPP_
+
+#include "ir.hpp"
+#include "ir_visitor.hpp"
+#include "analysis/name_writes.hpp"
+#include "analysis/function_analyzer.hpp"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace moss {
+namespace ir {
+
+/// \brief Inlines calls to small functions.
+/// Call to a function or named lambda declared directly in the module body,
+/// which FunctionAnalyzer finds small enough, is replaced by the expression
+/// the function returns with its arguments substituted.
+/// Callee has to be known statically, so its name cannot be written anywhere
+/// else in the module and only calls in code following its declaration are
+/// inlined (this also rules out recursion). Names are looked up through the
+/// caller's frames in both cases, so the body resolves them the same.
+/// Arguments have to be constants or variables not written by `$` or `::`
+/// assignment, so that their value is the same when the body uses them.
+/// Inlined body is wrapped in InlinedCall, which keeps the function in the
+/// stack trace.
+class InliningPass : public IRVisitor {
+private:
+    struct Callee {
+        std::vector<Argument *> *args;
+        Expression *body;
+        ustring args_str;
+    };
+
+    NameWrites writes;
+    /// Visits declarations of the module and calls this pass on their calls
+    PassManager calls_pm;
+    std::unordered_map<ustring, Callee> callees;
+    /// Calls in inlined bodies, these were not inlined when the callee's
+    /// body was visited, so they are not inlined into it now either
+    std::unordered_set<Call *> cloned_calls;
+    IR *module;
+    unsigned inlined;
+    /// Maximum amount of IR nodes in an inlined body
+    unsigned max_size;
+
+    void add_callee(IR *decl);
+    Expression *clone(Expression *e, std::unordered_map<ustring, Expression *> &args, std::unordered_set<ustring> &used);
+public:
+    InliningPass(Parser &parser, unsigned max_size=FunctionAnalyzer::INLINE_MAX_SIZE)
+        : IRVisitor(parser), calls_pm(parser), module(nullptr), inlined(0), max_size(max_size) {
+        calls_pm.add_pass(this);
+    }
+    virtual const char *get_name() const override { return "Inlining"; }
+
+    virtual IR *visit(class Module &mod) override;
+    virtual IR *visit(class Call &cl) override;
+};
+
+}
+}
+
+#endif//_INLINING_HPP_
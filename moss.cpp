@@ -10,6 +10,13 @@
 #include "bytecodegen.hpp"
 #include "bytecode.hpp"
 #include "interpreter.hpp"
+#include "profiler.hpp"
+#include "opcode_stats.hpp"
+#include "pass_stats.hpp"
+#include "gc.hpp"
+#include "snapshot.hpp"
+#include "module_precompiler.hpp"
+#include "note_cache.hpp"
 #include "bytecode_reader.hpp"
 #include "bytecode_writer.hpp"
 #include "opcode.hpp"
@@ -21,6 +28,9 @@
 
 #ifdef __windows__
 #include <Windows.h>
+#else
+#include <pthread.h>
+#include <sys/resource.h>
 #endif
 
 using namespace moss;
@@ -52,28 +62,101 @@ static void report_ir_exception(ir::IR *err, ustring error_name) {
     }
 }
 
-int main(int argc, const char *argv[]) {
-    // On Windows we need to set the output to accept utf8 strings
-#ifdef __windows__
-    // Set console code page to UTF-8 so console known how to interpret string data
-    SetConsoleOutputCP(CP_UTF8);
-    // Enable buffering to prevent VS from chopping up UTF-8 byte sequences
-    setvbuf(stdout, nullptr, _IOFBF, 1000);
-#endif
+/// Number of top level declarations compiled and run at once with --stream
+static constexpr size_t STREAM_CHUNK_DECLS = 16;
 
-    clopts::parse_clopts(argc, argv);
+/// \brief Compiles and runs the main module chunk by chunk
+/// Each chunk's IR is freed once its bytecode is generated and the code is
+/// run before the next chunk is parsed. Names are resolved when run, so
+/// functions and classes from already run chunks are visible to later ones
+/// the same way as in a module compiled at once.
+/// With note cache each chunk is a single cell, which might be replayed
+/// from the cache instead of being run.
+/// Bytecode passes which need the whole module are not run on the chunks.
+static void run_streamed(Interpreter *interpreter, Parser *parser, Bytecode *bc) {
+    bcgen::BytecodeGen cgen(bc);
+    ir::IRPipeline ipl(*parser, clopts::get_opt_level());
+    opcode::BCPipeline pipeline(bc, clopts::get_opt_level(), parser->get_src_file().get_name());
+    auto run = [&](ir::IR *decl) {
+        opcode::Address start = bc->size();
+        try {
+            cgen.generate(decl);
+        } catch (ir::IR *ir_err) {
+            report_ir_exception(ir_err, "SemanticsError");
+        }
+        if (bc->size() > start) {
+            pipeline.run(start, false);
+            module_precompiler::schedule_imports(bc, start);
+        }
+        interpreter->run();
+    };
 
-    if(clopts::get_logging_level() > 0) {
-        // Enable logging
-        Logger::get().set_logging_level(clopts::get_logging_level());
-        Logger::get().set_flags(std::ios_base::boolalpha);
-        Logger::get().set_log_everything(clopts::get_logging_list() == "all");
-        Logger::get().set_enabled(utils::split_csv_set(clopts::get_logging_list()));
+    std::optional<note_cache::CellChain> cells;
+    if (note_cache::is_enabled())
+        cells.emplace();
+    bool eof_reached = false;
+    while (!eof_reached && !global_controls::exit_called) {
+        auto chunk = parser->parse_chunk(cells ? 1 : STREAM_CHUNK_DECLS);
+        if (auto err = ipl.run(chunk)) {
+            chunk = err;
+        }
+        if (auto exc = dyn_cast<ir::Raise>(chunk)) {
+            report_ir_exception(exc, "SyntaxError");
+        }
+        auto mod = dyn_cast<ir::Module>(chunk);
+        assert(mod && "Parsed chunk is not a module");
+        eof_reached = !mod->empty() && isa<ir::EndOfFile>(mod->back());
+        if (!cells) {
+            run(mod);
+            delete mod;
+            continue;
+        }
+
+        // End of file is not part of the cell as it may run main function
+        ir::IR *eof = nullptr;
+        if (eof_reached) {
+            eof = mod->back();
+            mod->get_body().pop_back();
+        }
+        auto cell = cells->next_cell(mod->get_body(), mod->get_documentation(), *parser->get_scanner());
+        if (!cell || !cell->replay()) {
+            if (cell)
+                cell->begin_recording();
+            run(mod);
+            if (cell) {
+                // Output of exited cell is not complete
+                if (global_controls::exit_called)
+                    cell->set_uncacheable();
+                cell->end_recording();
+            }
+        }
+        delete mod;
+        if (eof) {
+            run(eof);
+            delete eof;
+        }
     }
+}
 
-    LOG1("Moss " << MOSS_VERSION);
-    LOG1("Logging enabled with level: " << clopts::get_logging_level());
-    LOG5("Unicode output test (sushi emoji, umlaut u and japanese): " << "🍣 ü ラーメン");
+/// \brief Compiles and runs moss program as set by the command line options
+/// \return Exit code
+static int run_moss() {
+    char stack_base;
+    global_controls::native_stack_base = reinterpret_cast<std::uintptr_t>(&stack_base);
+
+    if (clopts::create_libms_snapshot) {
+        // Main interpreter loads libms and the snapshot is written after its run
+        snapshot::LibmsSnapshot::set_output_path(args::get(clopts::create_libms_snapshot));
+        auto bc = new Bytecode();
+        auto interpreter = new Interpreter(bc, nullptr, true);
+        if (snapshot::LibmsSnapshot::is_creating()) {
+            error::error(error::ErrorCode::FILE_ACCESS, "Snapshot can be created only from libms.msb, which was not found", nullptr, true);
+        }
+        delete interpreter;
+        delete bc;
+        clopts::deinit();
+        return 0;
+    }
 
     bool input_is_msb = false;
     // Check if input is msb
@@ -98,6 +181,11 @@ int main(int argc, const char *argv[]) {
     if (clopts::disable_notes && clopts::print_notes) {
         error::error(error::ErrorCode::ARGUMENT, "Invalid combination of arguments '-q' ('--disable-notes') and '-p' ('--print-notes')", nullptr, true);
     }
+    if ((clopts::stream || clopts::note_cache_dir) && (input_is_msb || clopts::output || clopts::compile_only)) {
+        error::error(error::ErrorCode::ARGUMENT, "Options '--stream' and '--note-cache' can be used only for running moss source code", nullptr, true);
+    }
+    // Note cache runs the module cell by cell
+    bool streamed = clopts::stream || note_cache::is_enabled();
 
     ir::IR *main_mod = nullptr;
     File *input_file = nullptr;
@@ -122,24 +210,27 @@ int main(int argc, const char *argv[]) {
         }
 
         parser = new Parser(*main_file);
-        main_mod = parser->parse();
-        ir::IRPipeline ipl(*parser);
-        if (auto err = ipl.run(main_mod)) {
-            main_mod = err;
-        }
-        if (auto exc = dyn_cast<ir::Raise>(main_mod)) {
-            report_ir_exception(exc, "SyntaxError");
-        }
+        // Streamed module is parsed while it runs
+        if (!streamed) {
+            main_mod = parser->parse();
+            ir::IRPipeline ipl(*parser, clopts::get_opt_level());
+            if (auto err = ipl.run(main_mod)) {
+                main_mod = err;
+            }
+            if (auto exc = dyn_cast<ir::Raise>(main_mod)) {
+                report_ir_exception(exc, "SyntaxError");
+            }
 
 #ifndef NDEBUG
-        // When --parse-only is set, then let's not interpret this
-        if (clopts::parse_only) {
-            delete main_mod;
-            clopts::deinit();
-            return 0;
-        }
+            // When --parse-only is set, then let's not interpret this
+            if (clopts::parse_only) {
+                delete main_mod;
+                clopts::deinit();
+                return 0;
+            }
 #endif
-        LOG3("Parsed: " << *main_mod);
+            LOG3("Parsed: " << *main_mod);
+        }
     }
 
     Bytecode *bc = nullptr;
@@ -165,7 +256,7 @@ int main(int argc, const char *argv[]) {
             clopts::deinit();
             return 0;
         }
-    } else {
+    } else if (!streamed) {
         bc = new Bytecode();
         bcgen::BytecodeGen cgen(bc);
         try {
@@ -174,13 +265,19 @@ int main(int argc, const char *argv[]) {
         } catch (ir::IR *ir_err) {
             report_ir_exception(ir_err, "SemanticsError");
         }
+    } else {
+        bc = new Bytecode();
     }
 
-    opcode::BCPipeline pipeline(bc, opcode::O1Pipeline);
-    pipeline.run();
+    if (!streamed) {
+        opcode::BCPipeline pipeline(bc, clopts::get_opt_level(), input_file->get_name());
+        pipeline.run();
 
-    if (parser != nullptr)
+        // IR is allocated in the parser's arena, so it goes with it
+        delete main_mod;
         delete parser;
+        parser = nullptr;
+    }
 
     // If options were correct info would be printed and exited already
     if (clopts::print_bc_info) {
@@ -207,10 +304,19 @@ int main(int argc, const char *argv[]) {
     int exit_code = 0;
     // Interpretation
     if (!clopts::compile_only) {
+        // Imports are compiled in the background while libms loads and
+        // the main module runs
+        module_precompiler::schedule_imports(bc);
         Interpreter *interpreter = new Interpreter(bc, input_file, true);
 
+        if (clopts::profile)
+            profiler::start(args::get(clopts::profile));
+
         try {
-            interpreter->run();
+            if (streamed)
+                run_streamed(interpreter, parser, bc);
+            else
+                interpreter->run();
         } catch (Value *v) {
             if (v->get_type() == BuiltIns::SystemExit) {
                 auto se = dyn_cast<ObjectValue>(v);
@@ -242,6 +348,12 @@ int main(int argc, const char *argv[]) {
             }
         }
 
+        profiler::stop();
+        if (clopts::opcode_stats)
+            opstats::report(errs);
+        if (clopts::gc_stats)
+            gcs::TracingGC::report_stats(errs);
+
         mslib::deinitialize_modules();
 
         LOGMAX(*interpreter);
@@ -250,10 +362,13 @@ int main(int argc, const char *argv[]) {
         delete interpreter;
     }
 
+    if (clopts::time_passes)
+        passstats::report(errs);
+
     // Cleanup
+    delete parser;
     delete bc;
     delete input_file;
-    delete main_mod;
 
     if (clopts::delete_values_on_exit) {
         for (auto v: Value::all_values) {
@@ -273,4 +388,84 @@ int main(int argc, const char *argv[]) {
 #endif
 
     return exit_code;
+}
+
+/// \return Size of the main thread's native stack or 0 if it is not known
+static size_t get_main_stack_size() {
+#ifdef __windows__
+    // Default stack reserve of an executable
+    return 1024 * 1024;
+#else
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_STACK, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY)
+        return 0;
+    return static_cast<size_t>(rl.rlim_cur);
+#endif
+}
+
+/// \brief Runs moss on a new thread with native stack of given size
+/// Stack memory is only reserved and its pages are committed once the
+/// recursion reaches them.
+/// \return Exit code
+static int run_on_stack(size_t size) {
+    int exit_code = 0;
+#ifdef __windows__
+    auto thread = CreateThread(nullptr, size, [](LPVOID arg) -> DWORD {
+        *static_cast<int *>(arg) = run_moss();
+        return 0;
+    }, &exit_code, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+    if (!thread)
+        error::error(error::ErrorCode::INTERNAL, "Could not create thread with requested stack size", nullptr, true);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    if (pthread_attr_setstacksize(&attr, size) != 0 ||
+            pthread_create(&thread, &attr, [](void *arg) -> void * {
+                *static_cast<int *>(arg) = run_moss();
+                return nullptr;
+            }, &exit_code) != 0) {
+        error::error(error::ErrorCode::INTERNAL, "Could not create thread with requested stack size", nullptr, true);
+    }
+    pthread_attr_destroy(&attr);
+    pthread_join(thread, nullptr);
+#endif
+    return exit_code;
+}
+
+int main(int argc, const char *argv[]) {
+    // On Windows we need to set the output to accept utf8 strings
+#ifdef __windows__
+    // Set console code page to UTF-8 so console known how to interpret string data
+    SetConsoleOutputCP(CP_UTF8);
+    // Enable buffering to prevent VS from chopping up UTF-8 byte sequences
+    setvbuf(stdout, nullptr, _IOFBF, 1000);
+#endif
+
+    clopts::parse_clopts(argc, argv);
+
+    if(clopts::get_logging_level() > 0) {
+        // Enable logging
+        Logger::get().set_logging_level(clopts::get_logging_level());
+        Logger::get().set_flags(std::ios_base::boolalpha);
+        Logger::get().set_log_everything(clopts::get_logging_list() == "all");
+        Logger::get().set_enabled(utils::split_csv_set(clopts::get_logging_list()));
+    }
+
+    LOG1("Moss " << MOSS_VERSION);
+    LOG1("Logging enabled with level: " << clopts::get_logging_level());
+    LOG5("Unicode output test (sushi emoji, umlaut u and japanese): " << "🍣 ü ラーメン");
+
+    // Quarter of the stack is left for native code run between the depth
+    // checks of nested interpreter runs
+    if (clopts::stack_size) {
+        size_t size = static_cast<size_t>(args::get(clopts::stack_size)) * 1024 * 1024;
+        global_controls::native_stack_size = size - size / 4;
+        return run_on_stack(size);
+    }
+    auto size = get_main_stack_size();
+    global_controls::native_stack_size = size - size / 4;
+    return run_moss();
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include "microbench_utils.hpp"
+#include "bytecode.hpp"
+#include "bytecodegen.hpp"
+#include "bytecode_reader.hpp"
+#include "bytecode_writer.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+using namespace moss;
+using namespace microbench;
+
+static Bytecode *generate_bytecode(unsigned units) {
+    SourceFile sf(generate_source(units), SourceFile::SourceType::STRING);
+    Parser parser(sf);
+    auto mod = parser.parse();
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    cgen.generate(mod);
+    delete mod;
+    return bc;
+}
+
+static ustring bench_file_path() {
+    return (std::filesystem::temp_directory_path() / "moss_microbench.msb").string();
+}
+
+/// Writes bytecode of generated source with range(0) functions and classes
+static void BM_BytecodeWriterWrite(benchmark::State &state) {
+    auto bc = generate_bytecode(state.range(0));
+    auto path = bench_file_path();
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        BytecodeFile bf(path);
+        BytecodeWriter writer(bf);
+        writer.write(bc);
+    }
+    state.SetItemsProcessed(state.iterations() * bc->size());
+    std::remove(path.c_str());
+    delete bc;
+}
+BENCHMARK(BM_BytecodeWriterWrite)->Arg(10)->Arg(200);
+
+static void BM_BytecodeReaderRead(benchmark::State &state) {
+    auto bc = generate_bytecode(state.range(0));
+    auto path = bench_file_path();
+    {
+        BytecodeFile bf(path);
+        BytecodeWriter writer(bf);
+        writer.write(bc);
+    }
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        BytecodeFile bf(path);
+        BytecodeReader reader(bf);
+        auto read_bc = reader.read();
+        benchmark::DoNotOptimize(read_bc);
+        ac.pause();
+        delete read_bc;
+        ac.resume();
+    }
+    state.SetItemsProcessed(state.iterations() * bc->size());
+    std::remove(path.c_str());
+    delete bc;
+}
+BENCHMARK(BM_BytecodeReaderRead)->Arg(10)->Arg(200);
+
+}
@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include "microbench_utils.hpp"
+#include "scanner.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+
+namespace {
+
+using namespace moss;
+using namespace microbench;
+
+/// Tokenization of generated source with range(0) functions and classes
+static void BM_ScannerTokenize(benchmark::State &state) {
+    ustring code = generate_source(state.range(0));
+    size_t tokens = 0;
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        SourceFile sf(code, SourceFile::SourceType::STRING);
+        Scanner scanner(sf);
+        Token *t = scanner.next_token();
+        while (t->get_type() != TokenType::END_OF_FILE) {
+            ++tokens;
+            delete t;
+            t = scanner.next_token();
+        }
+        delete t;
+    }
+    state.SetBytesProcessed(state.iterations() * code.size());
+    state.counters["tokens"] = benchmark::Counter(static_cast<double>(tokens), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ScannerTokenize)->Arg(10)->Arg(200);
+
+static void BM_ParserParse(benchmark::State &state) {
+    ustring code = generate_source(state.range(0));
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        SourceFile sf(code, SourceFile::SourceType::STRING);
+        Parser parser(sf);
+        auto mod = parser.parse();
+        benchmark::DoNotOptimize(mod);
+        ac.pause();
+        delete mod;
+        ac.resume();
+    }
+    state.SetBytesProcessed(state.iterations() * code.size());
+}
+BENCHMARK(BM_ParserParse)->Arg(10)->Arg(200);
+
+}
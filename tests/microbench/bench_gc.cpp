@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+#include "microbench_utils.hpp"
+#include "values.hpp"
+#include "interpreter.hpp"
+#include "gc.hpp"
+
+namespace {
+
+using namespace moss;
+using namespace microbench;
+
+constexpr opcode::Register REG_LIVE = 20'000;
+
+/// Collection of a synthetic heap
+/// range(0) values are reachable from a global register (in lists of 100
+/// values) and range(1) unreachable values are allocated before each run.
+static void BM_TracingGCCollectGarbage(benchmark::State &state) {
+    auto vm = get_vm();
+    auto live = state.range(0);
+    auto garbage = state.range(1);
+
+    auto root = new ListValue();
+    for (int64_t i = 0; i < live; i += 100) {
+        auto chunk = new ListValue();
+        for (int64_t j = i; j < i + 100 && j < live; ++j)
+            chunk->push(FloatValue::get(static_cast<opcode::FloatConst>(j)));
+        root->push(chunk);
+    }
+    vm->store(REG_LIVE, root);
+
+    auto freed_before = gcs::TracingGC::get_stats().freed_values;
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        ac.pause();
+        for (int64_t i = 0; i < garbage; ++i)
+            benchmark::DoNotOptimize(IntValue::get(1000 + i));
+        ac.resume();
+        vm->collect_garbage();
+    }
+    state.SetItemsProcessed(state.iterations() * (live + garbage));
+    auto freed = gcs::TracingGC::get_stats().freed_values - freed_before;
+    state.counters["freed/op"] = benchmark::Counter(static_cast<double>(freed), benchmark::Counter::kAvgIterations);
+
+    vm->store(REG_LIVE, BuiltIns::Nil);
+    vm->collect_garbage();
+}
+BENCHMARK(BM_TracingGCCollectGarbage)
+    ->Args({1'000, 1'000})
+    ->Args({100'000, 1'000})
+    ->Args({1'000, 100'000})
+    ->Unit(benchmark::kMicrosecond);
+
+}
@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include "microbench_utils.hpp"
+#include "memory.hpp"
+#include "values.hpp"
+#include "interpreter.hpp"
+
+namespace {
+
+using namespace moss;
+using namespace microbench;
+
+/// Stores into range(0) registers of a pool
+static void BM_MemoryPoolStore(benchmark::State &state) {
+    auto regs = static_cast<opcode::Register>(state.range(0));
+    MemoryPool pool(get_vm());
+    Value *v = IntValue::get(42);
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        for (opcode::Register r = 0; r < regs; ++r)
+            pool.store(r, v);
+    }
+    state.SetItemsProcessed(state.iterations() * regs);
+}
+BENCHMARK(BM_MemoryPoolStore)->Arg(16)->Arg(256)->Arg(4096);
+
+static void BM_MemoryPoolLoad(benchmark::State &state) {
+    auto regs = static_cast<opcode::Register>(state.range(0));
+    MemoryPool pool(get_vm());
+    for (opcode::Register r = 0; r < regs; ++r)
+        pool.store(r, IntValue::get(r % 256));
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        for (opcode::Register r = 0; r < regs; ++r)
+            benchmark::DoNotOptimize(pool.load(r));
+    }
+    state.SetItemsProcessed(state.iterations() * regs);
+}
+BENCHMARK(BM_MemoryPoolLoad)->Arg(16)->Arg(256)->Arg(4096);
+
+/// Name is in the pool's symbol table
+static void BM_MemoryPoolLoadName(benchmark::State &state) {
+    auto vm = get_vm();
+    MemoryPool pool(vm);
+    for (opcode::Register r = 0; r < 64; ++r) {
+        pool.store(r, IntValue::get(r));
+        pool.store_name(r, "variable_name_" + std::to_string(r));
+    }
+    ustring name = "variable_name_42";
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pool.load_name(name, vm));
+    }
+}
+BENCHMARK(BM_MemoryPoolLoadName);
+
+/// Name is not in the frame, so spilled values (libms) are searched
+static void BM_MemoryPoolLoadNameSpilled(benchmark::State &state) {
+    auto vm = get_vm();
+    auto gf = vm->get_global_frame();
+    ustring name = "print";
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(gf->load_name(name, vm));
+    }
+}
+BENCHMARK(BM_MemoryPoolLoadNameSpilled);
+
+}
@@ -0,0 +1,144 @@
+#include <benchmark/benchmark.h>
+#include "microbench_utils.hpp"
+#include "values.hpp"
+#include "interpreter.hpp"
+#include "opcode.hpp"
+
+namespace {
+
+using namespace moss;
+using namespace microbench;
+
+/// Registers in the global frame of the shared interpreter used by opcodes
+constexpr opcode::Register REG_DST = 10'000;
+constexpr opcode::Register REG_SRC1 = 10'001;
+constexpr opcode::Register REG_SRC2 = 10'002;
+
+/// Interned value, no allocation should happen
+static void BM_IntValueGetInterned(benchmark::State &state) {
+    opcode::IntConst i = 0;
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(IntValue::get(i++ & 0xFF));
+    }
+}
+BENCHMARK(BM_IntValueGetInterned);
+
+static void BM_IntValueGet(benchmark::State &state) {
+    opcode::IntConst i = 1000;
+    AllocCounter ac(state);
+    ValueBatch batch(ac);
+    for (auto _ : state) {
+        batch.push(IntValue::get(i++));
+    }
+}
+BENCHMARK(BM_IntValueGet);
+
+static void BM_FloatValueGet(benchmark::State &state) {
+    opcode::FloatConst f = 0.5;
+    AllocCounter ac(state);
+    ValueBatch batch(ac);
+    for (auto _ : state) {
+        batch.push(FloatValue::get(f));
+        f += 1.0;
+    }
+}
+BENCHMARK(BM_FloatValueGet);
+
+/// Creates a dict and pushes range(0) Int keys into it
+static void BM_DictValuePush(benchmark::State &state) {
+    auto vm = get_vm();
+    auto items = state.range(0);
+    std::vector<Value *> keys;
+    for (int64_t i = 0; i < items; ++i)
+        keys.push_back(IntValue::get(i * 7919));
+    AllocCounter ac(state);
+    ValueBatch batch(ac);
+    for (auto _ : state) {
+        auto d = new DictValue();
+        for (auto k: keys)
+            d->push(k, k, vm);
+        batch.push(d);
+    }
+    state.SetItemsProcessed(state.iterations() * items);
+}
+BENCHMARK(BM_DictValuePush)->Arg(8)->Arg(1024);
+
+/// Lookup of a String key in a dict of range(0) items with SUBSC opcode
+static void BM_DictValueLookup(benchmark::State &state) {
+    auto vm = get_vm();
+    auto items = state.range(0);
+    auto d = new DictValue();
+    for (int64_t i = 0; i < items; ++i)
+        d->push(StringValue::get("key_" + std::to_string(i)), IntValue::get(i), vm);
+    vm->store(REG_SRC1, d);
+    vm->store(REG_SRC2, StringValue::get("key_" + std::to_string(items / 2)));
+    opcode::Subsc subsc(REG_DST, REG_SRC1, REG_SRC2);
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        subsc.exec(vm);
+    }
+}
+BENCHMARK(BM_DictValueLookup)->Arg(8)->Arg(1024);
+
+/// Appends range(0) values into a new list
+static void BM_ListValueAppend(benchmark::State &state) {
+    auto items = state.range(0);
+    Value *v = IntValue::get(42);
+    AllocCounter ac(state);
+    ValueBatch batch(ac);
+    for (auto _ : state) {
+        auto l = new ListValue();
+        for (int64_t i = 0; i < items; ++i)
+            l->push(v);
+        batch.push(l);
+    }
+    state.SetItemsProcessed(state.iterations() * items);
+}
+BENCHMARK(BM_ListValueAppend)->Arg(8)->Arg(1024);
+
+/// Subscript of a list with Int index with SUBSC opcode
+static void BM_ListValueSubscript(benchmark::State &state) {
+    auto vm = get_vm();
+    auto l = new ListValue();
+    for (int64_t i = 0; i < 1024; ++i)
+        l->push(IntValue::get(i));
+    vm->store(REG_SRC1, l);
+    vm->store(REG_SRC2, IntValue::get(100));
+    opcode::Subsc subsc(REG_DST, REG_SRC1, REG_SRC2);
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        subsc.exec(vm);
+    }
+}
+BENCHMARK(BM_ListValueSubscript);
+
+/// Concatenation of 2 Strings of range(0) characters with CONCAT opcode
+static void BM_StringValueConcat(benchmark::State &state) {
+    auto vm = get_vm();
+    auto len = state.range(0);
+    vm->store(REG_SRC1, StringValue::get(ustring(len, 'a')));
+    vm->store(REG_SRC2, StringValue::get(ustring(len, 'b')));
+    opcode::Concat concat(REG_DST, REG_SRC1, REG_SRC2);
+    AllocCounter ac(state);
+    ValueBatch batch(ac);
+    for (auto _ : state) {
+        concat.exec(vm);
+        batch.push(vm->load(REG_DST));
+    }
+    state.SetBytesProcessed(state.iterations() * len * 2);
+}
+BENCHMARK(BM_StringValueConcat)->Arg(8)->Arg(1024);
+
+static void BM_StringValueHash(benchmark::State &state) {
+    auto len = state.range(0);
+    auto s = StringValue::get(ustring(len, 'x'));
+    AllocCounter ac(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s->hash());
+    }
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_StringValueHash)->Arg(8)->Arg(1024);
+
+}
@@ -0,0 +1,96 @@
+#include "microbench_utils.hpp"
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include "values.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+static std::atomic<size_t> allocation_cntr{0};
+
+void *operator new(size_t size) {
+    allocation_cntr.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    std::free(p);
+}
+
+using namespace moss;
+
+size_t microbench::allocations() {
+    return allocation_cntr.load(std::memory_order_relaxed);
+}
+
+microbench::AllocCounter::~AllocCounter() {
+    allocs += allocations() - start;
+    state.counters["allocs/op"] = benchmark::Counter(static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+void microbench::ValueBatch::free_values() {
+    // Values are at the end of all_values as they were the last allocated
+    for (auto v = vals.rbegin(); v != vals.rend(); ++v) {
+        auto it = std::find(Value::all_values.rbegin(), Value::all_values.rend(), *v);
+        assert(it != Value::all_values.rend() && "Freeing unknown value");
+        Value::all_values.erase(std::next(it).base());
+        delete *v;
+    }
+    vals.clear();
+}
+
+Interpreter *microbench::get_vm() {
+    static Interpreter *vm = nullptr;
+    if (!vm) {
+        auto bc = new Bytecode();
+        bc->push_back(new opcode::End());
+        vm = new Interpreter(bc, nullptr, true);
+    }
+    return vm;
+}
+
+ustring microbench::generate_source(unsigned units) {
+    std::stringstream ss;
+    for (unsigned i = 0; i < units; ++i) {
+        ss << "fun foo" << i << "(a, b:Int=" << i << ") {\n"
+           << "    x = a * b + " << i << " - (a / 2)\n"
+           << "    if (x > 10 && b != 3) {\n"
+           << "        return \"str" << i << "\" ++ x\n"
+           << "    }\n"
+           << "    for (j : 0..a) {\n"
+           << "        x += j\n"
+           << "    }\n"
+           << "    return [x, " << i << ".5, {\"key\": x, \"other\": [1, 2, 3]}]\n"
+           << "}\n\n"
+           << "class Bar" << i << " {\n"
+           << "    fun Bar" << i << "(v) {\n"
+           << "        this.v = v\n"
+           << "    }\n\n"
+           << "    fun get() = this.v\n"
+           << "}\n\n"
+           << "b" << i << " = Bar" << i << "(foo" << i << "(" << i << ", 2))\n"
+           << "// Comment for line " << i << "\n";
+    }
+    return ss.str();
+}
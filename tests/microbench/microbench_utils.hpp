@@ -0,0 +1,86 @@
+///
+/// \file microbench_utils.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Helper functions for microbenchmarks
+///
+/// Global operator new is replaced in this binary so that every benchmark
+/// can report amount of heap allocations per iteration next to the time.
+///
+
+#ifndef _MICROBENCH_UTILS_HPP_
+#define _MICROBENCH_UTILS_HPP_
+
+#include <benchmark/benchmark.h>
+#include <cstddef>
+#include <vector>
+#include "commons.hpp"
+
+namespace moss {
+class Interpreter;
+class Value;
+}
+
+namespace microbench {
+
+/// \return Amount of heap allocations done by this process so far
+size_t allocations();
+
+/// \brief Counts heap allocations of a benchmark and reports them as allocs/op
+/// The counter has to be created before the benchmark loop and setup inside
+/// of the loop has to be done between pause() and resume().
+class AllocCounter {
+private:
+    benchmark::State &state;
+    size_t allocs;
+    size_t start;
+public:
+    AllocCounter(benchmark::State &state) : state(state), allocs(0), start(allocations()) {}
+    ~AllocCounter();
+
+    void pause() {
+        state.PauseTiming();
+        allocs += allocations() - start;
+    }
+
+    void resume() {
+        start = allocations();
+        state.ResumeTiming();
+    }
+};
+
+/// \brief Deletes values created in the benchmark loop outside of measured time
+/// Values are otherwise freed only by GC, which is not run by benchmarks.
+class ValueBatch {
+private:
+    static constexpr size_t BATCH_SIZE = 1024;
+    AllocCounter &ac;
+    std::vector<moss::Value *> vals;
+
+    void free_values();
+public:
+    ValueBatch(AllocCounter &ac) : ac(ac) { vals.reserve(BATCH_SIZE); }
+    ~ValueBatch() { free_values(); }
+
+    void push(moss::Value *v) {
+        vals.push_back(v);
+        if (vals.size() >= BATCH_SIZE) {
+            ac.pause();
+            free_values();
+            ac.resume();
+        }
+    }
+};
+
+/// \return Interpreter with loaded libms shared by all the benchmarks
+moss::Interpreter *get_vm();
+
+/// \brief Generates moss source code with functions, classes and expressions
+/// \param units How many functions (and classes) to generate
+ustring generate_source(unsigned units);
+
+}
+
+#endif//_MICROBENCH_UTILS_HPP_
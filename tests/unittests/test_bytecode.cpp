@@ -592,4 +592,34 @@ TEST(Bytecode, Subscript) {
     delete bc;
 }
 
+TEST(Bytecode, LineTable) {
+    Bytecode *bc = new Bytecode();
+    bc->set_line(1);
+    bc->push_back(new opcode::StoreIntConst(300, 1));
+    bc->push_back(new opcode::StoreConst(0, 300));
+    bc->set_line(3);
+    // Line without any opcode is dropped
+    bc->set_line(4);
+    bc->push_back(new opcode::StoreIntConst(301, 2));
+    bc->set_line(1);
+    bc->push_back(new opcode::End());
+
+    EXPECT_EQ(bc->get_lines().size(), 3);
+    EXPECT_EQ(bc->get_line(0), 1);
+    EXPECT_EQ(bc->get_line(1), 1);
+    EXPECT_EQ(bc->get_line(2), 4);
+    EXPECT_EQ(bc->get_line(3), 1);
+
+    bc->insert(new opcode::StoreIntConst(302, 3), 1);
+    EXPECT_EQ(bc->get_line(1), 1);
+    EXPECT_EQ(bc->get_line(3), 4);
+    EXPECT_EQ(bc->get_line(4), 1);
+
+    bc->erase(3);
+    EXPECT_EQ(bc->get_lines().size(), 1);
+    EXPECT_EQ(bc->get_line(3), 1);
+
+    delete bc;
+}
+
 }
\ No newline at end of file
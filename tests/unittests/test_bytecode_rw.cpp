@@ -43,6 +43,53 @@ TEST(BytecodeWriterAndReader, TestCorrectness){
     ASSERT_EQ(ret, 0) << "Failed to remove file";
 }
 
+TEST(BytecodeWriterAndReader, LazyFunctionBodies){
+    Bytecode *bc = new Bytecode();
+    bc->push_back(new opcode::FunBegin(0));
+    bc->push_back(new opcode::Jmp(8));
+    // Outer function body [2, 8)
+    bc->push_back(new opcode::PopCallFrame());
+    bc->push_back(new opcode::FunBegin(1));
+    bc->push_back(new opcode::Jmp(6));
+    // Inner function body [5, 6)
+    bc->push_back(new opcode::ReturnConst(2));
+    bc->push_back(new opcode::StoreNilConst(3));
+    bc->push_back(new opcode::ReturnConst(3));
+    bc->push_back(new opcode::End());
+
+    auto file_path = "mosstest_lazy.msb";
+
+    BytecodeFile bfo(file_path);
+    BytecodeWriter *bcwriter = new BytecodeWriter(bfo);
+    bcwriter->write(bc);
+
+    BytecodeFile bf(file_path);
+    BytecodeReader *bcreader = new BytecodeReader(bf);
+    Bytecode *bc_read = bcreader->read();
+
+    ASSERT_EQ(bc->size(), bc_read->size());
+    auto &raw = bc_read->get_raw_code();
+    EXPECT_NE(raw[1], nullptr);
+    EXPECT_NE(raw[8], nullptr);
+    for (unsigned int i = 2; i < 8; ++i) {
+        EXPECT_EQ(raw[i], nullptr) << "Function body opcode " << i << " was decoded";
+    }
+
+    // Accessing inner body decodes also the outer one
+    EXPECT_TRUE(*(*bc)[5] == *(*bc_read)[5]);
+    for (unsigned int i = 0; i < bc->size(); ++i) {
+        EXPECT_NE(raw[i], nullptr);
+        EXPECT_TRUE(*(*bc)[i] == *(*bc_read)[i]);
+    }
+
+    delete bc;
+    delete bc_read;
+    delete bcwriter;
+    delete bcreader;
+    int ret = std::remove(file_path);
+    ASSERT_EQ(ret, 0) << "Failed to remove file";
+}
+
 // Test for all opcodes
 TEST(BytecodeWriterAndReader, AllOpCodes){
     Bytecode *bc = new Bytecode();
@@ -208,6 +255,7 @@ TEST(BytecodeWriterAndReader, AllOpCodes){
     bc->push_back(new opcode::Iter(11, 14));
     bc->push_back(new opcode::LoopBegin());
     bc->push_back(new opcode::LoopEnd());
+    bc->push_back(new opcode::TailCall(4, 5));
 
     auto file_path = "mosstest_all.msb";
 
@@ -84,6 +84,47 @@ TEST(BytecodeTransforms, Inserting) {
     delete bc;
 }
 
+/// Jumps to the address lead to the landing opcode, switch addresses too
+TEST(BytecodeTransforms, InsertingWithLanding) {
+    Bytecode *bc = new Bytecode();
+
+    bc->push_back(new opcode::JmpIfTrue(1, 8));
+    bc->push_back(new opcode::BuildList(2));
+    bc->push_back(new opcode::StoreIntConst(0, 7));
+    bc->push_back(new opcode::ListPushConst(2, 0));
+    bc->push_back(new opcode::StoreIntConst(0, 8));
+    bc->push_back(new opcode::ListPushConst(2, 0));
+    bc->push_back(new opcode::Switch(1, 3, 2, 9));
+    bc->push_back(new opcode::Jmp(9));
+    // < Insert
+    bc->push_back(new opcode::StoreNilConst(1));
+    bc->push_back(new opcode::End());
+
+    bc->insert({new StoreBoolConst(5, true), new StoreBoolConst(6, false), new JmpIfTrue(4, 11)}, 8, 1);
+
+    std::stringstream ss;
+    ss << *bc;
+
+    ustring expected =
+"0\tJMP_IF_TRUE  %1, 9\n"
+"1\tBUILD_LIST  %2\n"
+"2\tSTORE_INT_CONST  #0, 7\n"
+"3\tLIST_PUSH_CONST  %2, #0\n"
+"4\tSTORE_INT_CONST  #0, 9\n"
+"5\tLIST_PUSH_CONST  %2, #0\n"
+"6\tSWITCH  %1, %3, %2, %12\n"
+"7\tJMP  12\n"
+"8\tSTORE_BOOL_CONST  #5, true\n"
+"9\tSTORE_BOOL_CONST  #6, false\n"
+"10\tJMP_IF_TRUE  %4, 11\n"
+"11\tSTORE_NIL_CONST  #1\n"
+"12\tEND\n";
+
+    EXPECT_EQ(ss.str(), expected);
+
+    delete bc;
+}
+
 TEST(BytecodeTransforms, Erasing) {
     Bytecode *bc = new Bytecode();
 
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "testing_utils.hpp"
+#include "ir.hpp"
+#include "ir_pipeline.hpp"
+#include "ir_visitor.hpp"
+#include "transforms/constant_propagation.hpp"
+#include "commons.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace ir;
+using namespace testing;
+
+ustring process_and_propagate(ustring code) {
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<Module>(parser.parse());
+    assert(mod && "failed parsing");
+    ir::IRPipeline irp(parser);
+    irp.get_pm().clear_passes();
+    auto cpp = new ConstantPropagationPass(parser);
+    irp.add_pass(cpp);
+    auto err = irp.run(mod);
+    assert(!err && "failed pipeline");
+
+    std::stringstream ss;
+    for (auto decl: mod->get_body()) {
+        ss << *decl << "\n";
+    }
+    return ss.str();
+}
+
+/// Test propagation of module and function constants
+TEST(ConstantPropagation, Propagation){
+    ustring code = R"(LEVEL = 3
+NAME = "moss"
+a = LEVEL * 2 + 1
+b = NAME ++ "-lang"
+c = NAME
+
+fun foo(x) {
+    k = 4
+    y = x + k
+    return k * LEVEL + y
+}
+)";
+
+    ustring expected = R"((LEVEL = 3)
+(NAME = "moss")
+(a = 7)
+(b = "moss-lang")
+(c = NAME)
+fun foo(x) {
+(k = 4)
+(y = (x + 4))
+return (12 + y)
+}
+<IR: <end-of-file>>
+)";
+
+    EXPECT_EQ(process_and_propagate(code), expected);
+}
+
+/// Names written more than once or outside of the scope are not propagated
+TEST(ConstantPropagation, MultipleWrites){
+    ustring code = R"(X = 5
+fun get_x() = X + 1
+fun set_x() {
+    X = 10
+}
+
+fun foo() {
+    i = 0
+    i += 1
+    j = 2
+    fun bar() {
+        $j = 3
+    }
+    return i + j
+}
+
+g = 1
+fun set_g() {
+    ::g = 2
+}
+h = g + 1
+)";
+
+    ustring expected = R"((X = 5)
+(fun get_x() = (X + 1))
+fun set_x() {
+(X = 10)
+}
+fun foo() {
+(i = 0)
+(i += 1)
+(j = 2)
+fun bar() {
+($j = 3)
+}
+return (i + j)
+}
+(g = 1)
+fun set_g() {
+((:: g) = 2)
+}
+(h = (g + 1))
+<IR: <end-of-file>>
+)";
+
+    EXPECT_EQ(process_and_propagate(code), expected);
+}
+
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <list>
+#include "bytecode.hpp"
+#include "opcode.hpp"
+#include "parser.hpp"
+#include "bytecodegen.hpp"
+#include "optimizer/bc_pipeline.hpp"
+#include "optimizer/cse_pass.hpp"
+#include "testing_utils.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace opcode;
+using namespace testing;
+
+/// \return Loaded names (attributes prefixed with .), stored int constants
+///         and register copies in order of the opcodes after CSE pass is run
+std::vector<ustring> get_loads(ustring code) {
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<ir::Module>(parser.parse());
+
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    cgen.generate(mod);
+
+    std::list<BCPass *> passes{new CSEPass()};
+    BCPipeline pipeline(bc, passes);
+    pipeline.run();
+
+    std::vector<ustring> loads;
+    for (auto op: bc->get_code()) {
+        if (auto ld = dyn_cast<Load>(op))
+            loads.push_back(ld->name);
+        else if (auto la = dyn_cast<LoadAttr>(op))
+            loads.push_back("." + la->name);
+        else if (auto sic = dyn_cast<StoreIntConst>(op))
+            loads.push_back(std::to_string(sic->val));
+        else if (isa<Store>(op))
+            loads.push_back("copy");
+    }
+
+    for (auto p: passes)
+        delete p;
+    delete bc;
+    delete mod;
+    return loads;
+}
+
+/// Repeated loads and constants in a basic block are removed
+TEST(CSE, RedundantLoads) {
+    ustring code = R"(
+fun f(p) {
+    return p.x * p.x + p.y * p.y
+}
+fun g(a) {
+    return a + 2 * a + 2
+}
+)";
+
+    std::vector<ustring> expected{
+        "p", ".x", ".y",
+        "a", "2",
+    };
+    EXPECT_EQ(get_loads(code), expected);
+}
+
+/// Loads are done again when their value might have changed
+TEST(CSE, ChangedValues) {
+    ustring code = R"(
+G = 1
+fun set_g(v) {
+    ::G = v
+}
+fun f(o) {
+    a = o.v + o.v + G + G
+    b = o.v * len(o) + o.v
+    c = G + set_g(a) + G
+    o.w = o.w + a
+    if (a) {
+        a = o.w
+    }
+    return a
+}
+)";
+
+    std::vector<ustring> expected{
+        "1", "v",
+        // G is stored by :: and reloaded after an operator
+        "o", ".v", "G", "G", "copy",
+        // Attributes are reloaded after a call
+        "len", ".v", "copy",
+        "G", "set_g", "a", "G", "copy",
+        // Assigned attribute
+        ".w",
+        // Values are not kept into other blocks
+        "o", ".w", "copy",
+        "a"
+    };
+    EXPECT_EQ(get_loads(code), expected);
+}
+
+}
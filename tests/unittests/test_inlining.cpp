@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "testing_utils.hpp"
+#include "ir.hpp"
+#include "ir_pipeline.hpp"
+#include "ir_visitor.hpp"
+#include "transforms/inlining.hpp"
+#include "commons.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace ir;
+using namespace testing;
+
+ustring process_and_inline(ustring code) {
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<Module>(parser.parse());
+    assert(mod && "failed parsing");
+    ir::IRPipeline irp(parser);
+    irp.get_pm().clear_passes();
+    auto ip = new InliningPass(parser);
+    irp.add_pass(ip);
+    auto err = irp.run(mod);
+    assert(!err && "failed pipeline");
+
+    std::stringstream ss;
+    for (auto decl: mod->get_body()) {
+        ss << *decl << "\n";
+    }
+    return ss.str();
+}
+
+/// Test inlining of calls with positional, named and default arguments
+TEST(Inlining, Inlining){
+    ustring code = R"(fun sq(x) = x * x
+fun scale(x, by=2) = x * by
+fun norm(a, b) = sq(a) + sq(b)
+
+fun foo(v) {
+    return scale(v) + scale(by=3, x=sq(v)) + norm(v, 1)
+}
+)";
+
+    ustring expected = R"((fun sq(x) = (x * x))
+(fun scale(x, by=2) = (x * by))
+(fun norm(a, b) = ((inlined sq(x) = (a * a)) + (inlined sq(x) = (b * b))))
+fun foo(v) {
+return (((inlined scale(x, by=2) = (v * 2)) + scale((by = 3), (x = (inlined sq(x) = (v * v))))) + (inlined norm(a, b) = ((inlined sq(x) = (v * v)) + (inlined sq(x) = (1 * 1)))))
+}
+<IR: <end-of-file>>
+)";
+
+    EXPECT_EQ(process_and_inline(code), expected);
+}
+
+/// Calls to functions which might be redefined or with arguments which might
+/// change are not inlined
+TEST(Inlining, NotInlined){
+    ustring code = R"(fun early() = late(1)
+fun late(x) = x + 1
+fun redefined() = 1
+fun unused(x) = 2
+fun big(x) {
+    y = x + 1
+    return y
+}
+
+fun foo(v) {
+    fun set_v() {
+        $v = 3
+    }
+    return late(v) + redefined() + unused(w) + big(1)
+}
+
+fun redefined() = 2
+)";
+
+    ustring expected = R"((fun early() = late(1))
+(fun late(x) = (x + 1))
+(fun redefined() = 1)
+(fun unused(x) = 2)
+fun big(x) {
+(y = (x + 1))
+return y
+}
+fun foo(v) {
+fun set_v() {
+($v = 3)
+}
+return (((late(v) + redefined()) + unused(w)) + big(1))
+}
+(fun redefined() = 2)
+<IR: <end-of-file>>
+)";
+
+    EXPECT_EQ(process_and_inline(code), expected);
+}
+
+}
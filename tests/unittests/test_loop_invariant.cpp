@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <list>
+#include <algorithm>
+#include "bytecode.hpp"
+#include "opcode.hpp"
+#include "parser.hpp"
+#include "bytecodegen.hpp"
+#include "optimizer/bc_pipeline.hpp"
+#include "optimizer/loop_invariant_pass.hpp"
+#include "testing_utils.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace opcode;
+using namespace testing;
+
+/// \return Names loaded by guarded loads
+std::vector<ustring> get_cached(Bytecode *bc) {
+    std::vector<ustring> cached;
+    auto &code = bc->get_code();
+    for (size_t i = 1; i < code.size(); ++i) {
+        auto ld = dyn_cast<Load>(code[i]);
+        if (ld && isa<JmpIfTrue>(code[i-1]))
+            cached.push_back(ld->name);
+    }
+    return cached;
+}
+
+/// Loads not changed by the loop are guarded by a flag
+TEST(LoopInvariant, CachingLoads) {
+    ustring code = R"(
+space Conf {
+    SCALE = 2
+}
+G = 1
+fun set_g(v) {
+    ::G = v
+}
+fun f(n) {
+    t = 0
+    x = 1
+    for (i : 0..n) {
+        t += Conf.SCALE * x + G
+        x = i
+    }
+    while (t > 0) {
+        t -= len(Conf.SCALE)
+    }
+    return t
+}
+)";
+
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<ir::Module>(parser.parse());
+
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    cgen.generate(mod);
+
+    std::list<BCPass *> passes{new LoopInvariantPass()};
+    BCPipeline pipeline(bc, passes);
+    pipeline.run();
+
+    // x is stored in the loop and G by ::, len and Conf are cached, but
+    // SCALE only in the loop without calls
+    std::vector<ustring> expected{"Conf", "Conf", "len"};
+    auto cached = get_cached(bc);
+    std::sort(cached.begin(), cached.end());
+    EXPECT_EQ(cached, expected);
+
+    // Already cached loads are not cached again
+    std::stringstream first;
+    first << *bc;
+    pipeline.run();
+    std::stringstream second;
+    second << *bc;
+    EXPECT_EQ(first.str(), second.str());
+
+    for (auto p: passes)
+        delete p;
+    delete bc;
+    delete mod;
+}
+
+/// Code outside of function loops is left as is
+TEST(LoopInvariant, NoFunctionLoops) {
+    ustring code = R"(
+for (i : 0..3) {
+    ~print(i)
+}
+fun f(a) {
+    return a.b.c + len(a)
+}
+)";
+
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<ir::Module>(parser.parse());
+
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    cgen.generate(mod);
+    std::stringstream before;
+    before << *bc;
+
+    std::list<BCPass *> passes{new LoopInvariantPass()};
+    BCPipeline pipeline(bc, passes);
+    pipeline.run();
+
+    std::stringstream after;
+    after << *bc;
+    EXPECT_EQ(before.str(), after.str());
+
+    for (auto p: passes)
+        delete p;
+    delete bc;
+    delete mod;
+}
+
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+#include <regex>
+#include <set>
+#include "bytecode_blob.hpp"
+#include "bytecode.hpp"
+#include "opcode.hpp"
+#include "parser.hpp"
+#include "bytecodegen.hpp"
+#include "optimizer/bc_pipeline.hpp"
+#include "optimizer/register_reuse_pass.hpp"
+#include "testing_utils.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace opcode;
+using namespace testing;
+
+std::set<ustring> get_registers(const ustring &text) {
+    std::set<ustring> regs;
+    std::regex reg_re("[%#][0-9]+");
+    for (auto it = std::sregex_iterator(text.begin(), text.end(), reg_re); it != std::sregex_iterator(); ++it)
+        regs.insert(it->str());
+    return regs;
+}
+
+std::vector<ustring> get_lines_with(const ustring &text, const ustring &mnem) {
+    std::vector<ustring> lines;
+    std::stringstream ss(text);
+    ustring line;
+    while (std::getline(ss, line)) {
+        if (line.find(mnem) != ustring::npos)
+            lines.push_back(line);
+    }
+    return lines;
+}
+
+/// Temporaries get reused, names stay in their registers
+TEST(RegisterReuse, ReusingTemporaries) {
+    ustring code = R"(
+fun f(a, b) {
+    c = a * 2 + b * 3 - a * b
+    return c + a * a + b * b
+}
+
+fun g(a) {
+    try {
+        return a + 1 + 2 * a
+    } catch (e) {
+        return 0
+    }
+}
+)";
+
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<ir::Module>(parser.parse());
+
+    auto bc = new Bytecode();
+    bcgen::BytecodeGen cgen(bc);
+    cgen.generate(mod);
+
+    std::stringstream before;
+    before << *bc;
+
+    BCBlob *bcb = BCBlob::parse_bc(*bc);
+    RegisterReusePass pass;
+    for (auto b: collect_all_blobs(bcb))
+        pass.run(b);
+
+    std::stringstream after;
+    after << *bc;
+
+    ustring before_f = before.str().substr(0, before.str().find("CREATE_FUN  %101"));
+    ustring after_f = after.str().substr(0, after.str().find("CREATE_FUN  %101"));
+    ustring before_g = before.str().substr(before.str().find("CREATE_FUN  %101"));
+    ustring after_g = after.str().substr(after.str().find("CREATE_FUN  %101"));
+
+    // Same code, just less registers
+    EXPECT_EQ(std::count(before_f.begin(), before_f.end(), '\n'), std::count(after_f.begin(), after_f.end(), '\n'));
+    EXPECT_LT(get_registers(after_f).size(), get_registers(before_f).size());
+    EXPECT_EQ(get_lines_with(before_f, "STORE_NAME"), get_lines_with(after_f, "STORE_NAME"));
+    EXPECT_EQ(get_lines_with(before_f, "CREATE_FUN"), get_lines_with(after_f, "CREATE_FUN"));
+
+    // Functions with try use dynamic addresses and are left as is
+    EXPECT_EQ(before_g, after_g);
+
+    delete bcb;
+    delete bc;
+    delete mod;
+}
+
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <unordered_set>
+#include "testing_utils.hpp"
+#include "ir.hpp"
+#include "ir_pipeline.hpp"
+#include "ir_visitor.hpp"
+#include "analysis/type_analyzer.hpp"
+#include "commons.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+
+namespace{
+
+using namespace moss;
+using namespace ir;
+using namespace testing;
+
+/// Collects binary expressions with known operands type
+class TypedExprs : public IRVisitor {
+public:
+    std::vector<ustring> typed;
+    std::unordered_set<BinaryExpr *> visited;
+
+    TypedExprs(Parser &parser) : IRVisitor(parser) {}
+
+    virtual IR *visit(BinaryExpr &be) override {
+        // Pass manager visits expression before and after its operands
+        if (be.get_operands_type() == StaticType::UNKNOWN || !visited.insert(&be).second)
+            return &be;
+        std::stringstream ss;
+        ss << be << (be.get_operands_type() == StaticType::INT ? ": Int" : ": Float");
+        typed.push_back(ss.str());
+        return &be;
+    }
+};
+
+std::vector<ustring> get_typed(ustring code) {
+    SourceFile sf(code, SourceFile::SourceType::STRING);
+    Parser parser(sf);
+
+    auto mod = dyn_cast<Module>(parser.parse());
+    assert(mod && "failed parsing");
+    ir::IRPipeline irp(parser);
+    irp.get_pm().clear_passes();
+    irp.add_pass(new TypeAnalyzer(parser));
+    auto collector = new TypedExprs(parser);
+    irp.add_pass(collector);
+    auto err = irp.run(mod);
+    assert(!err && "failed pipeline");
+
+    auto typed = collector->typed;
+    delete mod;
+    return typed;
+}
+
+/// Types come from literals, declared arguments and builtin type constructors
+TEST(TypeAnalysis, KnownTypes){
+    ustring code = R"(
+fun f(a:Int, b:Float, c, d:[Int, Float]) {
+    x = a + 1
+    y = b * 2.0
+    z = x + c
+    w = d - 1
+    v = Int(c) < 3
+    u = 1 + 2.0
+    q = Float(c)
+    return q / 2.0
+}
+)";
+
+    std::vector<ustring> expected{
+        "(a + 1): Int",
+        "(b * 2): Float",
+        "(Int(c) < 3): Int",
+        "(q / 2): Float",
+    };
+    EXPECT_EQ(get_typed(code), expected);
+}
+
+/// Types are merged after branches and loops
+TEST(TypeAnalysis, ControlFlow){
+    ustring code = R"(
+fun f(n) {
+    x = 1
+    y = 1
+    t = 0.0
+    if (n) {
+        y = 2.5
+    }
+    z = 1
+    for (i : 0..n) {
+        t += 0.5
+        s = i * x
+        x = x + 1
+        r = z * 2
+        z = z + y
+    }
+    while (x < 10) {
+        x = "a"
+    }
+    return y - 1
+}
+)";
+
+    std::vector<ustring> expected{
+        "(t += 0.5): Float",
+        "(i * x): Int",
+        "(x + 1): Int",
+    };
+    EXPECT_EQ(get_typed(code), expected);
+}
+
+/// Names which might be written from elsewhere are not known
+TEST(TypeAnalysis, UnknownNames){
+    ustring code = R"(
+Float = Int
+fun f(a:Float) {
+    x = 1
+    fun g() {
+        $x = "a"
+    }
+    g()
+    return x + 1 + a * 2.0
+}
+fun h() {
+    y = 1
+    return y + y
+}
+)";
+
+    std::vector<ustring> expected{
+        "(y + y): Int",
+    };
+    EXPECT_EQ(get_typed(code), expected);
+}
+
+}
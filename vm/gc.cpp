@@ -2,6 +2,7 @@
 #include "values.hpp"
 #include "logging.hpp"
 #include <unordered_set>
+#include <chrono>
 
 using namespace moss;
 using namespace gcs;
@@ -9,6 +10,7 @@ using namespace gcs;
 std::vector<ModuleValue *> TracingGC::currently_imported_modules{};
 std::list<MemoryPool *> TracingGC::popped_frames{};
 std::list<Interpreter *> TracingGC::vms{};
+GCStats TracingGC::stats{};
 
 void TracingGC::push_currently_imported_module(ModuleValue *m) {
     currently_imported_modules.push_back(m);
@@ -34,6 +36,16 @@ ModuleValue *TracingGC::top_currently_imported_module() {
 }
 #endif
 
+std::ostream &TracingGC::report_stats(std::ostream &os) {
+    stats.peak_bytes = std::max(stats.peak_bytes, Value::allocated_bytes);
+    os << "\n=== GC statistics ===\n"
+       << "  collections:  " << stats.collections << "\n"
+       << "  time (ms):    " << stats.time_ns / 1'000'000.0 << "\n"
+       << "  freed values: " << stats.freed_values << "\n"
+       << "  peak bytes:   " << stats.peak_bytes << "\n";
+    return os;
+}
+
 TracingGC::TracingGC(Interpreter *vm) : vm(vm) {
     LOGMAX("Initializing Tracing GC");
 }
@@ -54,6 +66,7 @@ void TracingGC::sweep() {
             LOGMAX("Deleting: " << TypeKind2String(v->get_kind()) << "(" << v->get_name() << ")");
             i = Value::all_values.erase(i);
             delete v;
+            ++stats.freed_values;
         }
     }
 
@@ -168,6 +181,23 @@ void TracingGC::blacken_value(Value *v) {
         }
         mark_roots(spcv->get_owner_vm());
     }
+    // Iterators reference the iterated value, which might not be in any
+    // register anymore
+    else if (auto itv = dyn_cast<ListIterator>(v)) {
+        mark_value(&itv->get_iterated());
+    }
+    else if (auto itv = dyn_cast<StringIterator>(v)) {
+        mark_value(&itv->get_iterated());
+    }
+    else if (auto itv = dyn_cast<DictIterator>(v)) {
+        mark_value(&itv->get_iterated());
+    }
+    else if (auto itv = dyn_cast<BytesIterator>(v)) {
+        mark_value(&itv->get_iterated());
+    }
+    else if (auto itv = dyn_cast<FunctionListIterator>(v)) {
+        mark_value(&itv->get_iterated());
+    }
 }
 
 void TracingGC::trace_refs() {
@@ -249,8 +279,8 @@ void TracingGC::mark_roots(Interpreter *ivm) {
             mark_value(m);
         }
         // Unwound functions are static so mark only by main
-        for (auto f: Interpreter::unwound_funs) {
-            mark_value(f);
+        for (auto &f: Interpreter::unwound_funs) {
+            mark_value(f.fun);
         }
     }
 }
@@ -268,6 +298,9 @@ void TracingGC::collect_garbage() {
 #ifndef NDEBUG
     auto pre_run_allocations = Value::allocated_bytes;
 #endif
+    auto start = std::chrono::steady_clock::now();
+    stats.peak_bytes = std::max(stats.peak_bytes, Value::allocated_bytes);
+    ++stats.collections;
     gray_list.clear();
     // gray list is empty and values are not marked, so all values are white
     mark_roots(vm);
@@ -276,6 +309,7 @@ void TracingGC::collect_garbage() {
     // Value is black when it is not in gray stack and marked is set
     sweep();
     // Freed not used values
+    stats.time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 
 #ifndef NDEBUG
     LOGMAX("Freed " << (pre_run_allocations - Value::allocated_bytes) << "B");
@@ -26,6 +26,14 @@ class MemoryPool;
 /// Namespace for garbage collector resources
 namespace gcs {
 
+/// Statistics of all GC runs (output with --gc-stats)
+struct GCStats {
+    unsigned long collections = 0;  ///< Amount of GC runs
+    unsigned long time_ns = 0;      ///< Time spent in GC
+    unsigned long freed_values = 0; ///< Amount of deleted values
+    size_t peak_bytes = 0;          ///< Highest amount of bytes allocated for values seen by GC
+};
+
 /// \brief Tracing (mark-and-sweep) garbage collector
 /// 
 /// This GC goes from root values and marks values that are reachable from
@@ -46,6 +54,7 @@ private:
     static std::vector<ModuleValue *> currently_imported_modules;
     static std::list<MemoryPool *> popped_frames;
     static std::list<Interpreter *> vms;
+    static GCStats stats;
 public:
     TracingGC(Interpreter *vm);
 
@@ -63,6 +72,11 @@ public:
 
     /// Adds a new removed memory pool for collection
     static void push_popped_frame(MemoryPool *f);
+
+    /// \return Statistics of all GC runs so far
+    static GCStats &get_stats() { return stats; }
+    /// Outputs GC statistics
+    static std::ostream &report_stats(std::ostream &os);
 #ifndef NDEBUG
     static ModuleValue *top_currently_imported_module();
     static size_t get_currently_imported_modules_size() { return currently_imported_modules.size(); }
@@ -2,6 +2,11 @@
 #include "logging.hpp"
 #include "values.hpp"
 #include "mslib.hpp"
+#include "jit.hpp"
+#include "profiler.hpp"
+#include "opcode_stats.hpp"
+#include "clopts.hpp"
+#include "errors.hpp"
 #include "values.hpp"
 #include <exception>
 #include <utility>
@@ -21,7 +26,7 @@ T_Converters Interpreter::converters{};
 T_Generators Interpreter::generators{};
 std::vector<Value *> Interpreter::generator_notes{};
 std::list<FrameInfo> Interpreter::stack_frames{};
-std::vector<Value *> Interpreter::unwound_funs{};
+std::vector<UnwoundFun> Interpreter::unwound_funs{};
 bool Interpreter::running_generator = false;
 bool Interpreter::enable_code_output = false;
 
@@ -108,7 +113,8 @@ FunValue *Interpreter::get_generator(ustring format) {
 Interpreter::Interpreter(Bytecode *code, File *src_file, bool main) 
         : code(code), src_file(src_file), vms_module(nullptr), bci(0),
           exit_code(0), bci_modified(false), stop(false), main(main),
-          marked(false), main_to_run(nullptr), runtime_finally_cntr(0) {
+          marked(false), jit_compiler(nullptr), main_to_run(nullptr),
+          runtime_finally_cntr(0) {
     if (main && !gc) {
         gc = new gcs::TracingGC(this);
     }
@@ -150,6 +156,11 @@ Interpreter::Interpreter(Bytecode *code, File *src_file, bool main)
     }
     init_global_module_values(glob_reg);
     assert(glob_reg < BC_RESERVED_REGS && "More registers used that is reserved");
+    // Compiled code does not go through the dispatch loop, so it would
+    // be missing in opcode statistics
+    if (clopts::use_jit && !clopts::opcode_stats && jit::BaselineJIT::is_supported()) {
+        jit_compiler = new jit::BaselineJIT(this, clopts::get_jit_threshold());
+    }
 }
 
 Interpreter::~Interpreter() {
@@ -165,6 +176,7 @@ Interpreter::~Interpreter() {
     for (auto p: parent_list) {
         delete p;
     }
+    delete jit_compiler;
     if (main) {
         // Only main is the holder of gc
         delete gc;
@@ -298,7 +310,12 @@ std::ostream& ExceptionCatch::debug(std::ostream& os) const {
 std::ostream& Interpreter::report_call_stack(std::ostream& os) {
     // TODO: Color output
     os << "Stacktrace:\n";
-    for (auto *fun_val : unwound_funs) {
+    for (auto &uf : unwound_funs) {
+        auto fun_val = uf.fun;
+        if (!fun_val && !uf.inlined.empty()) {
+            os << "  " << uf.inlined << " at " << uf.file << "\n";
+            continue;
+        }
         if (!fun_val) {
             // This is a case where the exception was raised while calling a
             // function, so we skip this
@@ -456,6 +473,37 @@ void Interpreter::pop_frame() {
     delete c;
 }
 
+bool Interpreter::tail_call(FunValue *fun) {
+    // Call frame for this call is on top of the calling function's one
+    if (call_frames.size() < 2 || frames.size() < 2)
+        return false;
+    auto cf = call_frames.back();
+    auto caller_cf = *std::prev(call_frames.end(), 2);
+    auto &top = stack_frames.back();
+    if (top.frame != get_local_frame() || top.call_frame != caller_cf)
+        return false;
+    // Return of these is handled by other VM or converts the value
+    if (caller_cf->is_extern_module_call() || caller_cf->is_runtime_call() || caller_cf->is_constructor_call())
+        return false;
+    if (!caller_cf->get_function() || caller_cf->get_function()->has_annotation(annots::FORMATTER))
+        return false;
+    auto lf = get_local_frame();
+    if (!lf->get_catches().empty() || lf->has_any_finally())
+        return false;
+    // Function defined in this frame accesses its non-local names
+    if (fun->has_closure(lf))
+        return false;
+
+    LOGMAX("Tail call, reusing frame of " << *caller_cf->get_function());
+    cf->set_return_reg(caller_cf->get_return_reg());
+    cf->set_caller_addr(caller_cf->get_caller_addr());
+    pop_frame();
+    call_frames.erase(std::prev(call_frames.end(), 2));
+    delete caller_cf;
+    push_frame(fun);
+    return true;
+}
+
 void Interpreter::cross_module_call(FunValue *fun, CallFrame *cf) {
     // No frame push as it will be done in specialized run
     call_frames.push_back(cf);
@@ -678,17 +726,27 @@ void Interpreter::print_stack_frame(ustring msg) {
 #endif //NDEBUG
 
 void Interpreter::unwind_stacks(FrameInfo fi) {
+    push_inlined_funs(bci);
     while(stack_frames.back().frame != fi.frame) {
         auto frinf = stack_frames.back();
         if (!frinf.frame->is_global())
             pop_frame();
-        if (frinf.call_frame) {
-            unwound_funs.push_back(frinf.call_frame->get_function());
+        if (auto cf = frinf.call_frame) {
+            unwound_funs.push_back(cf->get_function());
+            // Call itself might be in an inlined function, unless the caller
+            // is in other VM or runtime
+            if (!cf->is_extern_module_call() && !cf->is_runtime_call() && cf->get_caller_addr() > 0)
+                push_inlined_funs(cf->get_caller_addr() - 1);
             pop_call_frame();
         }
     }
 }
 
+void Interpreter::push_inlined_funs(opcode::Address addr) {
+    for (auto &sig : code->get_inlined_at(addr))
+        unwound_funs.push_back(UnwoundFun(sig, src_file ? src_file->get_name() : "??"));
+}
+
 void Interpreter::restore_to_global_frame() {
     LOG1("Restoring interpreter to global frame position");
     call_frames.clear();
@@ -701,6 +759,15 @@ void Interpreter::restore_to_global_frame() {
 }
 
 void Interpreter::run_from_external(MemoryPool *caller_frame) {
+    // Calls of other modules' functions and runtime calls run the interpreter
+    // recursively on the native stack, so too deep recursion through them is
+    // stopped before the stack overflows
+    char stack_top;
+    if (global_controls::native_stack_size > 0 &&
+            global_controls::native_stack_base - reinterpret_cast<std::uintptr_t>(&stack_top) > global_controls::native_stack_size) {
+        error::error(error::ErrorCode::RUNTIME,
+            "Maximum depth of nested calls exceeded (native stack size can be increased with '--stack-size')", src_file, true);
+    }
     push_frame(get_global_frame());
     if (caller_frame)
         push_frame(caller_frame);
@@ -714,81 +781,105 @@ void Interpreter::run_from_external(MemoryPool *caller_frame) {
     pop_frame();
 }
 
+void Interpreter::handle_raised(Value *v) {
+    if (has_finally() && !is_try_not_in_catch()) {
+        LOGMAX("Raise before running finally - run finally");
+        call_finally();
+    } else {
+        // Match to known catches otherwise let fall through to next interpreter
+        // or interpreter owner to print or exit or both
+        bool handled = false;
+        FrameInfo prev_p = {nullptr, nullptr};
+        int pop_amount = 0;
+        for (auto rfi = stack_frames.rbegin(); rfi != stack_frames.rend(); ++rfi, ++pop_amount) {
+            auto frinf = *rfi;
+            auto frm = frinf.frame;
+            // The issue is that in frames are only frames of this VM
+            // but we need to walk the frames across VMs from current
+            // frame back to its caller. So global stack_frame has to be
+            // used and if the owner is not this vm, then just re-raise.
+            if (auto owner = frm->get_vm_owner()) {
+                if (owner != this) {
+                    LOGMAX("Rethrowing exception, top of the stack is other VM");
+                    // Restore current VMs frames
+                    // Pop up until the frame before this;
+                    unwind_stacks(prev_p);
+                    throw v;
+                }
+            }
+            auto catches = frm->get_catches();
+            opcode::IntConst prev_id = -1;
+            for (auto riter = catches.rbegin(); riter != catches.rend(); ++riter) {
+                auto ec = *riter;
+                if (prev_id < 0) {
+                    prev_id = ec.id;
+                } else if (prev_id != ec.id) {
+                    if (has_finally()) {
+                        call_finally();
+                    }
+                    prev_id = ec.id;
+                }
+                if (!ec.type || opcode::is_type_eq_or_subtype(v->get_type(), ec.type)) {
+                    LOGMAX("Caught exception");
+                    handle_exception(ec, v);
+                    handled = true;
+                    break;
+                }
+            }
+            if (handled)
+                break;
+            prev_p = frinf;
+        }
+        // Rethrow exception to be handled by next interpreter or unhandled
+        if (!handled) {
+            if (has_finally()) {
+                LOGMAX("Uncaught raise, run finally before rethrow");
+                call_finally();
+            }else {
+                LOGMAX("Unwindind and rethrowing exception, no catch caught it");
+                unwind_stacks(prev_p);
+                throw v;
+            }
+        }
+    }
+}
+
 void Interpreter::run() {
     LOG1("Running interpreter of " << (src_file ? src_file->get_name() : "??") << "\n----- OUTPUT: -----");
 
+    // Loop is selected here so that the default one has no instrumentation
+    if (clopts::opcode_stats)
+        dispatch_loop<true>();
+    else
+        dispatch_loop<false>();
+
+    //assert((!is_main() || !has_finally()) && "Unrun finally");
+    LOG1("Finished interpreter");
+}
+
+template<bool OPCODE_STATS>
+void Interpreter::dispatch_loop() {
     while(bci < code->size()) {
+        opcode::Address opc_bci = bci;
         opcode::OpCode *opc = (*code)[bci];
         //outs << bci << " " << *opc << "\n";
+        opstats::Clock::time_point start;
+        if constexpr (OPCODE_STATS)
+            start = opstats::Clock::now();
         try {
             opc->exec(this);
+            if constexpr (OPCODE_STATS)
+                opstats::record(this, opc_bci, opc, start);
             // If we get to exectute opcode and unwound stack is not empty, then
             // we got here after some exception was handled or reported (repl),
             // so just clear it. The check for empty() for vector is O(1).
             if (!unwound_funs.empty()) {
                 unwound_funs.clear();
             }
-        } catch (Value *v) { 
-            if (has_finally() && !is_try_not_in_catch()) {
-                LOGMAX("Raise before running finally - run finally");
-                call_finally();
-            } else {
-                // Match to known catches otherwise let fall through to next interpreter
-                // or interpreter owner to print or exit or both
-                bool handled = false;
-                FrameInfo prev_p = {nullptr, nullptr};
-                int pop_amount = 0;
-                for (auto rfi = stack_frames.rbegin(); rfi != stack_frames.rend(); ++rfi, ++pop_amount) {
-                    auto frinf = *rfi;
-                    auto frm = frinf.frame;
-                    // The issue is that in frames are only frames of this VM
-                    // but we need to walk the frames across VMs from current
-                    // frame back to its caller. So global stack_frame has to be
-                    // used and if the owner is not this vm, then just re-raise.
-                    if (auto owner = frm->get_vm_owner()) {
-                        if (owner != this) {
-                            LOGMAX("Rethrowing exception, top of the stack is other VM");
-                            // Restore current VMs frames
-                            // Pop up until the frame before this;
-                            unwind_stacks(prev_p);
-                            throw v;
-                        }
-                    }
-                    auto catches = frm->get_catches();
-                    opcode::IntConst prev_id = -1;
-                    for (auto riter = catches.rbegin(); riter != catches.rend(); ++riter) {
-                        auto ec = *riter;
-                        if (prev_id < 0) {
-                            prev_id = ec.id;
-                        } else if (prev_id != ec.id) {
-                            if (has_finally()) {
-                                call_finally();
-                            }
-                            prev_id = ec.id;
-                        }
-                        if (!ec.type || opcode::is_type_eq_or_subtype(v->get_type(), ec.type)) {
-                            LOGMAX("Caught exception");
-                            handle_exception(ec, v);
-                            handled = true;
-                            break;
-                        }
-                    }
-                    if (handled)
-                        break;
-                    prev_p = frinf;
-                }
-                // Rethrow exception to be handled by next interpreter or unhandled
-                if (!handled) {
-                    if (has_finally()) {
-                        LOGMAX("Uncaught raise, run finally before rethrow");
-                        call_finally();
-                    }else {
-                        LOGMAX("Unwindind and rethrowing exception, no catch caught it");
-                        unwind_stacks(prev_p);
-                        throw v;
-                    }
-                }
-            }
+        } catch (Value *v) {
+            if constexpr (OPCODE_STATS)
+                opstats::record(this, opc_bci, opc, start);
+            handle_raised(v);
         }
         if (stop || global_controls::exit_called) {
             stop = false;
@@ -796,16 +887,23 @@ void Interpreter::run() {
         }
 
         // If bci was modified (jmp), then don't change it
-        if (bci_modified)
+        if (bci_modified) {
             bci_modified = false;
-        else
+            // Control transfer is the only place where compiled code is
+            // entered, so the JIT does not slow down straight-line code
+            if (jit_compiler && !jit_compiler->transfer(opc_bci))
+                break;
+        } else {
             ++bci;
+        }
 
         if (global_controls::trigger_gc) {
             gc->collect_garbage();
             global_controls::trigger_gc = false;
         }
+
+        if (global_controls::profile_tick) {
+            profiler::sample(this);
+        }
     }
-    //assert((!is_main() || !has_finally()) && "Unrun finally");
-    LOG1("Finished interpreter");
 }
\ No newline at end of file
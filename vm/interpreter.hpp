@@ -40,6 +40,14 @@ namespace opcode {
     class Finally;
 }
 
+namespace jit {
+    class BaselineJIT;
+}
+
+namespace snapshot {
+    class LibmsSnapshot;
+}
+
 // TODO: change to unordered_map
 /// Map for formats (from format -> to format) and the function doing this conversion.
 using T_Converters = std::map<std::pair<ustring, ustring>, FunValue *>;
@@ -196,11 +204,25 @@ struct FrameInfo {
     CallFrame *call_frame;
 };
 
+/// \brief Function unwound during exception handling
+/// Function inlined into its caller has no value, so only its signature and
+/// the file it was inlined in are known.
+struct UnwoundFun {
+    Value *fun;
+    ustring inlined;
+    ustring file;
+
+    UnwoundFun(Value *fun) : fun(fun) {}
+    UnwoundFun(ustring inlined, ustring file) : fun(nullptr), inlined(inlined), file(file) {}
+};
+
 /// \brief Interpreter for moss bytecode
 /// Interpreter holds memory pools (stack frames) and runs bytecode provided
 class Interpreter {
 private:
     friend class gcs::TracingGC;
+    friend class jit::BaselineJIT;
+    friend class snapshot::LibmsSnapshot;
     Bytecode *code;
     File *src_file;
     ModuleValue *vms_module;
@@ -208,7 +230,7 @@ private:
     std::list<MemoryPool *> const_pools; ///< Constant's frame stack
     std::list<MemoryPool *> frames;      ///< Frame stack
     static std::list<FrameInfo> stack_frames; ///< All VM's frames
-    static std::vector<Value *> unwound_funs; ///< Functions unwound during exception handling for stack frame dump
+    static std::vector<UnwoundFun> unwound_funs; ///< Functions unwound during exception handling for stack frame dump
 
     std::list<CallFrame *> call_frames;  ///< Call frame stack
     std::list<ClassValue *> parent_list; ///< Classes that will be used in class construction
@@ -227,17 +249,29 @@ private:
     bool stop;
     bool main;
     bool marked;
+
+    jit::BaselineJIT *jit_compiler; ///< Native code compiler, nullptr when JIT is disabled
     
     MemoryPool *get_global_const_pool() { return this->const_pools.front(); };
     MemoryPool *get_const_pool() { return this->const_pools.back(); }
     MemoryPool *get_local_frame() { return this->frames.back(); }
     
     void unwind_stacks(FrameInfo fi);
+    void push_inlined_funs(opcode::Address addr);
 
     void init_const_frame();
     opcode::Register init_global_frame();
     void init_global_module_values(opcode::Register &reg);
     void clear_unwound_frames();
+
+    /// Runs opcodes until the end of bytecode or until stop is set
+    /// \tparam OPCODE_STATS If true, then execution of each opcode is recorded
+    template<bool OPCODE_STATS>
+    void dispatch_loop();
+
+    /// Handles moss exception raised by an executed opcode
+    /// If it is not caught in this VM, then it is rethrown
+    void handle_raised(Value *v);
 public:
     static bool running_generator; ///< When true it means that the currently run code is generator of the output
     FunValue *main_to_run;         ///< Function annotated as @main (set only if this is main vm)
@@ -308,6 +342,14 @@ public:
     void push_frame(MemoryPool *pool, bool push_const=true);
     /// Pops a frame (memory pool) from a frame stack
     void pop_frame();
+    /// \brief Replaces frame of the current function with a new one for fun
+    /// Called function returns directly to the caller of the current one.
+    /// This is possible only when the current function was called from this
+    /// VM, nothing in its frame would run after the call (exception handler
+    /// or finally) and fun is not nested in it (accessing its names).
+    /// \return true if the frame was replaced, false if the call has to
+    ///         push a new frame
+    bool tail_call(FunValue *fun);
     /// \return Top frame, meaning the current local frame or global if no local is inserted
     MemoryPool *get_top_frame() { return this->get_local_frame(); }
     MemoryPool *get_top_const_frame() { return this->get_const_pool(); }
@@ -0,0 +1,368 @@
+#include "jit.hpp"
+#include "interpreter.hpp"
+#include "profiler.hpp"
+#include "bytecode_blob.hpp"
+#include "optimizer/bc_pipeline.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef MOSS_JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+using namespace moss;
+using namespace jit;
+
+BaselineJIT::BaselineJIT(Interpreter *vm, unsigned threshold)
+        : vm(vm), threshold(threshold), parsed_size(0), raised(nullptr),
+          native_raised(nullptr) {
+}
+
+BaselineJIT::~BaselineJIT() {
+#ifdef MOSS_JIT_SUPPORTED
+    for (auto &nc: compiled) {
+        munmap(nc.mem, nc.size);
+    }
+#endif
+}
+
+bool BaselineJIT::is_supported() {
+#ifdef MOSS_JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+void BaselineJIT::parse_blobs() {
+    auto code = vm->get_code();
+    parsed_size = code->size();
+    entries.resize(parsed_size, nullptr);
+    counters.resize(parsed_size, 0);
+    fun_spans.clear();
+    if (parsed_size == 0)
+        return;
+
+    auto mod_blob = opcode::BCBlob::parse_bc(*code);
+    auto all_blobs = opcode::collect_all_blobs(mod_blob);
+    for (auto b: all_blobs) {
+        if (b->isa_fun() && b->size() > 0) {
+            opcode::Address start = std::distance(code->get_code().begin(), b->begin());
+            opcode::Address end = start + b->size();
+            // Blob contains function creation followed by a jump over the
+            // body, the body starts right after this jump
+            opcode::Address body = end;
+            for (opcode::Address i = start; i < end; ++i) {
+                auto jmp = dyn_cast<opcode::Jmp>((*code)[i]);
+                if (jmp && jmp->addr == end) {
+                    body = i + 1;
+                    break;
+                }
+            }
+            fun_spans.push_back({start, end, body});
+        }
+    }
+    for (auto b: all_blobs) {
+        delete b;
+    }
+    std::sort(fun_spans.begin(), fun_spans.end(), [](const FunSpan &a, const FunSpan &b) {
+        return a.start < b.start;
+    });
+}
+
+const BaselineJIT::FunSpan *BaselineJIT::find_fun(opcode::Address bci) {
+    // Innermost function blob is the one with the latest start
+    const FunSpan *found = nullptr;
+    for (auto &fs: fun_spans) {
+        if (fs.start > bci)
+            break;
+        if (bci < fs.end)
+            found = &fs;
+    }
+    return found;
+}
+
+bool BaselineJIT::is_fun_body(opcode::Address bci) {
+    auto fs = find_fun(bci);
+    return fs && fs->body == bci;
+}
+
+uint32_t BaselineJIT::exec_op(Interpreter *vm, uint32_t bci) {
+    // This has to mirror one iteration of Interpreter::run, but no exception
+    // can be let through native code as it has no unwind information
+    vm->bci = bci;
+    try {
+        (*vm->code)[bci]->exec(vm);
+        if (!Interpreter::unwound_funs.empty()) {
+            Interpreter::unwound_funs.clear();
+        }
+    } catch (Value *v) {
+        vm->jit_compiler->raised = v;
+        return EXIT_RAISED;
+    } catch (...) {
+        vm->jit_compiler->native_raised = std::current_exception();
+        return EXIT_NATIVE_EXC;
+    }
+    if (vm->stop || global_controls::exit_called)
+        return EXIT_STOP;
+
+    if (vm->bci_modified)
+        vm->bci_modified = false;
+    else
+        ++vm->bci;
+
+    if (global_controls::trigger_gc) {
+        Interpreter::gc->collect_garbage();
+        global_controls::trigger_gc = false;
+    }
+
+    if (global_controls::profile_tick)
+        profiler::sample(vm);
+    return vm->bci;
+}
+
+/// \return true if opcode has to be executed by the interpreter
+static bool is_unsupported(opcode::OpCode *opc) {
+    switch (opc->get_type()) {
+        // Exception handling and finally blocks manipulate the interpreter's
+        // catch and finally stacks and might run nested interpreter loops
+        case opcode::OpCodes::RAISE:
+        case opcode::OpCodes::CATCH:
+        case opcode::OpCodes::CATCH_TYPED:
+        case opcode::OpCodes::POP_CATCH:
+        case opcode::OpCodes::FINALLY:
+        case opcode::OpCodes::POP_FINALLY:
+        case opcode::OpCodes::FINALLY_RETURN:
+        case opcode::OpCodes::RUN_FINALLY:
+        // Imports compile and run other modules
+        case opcode::OpCodes::IMPORT:
+        case opcode::OpCodes::IMPORT_ALL:
+        case opcode::OpCodes::END:
+            return true;
+        default: return false;
+    }
+}
+
+#ifdef MOSS_JIT_SUPPORTED
+namespace {
+
+/// Minimal x86-64 machine code emitter for the templates
+class Emitter {
+public:
+    std::vector<uint8_t> buff;
+
+    size_t pos() { return buff.size(); }
+    void byte(uint8_t b) { buff.push_back(b); }
+    void bytes(std::initializer_list<uint8_t> bs) { buff.insert(buff.end(), bs); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i)
+            byte((v >> (i * 8)) & 0xFF);
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i)
+            byte((v >> (i * 8)) & 0xFF);
+    }
+    /// Emits 32bit placeholder for relative jump and returns its position
+    size_t rel32() {
+        auto p = pos();
+        u32(0);
+        return p;
+    }
+    void patch_rel32(size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        std::memcpy(&buff[at], &rel, sizeof(rel));
+    }
+};
+
+/// Jump which will be resolved once all labels are known
+struct Fixup {
+    size_t at;
+    enum { LABEL, DISPATCH, EXIT } kind;
+    opcode::Address label;
+};
+
+}
+#endif
+
+void BaselineJIT::compile(const FunSpan &span) {
+#ifdef MOSS_JIT_SUPPORTED
+    auto code = vm->get_code();
+    const opcode::Address start = span.start;
+    const opcode::Address end = span.end;
+    const uint32_t len = end - start;
+    LOG2("JIT compiling function blob [" << start << "; " << end << ")");
+
+    Emitter e;
+    std::vector<Fixup> fixups;
+    std::vector<size_t> labels(len, 0);
+
+    // Prologue: rbx holds vm, eax the bci to start at.
+    // One push aligns the stack to 16 bytes for calls.
+    e.byte(0x53);                   // push rbx
+    e.bytes({0x48, 0x89, 0xFB});    // mov rbx, rdi
+    e.bytes({0x89, 0xF0});          // mov eax, esi
+    // Dispatch: jump to the template of bci in eax or exit if it is not
+    // inside of this blob
+    size_t dispatch = e.pos();
+    e.bytes({0x89, 0xC1});          // mov ecx, eax
+    e.bytes({0x81, 0xE9}); e.u32(start); // sub ecx, start
+    e.bytes({0x81, 0xF9}); e.u32(len);   // cmp ecx, len
+    e.bytes({0x0F, 0x83});          // jae exit
+    fixups.push_back({e.rel32(), Fixup::EXIT, 0});
+    e.bytes({0x48, 0x8D, 0x15});    // lea rdx, [rip + table]
+    size_t table_ref = e.rel32();
+    e.bytes({0xFF, 0x24, 0xCA});    // jmp [rdx + rcx*8]
+
+    for (opcode::Address i = start; i < end; ++i) {
+        labels[i - start] = e.pos();
+        auto opc = (*code)[i];
+        if (auto jmp = dyn_cast<opcode::Jmp>(opc)) {
+            if (jmp->addr >= start && jmp->addr < end) {
+                e.byte(0xE9);       // jmp label
+                fixups.push_back({e.rel32(), Fixup::LABEL, jmp->addr});
+            } else {
+                e.byte(0xB8); e.u32(jmp->addr); // mov eax, addr
+                e.byte(0xE9);       // jmp exit
+                fixups.push_back({e.rel32(), Fixup::EXIT, 0});
+            }
+            continue;
+        }
+        if (is_unsupported(opc)) {
+            // Let the interpreter run this opcode
+            e.byte(0xB8); e.u32(i); // mov eax, i
+            e.byte(0xE9);           // jmp exit
+            fixups.push_back({e.rel32(), Fixup::EXIT, 0});
+            continue;
+        }
+        e.bytes({0x48, 0x89, 0xDF});    // mov rdi, rbx
+        e.byte(0xBE); e.u32(i);         // mov esi, i
+        e.bytes({0x48, 0xB8});          // mov rax, exec_op
+        e.u64(reinterpret_cast<uint64_t>(&BaselineJIT::exec_op));
+        e.bytes({0xFF, 0xD0});          // call rax
+        if (i + 1 < end) {
+            // Most opcodes continue with the next one, so fall through and
+            // dispatch only on jumps
+            e.byte(0x3D); e.u32(i + 1); // cmp eax, i+1
+            e.bytes({0x0F, 0x85});      // jne dispatch
+            fixups.push_back({e.rel32(), Fixup::DISPATCH, 0});
+        } else {
+            e.byte(0xE9);               // jmp dispatch
+            fixups.push_back({e.rel32(), Fixup::DISPATCH, 0});
+        }
+    }
+
+    // Epilogue, eax contains the next bci or exit code
+    size_t exit = e.pos();
+    e.byte(0x5B);                   // pop rbx
+    e.byte(0xC3);                   // ret
+
+    while (e.pos() % 8 != 0)
+        e.byte(0xCC);               // int3 padding
+    size_t table = e.pos();
+    e.patch_rel32(table_ref, table);
+    for (opcode::Address i = 0; i < len; ++i)
+        e.u64(0);
+
+    for (auto &f: fixups) {
+        switch (f.kind) {
+            case Fixup::LABEL: e.patch_rel32(f.at, labels[f.label - start]); break;
+            case Fixup::DISPATCH: e.patch_rel32(f.at, dispatch); break;
+            case Fixup::EXIT: e.patch_rel32(f.at, exit); break;
+        }
+    }
+
+    size_t size = e.pos();
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        LOG1("JIT could not allocate executable memory");
+        // Do not try to compile again
+        threshold = static_cast<unsigned>(-1);
+        return;
+    }
+    auto base = reinterpret_cast<uint8_t *>(mem);
+    std::memcpy(base, e.buff.data(), size);
+    // Jump table contains absolute addresses
+    for (opcode::Address i = 0; i < len; ++i) {
+        uint64_t addr = reinterpret_cast<uint64_t>(base + labels[i]);
+        std::memcpy(base + table + i * 8, &addr, sizeof(addr));
+    }
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        threshold = static_cast<unsigned>(-1);
+        return;
+    }
+
+    auto entry = reinterpret_cast<NativeEntry>(mem);
+    compiled.push_back({mem, size, start, end, entry});
+    // Inner functions compiled before keep their own code
+    for (opcode::Address i = start; i < end; ++i) {
+        if (!entries[i])
+            entries[i] = entry;
+    }
+#else
+    (void)span;
+#endif
+}
+
+bool BaselineJIT::transfer(opcode::Address from) {
+    while (true) {
+        opcode::Address bci = vm->bci;
+        auto code_size = vm->get_code_size();
+        if (bci >= code_size)
+            return true;
+        // Code can grow in repl
+        if (parsed_size != code_size)
+            parse_blobs();
+
+        NativeEntry fn = entries[bci];
+        if (!fn) {
+            // Only calls (jump to function body) and loops (jump backwards)
+            // increase hotness
+            if (bci <= from || is_fun_body(bci)) {
+                if (++counters[bci] >= threshold) {
+                    if (auto fs = find_fun(bci))
+                        compile(*fs);
+                    fn = entries[bci];
+                }
+            }
+            if (!fn)
+                return true;
+        }
+
+        uint32_t next = fn(vm, bci);
+        switch (next) {
+            case EXIT_STOP:
+                vm->stop = false;
+                return false;
+            case EXIT_NATIVE_EXC: {
+                auto exc = native_raised;
+                native_raised = nullptr;
+                std::rethrow_exception(exc);
+            }
+            case EXIT_RAISED: {
+                auto v = raised;
+                raised = nullptr;
+                from = vm->bci;
+                vm->handle_raised(v);
+                if (vm->stop || global_controls::exit_called) {
+                    vm->stop = false;
+                    return false;
+                }
+                if (!vm->bci_modified) {
+                    ++vm->bci;
+                    return true;
+                }
+                vm->bci_modified = false;
+            } break;
+            default:
+                // Exited compiled code because the next bci is outside of it
+                // or the opcode is not supported
+                vm->bci = next;
+                if (next >= code_size || is_unsupported((*vm->code)[next]))
+                    return true;
+                from = 0;
+            break;
+        }
+    }
+}
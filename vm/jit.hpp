@@ -0,0 +1,121 @@
+///
+/// \file jit.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Baseline template JIT for hot function blobs
+///
+/// Hot function blobs (FUN_BLOB from BCBlob::parse_bc) are compiled into
+/// native code where each opcode is a call into its exec handler and jumps
+/// are native jumps. This removes the interpreter dispatch loop, but all the
+/// semantics are still provided by the handlers in opcode.cpp.
+/// Anything the compiled code cannot handle (exceptions, unsupported opcodes)
+/// exits back to the interpreter which continues at the current bci.
+///
+/// Native code generation is supported only for x86-64 Linux, elsewhere
+/// the JIT is never created.
+///
+
+#ifndef _JIT_HPP_
+#define _JIT_HPP_
+
+#include "opcode.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <exception>
+
+namespace moss {
+
+class Interpreter;
+class Value;
+
+namespace jit {
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MOSS_JIT_SUPPORTED 1
+#endif
+
+/// Default amount of function invocations or loop back-edges needed for
+/// a function blob to be compiled
+constexpr unsigned DEFAULT_HOT_THRESHOLD = 500;
+
+/// Native entry into compiled blob
+/// \param vm Interpreter running the code
+/// \param bci Bytecode index to start at (has to be inside of the blob)
+/// \return Bytecode index to continue at in interpreter or one of ExitCode values
+using NativeEntry = uint32_t (*)(Interpreter *vm, uint32_t bci);
+
+/// Special return values from native code (bcis this high cannot exist)
+enum ExitCode : uint32_t {
+    EXIT_STOP = 0xFFFFFFFF,    ///< Interpreter's stop was set or exit was called
+    EXIT_RAISED = 0xFFFFFFFE,  ///< Moss exception was raised
+    EXIT_NATIVE_EXC = 0xFFFFFFFD, ///< Other C++ exception was thrown
+};
+
+/// Executable memory with compiled function blob
+struct NativeCode {
+    void *mem;
+    size_t size;
+    opcode::Address start;
+    opcode::Address end;
+    NativeEntry entry;
+};
+
+/// \brief Baseline JIT compiler attached to one interpreter (one bytecode)
+class BaselineJIT {
+private:
+    /// Span of a function blob [start, end) with the address of its body
+    struct FunSpan {
+        opcode::Address start;
+        opcode::Address end;
+        opcode::Address body;
+    };
+
+    Interpreter *vm;
+    unsigned threshold;
+    std::vector<NativeEntry> entries; ///< Compiled code for every bci
+    std::vector<unsigned> counters;   ///< Hotness counters for jump targets
+    std::vector<FunSpan> fun_spans;   ///< Function blobs sorted by start
+    std::vector<NativeCode> compiled; ///< Owned native code
+    size_t parsed_size;               ///< Bytecode size when blobs were parsed
+    Value *raised;                    ///< Exception raised in native code
+    std::exception_ptr native_raised; ///< Non-moss exception from native code
+
+    void parse_blobs();
+    const FunSpan *find_fun(opcode::Address bci);
+    bool is_fun_body(opcode::Address bci);
+    void compile(const FunSpan &span);
+
+    /// Called from native code to execute one opcode
+    /// \return Next bci or ExitCode value
+    static uint32_t exec_op(Interpreter *vm, uint32_t bci);
+public:
+    BaselineJIT(Interpreter *vm, unsigned threshold=DEFAULT_HOT_THRESHOLD);
+    ~BaselineJIT();
+
+    /// \return true if native code can be generated on this platform
+    static bool is_supported();
+
+    /// \brief Handles control transfer in the interpreter
+    /// This updates hotness counters and if the target is compiled, then
+    /// the native code is run until it exits.
+    /// \param from Bci of the opcode that modified the bci
+    /// \return false if interpreter should stop (stop was set)
+    bool transfer(opcode::Address from);
+
+    /// \return true if code containing bci was compiled
+    bool is_compiled(opcode::Address bci) {
+        return bci < entries.size() && entries[bci] != nullptr;
+    }
+
+    /// \return Amount of compiled function blobs
+    size_t get_compiled_amount() { return compiled.size(); }
+};
+
+}
+
+}
+
+#endif//_JIT_HPP_
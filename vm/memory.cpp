@@ -10,6 +10,7 @@ long MemoryPool::allocated = 0;
 #endif
 
 opcode::Register MemoryPool::dynamic_register_am = 0;
+uint64_t MemoryPool::names_version_cntr = 0;
 
 void MemoryPool::store(opcode::Register reg, Value *v) {
     assert(v && "Storing nullptr");
@@ -30,12 +31,14 @@ Value *MemoryPool::load(opcode::Register reg) {
 
 void MemoryPool::store_name(opcode::Register reg, ustring name) {
     this->sym_table[name] = reg;
+    this->names_version = ++names_version_cntr;
 }
 
 void MemoryPool::remove_name(ustring name) {
     auto pos = this->sym_table.find(name);
     assert(pos != sym_table.end() && "Name does not exist");
     this->sym_table.erase(pos);
+    this->names_version = ++names_version_cntr;
 }
 
 Value *MemoryPool::load_name(ustring name, Interpreter *vm, Value **owner) {
@@ -152,6 +155,14 @@ size_t MemoryPool::get_finally_stack_size() {
     return this->finally_stack.size();
 }
 
+bool MemoryPool::has_any_finally() {
+    for (auto &fs: this->finally_stack) {
+        if (!fs.empty())
+            return true;
+    }
+    return false;
+}
+
 void MemoryPool::push_catch(ExceptionCatch ec) {
     this->catches.push_back(ec);
 }
@@ -32,12 +32,17 @@ namespace opcode {
     class Finally;
 }
 
+namespace snapshot {
+    class LibmsSnapshot;
+}
+
 /// \brief Virtual memory representation
 /// It holds pool of values with reference counting for their garbage collection
 /// and it also holds symbol table which has the variable names and corresponding
 /// index into the pool. 
 class MemoryPool {
 private:
+    friend class snapshot::LibmsSnapshot;
     Value *pool_owner; ///< This value is set to the owner of this pool if it is a function
     Interpreter *vm_owner;
     std::unordered_map<opcode::Register, Value *> pool;
@@ -46,17 +51,19 @@ private:
     std::vector<std::vector<opcode::Finally *>> finally_stack;
     std::list<ExceptionCatch> catches;
 
+    uint64_t names_version; ///< Changes every time sym_table changes
     bool holds_consts;
     bool global;
     bool marked;
     static opcode::Register dynamic_register_am;
+    static uint64_t names_version_cntr; ///< Global so that no 2 pools share the same version
 public:
 #ifndef NDEBUG
     static long allocated;
 #endif
     MemoryPool(Interpreter *vm_owner, bool holds_consts=false, bool global=false)
-                : pool_owner(nullptr), vm_owner(vm_owner), holds_consts(holds_consts),
-                  global(global), marked(false) {
+                : pool_owner(nullptr), vm_owner(vm_owner), names_version(++names_version_cntr),
+                  holds_consts(holds_consts), global(global), marked(false) {
         if (!global && !holds_consts) {
             // TODO: Fine tune these values
             pool = std::unordered_map<opcode::Register, Value *>(128);
@@ -108,6 +115,10 @@ public:
 
     std::optional<opcode::Register> get_name_register(ustring name);
 
+    /// \return version of the symbol table, which changes on every name
+    ///         store or removal and it is unique across all pools
+    uint64_t get_names_version() { return this->names_version; }
+
     bool overwrite(ustring name, Value *v, Interpreter *vm);
 
     /// Spills a new value.
@@ -143,6 +154,8 @@ public:
 
     std::vector<opcode::Finally *> &get_finally_stack();
     size_t get_finally_stack_size();
+    /// \return true if there is a finally in any of the finally stacks
+    bool has_any_finally();
 
     /// \brief Pushes a new catch exception block into the catch stack.
     void push_catch(ExceptionCatch ec);
@@ -0,0 +1,233 @@
+#include "note_cache.hpp"
+#include "interpreter.hpp"
+#include "values.hpp"
+#include "scanner.hpp"
+#include "ir.hpp"
+#include "clopts.hpp"
+#include "logging.hpp"
+#include "utils.hpp"
+#include "moss.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace moss;
+using namespace note_cache;
+
+/// Has to be increased on every change of the entry format
+static constexpr uint32_t NOTE_CACHE_FORMAT_VERSION = 1;
+static constexpr char NOTE_CACHE_MAGIC[8] = {'M', 'S', 'N', 'O', 'T', 'E', 'S', '\0'};
+
+Cell *note_cache::recorded_cell = nullptr;
+
+namespace {
+
+/// Header of a cell entry, which is followed by its notes
+struct EntryHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t note_count;
+    uint64_t key;
+};
+
+/// Paths of all loaded modules in order of loading
+std::vector<ustring> loaded_modules;
+
+void append_u32(ustring &out, uint32_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+bool read_u32(const ustring &data, size_t &pos, uint32_t &v) {
+    if (data.size() - pos < sizeof(v))
+        return false;
+    std::memcpy(&v, data.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+}
+
+bool read_str(const ustring &data, size_t &pos, ustring &s) {
+    uint32_t size;
+    if (!read_u32(data, pos, size) || data.size() - pos < size)
+        return false;
+    s = data.substr(pos, size);
+    pos += size;
+    return true;
+}
+
+uint64_t hash_str(const ustring &s, uint64_t h) {
+    // Size is hashed as well so that concatenations cannot collide
+    uint64_t size = s.size();
+    h = utils::fnv1a(reinterpret_cast<const char *>(&size), sizeof(size), h);
+    return utils::fnv1a(s.data(), s.size(), h);
+}
+
+/// \return true if declaration can only output notes and does not define
+///         anything used by other cells
+bool is_output_decl(ir::IR *decl) {
+    using namespace ir;
+    if (!isa<Expression>(decl) || isa<Lambda>(decl) || isa<Multivar>(decl))
+        return false;
+    if (auto be = dyn_cast<BinaryExpr>(decl))
+        return !is_set_op(be->get_op());
+    if (auto ue = dyn_cast<UnaryExpr>(decl))
+        return ue->get_op().get_kind() != OperatorKind::OP_SILENT;
+    return true;
+}
+
+}
+
+bool note_cache::is_enabled() {
+    return clopts::note_cache_dir && !clopts::disable_notes;
+}
+
+Cell::~Cell() {
+    // Cell might be destroyed by an exception while recording
+    if (recorded_cell == this)
+        recorded_cell = nullptr;
+}
+
+bool Cell::replay() {
+    auto data = utils::read_file(entry_path);
+    if (!data || data->size() < sizeof(EntryHeader)) {
+        LOGMAX("No note cache entry " << entry_path);
+        return false;
+    }
+    EntryHeader header;
+    std::memcpy(&header, data->data(), sizeof(header));
+    if (std::memcmp(header.magic, NOTE_CACHE_MAGIC, sizeof(header.magic)) != 0
+            || header.format_version != NOTE_CACHE_FORMAT_VERSION
+            || header.key != key) {
+        LOGMAX("Note cache entry " << entry_path << " is for different cell");
+        return false;
+    }
+    size_t pos = sizeof(header);
+    std::vector<CachedNote> cached;
+    for (uint32_t i = 0; i < header.note_count; ++i) {
+        CachedNote note;
+        if (pos >= data->size())
+            return false;
+        note.kind = static_cast<CachedNote::Kind>((*data)[pos++]);
+        if (!read_str(*data, pos, note.format) || !read_str(*data, pos, note.text)) {
+            LOGMAX("Note cache entry " << entry_path << " is corrupted");
+            return false;
+        }
+        cached.push_back(note);
+    }
+
+    LOGMAX("Replaying note cache entry " << entry_path);
+    for (auto &note: cached) {
+        switch (note.kind) {
+        case CachedNote::Kind::TEXT:
+            clopts::get_note_stream() << note.text;
+            if (clopts::print_notes)
+                outs << note.text;
+            break;
+        case CachedNote::Kind::STRING_VALUE:
+            Interpreter::add_generator_note(StringValue::get(note.text));
+            break;
+        case CachedNote::Kind::NOTE_VALUE:
+            Interpreter::add_generator_note(new NoteValue(note.format, StringValue::get(note.text)));
+            break;
+        }
+    }
+    return true;
+}
+
+void Cell::begin_recording() {
+    assert(!recorded_cell && "Cells cannot be nested");
+    recorded_cell = this;
+}
+
+void Cell::end_recording() {
+    namespace fs = std::filesystem;
+    recorded_cell = nullptr;
+    // Cell with no output is most likely run for its side effects
+    if (!cacheable || notes.empty())
+        return;
+
+    EntryHeader header;
+    std::memcpy(header.magic, NOTE_CACHE_MAGIC, sizeof(header.magic));
+    header.format_version = NOTE_CACHE_FORMAT_VERSION;
+    header.note_count = static_cast<uint32_t>(notes.size());
+    header.key = key;
+    ustring data(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (auto &note: notes) {
+        data.push_back(static_cast<char>(note.kind));
+        append_u32(data, static_cast<uint32_t>(note.format.size()));
+        data += note.format;
+        append_u32(data, static_cast<uint32_t>(note.text.size()));
+        data += note.text;
+    }
+
+    std::error_code ec;
+    fs::create_directories(fs::path(entry_path).parent_path(), ec);
+    if (ec) {
+        LOGMAX("Could not create note cache directory for " << entry_path << ": " << ec.message());
+        return;
+    }
+    auto tmp_path = entry_path + "." + std::to_string(std::random_device{}()) + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+        if (!out) {
+            LOGMAX("Could not write note cache entry " << tmp_path);
+            out.close();
+            fs::remove(tmp_path, ec);
+            return;
+        }
+    }
+    fs::rename(tmp_path, entry_path, ec);
+    if (ec) {
+        LOGMAX("Could not write note cache entry " << entry_path << ": " << ec.message());
+        fs::remove(tmp_path, ec);
+    }
+}
+
+CellChain::CellChain() : dir(args::get(clopts::note_cache_dir)), hashed_modules(0) {
+    // Output differs for each version and output format
+    hash = hash_str(MOSS_VERSION, utils::fnv1a(nullptr, 0));
+    hash = hash_str(clopts::get_note_format(), hash);
+}
+
+std::optional<Cell> CellChain::next_cell(std::list<ir::IR *> &decls, const ustring &documentation, Scanner &scanner) {
+    for (; hashed_modules < loaded_modules.size(); ++hashed_modules) {
+        auto &path = loaded_modules[hashed_modules];
+        auto contents = utils::read_file(path);
+        hash = hash_str(path, hash);
+        uint64_t mod_hash = contents ? utils::checksum(contents->data(), contents->size()) : 0;
+        hash = utils::fnv1a(reinterpret_cast<const char *>(&mod_hash), sizeof(mod_hash), hash);
+    }
+    hash = hash_str(documentation, hash);
+
+    bool cacheable = !decls.empty();
+    for (auto d: decls) {
+        auto lines = d->get_src_info().get_lines();
+        for (unsigned l = lines.first; l <= lines.second && l < scanner.get_src_line_count(); ++l)
+            hash = hash_str(scanner.get_src_line(l), hash);
+        if (!is_output_decl(d))
+            cacheable = false;
+    }
+    if (!cacheable)
+        return std::nullopt;
+    auto name = utils::formatv("%016llx.note", static_cast<unsigned long long>(hash));
+    return Cell(hash, (std::filesystem::path(dir) / name).string());
+}
+
+void note_cache::record_generator_note(Value *v) {
+    if (!recorded_cell)
+        return;
+    if (auto nv = dyn_cast<NoteValue>(v)) {
+        recorded_cell->add_note(CachedNote{CachedNote::Kind::NOTE_VALUE, nv->get_format(), nv->get_value()});
+    } else if (auto sv = dyn_cast<StringValue>(v)) {
+        recorded_cell->add_note(CachedNote{CachedNote::Kind::STRING_VALUE, "", sv->get_value()});
+    } else {
+        // Generator might use the value itself, not just its string
+        recorded_cell->set_uncacheable();
+    }
+}
+
+void note_cache::module_loaded(const ustring &path) {
+    if (is_enabled())
+        loaded_modules.push_back(path);
+}
@@ -0,0 +1,117 @@
+///
+/// \file note_cache.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Cache of notes output by top-level cells of the main module
+///
+/// With --note-cache the main module is run cell by cell, where a cell is
+/// a top-level declaration. Notes output by an expression cell are stored
+/// under a key made from the cell's source, the sources of all preceding
+/// cells and the contents of all modules loaded before it. When the
+/// document is generated again, the notes of an unchanged cell are replayed
+/// instead of running it. Cells that define anything (assignments,
+/// functions, classes, imports, ...) are always run, so that the cells that
+/// have to be run see the same state.
+///
+
+#ifndef _NOTE_CACHE_HPP_
+#define _NOTE_CACHE_HPP_
+
+#include "commons.hpp"
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <vector>
+
+namespace moss {
+
+class Value;
+class Scanner;
+
+namespace ir {
+    class IR;
+}
+
+/// Namespace for the cell output cache
+namespace note_cache {
+
+/// \return true if output of cells should be cached
+bool is_enabled();
+
+/// Note output by a cell
+struct CachedNote {
+    enum class Kind : uint8_t {
+        TEXT,           ///< Text written to the note stream
+        STRING_VALUE,   ///< String passed to the generator
+        NOTE_VALUE      ///< Note passed to the generator
+    };
+    Kind kind;
+    ustring format;
+    ustring text;
+};
+
+/// Cached cell which can be replayed or recorded
+class Cell {
+private:
+    uint64_t key;
+    ustring entry_path;
+    std::vector<CachedNote> notes;
+    bool cacheable;
+public:
+    Cell(uint64_t key, ustring entry_path) : key(key), entry_path(entry_path), cacheable(true) {}
+    ~Cell();
+
+    /// Outputs cached notes of this cell
+    /// \return false if there is no entry for this cell
+    bool replay();
+
+    /// Starts recording notes output by this cell
+    void begin_recording();
+
+    /// Stops recording and stores recorded notes unless they could not be
+    /// cached (they contain non-string value or there are none)
+    void end_recording();
+
+    void add_note(CachedNote note) { notes.push_back(note); }
+    void set_uncacheable() { cacheable = false; }
+};
+
+/// \brief Chain of cells of the main module
+/// Each cell's key depends on all the cells before it.
+class CellChain {
+private:
+    uint64_t hash;
+    ustring dir;
+    size_t hashed_modules;
+public:
+    CellChain();
+
+    /// Adds declarations of a cell into the chain
+    /// \param decls Parsed top-level declarations of the cell
+    /// \param documentation Module documentation (set only for the first cell)
+    /// \return Cell which can be cached or nullopt if the cell has to be run
+    std::optional<Cell> next_cell(std::list<ir::IR *> &decls, const ustring &documentation, Scanner &scanner);
+};
+
+/// Cell whose output is being recorded or nullptr
+extern Cell *recorded_cell;
+
+/// Records text output into the note stream
+inline void record_output(const ustring &text) {
+    if (recorded_cell)
+        recorded_cell->add_note(CachedNote{CachedNote::Kind::TEXT, "", text});
+}
+
+/// Records value passed to the generator
+void record_generator_note(Value *v);
+
+/// Adds loaded module into keys of the following cells
+void module_loaded(const ustring &path);
+
+}
+
+}
+
+#endif//_NOTE_CACHE_HPP_
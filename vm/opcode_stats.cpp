@@ -0,0 +1,144 @@
+#include "opcode_stats.hpp"
+#include "interpreter.hpp"
+#include "bytecode.hpp"
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iomanip>
+
+using namespace moss;
+using namespace moss::opstats;
+
+namespace {
+
+constexpr size_t KINDS = 256;
+
+/// Statistics for one bytecode address
+struct AddrStats {
+    ustring file;
+    opcode::Address bci;
+    unsigned line;
+    opcode::OpCodes type;
+    unsigned long count;
+    unsigned long ns;
+};
+
+struct AddrKey {
+    Bytecode *code;
+    opcode::Address bci;
+
+    bool operator==(const AddrKey &other) const {
+        return code == other.code && bci == other.bci;
+    }
+};
+
+struct AddrKeyHash {
+    size_t operator()(const AddrKey &k) const {
+        return std::hash<Bytecode *>()(k.code) ^ (std::hash<opcode::Address>()(k.bci) << 1);
+    }
+};
+
+std::array<unsigned long, KINDS> counts{};
+std::array<unsigned long, KINDS> times{};
+std::array<ustring, KINDS> mnems;
+std::vector<unsigned long> pairs; ///< KINDS x KINDS matrix, allocated on first use
+std::unordered_map<AddrKey, AddrStats, AddrKeyHash> addrs;
+int prev_type = -1;
+
+}
+
+void moss::opstats::record(Interpreter *vm, opcode::Address bci, opcode::OpCode *op, Clock::time_point start) {
+    unsigned long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    auto type = op->get_type();
+    if (counts[type] == 0)
+        mnems[type] = op->get_mnem();
+    ++counts[type];
+    times[type] += ns;
+
+    if (prev_type >= 0) {
+        if (pairs.empty())
+            pairs.resize(KINDS * KINDS, 0);
+        ++pairs[prev_type * KINDS + type];
+    }
+    prev_type = type;
+
+    AddrKey key{vm->get_code(), bci};
+    auto it = addrs.find(key);
+    if (it == addrs.end()) {
+        auto file = vm->get_src_file() ? vm->get_src_file()->get_name() : "??";
+        it = addrs.emplace(key, AddrStats{file, bci, vm->get_code()->get_line(bci), type, 0, 0}).first;
+    }
+    ++it->second.count;
+    it->second.ns += ns;
+}
+
+static double as_ms(unsigned long ns) {
+    return ns / 1'000'000.0;
+}
+
+void moss::opstats::report(std::ostream &os) {
+    unsigned long total = 0;
+    unsigned long total_ns = 0;
+    std::vector<size_t> kinds;
+    for (size_t i = 0; i < KINDS; ++i) {
+        if (counts[i] > 0) {
+            kinds.push_back(i);
+            total += counts[i];
+            total_ns += times[i];
+        }
+    }
+    os << "\n=== Opcode statistics: " << total << " executed ===\n";
+    if (total == 0)
+        return;
+    os << std::fixed;
+
+    std::stable_sort(kinds.begin(), kinds.end(), [](size_t a, size_t b) {
+        return counts[a] > counts[b];
+    });
+    os << "Opcodes:\n"
+       << std::setw(12) << "count" << std::setw(9) << "count %"
+       << std::setw(13) << "time (ms)" << std::setw(9) << "time %" << "  opcode\n";
+    for (auto k: kinds) {
+        os << std::setw(12) << counts[k]
+           << std::setw(8) << std::setprecision(2) << 100.0 * counts[k] / total << "%"
+           << std::setw(13) << std::setprecision(3) << as_ms(times[k])
+           << std::setw(8) << std::setprecision(2) << (total_ns ? 100.0 * times[k] / total_ns : 0.0) << "%"
+           << "  " << mnems[k] << "\n";
+    }
+
+    std::vector<std::pair<size_t, unsigned long>> hot_pairs;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (pairs[i] > 0)
+            hot_pairs.push_back({i, pairs[i]});
+    }
+    std::stable_sort(hot_pairs.begin(), hot_pairs.end(), [](auto &a, auto &b) {
+        return a.second > b.second;
+    });
+    os << "Opcode pairs:\n"
+       << std::setw(12) << "count" << std::setw(9) << "count %" << "  pair\n";
+    for (size_t i = 0; i < hot_pairs.size() && i < TOP_N; ++i) {
+        auto p = hot_pairs[i];
+        os << std::setw(12) << p.second
+           << std::setw(8) << std::setprecision(2) << 100.0 * p.second / total << "%"
+           << "  " << mnems[p.first / KINDS] << " -> " << mnems[p.first % KINDS] << "\n";
+    }
+
+    std::vector<const AddrStats *> hot_addrs;
+    for (auto &[k, v]: addrs) {
+        hot_addrs.push_back(&v);
+    }
+    std::stable_sort(hot_addrs.begin(), hot_addrs.end(), [](auto a, auto b) {
+        return a->count > b->count;
+    });
+    os << "Hot addresses:\n"
+       << std::setw(12) << "count" << std::setw(13) << "time (ms)" << "  location\n";
+    for (size_t i = 0; i < hot_addrs.size() && i < TOP_N; ++i) {
+        auto a = hot_addrs[i];
+        os << std::setw(12) << a->count
+           << std::setw(13) << std::setprecision(3) << as_ms(a->ns)
+           << "  " << a->file << ":" << (a->line ? std::to_string(a->line) : "?")
+           << " [" << a->bci << "] " << mnems[a->type] << "\n";
+    }
+    os << std::defaultfloat;
+}
@@ -0,0 +1,48 @@
+///
+/// \file opcode_stats.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Per-opcode execution counters and timing
+///
+/// Statistics are recorded only by the instrumented dispatch loop, which
+/// the interpreter selects when --opcode-stats is set. Time of opcodes
+/// which run nested code (calls to functions, imports) includes the time
+/// of the nested opcodes.
+///
+
+#ifndef _OPCODE_STATS_HPP_
+#define _OPCODE_STATS_HPP_
+
+#include "opcode.hpp"
+#include "commons.hpp"
+#include <chrono>
+
+namespace moss {
+
+class Interpreter;
+
+/// Namespace for opcode statistics resources
+namespace opstats {
+
+using Clock = std::chrono::steady_clock;
+
+/// Amount of opcode pairs and bytecode addresses in the report
+constexpr size_t TOP_N = 20;
+
+/// \brief Records one execution of an opcode
+/// \param vm Interpreter which executed the opcode
+/// \param bci Address of the opcode
+/// \param op Executed opcode
+/// \param start Time when the execution started
+void record(Interpreter *vm, opcode::Address bci, opcode::OpCode *op, Clock::time_point start);
+
+/// \brief Outputs collected statistics
+void report(std::ostream &os);
+
+}
+
+}
+
+#endif//_OPCODE_STATS_HPP_
@@ -0,0 +1,181 @@
+#include "profiler.hpp"
+#include "interpreter.hpp"
+#include "memory.hpp"
+#include "values.hpp"
+#include "errors.hpp"
+#include "logging.hpp"
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <csignal>
+#ifndef __windows__
+#include <sys/time.h>
+#endif
+
+using namespace moss;
+using namespace moss::profiler;
+
+namespace {
+
+/// Collected samples
+struct Profile {
+    std::ofstream out;
+    std::map<ustring, unsigned long> stacks;   ///< Folded stack -> samples
+    std::map<ustring, unsigned long> fun_self; ///< Function -> self samples
+    std::map<ustring, unsigned long> line_self; ///< file:line -> self samples
+    unsigned long samples = 0;
+};
+
+/// One moss frame of a sample
+struct FrameSample {
+    Interpreter *vm;
+    CallFrame *cf;
+    ustring name;
+};
+
+Profile *profile = nullptr;
+
+}
+
+#ifndef __windows__
+static void on_timer(int) {
+    // Opcode might run for multiple intervals (e.g. GC or builtin call),
+    // so all the expirations are counted to weight the sample
+    global_controls::profile_tick = global_controls::profile_tick + 1;
+}
+
+static void set_timer(unsigned interval_us) {
+    struct itimerval timer{};
+    timer.it_interval.tv_sec = interval_us / 1'000'000;
+    timer.it_interval.tv_usec = interval_us % 1'000'000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+#endif
+
+void moss::profiler::start(ustring out_path) {
+    assert(!profile && "Profiler started twice");
+#ifdef __windows__
+    (void)out_path;
+    error::warning("Profiling is not supported on this platform");
+#else
+    profile = new Profile();
+    profile->out.open(out_path);
+    if (!profile->out) {
+        ustring msg = "Cannot open profile output file '" + out_path + "'";
+        error::error(error::ErrorCode::FILE_ACCESS, msg.c_str());
+    }
+    LOG1("Profiler started with output to " << out_path);
+
+    struct sigaction sa{};
+    sa.sa_handler = on_timer;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &sa, nullptr);
+    set_timer(SAMPLE_INTERVAL_US);
+#endif
+}
+
+bool moss::profiler::is_running() {
+    return profile != nullptr;
+}
+
+static ustring get_file_name(Interpreter *vm) {
+    if (!vm || !vm->get_src_file())
+        return "??";
+    return vm->get_src_file()->get_name();
+}
+
+void moss::profiler::sample(Interpreter *vm) {
+    unsigned long weight = global_controls::profile_tick;
+    global_controls::profile_tick = 0;
+    if (!profile || weight == 0)
+        return;
+
+    std::vector<FrameSample> frames;
+    for (auto fi: Interpreter::get_stack_frames()) {
+        auto owner = fi.frame->get_pool_owner();
+        if (auto f = owner ? dyn_cast<FunValue>(owner) : nullptr) {
+            auto fvm = f->get_vm() ? f->get_vm() : fi.frame->get_vm_owner();
+            frames.push_back(FrameSample{fvm, fi.call_frame, f->get_name()});
+        } else if (fi.frame->is_global()) {
+            frames.push_back(FrameSample{fi.frame->get_vm_owner(), fi.call_frame, "<module>"});
+        }
+        // Other frames are blocks of their enclosing frame
+    }
+    if (frames.empty())
+        frames.push_back(FrameSample{vm, nullptr, "<module>"});
+
+    ustring folded;
+    ustring leaf_fun;
+    ustring leaf_line;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        auto &fs = frames[i];
+        opcode::Address bci = fs.vm->get_bci();
+        // Caller's position is the call opcode, which is right before the
+        // return address. Interpreters of other modules are stopped at the
+        // call so their bci can be used.
+        if (i + 1 < frames.size()) {
+            auto callee = frames[i + 1];
+            if (callee.cf && callee.vm == fs.vm && callee.cf->get_caller_addr() > 0)
+                bci = callee.cf->get_caller_addr() - 1;
+        }
+        unsigned line = fs.vm->get_code()->get_line(bci);
+        auto file = get_file_name(fs.vm);
+        auto line_str = file + ":" + (line ? std::to_string(line) : "?");
+
+        if (!folded.empty())
+            folded += ";";
+        folded += fs.name + " (" + line_str + ")";
+        leaf_fun = fs.name + " (" + file + ")";
+        leaf_line = line_str;
+    }
+
+    profile->stacks[folded] += weight;
+    profile->fun_self[leaf_fun] += weight;
+    profile->line_self[leaf_line] += weight;
+    profile->samples += weight;
+}
+
+static void output_table(std::ostream &os, ustring title, std::map<ustring, unsigned long> &data, unsigned long total) {
+    std::vector<std::pair<ustring, unsigned long>> rows(data.begin(), data.end());
+    std::stable_sort(rows.begin(), rows.end(), [](auto &a, auto &b) {
+        return a.second > b.second;
+    });
+    os << title << ":\n"
+       << std::setw(10) << "samples" << std::setw(9) << "self %" << "  " << "location\n";
+    for (size_t i = 0; i < rows.size() && i < TABLE_ROWS; ++i) {
+        double pct = 100.0 * rows[i].second / total;
+        os << std::setw(10) << rows[i].second
+           << std::setw(8) << std::fixed << std::setprecision(2) << pct << "%"
+           << "  " << rows[i].first << "\n";
+    }
+}
+
+void moss::profiler::stop() {
+    if (!profile)
+        return;
+#ifndef __windows__
+    set_timer(0);
+    std::signal(SIGPROF, SIG_DFL);
+#endif
+    LOG1("Profiler stopped with " << profile->samples << " samples");
+
+    for (auto &[stack, count]: profile->stacks) {
+        profile->out << stack << " " << count << "\n";
+    }
+    profile->out.close();
+
+    errs << "\n=== Profile: " << profile->samples << " samples ("
+         << SAMPLE_INTERVAL_US << " us interval) ===\n";
+    if (profile->samples > 0) {
+        output_table(errs, "Self time by function", profile->fun_self, profile->samples);
+        output_table(errs, "Self time by line", profile->line_self, profile->samples);
+        errs << std::defaultfloat;
+    }
+
+    delete profile;
+    profile = nullptr;
+}
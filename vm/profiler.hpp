@@ -0,0 +1,57 @@
+///
+/// \file profiler.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Sampling profiler for moss code
+///
+/// Profiling timer (SIGPROF) only sets a flag, the sample itself is taken by
+/// the interpreter before the next opcode is executed. A sample is the moss
+/// call stack built from Interpreter::stack_frames where every frame is
+/// mapped to a source line using the bytecode line table.
+///
+/// Output is a file with folded stacks (one stack per line followed by its
+/// sample count), which can be passed to flamegraph tools, and a table of
+/// self time per function and line printed to the error stream.
+///
+
+#ifndef _PROFILER_HPP_
+#define _PROFILER_HPP_
+
+#include "commons.hpp"
+
+namespace moss {
+
+class Interpreter;
+
+/// Namespace for moss code profiler resources
+namespace profiler {
+
+/// Time between 2 samples in microseconds (CPU time of the process)
+constexpr unsigned SAMPLE_INTERVAL_US = 1000;
+
+/// Amount of rows in the self time tables
+constexpr size_t TABLE_ROWS = 20;
+
+/// \brief Starts sampling
+/// \param out_path File into which folded stacks will be written on stop
+void start(ustring out_path);
+
+/// \brief Records current moss call stack
+/// This is called by the interpreter once the timer has expired.
+/// \param vm Currently running interpreter
+void sample(Interpreter *vm);
+
+/// \brief Stops sampling and outputs collected profile
+/// Does nothing if profiler was not started.
+void stop();
+
+/// \return true if profiler is running
+bool is_running();
+
+}
+
+}
+
+#endif//_PROFILER_HPP_
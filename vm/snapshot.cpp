@@ -0,0 +1,768 @@
+#include "snapshot.hpp"
+#include "interpreter.hpp"
+#include "values.hpp"
+#include "memory.hpp"
+#include "errors.hpp"
+#include "logging.hpp"
+#include "moss.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <unordered_map>
+
+using namespace moss;
+using namespace snapshot;
+
+/// Has to be increased on every change of the snapshot format
+static constexpr uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+static constexpr char SNAPSHOT_MAGIC[8] = {'M', 'S', 'S', 'N', 'A', 'P', 'S', 'H'};
+
+ustring LibmsSnapshot::output_path = "";
+std::vector<Value *> LibmsSnapshot::externals{};
+std::vector<MemoryPool *> LibmsSnapshot::external_pools{};
+std::unordered_set<Value *> LibmsSnapshot::existing_values{};
+
+namespace {
+
+/// Header of the snapshot file, all the values are stored in native
+/// byte order as snapshot is created for and by the installed interpreter
+struct Header {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t moss_version;
+    uint32_t msb_checksum;      ///< Checksum from header of libms.msb the snapshot was created from
+    uint32_t msb_timestamp;     ///< Timestamp from header of libms.msb the snapshot was created from
+    uint64_t payload_checksum;  ///< Checksum of everything after the header
+    uint32_t external_values;   ///< Amount of values existing before libms run
+    uint32_t external_pools;    ///< Amount of pools existing before libms run
+    uint64_t externals_hash;    ///< Hash of kinds and names of external values
+};
+
+}
+
+/// Walk of the heap which assigns each reached value and pool an index.
+/// Order of the walk is deterministic for the same heap so that values
+/// existing before libms run can be referenced by their index.
+class LibmsSnapshot::HeapWalk {
+public:
+    std::vector<Value *> values;
+    std::vector<MemoryPool *> pools;
+    std::unordered_map<Value *, uint32_t> value_ids;
+    std::unordered_map<MemoryPool *, uint32_t> pool_ids;
+
+    void add(Value *v) {
+        if (!v || value_ids.find(v) != value_ids.end())
+            return;
+        value_ids[v] = static_cast<uint32_t>(values.size());
+        values.push_back(v);
+    }
+
+    void add(MemoryPool *p) {
+        if (!p || pool_ids.find(p) != pool_ids.end())
+            return;
+        pool_ids[p] = static_cast<uint32_t>(pools.size());
+        pools.push_back(p);
+    }
+
+    /// Adds values that libms vm holds (its module, global and constant frame)
+    void add_roots(Interpreter *vm) {
+        add(vm->get_vms_module());
+        add(vm->get_global_frame());
+        add(vm->get_global_const_pool());
+    }
+
+    /// Visits all values and pools reachable from the already added ones
+    void walk() {
+        while (next_value < values.size() || next_pool < pools.size()) {
+            while (next_pool < pools.size())
+                visit(pools[next_pool++]);
+            if (next_value < values.size())
+                visit(values[next_value++]);
+        }
+    }
+
+    /// Hash of kinds and names of first `amount` values
+    uint64_t hash(size_t amount) const {
+        uint64_t h = utils::fnv1a(nullptr, 0);
+        for (size_t i = 0; i < amount; ++i) {
+            auto kind = static_cast<char>(values[i]->kind);
+            h = utils::fnv1a(&kind, 1, h);
+            h = utils::fnv1a(values[i]->name.data(), values[i]->name.size() + 1, h);
+        }
+        return h;
+    }
+
+    /// \return registers of pool in ascending order
+    static std::vector<opcode::Register> sorted_registers(MemoryPool *p) {
+        std::vector<opcode::Register> regs;
+        regs.reserve(p->pool.size());
+        for (auto &[r, _]: p->pool)
+            regs.push_back(r);
+        std::sort(regs.begin(), regs.end());
+        return regs;
+    }
+private:
+    size_t next_value = 0;
+    size_t next_pool = 0;
+
+    void visit(Value *v) {
+        add(v->type);
+        add(v->owner);
+        for (auto &[_, a]: v->annotations)
+            add(a);
+        add(v->attrs);
+        switch (v->kind) {
+            case TypeKind::LIST:
+                for (auto e: static_cast<ListValue *>(v)->get_vals())
+                    add(e);
+            break;
+            case TypeKind::DICT:
+                for (const auto &[_, k, e]: *static_cast<DictValue *>(v)) {
+                    add(k);
+                    add(e);
+                }
+            break;
+            case TypeKind::CLASS:
+                for (auto s: static_cast<ClassValue *>(v)->supers)
+                    add(s);
+            break;
+            case TypeKind::FUN: {
+                auto f = static_cast<FunValue *>(v);
+                for (auto a: f->args) {
+                    for (auto t: a->types)
+                        add(t);
+                    add(a->default_value);
+                }
+                add(f->parent_class);
+                for (auto c: f->closures)
+                    add(c);
+            }
+            break;
+            case TypeKind::FUN_LIST:
+                for (auto f: static_cast<FunValueList *>(v)->get_funs())
+                    add(f);
+            break;
+            case TypeKind::ENUM:
+                for (auto e: static_cast<EnumTypeValue *>(v)->get_values())
+                    add(e);
+            break;
+            case TypeKind::SPACE:
+                for (auto o: static_cast<SpaceValue *>(v)->extra_owners)
+                    add(o);
+            break;
+            default: break;
+        }
+    }
+
+    void visit(MemoryPool *p) {
+        for (auto r: sorted_registers(p))
+            add(p->pool[r]);
+        for (auto s: p->spilled_values)
+            add(s);
+        add(p->pool_owner);
+        for (auto &c: p->catches)
+            add(c.type);
+    }
+};
+
+/// Serializes walked heap
+class LibmsSnapshot::Writer {
+private:
+    Interpreter *vm;
+    HeapWalk &walk;
+    size_t ext_values;
+    size_t ext_pools;
+    ustring out;
+    std::unordered_map<MemoryPool *, uint32_t> pool_numbers; ///< Index of written pool (shared pools have the same)
+    std::vector<MemoryPool *> written_pools;
+
+    [[noreturn]] void fail(ustring msg) {
+        msg = "Cannot create libms snapshot: " + msg;
+        error::error(error::ErrorCode::INTERNAL, msg.c_str());
+        std::exit(1);
+    }
+
+    template<typename T>
+    void write(T v) {
+        out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    void write(const ustring &s) {
+        write<uint32_t>(static_cast<uint32_t>(s.size()));
+        out.append(s);
+    }
+
+    void write_size(size_t s) { write<uint32_t>(static_cast<uint32_t>(s)); }
+
+    void write_ref(Value *v) {
+        write<uint32_t>(v ? walk.value_ids.at(v) + 1 : 0);
+    }
+
+    void write_ref(MemoryPool *p) {
+        write<uint32_t>(p ? pool_numbers.at(p) + 1 : 0);
+    }
+
+    void write_vm(Interpreter *i) {
+        if (i && i != vm)
+            fail("value is owned by other interpreter than libms");
+        write<uint8_t>(i ? 1 : 0);
+    }
+
+    /// Data needed to allocate a new value
+    void write_alloc(Value *v) {
+        write<uint8_t>(static_cast<uint8_t>(v->kind));
+        write(v->name);
+        switch (v->kind) {
+            case TypeKind::INT: {
+                // Interned Ints are all external and new one would be
+                // restored as the interned one
+                auto i = static_cast<IntValue *>(v)->get_value();
+                if (i >= -5 && i <= 256)
+                    fail("Int " + std::to_string(i) + " is not interned");
+                write<opcode::IntConst>(i);
+            }
+            break;
+            case TypeKind::FLOAT: write(static_cast<FloatValue *>(v)->get_value()); break;
+            case TypeKind::STRING: write(static_cast<StringValue *>(v)->get_value()); break;
+            case TypeKind::NOTE: {
+                auto n = static_cast<NoteValue *>(v);
+                write(n->get_format());
+                write(n->get_value());
+            }
+            break;
+            case TypeKind::FUN: {
+                auto f = static_cast<FunValue *>(v);
+                if (!f->catches.empty())
+                    fail("function " + f->name + " has catches");
+                write_vm(f->vm);
+                write(f->body_addr);
+            }
+            break;
+            case TypeKind::SPACE: {
+                auto s = static_cast<SpaceValue *>(v);
+                write_vm(s->owner_vm);
+                write<uint8_t>(s->anonymous);
+            }
+            break;
+            case TypeKind::LIST:
+            case TypeKind::DICT:
+            case TypeKind::CLASS:
+            case TypeKind::FUN_LIST:
+            case TypeKind::ENUM:
+            case TypeKind::ENUM_VALUE:
+            break;
+            default:
+                fail("unsupported value of kind " + TypeKind2String(v->kind) + " (" + v->name + ")");
+        }
+    }
+
+    /// References to other values and pools
+    void write_links(Value *v) {
+        write_ref(v->type);
+        write_ref(v->owner);
+        write_ref(v->attrs);
+        write_size(v->annotations.size());
+        for (auto &[n, a]: v->annotations) {
+            write(n);
+            write_ref(a);
+        }
+        switch (v->kind) {
+            case TypeKind::LIST: {
+                auto &vals = static_cast<ListValue *>(v)->get_vals();
+                write_size(vals.size());
+                for (auto e: vals)
+                    write_ref(e);
+            }
+            break;
+            case TypeKind::DICT: {
+                auto d = static_cast<DictValue *>(v);
+                write_size(d->insertion_order.size());
+                for (auto k: d->insertion_order) {
+                    auto &bucket = d->vals.at(k);
+                    write(k);
+                    write_size(bucket.size());
+                    for (auto [bk, bv]: bucket) {
+                        write_ref(bk);
+                        write_ref(bv);
+                    }
+                }
+            }
+            break;
+            case TypeKind::CLASS: {
+                auto &supers = static_cast<ClassValue *>(v)->supers;
+                write_size(supers.size());
+                for (auto s: supers)
+                    write_ref(s);
+            }
+            break;
+            case TypeKind::FUN: {
+                auto f = static_cast<FunValue *>(v);
+                write_size(f->args.size());
+                for (auto a: f->args) {
+                    write(a->name);
+                    write_size(a->types.size());
+                    for (auto t: a->types)
+                        write_ref(t);
+                    write_ref(a->default_value);
+                    write<uint8_t>(a->vararg);
+                }
+                write_ref(f->parent_class);
+                write_size(f->closures.size());
+                for (auto c: f->closures)
+                    write_ref(c);
+            }
+            break;
+            case TypeKind::FUN_LIST: {
+                auto &funs = static_cast<FunValueList *>(v)->get_funs();
+                write_size(funs.size());
+                for (auto f: funs)
+                    write_ref(f);
+            }
+            break;
+            case TypeKind::ENUM: {
+                auto vals = static_cast<EnumTypeValue *>(v)->get_values();
+                write_size(vals.size());
+                for (auto e: vals)
+                    write_ref(e);
+            }
+            break;
+            case TypeKind::SPACE: {
+                auto &owners = static_cast<SpaceValue *>(v)->extra_owners;
+                write_size(owners.size());
+                for (auto o: owners)
+                    write_ref(o);
+            }
+            break;
+            default: break;
+        }
+    }
+
+    void write_pool(MemoryPool *p) {
+        if (!p->catches.empty() || p->finally_stack.size() != 1 || !p->finally_stack.back().empty())
+            fail("frame with active try or finally block");
+        write_ref(p->pool_owner);
+        auto regs = HeapWalk::sorted_registers(p);
+        write_size(regs.size());
+        for (auto r: regs) {
+            write(r);
+            write_ref(p->pool[r]);
+        }
+        write_size(p->sym_table.size());
+        for (auto &[n, r]: p->sym_table) {
+            write(n);
+            write(r);
+        }
+        write_size(p->spilled_values.size());
+        for (auto s: p->spilled_values)
+            write_ref(s);
+    }
+    ustring pool_content(MemoryPool *p) {
+        ustring content;
+        std::swap(content, out);
+        write_pool(p);
+        std::swap(content, out);
+        return content;
+    }
+
+    /// Assigns indices to written pools.
+    /// Attributes of values which cannot be modified do not change after the
+    /// value is created, so the ones with the same content (mostly methods
+    /// cloned from the value's class) are written as one shared pool.
+    void number_pools() {
+        std::unordered_map<MemoryPool *, unsigned> refs;
+        std::unordered_set<MemoryPool *> immutable_attrs;
+        for (auto v: walk.values) {
+            if (v->attrs) {
+                ++refs[v->attrs];
+                if (!v->is_modifiable())
+                    immutable_attrs.insert(v->attrs);
+            }
+            if (auto f = dyn_cast<FunValue>(v)) {
+                for (auto c: f->closures)
+                    ++refs[c];
+            }
+        }
+        std::unordered_map<ustring, uint32_t> shared;
+        for (size_t i = 0; i < walk.pools.size(); ++i) {
+            auto p = walk.pools[i];
+            if (i >= ext_pools && refs[p] == 1 && immutable_attrs.count(p)) {
+                auto [it, inserted] = shared.try_emplace(pool_content(p), written_pools.size());
+                if (!inserted) {
+                    pool_numbers[p] = it->second;
+                    continue;
+                }
+            }
+            pool_numbers[p] = written_pools.size();
+            written_pools.push_back(p);
+        }
+    }
+public:
+    Writer(Interpreter *vm, HeapWalk &walk, size_t ext_values, size_t ext_pools)
+        : vm(vm), walk(walk), ext_values(ext_values), ext_pools(ext_pools) {}
+
+    /// \return serialized heap (without the header)
+    ustring write_heap() {
+        if (vm->frames.size() != 1 || vm->const_pools.size() != 1 || !vm->call_frames.empty())
+            fail("libms did not finish in its global frame");
+        write_size(walk.values.size() - ext_values);
+        for (size_t i = ext_values; i < walk.values.size(); ++i) {
+            auto v = walk.values[i];
+            if (LibmsSnapshot::existing_values.find(v) != LibmsSnapshot::existing_values.end())
+                fail(v->name + " created before libms run is reachable only after the run");
+            write_alloc(v);
+        }
+        number_pools();
+        write_size(written_pools.size() - ext_pools);
+        for (size_t i = ext_pools; i < written_pools.size(); ++i) {
+            auto p = written_pools[i];
+            write_vm(p->vm_owner);
+            write<uint8_t>(p->holds_consts);
+            write<uint8_t>(p->global);
+        }
+        for (auto v: walk.values)
+            write_links(v);
+        for (auto p: written_pools)
+            write_pool(p);
+
+        write_size(Interpreter::converters.size());
+        for (auto &[k, f]: Interpreter::converters) {
+            write(k.first);
+            write(k.second);
+            write_ref(f);
+        }
+        write_size(Interpreter::generators.size());
+        for (auto &[k, f]: Interpreter::generators) {
+            write(k);
+            write_ref(f);
+        }
+        write(MemoryPool::dynamic_register_am);
+        return out;
+    }
+};
+
+/// Restores heap written by the Writer
+/// \note Reader expects valid data as checksum was already checked.
+class LibmsSnapshot::Reader {
+private:
+    Interpreter *vm;
+    const ustring &data;
+    size_t pos;
+    std::vector<Value *> values;
+    std::vector<MemoryPool *> pools;
+
+    template<typename T>
+    T read() {
+        assert(pos + sizeof(T) <= data.size() && "snapshot read out of bounds");
+        T v;
+        std::memcpy(&v, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    ustring read_str() {
+        auto size = read<uint32_t>();
+        assert(pos + size <= data.size() && "snapshot read out of bounds");
+        ustring s(data, pos, size);
+        pos += size;
+        return s;
+    }
+
+    size_t read_size() { return read<uint32_t>(); }
+
+    Value *read_ref() {
+        auto i = read<uint32_t>();
+        assert(i <= values.size() && "incorrect value reference");
+        return i ? values[i - 1] : nullptr;
+    }
+
+    template<class T>
+    T *read_ref_as() {
+        return static_cast<T *>(read_ref());
+    }
+
+    MemoryPool *read_pool_ref() {
+        auto i = read<uint32_t>();
+        assert(i <= pools.size() && "incorrect pool reference");
+        return i ? pools[i - 1] : nullptr;
+    }
+
+    Interpreter *read_vm() {
+        return read<uint8_t>() ? vm : nullptr;
+    }
+
+    Value *read_alloc() {
+        auto kind = static_cast<TypeKind>(read<uint8_t>());
+        auto name = read_str();
+        Value *v = nullptr;
+        switch (kind) {
+            case TypeKind::INT: v = IntValue::get(read<opcode::IntConst>()); break;
+            case TypeKind::FLOAT: v = FloatValue::get(read<opcode::FloatConst>()); break;
+            case TypeKind::STRING: v = StringValue::get(read_str()); break;
+            case TypeKind::NOTE: {
+                auto format = read_str();
+                v = new NoteValue(format, StringValue::get(read_str()));
+            }
+            break;
+            case TypeKind::FUN: {
+                auto fvm = read_vm();
+                v = new FunValue(name, std::vector<FunValueArg *>{}, fvm, read<opcode::Address>());
+            }
+            break;
+            case TypeKind::SPACE: {
+                auto svm = read_vm();
+                v = new SpaceValue(name, svm, read<uint8_t>());
+            }
+            break;
+            case TypeKind::LIST: v = new ListValue(); break;
+            case TypeKind::DICT: v = new DictValue(); break;
+            case TypeKind::CLASS: v = new ClassValue(name); break;
+            case TypeKind::FUN_LIST: v = new FunValueList(std::vector<FunValue *>{}); break;
+            case TypeKind::ENUM: v = new EnumTypeValue(name); break;
+            case TypeKind::ENUM_VALUE: v = new EnumValue(nullptr, name); break;
+            default:
+                assert(false && "unsupported value kind in snapshot");
+                return nullptr;
+        }
+        v->name = name;
+        // Attributes created by the constructor are replaced by the stored ones
+        delete v->attrs;
+        v->attrs = nullptr;
+        return v;
+    }
+
+    void read_links(Value *v) {
+        v->type = read_ref();
+        v->owner = read_ref_as<ModuleValue>();
+        v->attrs = read_pool_ref();
+        v->annotations.clear();
+        for (auto i = read_size(); i > 0; --i) {
+            auto name = read_str();
+            v->annotations[name] = read_ref();
+        }
+        switch (v->kind) {
+            case TypeKind::LIST: {
+                auto &vals = static_cast<ListValue *>(v)->get_vals();
+                vals.clear();
+                for (auto i = read_size(); i > 0; --i)
+                    vals.push_back(read_ref());
+            }
+            break;
+            case TypeKind::DICT: {
+                auto d = static_cast<DictValue *>(v);
+                d->clear();
+                for (auto i = read_size(); i > 0; --i) {
+                    auto k = read<DictValue::Key>();
+                    auto &bucket = d->vals[k];
+                    for (auto j = read_size(); j > 0; --j) {
+                        auto bk = read_ref();
+                        bucket.push_back({bk, read_ref()});
+                    }
+                    d->insertion_order.push_back(k);
+                }
+            }
+            break;
+            case TypeKind::CLASS: {
+                auto &supers = static_cast<ClassValue *>(v)->supers;
+                supers.clear();
+                for (auto i = read_size(); i > 0; --i)
+                    supers.push_back(read_ref_as<ClassValue>());
+            }
+            break;
+            case TypeKind::FUN: {
+                auto f = static_cast<FunValue *>(v);
+                for (auto a: f->args)
+                    delete a;
+                f->args.clear();
+                for (auto i = read_size(); i > 0; --i) {
+                    auto name = read_str();
+                    std::vector<Value *> types;
+                    for (auto j = read_size(); j > 0; --j)
+                        types.push_back(read_ref());
+                    auto default_value = read_ref();
+                    f->args.push_back(new FunValueArg(name, types, default_value, read<uint8_t>()));
+                }
+                f->parent_class = read_ref_as<ClassValue>();
+                f->closures.clear();
+                for (auto i = read_size(); i > 0; --i)
+                    f->closures.push_back(read_pool_ref());
+            }
+            break;
+            case TypeKind::FUN_LIST: {
+                auto &funs = static_cast<FunValueList *>(v)->get_funs();
+                funs.clear();
+                for (auto i = read_size(); i > 0; --i)
+                    funs.push_back(read_ref_as<FunValue>());
+            }
+            break;
+            case TypeKind::ENUM: {
+                std::vector<EnumValue *> vals;
+                for (auto i = read_size(); i > 0; --i)
+                    vals.push_back(read_ref_as<EnumValue>());
+                static_cast<EnumTypeValue *>(v)->set_values(vals);
+            }
+            break;
+            case TypeKind::SPACE: {
+                auto &owners = static_cast<SpaceValue *>(v)->extra_owners;
+                owners.clear();
+                for (auto i = read_size(); i > 0; --i)
+                    owners.push_back(read_ref_as<ModuleValue>());
+            }
+            break;
+            default: break;
+        }
+    }
+
+    void read_pool(MemoryPool *p) {
+        p->pool_owner = read_ref();
+        p->pool.clear();
+        for (auto i = read_size(); i > 0; --i) {
+            auto r = read<opcode::Register>();
+            p->pool[r] = read_ref();
+        }
+        p->sym_table.clear();
+        for (auto i = read_size(); i > 0; --i) {
+            auto name = read_str();
+            p->sym_table[name] = read<opcode::Register>();
+        }
+        p->spilled_values.clear();
+        for (auto i = read_size(); i > 0; --i)
+            p->spilled_values.push_back(read_ref());
+        // Names changed so any cached lookups into this pool are invalid
+        p->names_version = ++MemoryPool::names_version_cntr;
+    }
+public:
+    Reader(Interpreter *vm, const ustring &data, size_t pos, HeapWalk &walk)
+        : vm(vm), data(data), pos(pos), values(walk.values), pools(walk.pools) {}
+
+    void read_heap() {
+        auto new_values = read_size();
+        values.reserve(values.size() + new_values);
+        for (size_t i = 0; i < new_values; ++i)
+            values.push_back(read_alloc());
+        auto new_pools = read_size();
+        pools.reserve(pools.size() + new_pools);
+        for (size_t i = 0; i < new_pools; ++i) {
+            auto pvm = read_vm();
+            auto holds_consts = read<uint8_t>();
+            pools.push_back(new MemoryPool(pvm, holds_consts, read<uint8_t>()));
+        }
+        for (auto v: values)
+            read_links(v);
+        for (auto p: pools)
+            read_pool(p);
+
+        for (auto i = read_size(); i > 0; --i) {
+            auto from = read_str();
+            auto to = read_str();
+            Interpreter::add_converter(from, to, read_ref_as<FunValue>());
+        }
+        for (auto i = read_size(); i > 0; --i) {
+            auto format = read_str();
+            Interpreter::add_generator(format, read_ref_as<FunValue>());
+        }
+        // Registers for new attributes cannot collide with restored ones
+        auto reg_am = read<opcode::Register>();
+        MemoryPool::dynamic_register_am = std::max(MemoryPool::dynamic_register_am, reg_am);
+        assert(pos == data.size() && "snapshot was not fully read");
+    }
+};
+
+void LibmsSnapshot::begin(Interpreter *libms_vm) {
+    existing_values = std::unordered_set<Value *>(Value::all_values.begin(), Value::all_values.end());
+    HeapWalk walk;
+    walk.add_roots(libms_vm);
+    walk.walk();
+    externals = walk.values;
+    external_pools = walk.pools;
+}
+
+void LibmsSnapshot::write(Interpreter *libms_vm) {
+    LOGMAX("Writing libms snapshot into " << output_path);
+    // Values existing before the run keep their index as their state is
+    // stored as well
+    HeapWalk walk;
+    for (auto v: externals)
+        walk.add(v);
+    for (auto p: external_pools)
+        walk.add(p);
+    walk.walk();
+    for (auto &[_, f]: Interpreter::converters)
+        walk.add(f);
+    for (auto &[_, f]: Interpreter::generators)
+        walk.add(f);
+    walk.walk();
+
+    Writer writer(libms_vm, walk, externals.size(), external_pools.size());
+    auto payload = writer.write_heap();
+
+    auto msb_header = libms_vm->code->get_header();
+    Header header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.format_version = SNAPSHOT_FORMAT_VERSION;
+    header.moss_version = MOSS_VERSION_UINT32;
+    header.msb_checksum = msb_header->checksum;
+    header.msb_timestamp = msb_header->timestamp;
+    header.payload_checksum = utils::checksum(payload.data(), payload.size());
+    header.external_values = static_cast<uint32_t>(externals.size());
+    header.external_pools = static_cast<uint32_t>(external_pools.size());
+    header.externals_hash = walk.hash(externals.size());
+
+    std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(payload.data(), payload.size());
+    if (!out) {
+        ustring msg = "Could not write libms snapshot into " + output_path;
+        error::error(error::ErrorCode::FILE_ACCESS, msg.c_str());
+    }
+
+    output_path.clear();
+    externals.clear();
+    external_pools.clear();
+    existing_values.clear();
+}
+
+bool LibmsSnapshot::restore(Interpreter *libms_vm, ustring msb_path) {
+    auto snapshot_path = std::filesystem::path(msb_path).parent_path() / LIBMS_SNAPSHOT_FILE;
+    auto data = utils::read_file(snapshot_path.string());
+    if (!data || data->size() < sizeof(Header)) {
+        LOGMAX("No libms snapshot at " << snapshot_path);
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, data->data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.format_version != SNAPSHOT_FORMAT_VERSION ||
+            header.moss_version != MOSS_VERSION_UINT32) {
+        LOGMAX("libms snapshot is of different format or version");
+        return false;
+    }
+    auto msb_header = libms_vm->code->get_header();
+    if (!msb_header || header.msb_checksum != msb_header->checksum || header.msb_timestamp != msb_header->timestamp) {
+        LOGMAX("libms snapshot was created for different libms.msb");
+        return false;
+    }
+    if (header.payload_checksum != utils::checksum(data->data() + sizeof(header), data->size() - sizeof(header))) {
+        LOGMAX("libms snapshot is corrupted");
+        return false;
+    }
+
+    HeapWalk walk;
+    walk.add_roots(libms_vm);
+    walk.walk();
+    if (walk.values.size() != header.external_values || walk.pools.size() != header.external_pools ||
+            walk.hash(walk.values.size()) != header.externals_hash) {
+        LOGMAX("libms snapshot was created by different interpreter");
+        return false;
+    }
+
+    Reader reader(libms_vm, *data, sizeof(header), walk);
+    reader.read_heap();
+    // Nothing is to be run as if libms was already interpreted
+    libms_vm->bci = libms_vm->code->size();
+    LOGMAX("Restored libms from snapshot " << snapshot_path);
+    return true;
+}
@@ -0,0 +1,78 @@
+///
+/// \file snapshot.hpp
+/// \author Marek Sedlacek
+/// \copyright Copyright 2026 Marek Sedlacek. All rights reserved.
+///            See accompanied LICENSE file.
+///
+/// \brief Snapshot of libms heap for fast interpreter startup
+///
+/// Running libms creates all of its classes, spaces and functions and binds
+/// them to the built-in types. The snapshot holds the heap after this run and
+/// restoring it relinks the values without interpreting any libms code.
+/// Values which exist before libms is run (built-in classes, interned Ints,
+/// libms frames) are not stored by their content, but by their position in
+/// a walk from the libms vm roots and only their modified state (attributes,
+/// annotations, parents...) is stored.
+///
+
+#ifndef _SNAPSHOT_HPP_
+#define _SNAPSHOT_HPP_
+
+#include "commons.hpp"
+#include <vector>
+#include <unordered_set>
+
+namespace moss {
+
+class Interpreter;
+class Value;
+class MemoryPool;
+
+/// Namespace for heap snapshot resources
+namespace snapshot {
+
+/// Name of libms snapshot file, which is looked up next to libms.msb
+inline constexpr char LIBMS_SNAPSHOT_FILE[] = "libms.snapshot";
+
+/// \brief Snapshot of libms heap
+///
+/// Snapshot is created by running libms (from libms.msb) with recording
+/// enabled and it is restored in place of the run when libms.msb matches
+/// the one used for its creation.
+/// \note This class is a friend of values, memory pools and interpreter to
+///       be able to restore their private state.
+class LibmsSnapshot {
+private:
+    class HeapWalk;
+    class Writer;
+    class Reader;
+
+    static ustring output_path;
+    static std::vector<Value *> externals;           ///< Values reachable from libms before its run
+    static std::vector<MemoryPool *> external_pools; ///< Pools reachable from libms before its run
+    static std::unordered_set<Value *> existing_values; ///< All values allocated before libms run
+public:
+    /// Sets file into which the snapshot will be written once libms is run.
+    static void set_output_path(ustring path) { output_path = path; }
+    /// \return true if libms run should be recorded and written as a snapshot
+    static bool is_creating() { return !output_path.empty(); }
+
+    /// Records values existing before libms is run.
+    /// This has to be called right before libms vm is run.
+    static void begin(Interpreter *libms_vm);
+    /// Writes snapshot of the heap after libms was run into output path.
+    /// On any unsupported value in the heap error is reported and moss exits.
+    static void write(Interpreter *libms_vm);
+    /// Restores libms heap from snapshot found next to libms.msb.
+    /// \param libms_vm Not yet run libms vm
+    /// \param msb_path Path to libms.msb from which vm's bytecode was read
+    /// \return false if there is no snapshot or it does not match the msb
+    ///         or this interpreter, in which case nothing is modified
+    static bool restore(Interpreter *libms_vm, ustring msb_path);
+};
+
+}
+
+}
+
+#endif//_SNAPSHOT_HPP_
@@ -31,6 +31,10 @@ class MemoryPool;
 class Interpreter;
 class ModuleValue;
 
+namespace snapshot {
+    class LibmsSnapshot;
+}
+
 /// \note Add any new that have object methods to has_methods
 enum class TypeKind {
     INT,
@@ -110,6 +114,7 @@ inline ustring TypeKind2String(TypeKind kind) {
 /// Base class of all values
 class Value {
 protected:
+    friend class snapshot::LibmsSnapshot;
     bool marked;
     
     TypeKind kind;
@@ -327,6 +332,12 @@ public:
         return IntConstants;
     }
 
+    /// \return true if value is always the same object (its identity
+    ///         cannot be told apart from another use of the same constant)
+    static bool is_interned(opcode::IntConst value) {
+        return value >= -5 && value <= 256;
+    }
+
     static IntValue *get(opcode::IntConst value) {
         if (value >= 0 && value <= 256)
             return get_interned()[value];
@@ -519,6 +530,9 @@ public:
 
     StringIterator(StringValue &value);
 
+    /// \return Value which is iterated (it has to be kept alive by gc)
+    StringValue &get_iterated() { return value; }
+
     virtual Value *clone() override {
         return new StringIterator(value);
     }
@@ -685,6 +699,9 @@ public:
 
     ListIterator(ListValue &value);
 
+    /// \return Value which is iterated (it has to be kept alive by gc)
+    ListValue &get_iterated() { return value; }
+
     virtual Value *clone() override {
         return new ListIterator(value);
     }
@@ -716,6 +733,7 @@ public:
     using ValueT = std::vector<std::pair<Value*, Value*>>;
 private:
     friend class DictIterator;
+    friend class snapshot::LibmsSnapshot;
     std::map<Key, ValueT> vals;
     std::vector<Key> insertion_order;
 public:
@@ -924,6 +942,9 @@ public:
 
     DictIterator(DictValue &value);
 
+    /// \return Value which is iterated (it has to be kept alive by gc)
+    DictValue &get_iterated() { return value; }
+
     virtual Value *clone() override {
         return new DictIterator(value);
     }
@@ -996,6 +1017,9 @@ public:
 
     BytesIterator(BytesValue &value);
 
+    /// \return Value which is iterated (it has to be kept alive by gc)
+    BytesValue &get_iterated() { return value; }
+
     virtual Value *clone() override {
         return new BytesIterator(value);
     }
@@ -1021,6 +1045,7 @@ public:
 
 class ClassValue : public Value {
 private:
+    friend class snapshot::LibmsSnapshot;
     std::list<ClassValue *> supers;
 public:
     static const TypeKind ClassType = TypeKind::CLASS;
@@ -1110,6 +1135,7 @@ public:
 
 class SpaceValue : public Value {
 private:
+    friend class snapshot::LibmsSnapshot;
     Interpreter *owner_vm;
     std::list<ModuleValue *> extra_owners; // Since space can be extended its functions may reside in multiple modules.
     bool anonymous;
@@ -1236,6 +1262,7 @@ struct ExceptionCatch;
 
 class FunValue : public Value {
 private:
+    friend class snapshot::LibmsSnapshot;
     std::vector<FunValueArg *> args;
     std::list<MemoryPool *> closures;
     Interpreter *vm;
@@ -1317,9 +1344,14 @@ public:
         return this->closures;
     }
 
+    /// \return true if function was defined within frame p
+    bool has_closure(MemoryPool *p) {
+        return std::find(closures.begin(), closures.end(), p) != closures.end();
+    }
+
     opcode::Address get_body_addr() { return this->body_addr; }
 
-    std::vector<FunValueArg *> get_args() { return this->args; }
+    const std::vector<FunValueArg *> &get_args() const { return this->args; }
 
     Interpreter *get_vm() { return this->vm; }
 
@@ -1474,6 +1506,9 @@ public:
 
     FunctionListIterator(FunValueList &value);
 
+    /// \return Value which is iterated (it has to be kept alive by gc)
+    FunValueList &get_iterated() { return value; }
+
     virtual Value *clone() override {
         return new FunctionListIterator(value);
     }